@@ -13,6 +13,9 @@
 /* Tests will generate files for manual check if this macro is defined */
 #cmakedefine MANUAL_CHECK
 
+/* USDT probes are compiled in if this macro is defined */
+#cmakedefine HAVE_SYS_SDT_H
+
 /* Library installation directory */
 #cmakedefine KURENTO_MODULES_DIR "@CMAKE_INSTALL_PREFIX@/@CMAKE_INSTALL_LIBDIR@/@KURENTO_MODULES_DIR_INSTALL_PREFIX@"
 
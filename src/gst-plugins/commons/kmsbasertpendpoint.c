@@ -34,6 +34,7 @@
 #include "sdpagent/kmssdprtpavpfmediahandler.h"
 #include "kmsremb.h"
 #include "kmsrefstruct.h"
+#include "kmsrtpadaptation.h"
 
 #include <gst/rtp/gstrtpdefs.h>
 #include <gst/rtp/gstrtpbuffer.h>
@@ -41,6 +42,8 @@
 #include <gst/video/video-event.h>
 #include "kmsbufferlacentymeta.h"
 #include "kmsstats.h"
+#include "kmslist.h"
+#include "kmscensus.h"
 
 #include <glib/gstdio.h>
 
@@ -72,8 +75,6 @@ G_DEFINE_TYPE_WITH_CODE (KmsBaseRtpEndpoint, kms_base_rtp_endpoint,
 )
 
 #define JB_INITIAL_LATENCY 0
-#define JB_READY_AUDIO_LATENCY 100
-#define JB_READY_VIDEO_LATENCY 500
 
 #define DEFAULT_MIN_PORT 1
 #define DEFAULT_MAX_PORT G_MAXUINT16
@@ -96,6 +97,46 @@ struct _KmsSSRCStats
   GstElement *jitter_buffer;
 };
 
+typedef struct _KmsRtxCache
+{
+  KmsRefStruct ref;
+  GstElement *queue;            /* weak, owned by rtpbin */
+  gint size;                    /* packets */
+  guint64 memory;               /* bytes accounted in the rtx memory budget */
+  gint highest_seq;
+  gint packets;
+  gint requests;
+  gint hits;
+} KmsRtxCache;
+
+typedef struct _KmsFecControl
+{
+  KmsRefStruct ref;
+  GstElement *encoder;          /* weak, owned by rtpbin */
+  gboolean nack;
+  guint percentage;
+} KmsFecControl;
+
+/* Sender side feedback of a session, taken from RTCP reports */
+typedef struct _KmsSendFeedback
+{
+  guint64 bitrate;
+  guint64 octets;
+  guint64 packets;
+  guint rtt;                    /* NTP short format, worst receiver */
+  guint fraction_lost;          /* 1/256 units, worst receiver */
+} KmsSendFeedback;
+
+typedef struct _KmsJitterControl
+{
+  guint min_latency;
+  guint max_latency;
+  guint64 late;
+  gint lost;
+} KmsJitterControl;
+
+G_DEFINE_QUARK (kms-jitter-control, kms_jitter_control);
+
 typedef struct _KmsRTPSessionStats KmsRTPSessionStats;
 
 struct _KmsRTPSessionStats
@@ -103,6 +144,8 @@ struct _KmsRTPSessionStats
   GObject *rtp_session;
   GstSDPDirection direction;
   GSList *ssrcs;                /* list of all jitter buffers associated to a ssrc */
+  KmsRtxCache *rtx_cache;
+  KmsFecControl *fec;
 };
 
 typedef struct _KmsBaseRTPStats KmsBaseRTPStats;
@@ -126,6 +169,7 @@ typedef struct _ExtData
 typedef struct _E2EProbeData
 {
   gchar *id;
+  GQuark quark;
   StreamE2EAvgStat *stat;
 } E2EProbeData;
 
@@ -210,6 +254,142 @@ ext_data_new ()
   return edata;
 }
 
+static void
+kms_rtx_cache_destroy (KmsRtxCache * cache)
+{
+  kms_rtx_history_release (&cache->memory);
+
+  if (cache->queue != NULL) {
+    g_object_remove_weak_pointer (G_OBJECT (cache->queue),
+        (gpointer *) & cache->queue);
+  }
+
+  g_slice_free (KmsRtxCache, cache);
+}
+
+static KmsRtxCache *
+kms_rtx_cache_new (GstElement * queue, guint size)
+{
+  KmsRtxCache *cache;
+
+  cache = g_slice_new0 (KmsRtxCache);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (cache),
+      (GDestroyNotify) kms_rtx_cache_destroy);
+
+  cache->queue = queue;
+  g_object_add_weak_pointer (G_OBJECT (queue), (gpointer *) & cache->queue);
+  /* Charge the initial history against the budget until it is resized */
+  cache->size = kms_rtx_history_get_initial_size (&cache->memory, size);
+  g_object_set (queue, "max-size-packets", cache->size, NULL);
+  cache->highest_seq = -1;
+
+  return cache;
+}
+
+static void
+kms_fec_control_destroy (KmsFecControl * fec)
+{
+  if (fec->encoder != NULL) {
+    g_object_remove_weak_pointer (G_OBJECT (fec->encoder),
+        (gpointer *) & fec->encoder);
+  }
+
+  g_slice_free (KmsFecControl, fec);
+}
+
+static KmsFecControl *
+kms_fec_control_new (GstElement * encoder, gboolean nack)
+{
+  KmsFecControl *fec;
+
+  fec = g_slice_new0 (KmsFecControl);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (fec),
+      (GDestroyNotify) kms_fec_control_destroy);
+
+  fec->encoder = encoder;
+  g_object_add_weak_pointer (G_OBJECT (encoder), (gpointer *) & fec->encoder);
+  fec->nack = nack;
+  g_object_get (encoder, "percentage", &fec->percentage, NULL);
+
+  return fec;
+}
+
+static GstPadProbeReturn
+kms_rtx_cache_packet_probe (GstPad * pad, GstPadProbeInfo * info,
+    KmsRtxCache * cache)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  g_atomic_int_set (&cache->highest_seq, gst_rtp_buffer_get_seq (&rtp));
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (g_atomic_int_get (&cache->packets) < G_MAXINT) {
+    g_atomic_int_inc (&cache->packets);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+kms_rtx_cache_request_probe (GstPad * pad, GstPadProbeInfo * info,
+    KmsRtxCache * cache)
+{
+  GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  const GstStructure *st;
+  guint seqnum, stored;
+  gint highest;
+
+  if (GST_EVENT_TYPE (event) != GST_EVENT_CUSTOM_UPSTREAM) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  st = gst_event_get_structure (event);
+
+  if (!gst_structure_has_name (st, "GstRTPRetransmissionRequest") ||
+      !gst_structure_get_uint (st, "seqnum", &seqnum)) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  g_atomic_int_inc (&cache->requests);
+
+  /* rtprtxqueue keeps the last max-size-packets packets, so the request */
+  /* is answered if it is not older than that                           */
+  highest = g_atomic_int_get (&cache->highest_seq);
+  stored = MIN (g_atomic_int_get (&cache->packets),
+      g_atomic_int_get (&cache->size));
+
+  if (highest >= 0 && (guint16) (highest - seqnum) < stored) {
+    g_atomic_int_inc (&cache->hits);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+kms_rtx_cache_add_probes (KmsRtxCache * cache)
+{
+  GstPad *pad;
+
+  pad = gst_element_get_static_pad (cache->queue, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) kms_rtx_cache_packet_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (cache)),
+      (GDestroyNotify) kms_ref_struct_unref);
+  g_object_unref (pad);
+
+  pad = gst_element_get_static_pad (cache->queue, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM,
+      (GstPadProbeCallback) kms_rtx_cache_request_probe,
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (cache)),
+      (GDestroyNotify) kms_ref_struct_unref);
+  g_object_unref (pad);
+}
+
 static SSRCSyncData *
 ssrc_sync_data_new (KmsBaseRtpEndpoint * self, guint ssrc)
 {
@@ -710,6 +890,14 @@ rtp_session_stats_destroy (KmsRTPSessionStats * stats)
 
   g_clear_object (&stats->rtp_session);
 
+  if (stats->rtx_cache != NULL) {
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (stats->rtx_cache));
+  }
+
+  if (stats->fec != NULL) {
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (stats->fec));
+  }
+
   g_slice_free (KmsRTPSessionStats, stats);
 }
 
@@ -1311,21 +1499,17 @@ end:
 
 static void
 add_mark_data_cb (GstPad * pad, KmsMediaType type, GstClockTimeDiff t,
-    KmsList * meta_data, gpointer user_data)
+    KmsBufferLatencyMeta * meta, gpointer user_data)
 {
   E2EProbeData *data = (E2EProbeData *) user_data;
 
-  StreamE2EAvgStat *stat;
-
-  stat = kms_list_lookup (meta_data, data->id);
-
-  if (stat != NULL) {
+  if (kms_buffer_latency_meta_lookup_mark (meta, data->quark) != NULL) {
     GST_WARNING_OBJECT (pad, "Can not mark buffer for e2e latency. "
         "Already used ID: %s", data->id);
   } else {
     /* add mark data to this meta */
-    kms_list_prepend (meta_data, g_strdup (data->id),
-        kms_stats_stream_e2e_avg_stat_ref (data->stat));
+    kms_buffer_latency_meta_add_mark (meta, data->quark,
+        KMS_REF_STRUCT_CAST (data->stat));
   }
 }
 
@@ -1367,12 +1551,13 @@ kms_base_rtp_endpoint_configure_2e2_latency (KmsBaseRtpEndpoint * self,
 
   data = e2e_probe_data_new ();
   data->id = id;
+  data->quark = kms_stats_get_element_latency_mark (GST_ELEMENT (self));
   data->stat = kms_stats_stream_e2e_avg_stat_ref (stat);
 
   KMS_ELEMENT_UNLOCK (self);
 
-  kms_stats_add_buffer_latency_notification_probe (pad, add_mark_data_cb,
-      TRUE /* lock the data */ , data, (GDestroyNotify) e2e_probe_data_destroy);
+  kms_stats_add_buffer_latency_notification_probe_full (pad, add_mark_data_cb,
+      data, (GDestroyNotify) e2e_probe_data_destroy);
 }
 
 static void
@@ -2029,6 +2214,7 @@ kms_base_rtp_endpoint_rtpbin_pad_added (GstElement * rtpbin, GstPad * pad,
 
     if (self->priv->rl != NULL) {
       self->priv->rl->event_manager = kms_utils_remb_event_manager_create (pad);
+      kms_census_add (KMS_CENSUS_REMB_EVENT_MANAGER);
     }
   } else {
     added = FALSE;
@@ -2102,6 +2288,105 @@ end:
   }
 }
 
+static void
+kms_jitter_control_destroy (KmsJitterControl * ctrl)
+{
+  g_slice_free (KmsJitterControl, ctrl);
+}
+
+static void
+kms_jitter_control_set_limits (KmsJitterControl * ctrl, guint session,
+    const KmsLatencySettings * settings)
+{
+  if (session == VIDEO_RTP_SESSION) {
+    ctrl->min_latency = settings->jb_video_min_latency;
+    ctrl->max_latency = settings->jb_video_max_latency;
+  } else {
+    ctrl->min_latency = settings->jb_audio_min_latency;
+    ctrl->max_latency = settings->jb_audio_max_latency;
+  }
+}
+
+static void
+kms_jitter_control_attach (GstElement * jitterbuffer, guint session,
+    const KmsLatencySettings * settings)
+{
+  KmsJitterControl *ctrl;
+
+  ctrl = g_slice_new0 (KmsJitterControl);
+  kms_jitter_control_set_limits (ctrl, session, settings);
+
+  g_object_set_qdata_full (G_OBJECT (jitterbuffer), kms_jitter_control_quark (),
+      ctrl, (GDestroyNotify) kms_jitter_control_destroy);
+}
+
+/* Moves the latency of @jitterbuffer towards the interarrival jitter of */
+/* @source within the limits of the latency profile */
+static void
+kms_jitter_control_update (GstElement * jitterbuffer, GObject * source,
+    guint session, const KmsLatencySettings * settings)
+{
+  KmsJitterControl *ctrl;
+  GstStructure *jb_stats = NULL, *src_stats;
+  guint64 late = 0, rtx_rtt = 0;
+  guint latency, target, jitter_ms, jitter = 0;
+  gint clock_rate = 0, lost = 0;
+  gboolean rtx = FALSE, growing;
+
+  ctrl = g_object_get_qdata (G_OBJECT (jitterbuffer),
+      kms_jitter_control_quark ());
+
+  if (ctrl == NULL) {
+    return;
+  }
+
+  /* The latency profile may have changed since the last update */
+  kms_jitter_control_set_limits (ctrl, session, settings);
+
+  g_object_get (jitterbuffer, "latency", &latency, "do-retransmission", &rtx,
+      "stats", &jb_stats, NULL);
+
+  if (latency == JB_INITIAL_LATENCY) {
+    /* No media yet, latency not configured */
+    goto end;
+  }
+
+  g_object_get (source, "stats", &src_stats, NULL);
+  gst_structure_get (src_stats, "jitter", G_TYPE_UINT, &jitter, "clock-rate",
+      G_TYPE_INT, &clock_rate, "packets-lost", G_TYPE_INT, &lost, NULL);
+  gst_structure_free (src_stats);
+
+  if (clock_rate <= 0) {
+    goto end;
+  }
+
+  if (jb_stats != NULL) {
+    /* Not all versions of rtpjitterbuffer provide these fields */
+    gst_structure_get_uint64 (jb_stats, "num-late", &late);
+    gst_structure_get_uint64 (jb_stats, "rtx-rtt", &rtx_rtt);
+  }
+
+  growing = late > ctrl->late || (rtx && lost > ctrl->lost);
+  ctrl->late = late;
+  ctrl->lost = lost;
+
+  /* jitter is computed in timestamp units */
+  jitter_ms = (guint64) jitter * 1000 / clock_rate;
+  target = kms_jitter_buffer_get_latency (latency, ctrl->min_latency,
+      ctrl->max_latency, jitter_ms, rtx ? rtx_rtt / GST_MSECOND : 0, growing);
+
+  if (target != latency) {
+    GST_DEBUG_OBJECT (jitterbuffer, "Latency %u -> %u ms (jitter %u ms, late %"
+        G_GUINT64_FORMAT ", lost %d)", latency, target, jitter_ms, late, lost);
+    g_object_set (jitterbuffer, "latency", target, NULL);
+  }
+
+end:
+  if (jb_stats != NULL) {
+    gst_structure_free (jb_stats);
+  }
+}
+
 static GstPadProbeReturn
 kms_base_rtp_endpoint_change_latency_probe (GstPad * pad,
     GstPadProbeInfo * info, gpointer user_data)
@@ -2203,6 +2488,8 @@ kms_base_rtp_endpoint_rtpbin_new_jitterbuffer (GstElement * rtpbin,
 
   SSRCSyncData *ssrcsyncdata = 0;
 
+  const KmsLatencySettings *settings;
+
   if (session == AUDIO_RTP_SESSION) {
     GSList *item = g_slist_nth (self->priv->ssrc_sync_list, 0);
 
@@ -2242,16 +2529,21 @@ kms_base_rtp_endpoint_rtpbin_new_jitterbuffer (GstElement * rtpbin,
     g_assert_not_reached ();
   }
 
+  settings =
+      kms_latency_profile_get_settings (kms_element_get_latency_profile
+      (KMS_ELEMENT (self)));
+
   g_object_set (jitterbuffer, "mode", 4 /* synced */ ,
       "latency", JB_INITIAL_LATENCY, NULL);
+  kms_jitter_control_attach (jitterbuffer, session, settings);
 
   src_pad = gst_element_get_static_pad (jitterbuffer, "src");
   gst_pad_add_probe (src_pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
       kms_base_rtp_endpoint_change_latency_probe,
       GINT_TO_POINTER (session ==
-          VIDEO_RTP_SESSION ? JB_READY_VIDEO_LATENCY : JB_READY_AUDIO_LATENCY),
-      NULL);
+          VIDEO_RTP_SESSION ? settings->jb_video_latency :
+          settings->jb_audio_latency), NULL);
 
   gst_pad_add_probe (src_pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
@@ -2406,6 +2698,28 @@ set_outbound_additional_params (const GstStructure * session_stats,
       "outbound-packet-lost", G_TYPE_INT, packet_lost, NULL);
 }
 
+static void
+set_rtx_params (const GstStructure * session_stats, const gchar * ssrc_id,
+    KmsRtxCache * cache)
+{
+  const GstStructure *ssrc_stats;
+  guint requests, hits;
+
+  ssrc_stats = get_structure_from_id (session_stats, ssrc_id);
+
+  if (ssrc_stats == NULL) {
+    return;
+  }
+
+  hits = g_atomic_int_get (&cache->hits);
+  requests = g_atomic_int_get (&cache->requests);
+
+  gst_structure_set ((GstStructure *) ssrc_stats, "rtx-history-size",
+      G_TYPE_UINT, g_atomic_int_get (&cache->size), "rtx-requests",
+      G_TYPE_UINT, requests, "rtx-hits", G_TYPE_UINT, hits, "rtx-misses",
+      G_TYPE_UINT, requests - hits, NULL);
+}
+
 static gboolean
 filter_rtp_source (GstSDPDirection direction, gboolean internal)
 {
@@ -2521,6 +2835,11 @@ append_rtp_session_stats (gpointer * session, KmsRTPSessionStats * rtp_stats,
   if (ssrc_id != NULL) {
     set_outbound_additional_params (session_stats, ssrc_id, rtt, f_lost,
         p_lost);
+
+    if (rtp_stats->rtx_cache != NULL) {
+      set_rtx_params (session_stats, ssrc_id, rtp_stats->rtx_cache);
+    }
+
     g_free (ssrc_id);
   }
 
@@ -2630,6 +2949,9 @@ kms_base_rtp_endpoint_set_property (GObject * object, guint property_id,
       }
 
       self->priv->max_video_send_bw = v;
+      if (self->priv->rm != NULL) {
+        kms_remb_remote_set_max_bw (self->priv->rm, v);
+      }
       break;
     }
     case PROP_REMB_PARAMS:
@@ -3396,6 +3718,200 @@ kms_base_rtp_endpoint_rtpbin_on_timeout (GstElement * rtpbin,
       KMS_MEDIA_STATE_DISCONNECTED);
 }
 
+/*
+ * Only the media sender is taken into account: the session may have other
+ * internal sources (e.g. retransmissions) whose reports must not be mixed.
+ */
+static void
+rtp_session_get_send_feedback (GObject * rtpsession, KmsSendFeedback * fb)
+{
+  GValueArray *arr;
+  guint i, local_ssrc;
+
+  memset (fb, 0, sizeof (KmsSendFeedback));
+
+  g_object_get (rtpsession, "internal-ssrc", &local_ssrc, "sources", &arr,
+      NULL);
+
+  for (i = 0; i < arr->n_values; i++) {
+    GstStructure *ssrc_stats;
+    gboolean internal = FALSE, have_rb = FALSE;
+    GObject *source;
+    guint ssrc = 0, rb_ssrc = 0, rtt = 0, fraction_lost = 0;
+
+    source = g_value_get_object (g_value_array_get_nth (arr, i));
+    g_object_get (source, "stats", &ssrc_stats, NULL);
+    gst_structure_get (ssrc_stats, "internal", G_TYPE_BOOLEAN, &internal,
+        "ssrc", G_TYPE_UINT, &ssrc, NULL);
+
+    if (internal) {
+      if (ssrc == local_ssrc) {
+        gst_structure_get (ssrc_stats, "bitrate", G_TYPE_UINT64, &fb->bitrate,
+            "octets-sent", G_TYPE_UINT64, &fb->octets, "packets-sent",
+            G_TYPE_UINT64, &fb->packets, NULL);
+      }
+    } else if (gst_structure_get (ssrc_stats, "have-rb", G_TYPE_BOOLEAN,
+            &have_rb, "rb-ssrc", G_TYPE_UINT, &rb_ssrc, NULL) && have_rb
+        && rb_ssrc == local_ssrc
+        && gst_structure_get (ssrc_stats, "rb-round-trip", G_TYPE_UINT, &rtt,
+            "rb-fractionlost", G_TYPE_UINT, &fraction_lost, NULL)) {
+      /* Protect for the worst receiver */
+      fb->rtt = MAX (fb->rtt, rtt);
+      fb->fraction_lost = MAX (fb->fraction_lost, fraction_lost);
+    }
+
+    gst_structure_free (ssrc_stats);
+  }
+
+  g_value_array_free (arr);
+}
+
+static void
+kms_rtx_cache_update (KmsRtxCache * cache, KmsSendFeedback * fb,
+    guint session)
+{
+  gint size;
+
+  if (fb->rtt == 0 || fb->packets == 0 || fb->bitrate == 0) {
+    /* Nothing measured yet, keep current size */
+    return;
+  }
+
+  size = kms_rtx_history_get_size (&cache->memory, fb->rtt, fb->bitrate,
+      fb->octets / fb->packets);
+
+  if (size != g_atomic_int_get (&cache->size) && cache->queue != NULL) {
+    GST_DEBUG_OBJECT (cache->queue, "Session %u retransmission history: %d "
+        "packets (rtt %u ms at %" G_GUINT64_FORMAT " bps)", session, size,
+        (guint) ((guint64) fb->rtt * 1000 >> 16), fb->bitrate);
+    g_atomic_int_set (&cache->size, size);
+    g_object_set (cache->queue, "max-size-packets", size, NULL);
+  }
+}
+
+static void
+kms_fec_control_update (KmsFecControl * fec, KmsSendFeedback * fb,
+    guint available_bw, guint session)
+{
+  guint percentage;
+
+  if (fb->rtt == 0 || fb->bitrate == 0 || fec->encoder == NULL) {
+    return;
+  }
+
+  percentage = kms_fec_get_percentage (fec->percentage, fec->nack, fb->rtt,
+      fb->fraction_lost, fb->bitrate, available_bw);
+
+  if (percentage == fec->percentage) {
+    return;
+  }
+
+  GST_DEBUG_OBJECT (fec->encoder, "Session %u FEC protection %u%% (loss %u%%,"
+      " rtt %u ms, sent %" G_GUINT64_FORMAT " bps, available %u bps)", session,
+      percentage, fb->fraction_lost * 100 / 256,
+      (guint) ((guint64) fb->rtt * 1000 >> 16), fb->bitrate, available_bw);
+
+  fec->percentage = percentage;
+  g_object_set (fec->encoder, "percentage", percentage, NULL);
+}
+
+static void
+kms_base_rtp_endpoint_update_send_protection (KmsBaseRtpEndpoint * self,
+    guint session)
+{
+  KmsRTPSessionStats *rtp_stats;
+  GObject *rtpsession = NULL;
+  KmsRtxCache *cache = NULL;
+  KmsFecControl *fec = NULL;
+  guint available_bw = 0;
+  KmsSendFeedback fb;
+
+  KMS_ELEMENT_LOCK (self);
+
+  rtp_stats = g_hash_table_lookup (self->priv->stats.rtp_stats,
+      GUINT_TO_POINTER (session));
+
+  if (rtp_stats != NULL && rtp_stats->rtx_cache != NULL) {
+    cache = (KmsRtxCache *)
+        kms_ref_struct_ref (KMS_REF_STRUCT_CAST (rtp_stats->rtx_cache));
+  }
+
+  if (rtp_stats != NULL && rtp_stats->fec != NULL) {
+    fec = (KmsFecControl *)
+        kms_ref_struct_ref (KMS_REF_STRUCT_CAST (rtp_stats->fec));
+  }
+
+  if (cache != NULL || fec != NULL) {
+    rtpsession = g_object_ref (rtp_stats->rtp_session);
+  }
+
+  if (session == VIDEO_RTP_SESSION && self->priv->rm != NULL) {
+    /* Updated by the REMB manager when RTCP is received */
+    available_bw = g_atomic_int_get (&self->priv->rm->remb);
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  if (rtpsession == NULL) {
+    return;
+  }
+
+  rtp_session_get_send_feedback (rtpsession, &fb);
+  g_object_unref (rtpsession);
+
+  if (cache != NULL) {
+    kms_rtx_cache_update (cache, &fb, session);
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (cache));
+  }
+
+  if (fec != NULL) {
+    kms_fec_control_update (fec, &fb, available_bw, session);
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (fec));
+  }
+}
+
+static void
+kms_base_rtp_endpoint_update_jitterbuffer (KmsBaseRtpEndpoint * self,
+    guint session, guint ssrc)
+{
+  KmsRTPSessionStats *rtp_stats;
+  GstElement *jitterbuffer = NULL;
+  GObject *rtpsession = NULL, *source = NULL;
+
+  KMS_ELEMENT_LOCK (self);
+
+  rtp_stats = g_hash_table_lookup (self->priv->stats.rtp_stats,
+      GUINT_TO_POINTER (session));
+
+  if (rtp_stats != NULL) {
+    jitterbuffer = rtp_session_stats_get_jitter_buffer (rtp_stats, ssrc);
+  }
+
+  if (jitterbuffer != NULL) {
+    gst_object_ref (jitterbuffer);
+    rtpsession = g_object_ref (rtp_stats->rtp_session);
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  if (jitterbuffer == NULL) {
+    /* Not a remote sender */
+    return;
+  }
+
+  g_signal_emit_by_name (rtpsession, "get-source-by-ssrc", ssrc, &source);
+
+  if (source != NULL) {
+    kms_jitter_control_update (jitterbuffer, source, session,
+        kms_latency_profile_get_settings (kms_element_get_latency_profile
+            (KMS_ELEMENT (self))));
+    g_object_unref (source);
+  }
+
+  g_object_unref (rtpsession);
+  gst_object_unref (jitterbuffer);
+}
+
 static void
 kms_base_rtp_endpoint_rtpbin_on_ssrc_active (GstElement * rtpbin,
     guint session, guint ssrc, gpointer user_data)
@@ -3404,6 +3920,10 @@ kms_base_rtp_endpoint_rtpbin_on_ssrc_active (GstElement * rtpbin,
 
   kms_base_rtp_endpoint_set_media_state (self, session,
       KMS_MEDIA_STATE_CONNECTED);
+
+  /* RTCP received, RTT, loss and bitrate estimations may have changed */
+  kms_base_rtp_endpoint_update_send_protection (self, session);
+  kms_base_rtp_endpoint_update_jitterbuffer (self, session, ssrc);
 }
 
 static GstElement *
@@ -3531,6 +4051,8 @@ static GstElement *
 kms_base_rtp_endpoint_create_aux_sender (KmsBaseRtpEndpoint * self,
     guint session, ExtData * edata)
 {
+  KmsRTPSessionStats *rtp_stats;
+
   GSList *list = NULL;
 
   GstElement *e;
@@ -3539,6 +4061,18 @@ kms_base_rtp_endpoint_create_aux_sender (KmsBaseRtpEndpoint * self,
   g_object_set (e, "max-size-packets", RTP_RTX_SIZE, NULL);
   list = g_slist_prepend (list, e);
 
+  rtp_stats = g_hash_table_lookup (self->priv->stats.rtp_stats,
+      GUINT_TO_POINTER (session));
+
+  if (rtp_stats != NULL) {
+    if (rtp_stats->rtx_cache != NULL) {
+      kms_ref_struct_unref (KMS_REF_STRUCT_CAST (rtp_stats->rtx_cache));
+    }
+
+    rtp_stats->rtx_cache = kms_rtx_cache_new (e, RTP_RTX_SIZE);
+    kms_rtx_cache_add_probes (rtp_stats->rtx_cache);
+  }
+
   if (edata == NULL) {
     GST_DEBUG_OBJECT (self, "Session '%u' not protected", session);
     goto end;
@@ -3556,6 +4090,18 @@ kms_base_rtp_endpoint_create_aux_sender (KmsBaseRtpEndpoint * self,
     /* in our side. Uncomment this when this issue is fixed.                */
 //    g_object_set (e, "pt", edata->ulpfec_pt, NULL);
     list = g_slist_prepend (list, e);
+
+    if (rtp_stats != NULL && g_object_class_find_property (G_OBJECT_GET_CLASS
+            (e), "percentage") != NULL) {
+      gboolean nack = session == VIDEO_RTP_SESSION &&
+          kms_base_rtp_endpoint_is_video_rtcp_nack (self);
+
+      if (rtp_stats->fec != NULL) {
+        kms_ref_struct_unref (KMS_REF_STRUCT_CAST (rtp_stats->fec));
+      }
+
+      rtp_stats->fec = kms_fec_control_new (e, nack);
+    }
   }
 
 end:
@@ -23,6 +23,7 @@
 #include "constants.h"
 #include "kmsutils.h"
 #include "sdp_utils.h"
+#include "kmscensus.h"
 
 #include "kms-core-enumtypes.h"
 #include "kms-core-marshal.h"
@@ -193,30 +194,33 @@ kms_base_rtp_session_create_bundle_connection_default (KmsBaseRtpSession *
 
 static void
 kms_base_rtp_session_e2e_latency_cb (GstPad * pad, KmsMediaType type,
-    GstClockTimeDiff t, KmsList * mdata, gpointer user_data)
+    GstClockTimeDiff t, KmsBufferLatencyMeta * meta, gpointer user_data)
 {
   KmsBaseRtpSession *self = KMS_BASE_RTP_SESSION (user_data);
+  StreamE2EAvgStat *stat;
+  GQuark mark;
 
-  KmsListIter iter;
-
-  gpointer key, value;
-
-  gchar *name;
-
-  name = gst_element_get_name (KMS_SDP_SESSION (self)->ep);
+  mark = kms_stats_get_element_latency_mark (KMS_SDP_SESSION (self)->ep);
+  stat = (StreamE2EAvgStat *) kms_buffer_latency_meta_lookup_mark (meta, mark);
 
-  kms_list_iter_init (&iter, mdata);
-  while (kms_list_iter_next (&iter, &key, &value)) {
-    gchar *id = (gchar *) key;
+  if (stat != NULL) {
+    stat->avg = KMS_STATS_CALCULATE_LATENCY_AVG (t, stat->avg);
+  }
+}
 
-    StreamE2EAvgStat *stat;
+/* For connections that only implement the deprecated callback */
+static void
+kms_base_rtp_session_e2e_latency_legacy_cb (GstPad * pad, KmsMediaType type,
+    GstClockTimeDiff t, KmsList * mdata, gpointer user_data)
+{
+  KmsBaseRtpSession *self = KMS_BASE_RTP_SESSION (user_data);
+  StreamE2EAvgStat *stat;
+  GQuark mark;
 
-    if (!g_str_has_prefix (id, name)) {
-      /* This element did not add this mark to the metada */
-      continue;
-    }
+  mark = kms_stats_get_element_latency_mark (KMS_SDP_SESSION (self)->ep);
+  stat = kms_list_lookup (mdata, (gpointer) g_quark_to_string (mark));
 
-    stat = (StreamE2EAvgStat *) value;
+  if (stat != NULL) {
     stat->avg = KMS_STATS_CALCULATE_LATENCY_AVG (t, stat->avg);
   }
 }
@@ -225,8 +229,11 @@ static void
 kms_base_rtp_session_set_connection_stats (KmsBaseRtpSession * self,
     KmsIRtpConnection * conn)
 {
-  kms_i_rtp_connection_set_latency_callback (conn,
-      kms_base_rtp_session_e2e_latency_cb, self);
+  if (!kms_i_rtp_connection_set_latency_meta_callback (conn,
+          kms_base_rtp_session_e2e_latency_cb, self)) {
+    kms_i_rtp_connection_set_latency_callback (conn,
+        kms_base_rtp_session_e2e_latency_legacy_cb, self);
+  }
 
   /* Active insertion of metadata if stats are enabled */
   kms_i_rtp_connection_collect_latency_stats (conn, self->stats_enabled);
@@ -847,6 +854,8 @@ kms_base_rtp_session_finalize (GObject * object)
 
   g_hash_table_destroy (self->conns);
 
+  kms_census_remove (KMS_CENSUS_RTP_SESSION);
+
   /* chain up */
   G_OBJECT_CLASS (kms_base_rtp_session_parent_class)->finalize (object);
 }
@@ -869,6 +878,8 @@ kms_base_rtp_session_init (KmsBaseRtpSession * self)
       g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_object_unref);
 
   self->stats_enabled = FALSE;
+
+  kms_census_add (KMS_CENSUS_RTP_SESSION);
 }
 
 static void
@@ -15,7 +15,8 @@
  *
  */
 
-#include "kmsrefstruct.h"
+#include <string.h>
+
 #include "kmsbufferlacentymeta.h"
 
 GType
@@ -41,14 +42,20 @@ kms_buffer_latency_meta_init (GstMeta * meta, gpointer params,
 
   lmeta->ts = GST_CLOCK_TIME_NONE;
   lmeta->valid = FALSE;
-
-  g_rec_mutex_init (&lmeta->datamutex);
-  lmeta->data = kms_list_new_full (g_str_equal, g_free,
-      (GDestroyNotify) kms_ref_struct_unref);
+  lmeta->n_marks = 0;
+  memset (lmeta->marks, 0, sizeof (lmeta->marks));
+  g_mutex_init (&lmeta->overflow_mutex);
+  lmeta->overflow = NULL;
 
   return TRUE;
 }
 
+static void
+copy_mark (GQuark id, KmsRefStruct * data, KmsBufferLatencyMeta * new_meta)
+{
+  kms_buffer_latency_meta_add_mark (new_meta, id, data);
+}
+
 static gboolean
 kms_buffer_latency_meta_transform (GstBuffer * transbuf, GstMeta * meta,
     GstBuffer * buffer, GQuark type, gpointer data)
@@ -68,13 +75,8 @@ kms_buffer_latency_meta_transform (GstBuffer * transbuf, GstMeta * meta,
     return FALSE;
   }
 
-  if (new_meta->data != NULL) {
-    kms_list_unref (new_meta->data);
-  }
-
-  KMS_BUFFER_LATENCY_DATA_LOCK (lmeta);
-  new_meta->data = kms_list_ref (lmeta->data);
-  KMS_BUFFER_LATENCY_DATA_UNLOCK (lmeta);
+  kms_buffer_latency_meta_foreach_mark (lmeta,
+      (KmsBufferLatencyMarkFunc) copy_mark, new_meta);
 
   return TRUE;
 }
@@ -83,12 +85,25 @@ static void
 kms_buffer_latency_meta_free (GstMeta * meta, GstBuffer * buffer)
 {
   KmsBufferLatencyMeta *lmeta = (KmsBufferLatencyMeta *) meta;
+  gint i, n_marks;
+  guint j;
+
+  n_marks = MIN (lmeta->n_marks, KMS_BUFFER_LATENCY_META_MAX_MARKS);
+  for (i = 0; i < n_marks; i++) {
+    if (lmeta->marks[i].id != 0) {
+      kms_ref_struct_unref (lmeta->marks[i].data);
+    }
+  }
 
-  KMS_BUFFER_LATENCY_DATA_LOCK (lmeta);
-  kms_list_unref (lmeta->data);
-  KMS_BUFFER_LATENCY_DATA_UNLOCK (lmeta);
+  if (lmeta->overflow != NULL) {
+    for (j = 0; j < lmeta->overflow->len; j++) {
+      kms_ref_struct_unref (g_array_index (lmeta->overflow,
+              KmsBufferLatencyMark, j).data);
+    }
+    g_array_free (lmeta->overflow, TRUE);
+  }
 
-  g_rec_mutex_clear (&lmeta->datamutex);
+  g_mutex_clear (&lmeta->overflow_mutex);
 }
 
 const GstMetaInfo *
@@ -127,3 +142,125 @@ kms_buffer_add_buffer_latency_meta (GstBuffer * buffer, GstClockTime ts,
 
   return meta;
 }
+
+/*
+ * The same buffer can be marked from several branches at the same time, so a
+ * slot is reserved atomically and its id is published once data is set.
+ */
+gboolean
+kms_buffer_latency_meta_add_mark (KmsBufferLatencyMeta * meta, GQuark id,
+    KmsRefStruct * data)
+{
+  KmsBufferLatencyMark *mark, overflow_mark;
+  gint idx;
+
+  g_return_val_if_fail (meta != NULL, FALSE);
+  g_return_val_if_fail (id != 0, FALSE);
+
+  idx = g_atomic_int_add (&meta->n_marks, 1);
+  if (G_LIKELY (idx < KMS_BUFFER_LATENCY_META_MAX_MARKS)) {
+    mark = &meta->marks[idx];
+    mark->data = kms_ref_struct_ref (data);
+    g_atomic_int_set (&mark->id, id);
+
+    return TRUE;
+  }
+
+  overflow_mark.id = id;
+  overflow_mark.data = kms_ref_struct_ref (data);
+
+  g_mutex_lock (&meta->overflow_mutex);
+  if (meta->overflow == NULL) {
+    meta->overflow = g_array_new (FALSE, FALSE, sizeof (KmsBufferLatencyMark));
+  }
+  g_array_append_val (meta->overflow, overflow_mark);
+  g_mutex_unlock (&meta->overflow_mutex);
+
+  return TRUE;
+}
+
+KmsRefStruct *
+kms_buffer_latency_meta_lookup_mark (KmsBufferLatencyMeta * meta, GQuark id)
+{
+  KmsRefStruct *data = NULL;
+  gint i, n_marks;
+  guint j;
+
+  g_return_val_if_fail (meta != NULL, NULL);
+
+  n_marks = g_atomic_int_get (&meta->n_marks);
+  for (i = 0; i < MIN (n_marks, KMS_BUFFER_LATENCY_META_MAX_MARKS); i++) {
+    if (g_atomic_int_get (&meta->marks[i].id) == id) {
+      return meta->marks[i].data;
+    }
+  }
+
+  if (n_marks <= KMS_BUFFER_LATENCY_META_MAX_MARKS) {
+    return NULL;
+  }
+
+  g_mutex_lock (&meta->overflow_mutex);
+  for (j = 0; meta->overflow != NULL && j < meta->overflow->len; j++) {
+    KmsBufferLatencyMark *mark =
+        &g_array_index (meta->overflow, KmsBufferLatencyMark, j);
+
+    if (mark->id == id) {
+      data = mark->data;
+      break;
+    }
+  }
+  g_mutex_unlock (&meta->overflow_mutex);
+
+  return data;
+}
+
+void
+kms_buffer_latency_meta_foreach_mark (KmsBufferLatencyMeta * meta,
+    KmsBufferLatencyMarkFunc func, gpointer user_data)
+{
+  GArray *overflow = NULL;
+  gint i, n_marks;
+  guint j;
+
+  g_return_if_fail (meta != NULL);
+
+  n_marks = g_atomic_int_get (&meta->n_marks);
+  for (i = 0; i < MIN (n_marks, KMS_BUFFER_LATENCY_META_MAX_MARKS); i++) {
+    GQuark id = g_atomic_int_get (&meta->marks[i].id);
+
+    if (id != 0) {
+      func (id, meta->marks[i].data, user_data);
+    }
+  }
+
+  if (n_marks <= KMS_BUFFER_LATENCY_META_MAX_MARKS) {
+    return;
+  }
+
+  /* Work on a copy, so that func is free to add marks */
+  g_mutex_lock (&meta->overflow_mutex);
+  if (meta->overflow != NULL) {
+    overflow = g_array_sized_new (FALSE, FALSE, sizeof (KmsBufferLatencyMark),
+        meta->overflow->len);
+    g_array_append_vals (overflow, meta->overflow->data, meta->overflow->len);
+    for (j = 0; j < overflow->len; j++) {
+      kms_ref_struct_ref (g_array_index (overflow, KmsBufferLatencyMark,
+              j).data);
+    }
+  }
+  g_mutex_unlock (&meta->overflow_mutex);
+
+  if (overflow == NULL) {
+    return;
+  }
+
+  for (j = 0; j < overflow->len; j++) {
+    KmsBufferLatencyMark *mark =
+        &g_array_index (overflow, KmsBufferLatencyMark, j);
+
+    func (mark->id, mark->data, user_data);
+    kms_ref_struct_unref (mark->data);
+  }
+
+  g_array_free (overflow, TRUE);
+}
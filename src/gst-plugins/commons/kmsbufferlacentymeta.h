@@ -21,11 +21,19 @@
 #include <gst/gst.h>
 
 #include "kmsmediatype.h"
-#include "kmslist.h"
+#include "kmsrefstruct.h"
 
 G_BEGIN_DECLS
 
+#define KMS_BUFFER_LATENCY_META_MAX_MARKS 8
+
 typedef struct _KmsBufferLatencyMeta KmsBufferLatencyMeta;
+typedef struct _KmsBufferLatencyMark KmsBufferLatencyMark;
+
+struct _KmsBufferLatencyMark {
+  GQuark id; /* 0 until the mark is completely written */
+  KmsRefStruct *data;
+};
 
 /**
  * KmsBufferLatencyMeta:
@@ -33,7 +41,13 @@ typedef struct _KmsBufferLatencyMeta KmsBufferLatencyMeta;
  * @ts: The time stamp
  *
  * Buffer metadata for measuring buffer latency since the buffer is generated
- * until it is processed by a sink.
+ * until it is processed by a sink. The first marks are stored inline and added
+ * with atomic operations, so neither locks nor allocations are needed unless
+ * more than KMS_BUFFER_LATENCY_META_MAX_MARKS elements mark the same buffer.
+ *
+ * The layout is not compatible with previous releases: the datamutex and data
+ * fields are gone. Code reading them must use the mark functions below and
+ * be rebuilt.
  */
 struct _KmsBufferLatencyMeta {
   GstMeta       meta;
@@ -42,14 +56,20 @@ struct _KmsBufferLatencyMeta {
   KmsMediaType type;
   gboolean valid;
 
-  GRecMutex datamutex;
-  KmsList *data; /* <string, refstruct> */
+  gint n_marks;
+  KmsBufferLatencyMark marks[KMS_BUFFER_LATENCY_META_MAX_MARKS];
+
+  /* Marks not fitting in @marks, only used when n_marks exceeds it */
+  GMutex overflow_mutex;
+  GArray *overflow; /* KmsBufferLatencyMark */
 };
 
-#define KMS_BUFFER_LATENCY_DATA_LOCK(mdata) \
-  (g_rec_mutex_lock (&((KmsBufferLatencyMeta *)mdata)->datamutex))
-#define KMS_BUFFER_LATENCY_DATA_UNLOCK(mdata) \
-  (g_rec_mutex_unlock (&((KmsBufferLatencyMeta *)mdata)->datamutex))
+/* Marks do not need locking any more, kept for source compatibility */
+#define KMS_BUFFER_LATENCY_DATA_LOCK(mdata) ((void) (mdata))
+#define KMS_BUFFER_LATENCY_DATA_UNLOCK(mdata) ((void) (mdata))
+
+typedef void (*KmsBufferLatencyMarkFunc) (GQuark id, KmsRefStruct *data,
+  gpointer user_data);
 
 GType kms_buffer_latency_meta_api_get_type (void);
 #define KMS_BUFFER_LATENCY_META_API_TYPE \
@@ -65,6 +85,13 @@ const GstMetaInfo *kms_buffer_latency_meta_get_info (void);
 KmsBufferLatencyMeta * kms_buffer_add_buffer_latency_meta (GstBuffer *buffer,
   GstClockTime ts, gboolean valid, KmsMediaType type);
 
+gboolean kms_buffer_latency_meta_add_mark (KmsBufferLatencyMeta *meta,
+  GQuark id, KmsRefStruct *data);
+KmsRefStruct * kms_buffer_latency_meta_lookup_mark (KmsBufferLatencyMeta *meta,
+  GQuark id);
+void kms_buffer_latency_meta_foreach_mark (KmsBufferLatencyMeta *meta,
+  KmsBufferLatencyMarkFunc func, gpointer user_data);
+
 G_END_DECLS
 
 #endif /* __KMS_BUFFER_LATENCY_META_H__ */
@@ -0,0 +1,83 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "kmscensus.h"
+
+typedef struct _KmsCensusCounter
+{
+  gint live;
+  gint max;
+} KmsCensusCounter;
+
+static KmsCensusCounter counters[KMS_CENSUS_N_TYPES];
+
+static const gchar *names[KMS_CENSUS_N_TYPES] = {
+  "KmsElement",
+  "KmsTreeBin",
+  "KmsBaseRtpSession",
+  "RembEventManager",
+  "KmsLoop"
+};
+
+void
+kms_census_add (KmsCensusType type)
+{
+  gint live, max;
+
+  g_return_if_fail (type < KMS_CENSUS_N_TYPES);
+
+  live = g_atomic_int_add (&counters[type].live, 1) + 1;
+
+  do {
+    max = g_atomic_int_get (&counters[type].max);
+  } while (live > max &&
+      !g_atomic_int_compare_and_exchange (&counters[type].max, max, live));
+}
+
+void
+kms_census_remove (KmsCensusType type)
+{
+  g_return_if_fail (type < KMS_CENSUS_N_TYPES);
+
+  g_atomic_int_add (&counters[type].live, -1);
+}
+
+const gchar *
+kms_census_type_get_name (KmsCensusType type)
+{
+  g_return_val_if_fail (type < KMS_CENSUS_N_TYPES, NULL);
+
+  return names[type];
+}
+
+void
+kms_census_get (KmsCensusType type, gint * live, gint * max)
+{
+  g_return_if_fail (type < KMS_CENSUS_N_TYPES);
+
+  if (live != NULL) {
+    *live = g_atomic_int_get (&counters[type].live);
+  }
+
+  if (max != NULL) {
+    *max = g_atomic_int_get (&counters[type].max);
+  }
+}
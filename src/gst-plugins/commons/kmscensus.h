@@ -0,0 +1,46 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_CENSUS_H__
+#define __KMS_CENSUS_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Counters of live instances of the objects that leak the most, cheap
+ * enough to be always on. Each counter also keeps its high-water mark.
+ */
+typedef enum
+{
+  KMS_CENSUS_ELEMENT,
+  KMS_CENSUS_TREE_BIN,
+  KMS_CENSUS_RTP_SESSION,
+  KMS_CENSUS_REMB_EVENT_MANAGER,
+  KMS_CENSUS_LOOP,
+  KMS_CENSUS_N_TYPES
+} KmsCensusType;
+
+void kms_census_add (KmsCensusType type);
+void kms_census_remove (KmsCensusType type);
+
+const gchar * kms_census_type_get_name (KmsCensusType type);
+void kms_census_get (KmsCensusType type, gint * live, gint * max);
+
+G_END_DECLS
+#endif /* __KMS_CENSUS_H__ */
@@ -27,6 +27,10 @@
 #include "kmsstats.h"
 #include "kmsutils.h"
 #include "kmsrefstruct.h"
+#include "kmsprobes.h"
+#include "kmsproctime.h"
+#include "kmscensus.h"
+#include "kmsflightrecorder.h"
 #include "constants.h"
 
 #define PLUGIN_NAME "kmselement"
@@ -34,14 +38,22 @@
 #define MAX_BITRATE "max-bitrate"
 #define MIN_BITRATE "min-bitrate"
 #define CODEC_CONFIG "codec-config"
+#define BITRATE_TIERS "bitrate-tiers"
+#define LATENCY_PROFILE "latency-profile"
 
 #define DEFAULT_MIN_BITRATE 0
 #define DEFAULT_MAX_BITRATE G_MAXINT
+#define DEFAULT_LATENCY_PROFILE KMS_LATENCY_PROFILE_DEFAULT
 #define MEDIA_FLOW_INTERNAL_TIME_MSEC 2000
+#define MEDIA_FLOW_WHEEL_SLOTS 8
+#define MEDIA_FLOW_WHEEL_TICK_MSEC \
+  (MEDIA_FLOW_INTERNAL_TIME_MSEC / MEDIA_FLOW_WHEEL_SLOTS)
 
 GST_DEBUG_CATEGORY_STATIC (kms_element_debug_category);
 #define GST_CAT_DEFAULT kms_element_debug_category
 
+KMS_PROBE_DEFINE (element_buffer);
+
 G_DEFINE_TYPE_WITH_CODE (KmsElement, kms_element,
     GST_TYPE_BIN,
     GST_DEBUG_CATEGORY_INIT (kms_element_debug_category, PLUGIN_NAME,
@@ -120,6 +132,9 @@ typedef struct _KmsMediaFlowData
   KmsRefStruct ref;
 
   GWeakRef element;
+  /* Not owned. Only used as an identifier by the tracing probe, which */
+  /* runs on pads of the element itself.                               */
+  KmsElement *owner;
   KmsElementPadType type;
   char *pad_description;
   gint media_flowing;
@@ -127,6 +142,19 @@ typedef struct _KmsMediaFlowData
   KmsMediaFlowType media_flow_type;
 } KmsMediaFlowData;
 
+/*
+ * All the flow data of the elements using a loop are checked by a single
+ * timer wheel. Each tick checks one of the slots, so every flow data is
+ * checked once every MEDIA_FLOW_INTERNAL_TIME_MSEC.
+ */
+typedef struct _KmsMediaFlowWheel
+{
+  GMutex mutex;
+  GHashTable *slots[MEDIA_FLOW_WHEEL_SLOTS];    /* set of KmsMediaFlowData */
+  guint current;
+  guint next;
+} KmsMediaFlowWheel;
+
 typedef struct _KmsMediaFlowTimeoutData
 {
   KmsRefStruct ref;
@@ -135,8 +163,8 @@ typedef struct _KmsMediaFlowTimeoutData
 
   /* Media Flow signal */
   GOnce init;
-  KmsLoop *loop;
-  guint source_id;
+  KmsMediaFlowWheel *wheel;
+  guint slot;
 } KmsMediaFlowTimeoutData;
 
 struct _KmsElementPrivate
@@ -158,6 +186,11 @@ struct _KmsElementPrivate
   gint max_bitrate;
 
   GstStructure *codec_config;
+  gchar *bitrate_tiers;
+  KmsLatencyProfile latency_profile;
+
+  /* Loop of the pool assigned to this element */
+  KmsLoop *loop;
 
   /* Statistics */
   KmsElementStats stats;
@@ -187,6 +220,8 @@ enum
   PROP_MAX_BITRATE,
   PROP_MEDIA_STATS,
   PROP_CODEC_CONFIG,
+  PROP_BITRATE_TIERS,
+  PROP_LATENCY_PROFILE,
   PROP_LAST
 };
 
@@ -252,6 +287,7 @@ media_flow_data_new (KmsElement * self, const gchar * description,
   data->media_flowing = 0;
   data->buffers = 0;
   g_weak_ref_init (&data->element, self);
+  data->owner = self;
   data->type = type;
   data->media_flow_type = media_flow_type;
 
@@ -270,11 +306,148 @@ media_flow_data_ref (KmsMediaFlowData * data)
   return (KmsMediaFlowData *) kms_ref_struct_ref ((KmsRefStruct *) data);
 }
 
+G_DEFINE_QUARK (kms-media-flow-wheel, media_flow_wheel);
+
+static void
+media_flow_data_emit (KmsMediaFlowData * data, gboolean flowing)
+{
+  gpointer weak_ptr = g_weak_ref_get (&data->element);
+  KmsElement *element;
+
+  if (weak_ptr == NULL) {
+    return;
+  }
+
+  element = KMS_ELEMENT (weak_ptr);
+  kms_flight_recorder_record (element,
+      data->media_flow_type == KMS_MEDIA_FLOW_IN ? KMS_FLIGHT_EVENT_FLOW_IN :
+      KMS_FLIGHT_EVENT_FLOW_OUT, flowing, data->type, data->pad_description);
+
+  if (data->media_flow_type == KMS_MEDIA_FLOW_IN) {
+    g_signal_emit (G_OBJECT (element), element_signals[SIGNAL_FLOW_IN_MEDIA],
+        0, flowing, data->pad_description, data->type);
+  } else if (data->media_flow_type == KMS_MEDIA_FLOW_OUT) {
+    g_signal_emit (G_OBJECT (element), element_signals[SIGNAL_FLOW_OUT_MEDIA],
+        0, flowing, data->pad_description, data->type);
+  }
+
+  g_object_unref (element);
+}
+
+static gboolean
+media_flow_wheel_tick (KmsMediaFlowWheel * wheel)
+{
+  GSList *stopped = NULL, *l;
+  GHashTableIter iter;
+  gpointer key;
+
+  g_mutex_lock (&wheel->mutex);
+
+  g_hash_table_iter_init (&iter, wheel->slots[wheel->current]);
+  while (g_hash_table_iter_next (&iter, &key, NULL)) {
+    KmsMediaFlowData *data = key;
+
+    if (g_atomic_int_get (&data->media_flowing) == 0) {
+      /* Let the next buffer notify that media is flowing again */
+      g_atomic_int_set (&data->buffers, 0);
+    } else if (g_atomic_int_get (&data->buffers) == 0) {
+      g_atomic_int_set (&data->media_flowing, 0);
+      stopped = g_slist_prepend (stopped, media_flow_data_ref (data));
+    } else {
+      g_atomic_int_set (&data->buffers, 0);
+    }
+  }
+
+  wheel->current = (wheel->current + 1) % MEDIA_FLOW_WHEEL_SLOTS;
+
+  g_mutex_unlock (&wheel->mutex);
+
+  /* Signals are emitted unlocked as handlers may remove pads */
+  for (l = stopped; l != NULL; l = l->next) {
+    media_flow_data_emit (l->data, FALSE);
+  }
+
+  g_slist_free_full (stopped, (GDestroyNotify) media_flow_data_unref);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+media_flow_wheel_destroy (KmsMediaFlowWheel * wheel)
+{
+  guint i;
+
+  /* Called when the loop is finalized, its source is already gone */
+  for (i = 0; i < MEDIA_FLOW_WHEEL_SLOTS; i++) {
+    g_hash_table_unref (wheel->slots[i]);
+  }
+
+  g_mutex_clear (&wheel->mutex);
+
+  g_slice_free (KmsMediaFlowWheel, wheel);
+}
+
+static KmsMediaFlowWheel *
+media_flow_wheel_get (KmsLoop * loop)
+{
+  static GMutex mutex;
+  KmsMediaFlowWheel *wheel;
+  guint i;
+
+  g_mutex_lock (&mutex);
+
+  wheel = g_object_get_qdata (G_OBJECT (loop), media_flow_wheel_quark ());
+  if (wheel != NULL) {
+    goto end;
+  }
+
+  wheel = g_slice_new0 (KmsMediaFlowWheel);
+  g_mutex_init (&wheel->mutex);
+  for (i = 0; i < MEDIA_FLOW_WHEEL_SLOTS; i++) {
+    wheel->slots[i] = g_hash_table_new_full (NULL, NULL,
+        (GDestroyNotify) media_flow_data_unref, NULL);
+  }
+
+  /* The wheel lives as long as the loop, it does not keep a reference */
+  kms_loop_timeout_add (loop, MEDIA_FLOW_WHEEL_TICK_MSEC,
+      (GSourceFunc) media_flow_wheel_tick, wheel);
+
+  g_object_set_qdata_full (G_OBJECT (loop), media_flow_wheel_quark (), wheel,
+      (GDestroyNotify) media_flow_wheel_destroy);
+
+end:
+  g_mutex_unlock (&mutex);
+
+  return wheel;
+}
+
+static guint
+media_flow_wheel_add (KmsMediaFlowWheel * wheel, KmsMediaFlowData * data)
+{
+  guint slot;
+
+  g_mutex_lock (&wheel->mutex);
+  slot = wheel->next++ % MEDIA_FLOW_WHEEL_SLOTS;
+  g_hash_table_add (wheel->slots[slot], media_flow_data_ref (data));
+  g_mutex_unlock (&wheel->mutex);
+
+  return slot;
+}
+
+static void
+media_flow_wheel_remove (KmsMediaFlowWheel * wheel, guint slot,
+    KmsMediaFlowData * data)
+{
+  g_mutex_lock (&wheel->mutex);
+  g_hash_table_remove (wheel->slots[slot], data);
+  g_mutex_unlock (&wheel->mutex);
+}
+
 static void
 media_flow_timeout_data_destroy (KmsMediaFlowTimeoutData * data)
 {
-  if (data->source_id != 0) {
-    kms_loop_remove (data->loop, data->source_id);
+  if (data->init.status == G_ONCE_STATUS_READY) {
+    media_flow_wheel_remove (data->wheel, data->slot, data->media_flow_data);
   }
 
   media_flow_data_unref (data->media_flow_data);
@@ -286,7 +459,6 @@ static KmsMediaFlowTimeoutData *
 media_flow_timeout_data_new (KmsElement * self, const gchar * description,
     KmsElementPadType type, KmsMediaFlowType media_flow_type)
 {
-  KmsElementClass *klass = KMS_ELEMENT_GET_CLASS (self);
   KmsMediaFlowTimeoutData *data;
 
   data = g_slice_new0 (KmsMediaFlowTimeoutData);
@@ -297,8 +469,7 @@ media_flow_timeout_data_new (KmsElement * self, const gchar * description,
   data->media_flow_data =
       media_flow_data_new (self, description, type, media_flow_type);
   data->init.status = G_ONCE_STATUS_NOTCALLED;
-  data->source_id = 0;
-  data->loop = klass->loop;
+  data->wheel = media_flow_wheel_get (kms_element_get_loop (self));
 
   return data;
 }
@@ -412,6 +583,12 @@ kms_element_set_target_on_linked (GstPad * pad, GstPad * peer,
     GstElement * element)
 {
   GstPad *target;
+  gchar *peer_name;
+
+  peer_name = g_strdup_printf ("%s:%s", GST_DEBUG_PAD_NAME (peer));
+  kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_PAD_LINKED, 0, 0,
+      peer_name);
+  g_free (peer_name);
 
   target = gst_element_get_request_pad (element, "src_%u");
 
@@ -434,6 +611,12 @@ kms_element_remove_target_on_unlinked (GstPad * pad, GstPad * peer,
     GstElement * element)
 {
   GstPad *target;
+  gchar *peer_name;
+
+  peer_name = g_strdup_printf ("%s:%s", GST_DEBUG_PAD_NAME (peer));
+  kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_PAD_UNLINKED, 0, 0,
+      peer_name);
+  g_free (peer_name);
 
   target = gst_ghost_pad_get_target (GST_GHOST_PAD (pad));
 
@@ -560,81 +743,48 @@ cb_buffer_received (GstPad * pad, GstPadProbeInfo * info, gpointer data)
 {
   KmsMediaFlowTimeoutData *fdto_data = (KmsMediaFlowTimeoutData *) data;
   KmsMediaFlowData *fd_data = fdto_data->media_flow_data;
-  gpointer weak_ptr = g_weak_ref_get (&fd_data->element);
-  KmsElement *element;
 
-  if (weak_ptr == NULL) {
-    return FALSE;
-  }
+#if defined (HAVE_SYS_SDT_H)
+  if (KMS_PROBE_ENABLED (element_buffer)) {
+    GstObject *element = GST_OBJECT_CAST (fd_data->owner);
+    GstObject *pipeline = GST_OBJECT_PARENT (element);
+    GstClockTime pts = GST_CLOCK_TIME_NONE;
+    gsize size = 0;
 
-  element = KMS_ELEMENT (weak_ptr);
-  if (g_atomic_int_compare_and_exchange (&fd_data->media_flowing, 0, 1)) {
-    if (fd_data->media_flow_type == KMS_MEDIA_FLOW_IN) {
-      g_signal_emit (G_OBJECT (element),
-          element_signals[SIGNAL_FLOW_IN_MEDIA], 0, TRUE,
-          fd_data->pad_description, fd_data->type);
-    } else if (fd_data->media_flow_type == KMS_MEDIA_FLOW_OUT) {
-      g_signal_emit (G_OBJECT (element),
-          element_signals[SIGNAL_FLOW_OUT_MEDIA], 0, TRUE,
-          fd_data->pad_description, fd_data->type);
-    }
-  }
-
-  g_atomic_int_compare_and_exchange (&fd_data->buffers, 0, 1);
+    if (GST_PAD_PROBE_INFO_TYPE (info) & GST_PAD_PROBE_TYPE_BUFFER) {
+      GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
 
-  g_object_unref (element);
-
-  return GST_PAD_PROBE_OK;
-}
-
-gboolean
-check_if_flow_media (gpointer user_data)
-{
-  KmsMediaFlowData *data = (KmsMediaFlowData *) user_data;
-  gpointer weak_ptr;
-  KmsElement *element;
+      pts = GST_BUFFER_PTS (buffer);
+      size = gst_buffer_get_size (buffer);
+    }
 
-  if (g_source_is_destroyed (g_main_current_source ())) {
-    return G_SOURCE_REMOVE;
+    KMS_PROBE8 (element_buffer, element, GST_OBJECT_NAME (element), pipeline,
+        pipeline != NULL ? GST_OBJECT_NAME (pipeline) : NULL,
+        fd_data->media_flow_type, fd_data->type, pts, size);
   }
+#endif
 
-  weak_ptr = g_weak_ref_get (&data->element);
-  if (weak_ptr == NULL) {
-    return G_SOURCE_REMOVE;
+  /* Just flag activity, the wheel detects when media stops */
+  if (G_LIKELY (g_atomic_int_get (&fd_data->buffers) == 1)) {
+    return GST_PAD_PROBE_OK;
   }
 
-  element = KMS_ELEMENT (weak_ptr);
-  if (g_atomic_int_get (&data->media_flowing) == 1) {
-    if (g_atomic_int_get (&data->buffers) == 0) {
-      g_atomic_int_set (&data->media_flowing, 0);
-      if (data->media_flow_type == KMS_MEDIA_FLOW_IN) {
-        g_signal_emit (G_OBJECT (element),
-            element_signals[SIGNAL_FLOW_IN_MEDIA], 0, FALSE,
-            data->pad_description, data->type);
-      } else if (data->media_flow_type == KMS_MEDIA_FLOW_OUT) {
-        g_signal_emit (G_OBJECT (element),
-            element_signals[SIGNAL_FLOW_OUT_MEDIA], 0, FALSE,
-            data->pad_description, data->type);
-      }
-    } else {
-      g_atomic_int_set (&data->buffers, 0);
-    }
-  }
+  g_atomic_int_set (&fd_data->buffers, 1);
 
-  g_object_unref (element);
+  if (g_atomic_int_compare_and_exchange (&fd_data->media_flowing, 0, 1)) {
+    media_flow_data_emit (fd_data, TRUE);
+  }
 
-  return G_SOURCE_CONTINUE;
+  return GST_PAD_PROBE_OK;
 }
 
 static gpointer
 attach_timeout (gpointer data)
 {
   KmsMediaFlowTimeoutData *fdto_data = data;
-  KmsMediaFlowData *fd_data = fdto_data->media_flow_data;
 
-  fdto_data->source_id = kms_loop_timeout_add_full (fdto_data->loop,
-      G_PRIORITY_DEFAULT, MEDIA_FLOW_INTERNAL_TIME_MSEC, check_if_flow_media,
-      media_flow_data_ref (fd_data), (GDestroyNotify) media_flow_data_unref);
+  fdto_data->slot = media_flow_wheel_add (fdto_data->wheel,
+      fdto_data->media_flow_data);
 
   return NULL;
 }
@@ -697,6 +847,12 @@ kms_element_set_video_output_properties (KmsElement * self,
 
   KMS_SET_OBJECT_PROPERTY_SAFETLY (element, MIN_BITRATE,
       self->priv->min_bitrate);
+
+  KMS_SET_OBJECT_PROPERTY_SAFETLY (element, BITRATE_TIERS,
+      self->priv->bitrate_tiers);
+
+  KMS_SET_OBJECT_PROPERTY_SAFETLY (element, LATENCY_PROFILE,
+      self->priv->latency_profile);
 }
 
 GstElement *
@@ -893,7 +1049,7 @@ get_sink_pad_name (KmsElementPadType type, const gchar * description)
 
 static void
 kms_element_calculate_stats (GstPad * pad, KmsMediaType type,
-    GstClockTimeDiff t, KmsList * mdata, gpointer user_data)
+    GstClockTimeDiff t, KmsBufferLatencyMeta * meta, gpointer user_data)
 {
   StreamInputAvgStat *sstat = (StreamInputAvgStat *) user_data;
 
@@ -950,7 +1106,7 @@ kms_element_set_sink_input_stats (KmsElement * self, GstPad * pad,
 
   if (self->priv->stats_enabled) {
     GST_INFO_OBJECT (self, "Enabling average stat for %" GST_PTR_FORMAT, pad);
-    kms_stats_probe_add_latency (s_probe, kms_element_calculate_stats, FALSE,
+    kms_stats_probe_add_latency_full (s_probe, kms_element_calculate_stats,
         stream_input_avg_stat_ref (sstat),
         (GDestroyNotify) kms_ref_struct_unref);
   }
@@ -1215,6 +1371,29 @@ set_codec_config (gchar * id, KmsOutputElementData * odata, KmsElement * self)
   }
 }
 
+static void
+set_latency_profile (gchar * id, KmsOutputElementData * odata,
+    KmsElement * self)
+{
+  if (odata->type == KMS_ELEMENT_PAD_TYPE_VIDEO) {
+    if (odata->element != NULL) {
+      KMS_SET_OBJECT_PROPERTY_SAFETLY (odata->element, LATENCY_PROFILE,
+          self->priv->latency_profile);
+    }
+  }
+}
+
+static void
+set_bitrate_tiers (gchar * id, KmsOutputElementData * odata, KmsElement * self)
+{
+  if (odata->type == KMS_ELEMENT_PAD_TYPE_VIDEO) {
+    if (odata->element != NULL) {
+      KMS_SET_OBJECT_PROPERTY_SAFETLY (odata->element, BITRATE_TIERS,
+          self->priv->bitrate_tiers);
+    }
+  }
+}
+
 static void
 kms_element_set_property (GObject * object, guint property_id,
     const GValue * value, GParamSpec * pspec)
@@ -1278,6 +1457,25 @@ kms_element_set_property (GObject * object, guint property_id,
       KMS_ELEMENT_UNLOCK (self);
       break;
     }
+    case PROP_BITRATE_TIERS:{
+      KMS_ELEMENT_LOCK (self);
+      g_free (self->priv->bitrate_tiers);
+      self->priv->bitrate_tiers = g_value_dup_string (value);
+
+      g_hash_table_foreach (self->priv->output_elements,
+          (GHFunc) set_bitrate_tiers, self);
+      KMS_ELEMENT_UNLOCK (self);
+      break;
+    }
+    case PROP_LATENCY_PROFILE:{
+      KMS_ELEMENT_LOCK (self);
+      self->priv->latency_profile = g_value_get_enum (value);
+
+      g_hash_table_foreach (self->priv->output_elements,
+          (GHFunc) set_latency_profile, self);
+      KMS_ELEMENT_UNLOCK (self);
+      break;
+    }
     case PROP_MEDIA_STATS:{
       gboolean enable = g_value_get_boolean (value);
 
@@ -1333,6 +1531,14 @@ kms_element_get_property (GObject * object, guint property_id,
       g_value_set_boxed (value, self->priv->codec_config);
       KMS_ELEMENT_UNLOCK (self);
       break;
+    case PROP_BITRATE_TIERS:
+      KMS_ELEMENT_LOCK (self);
+      g_value_set_string (value, self->priv->bitrate_tiers);
+      KMS_ELEMENT_UNLOCK (self);
+      break;
+    case PROP_LATENCY_PROFILE:
+      g_value_set_enum (value, kms_element_get_latency_profile (self));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1362,6 +1568,8 @@ kms_element_finalize (GObject * object)
 
   g_rec_mutex_clear (&element->mutex);
 
+  kms_census_remove (KMS_CENSUS_ELEMENT);
+
   if (element->priv->video_caps != NULL) {
     gst_caps_unref (element->priv->video_caps);
   }
@@ -1375,6 +1583,9 @@ kms_element_finalize (GObject * object)
     element->priv->codec_config = NULL;
   }
 
+  g_free (element->priv->bitrate_tiers);
+  g_clear_object (&element->priv->loop);
+
   /* chain up */
   G_OBJECT_CLASS (kms_element_parent_class)->finalize (object);
 }
@@ -1670,12 +1881,13 @@ kms_element_get_input_latency_stats (KmsElement * self, gchar * selector)
 static GstStructure *
 kms_element_stats_impl (KmsElement * self, gchar * selector)
 {
+  GstStructure *e_stats = NULL;
+  GstStructure *p_stats;
   GstStructure *stats;
 
   stats = gst_structure_new_empty ("stats");
 
   if (self->priv->stats_enabled) {
-    GstStructure *e_stats;
     GstStructure *l_stats;
 
     l_stats = kms_element_get_input_latency_stats (self, selector);
@@ -1683,7 +1895,22 @@ kms_element_stats_impl (KmsElement * self, gchar * selector)
     e_stats = gst_structure_new (KMS_ELEMENT_STATS_STRUCT_NAME,
         "input-latencies", GST_TYPE_STRUCTURE, l_stats, NULL);
     gst_structure_free (l_stats);
+  }
+
+  /* Only available when the kmsproctime tracer is running */
+  p_stats = kms_proc_time_get_stats (GST_ELEMENT (self));
 
+  if (p_stats != NULL) {
+    if (e_stats == NULL) {
+      e_stats = gst_structure_new_empty (KMS_ELEMENT_STATS_STRUCT_NAME);
+    }
+
+    gst_structure_set (e_stats, KMS_PROC_TIME_STATS_FIELD, GST_TYPE_STRUCTURE,
+        p_stats, NULL);
+    gst_structure_free (p_stats);
+  }
+
+  if (e_stats != NULL) {
     gst_structure_set (stats, KMS_MEDIA_ELEMENT_FIELD, GST_TYPE_STRUCTURE,
         e_stats, NULL);
 
@@ -1765,8 +1992,8 @@ kms_element_enable_media_stats (KmsStatsProbe * probe, KmsElement * self)
   sstat = kms_element_get_stat_for_probe (probe, self);
 
   if (sstat != NULL) {
-    kms_stats_probe_add_latency (probe, kms_element_calculate_stats,
-        FALSE, stream_input_avg_stat_ref (sstat),
+    kms_stats_probe_add_latency_full (probe, kms_element_calculate_stats,
+        stream_input_avg_stat_ref (sstat),
         (GDestroyNotify) kms_ref_struct_unref);
   }
 }
@@ -1857,6 +2084,17 @@ kms_element_class_init (KmsElementClass * klass)
       g_param_spec_boxed ("codec-config", "codec config",
           "Codec configuration", GST_TYPE_STRUCTURE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_BITRATE_TIERS,
+      g_param_spec_string ("output-bitrate-tiers", "output bitrate tiers",
+          "Comma separated list of bitrates (bps) used to group video "
+          "consumers in encoding tiers", NULL, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_PROFILE,
+      g_param_spec_enum ("latency-profile", "Latency profile",
+          "Set of latency related values applied to this element",
+          KMS_TYPE_LATENCY_PROFILE, DEFAULT_LATENCY_PROFILE,
+          G_PARAM_READWRITE));
+
   klass->sink_query = GST_DEBUG_FUNCPTR (kms_element_sink_query_default);
   klass->collect_media_stats =
       GST_DEBUG_FUNCPTR (kms_element_collect_media_stats_impl);
@@ -1916,7 +2154,8 @@ kms_element_class_init (KmsElementClass * klass)
 
   g_type_class_add_private (klass, sizeof (KmsElementPrivate));
 
-  klass->loop = kms_loop_new ();
+  /* Kept for subclasses not using kms_element_get_loop yet */
+  klass->loop = kms_loop_pool_get_loop (NULL);
 }
 
 static void
@@ -1926,10 +2165,13 @@ kms_element_init (KmsElement * element)
 
   element->priv = KMS_ELEMENT_GET_PRIVATE (element);
 
+  kms_census_add (KMS_CENSUS_ELEMENT);
+
   element->priv->accept_eos = DEFAULT_ACCEPT_EOS;
 
   element->priv->min_bitrate = DEFAULT_MIN_BITRATE;
   element->priv->max_bitrate = DEFAULT_MAX_BITRATE;
+  element->priv->latency_profile = DEFAULT_LATENCY_PROFILE;
 
   element->priv->pendingpads = g_hash_table_new_full (g_str_hash, g_str_equal,
       g_free, (GDestroyNotify) destroy_pendingpads);
@@ -1940,6 +2182,62 @@ kms_element_init (KmsElement * element)
       g_free, (GDestroyNotify) kms_ref_struct_unref);
 }
 
+/*
+ * Elements of the same pipeline share a loop of the pool, so that a busy
+ * pipeline does not delay the tasks of elements in other pipelines.
+ */
+KmsLoop *
+kms_element_get_loop (KmsElement * self)
+{
+  KmsLoop *loop;
+
+  g_return_val_if_fail (KMS_IS_ELEMENT (self), NULL);
+
+  KMS_ELEMENT_LOCK (self);
+
+  if (self->priv->loop == NULL) {
+    GstObject *parent, *top = gst_object_ref (self);
+
+    while ((parent = gst_object_get_parent (top)) != NULL) {
+      gst_object_unref (top);
+      top = parent;
+    }
+
+    if (top != GST_OBJECT (self)) {
+      self->priv->loop = kms_loop_pool_get_loop (top);
+      loop = self->priv->loop;
+    } else {
+      /* Not in a pipeline yet, do not bind the element to a loop of its own.
+       * Pool loops are never destroyed, so the reference can be dropped */
+      GST_DEBUG_OBJECT (self, "Getting loop before being added to a bin");
+      loop = kms_loop_pool_get_loop (NULL);
+      g_object_unref (loop);
+    }
+
+    gst_object_unref (top);
+  } else {
+    loop = self->priv->loop;
+  }
+
+  KMS_ELEMENT_UNLOCK (self);
+
+  return loop;
+}
+
+KmsLatencyProfile
+kms_element_get_latency_profile (KmsElement * self)
+{
+  KmsLatencyProfile profile;
+
+  g_return_val_if_fail (KMS_IS_ELEMENT (self), DEFAULT_LATENCY_PROFILE);
+
+  KMS_ELEMENT_LOCK (self);
+  profile = self->priv->latency_profile;
+  KMS_ELEMENT_UNLOCK (self);
+
+  return profile;
+}
+
 KmsElementPadType
 kms_element_get_pad_type (KmsElement * self, GstPad * pad)
 {
@@ -21,6 +21,7 @@
 #include "kmsloop.h"
 #include "kmselementpadtype.h"
 #include "kmsmediatype.h"
+#include "kmslatencyprofile.h"
 
 G_BEGIN_DECLS
 
@@ -76,6 +77,7 @@ struct _KmsElementClass
 {
   GstBinClass parent_class;
 
+  /* deprecated: a loop of the pool, use kms_element_get_loop */
   KmsLoop * loop;
 
   /* actions */
@@ -137,5 +139,8 @@ void kms_element_remove_sink_by_type_full (KmsElement *self,
 
 KmsElementPadType kms_element_get_pad_type (KmsElement * self, GstPad * pad);
 
+KmsLoop * kms_element_get_loop (KmsElement * self);
+KmsLatencyProfile kms_element_get_latency_profile (KmsElement * self);
+
 G_END_DECLS
 #endif /* __KMS_ELEMENT_H__ */
@@ -21,6 +21,7 @@
 
 #include "kmsenctreebin.h"
 #include "kmsutils.h"
+#include "kmscensus.h"
 
 #define GST_DEFAULT_NAME "enctreebin"
 #define GST_CAT_DEFAULT kms_enc_tree_bin_debug
@@ -40,6 +41,9 @@ G_DEFINE_TYPE (KmsEncTreeBin, kms_enc_tree_bin, KMS_TYPE_TREE_BIN);
 #define KMS_ENC_TREE_BIN_LIMIT(obj, value) \
   MAX((obj)->priv->min_bitrate,MIN((obj)->priv->max_bitrate, (value)))
 
+/* A step is only raised when bitrate is this factor over its minimum */
+#define LADDER_HYSTERESIS_FACTOR 1.2
+
 typedef enum
 {
   VP8,
@@ -49,9 +53,27 @@ typedef enum
   UNSUPPORTED
 } EncoderType;
 
+typedef struct _KmsEncLadderStep
+{
+  gint min_bitrate;
+  gint max_height;
+  gint max_framerate;
+} KmsEncLadderStep;
+
+/* Ordered from the highest to the lowest bitrate */
+static const KmsEncLadderStep resolution_ladder[] = {
+  {1000000, G_MAXINT, G_MAXINT},
+  {500000, 480, 30},
+  {250000, 360, 30},
+  {120000, 240, 15},
+  {0, 180, 15}
+};
+
 struct _KmsEncTreeBinPrivate
 {
   GstElement *enc;
+  GstElement *rate;
+  GstElement *scale_filter;
   EncoderType enc_type;
   RembEventManager *remb_manager;
 
@@ -62,6 +84,12 @@ struct _KmsEncTreeBinPrivate
 
   gint max_bitrate;
   gint min_bitrate;
+
+  /* Bitrate updates come from REMB, tag and property threads */
+  GMutex ladder_mutex;
+  gint ladder_step;
+
+  KmsLatencyProfile latency_profile;
 };
 
 static const gchar *
@@ -135,8 +163,11 @@ set_encoder_configuration (GstElement * encoder, GstStructure * codec_config,
 
 static void
 configure_encoder (GstElement * encoder, EncoderType type, gint target_bitrate,
-    GstStructure * codec_configs)
+    KmsLatencyProfile profile, GstStructure * codec_configs)
 {
+  const KmsLatencySettings *settings =
+      kms_latency_profile_get_settings (profile);
+
   GST_DEBUG ("Configure encoder: %" GST_PTR_FORMAT, encoder);
   switch (type) {
     case VP8:
@@ -151,6 +182,10 @@ configure_encoder (GstElement * encoder, EncoderType type, gint target_bitrate,
                     "end-usage", /* cbr */ 1,
                     NULL);
       /* *INDENT-ON* */
+      if (settings->enc_keyframe_interval > 0) {
+        g_object_set (G_OBJECT (encoder), "keyframe-max-dist",
+            settings->enc_keyframe_interval, NULL);
+      }
       break;
     }
     case X264:
@@ -160,8 +195,10 @@ configure_encoder (GstElement * encoder, EncoderType type, gint target_bitrate,
                     "speed-preset", /* veryfast */ 3,
                     "threads", (guint) 1,
                     "bitrate", target_bitrate / 1000,
-                    "key-int-max", 60,
-                    "tune", /* zero-latency */ 4,
+                    "key-int-max", settings->enc_keyframe_interval > 0 ?
+                        settings->enc_keyframe_interval : 60,
+                    "tune", settings->enc_zero_latency ?
+                        /* zero-latency */ 4 : /* none */ 0,
                     NULL);
       /* *INDENT-ON* */
       break;
@@ -249,7 +286,7 @@ kms_enc_tree_bin_create_encoder_for_caps (KmsEncTreeBin * self,
     self->priv->enc = gst_element_factory_create (encoder_factory, NULL);
     kms_enc_tree_bin_set_encoder_type (self);
     configure_encoder (self->priv->enc, self->priv->enc_type, target_bitrate,
-        codec_configs);
+        self->priv->latency_profile, codec_configs);
   }
 
   gst_plugin_feature_list_free (filtered_list);
@@ -279,6 +316,77 @@ kms_enc_tree_bin_get_bitrate (KmsEncTreeBin * self)
   return bitrate;
 }
 
+static gint
+kms_enc_tree_bin_select_ladder_step (KmsEncTreeBin * self, gint bitrate)
+{
+  gint step = 0;
+
+  while (bitrate < resolution_ladder[step].min_bitrate) {
+    step++;
+  }
+
+  while (step < self->priv->ladder_step && bitrate <
+      resolution_ladder[step].min_bitrate * LADDER_HYSTERESIS_FACTOR) {
+    step++;
+  }
+
+  return step;
+}
+
+/*
+ * Encoding fewer pixels at low bitrates saves CPU and looks better than
+ * starving the encoder, so resolution and framerate follow the bitrate.
+ */
+static void
+kms_enc_tree_bin_update_resolution (KmsEncTreeBin * self, gint bitrate)
+{
+  const KmsEncLadderStep *ladder_step;
+  GstCaps *caps;
+  GstPad *sink;
+  gint step;
+
+  if (self->priv->scale_filter == NULL) {
+    return;
+  }
+
+  /* Not the object lock, setting children properties takes it to notify */
+  g_mutex_lock (&self->priv->ladder_mutex);
+
+  step = kms_enc_tree_bin_select_ladder_step (self, bitrate);
+  if (step == self->priv->ladder_step) {
+    g_mutex_unlock (&self->priv->ladder_mutex);
+    return;
+  }
+
+  ladder_step = &resolution_ladder[step];
+  GST_DEBUG_OBJECT (self, "Bitrate %d, limiting height to %d and framerate "
+      "to %d", bitrate, ladder_step->max_height, ladder_step->max_framerate);
+
+  self->priv->ladder_step = step;
+
+  if (ladder_step->max_height == G_MAXINT) {
+    caps = gst_caps_new_empty_simple ("video/x-raw");
+  } else {
+    caps = gst_caps_new_simple ("video/x-raw", "height", GST_TYPE_INT_RANGE, 1,
+        ladder_step->max_height, NULL);
+  }
+
+  g_object_set (self->priv->scale_filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  if (self->priv->rate != NULL) {
+    g_object_set (self->priv->rate, "max-rate", ladder_step->max_framerate,
+        NULL);
+  }
+
+  g_mutex_unlock (&self->priv->ladder_mutex);
+
+  /* Make the scaler renegotiate with the new limits */
+  sink = gst_element_get_static_pad (self->priv->scale_filter, "sink");
+  gst_pad_push_event (sink, gst_event_new_reconfigure ());
+  g_object_unref (sink);
+}
+
 static void
 kms_enc_tree_bin_set_target_bitrate (KmsEncTreeBin * self)
 {
@@ -288,6 +396,8 @@ kms_enc_tree_bin_set_target_bitrate (KmsEncTreeBin * self)
     return;
   }
 
+  kms_enc_tree_bin_update_resolution (self, target_bitrate);
+
   GST_DEBUG_OBJECT (self->priv->enc, "Setting encoding bitrate to: %d",
       target_bitrate);
 
@@ -451,7 +561,7 @@ kms_enc_tree_bin_configure (KmsEncTreeBin * self, const GstCaps * caps,
 {
   KmsTreeBin *tree_bin = KMS_TREE_BIN (self);
   GstElement *rate, *convert, *mediator, *output_tee, *capsfilter = NULL;
-  GstElement *queue;
+  GstElement *queue, *prev;
   GstPad *enc_src;
 
   self->priv->current_bitrate = target_bitrate;
@@ -469,6 +579,7 @@ kms_enc_tree_bin_configure (KmsEncTreeBin * self, const GstCaps * caps,
 
   enc_src = gst_element_get_static_pad (self->priv->enc, "src");
   self->priv->remb_manager = kms_utils_remb_event_manager_create (enc_src);
+  kms_census_add (KMS_CENSUS_REMB_EVENT_MANAGER);
   kms_utils_remb_event_manager_set_callback (self->priv->remb_manager,
       bitrate_callback, self, NULL);
   gst_pad_add_probe (enc_src, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
@@ -483,6 +594,14 @@ kms_enc_tree_bin_configure (KmsEncTreeBin * self, const GstCaps * caps,
   if (rate) {
     gst_bin_add (GST_BIN (self), rate);
   }
+
+  if (kms_utils_caps_are_video (caps)) {
+    self->priv->rate = rate;
+    self->priv->scale_filter = gst_element_factory_make ("capsfilter", NULL);
+    gst_bin_add (GST_BIN (self), self->priv->scale_filter);
+    gst_element_sync_state_with_parent (self->priv->scale_filter);
+    kms_enc_tree_bin_update_resolution (self, target_bitrate);
+  }
   gst_bin_add_many (GST_BIN (self), convert, mediator, queue, self->priv->enc,
       NULL);
   gst_element_sync_state_with_parent (self->priv->enc);
@@ -521,26 +640,32 @@ kms_enc_tree_bin_configure (KmsEncTreeBin * self, const GstCaps * caps,
   if (rate) {
     gst_element_link (rate, convert);
   }
-  if (self->priv->enc_type == X264) {
-    gst_element_link_many (convert, mediator, capsfilter, queue,
-        self->priv->enc, output_tee, NULL);
-  } else {
-    gst_element_link_many (convert, mediator, queue, self->priv->enc,
-        output_tee, NULL);
+  gst_element_link (convert, mediator);
+  prev = mediator;
+  if (self->priv->scale_filter != NULL) {
+    gst_element_link (prev, self->priv->scale_filter);
+    prev = self->priv->scale_filter;
+  }
+  if (capsfilter != NULL) {
+    gst_element_link (prev, capsfilter);
+    prev = capsfilter;
   }
+  gst_element_link_many (prev, queue, self->priv->enc, output_tee, NULL);
 
   return TRUE;
 }
 
 KmsEncTreeBin *
-kms_enc_tree_bin_new (const GstCaps * caps, gint target_bitrate,
-    gint min_bitrate, gint max_bitrate, GstStructure * codec_configs)
+kms_enc_tree_bin_new_full (const GstCaps * caps, gint target_bitrate,
+    gint min_bitrate, gint max_bitrate, GstStructure * codec_configs,
+    KmsLatencyProfile profile)
 {
   KmsEncTreeBin *enc;
 
   enc = g_object_new (KMS_TYPE_ENC_TREE_BIN, NULL);
   enc->priv->max_bitrate = max_bitrate;
   enc->priv->min_bitrate = min_bitrate;
+  enc->priv->latency_profile = profile;
 
   target_bitrate = KMS_ENC_TREE_BIN_LIMIT (enc, target_bitrate);
   if (!kms_enc_tree_bin_configure (enc, caps, target_bitrate, codec_configs)) {
@@ -551,18 +676,33 @@ kms_enc_tree_bin_new (const GstCaps * caps, gint target_bitrate,
   return enc;
 }
 
+KmsEncTreeBin *
+kms_enc_tree_bin_new (const GstCaps * caps, gint target_bitrate,
+    gint min_bitrate, gint max_bitrate, GstStructure * codec_configs)
+{
+  return kms_enc_tree_bin_new_full (caps, target_bitrate, min_bitrate,
+      max_bitrate, codec_configs, KMS_LATENCY_PROFILE_DEFAULT);
+}
+
 static void
 kms_enc_tree_bin_init (KmsEncTreeBin * self)
 {
   self->priv = KMS_ENC_TREE_BIN_GET_PRIVATE (self);
 
   self->priv->remb_manager = NULL;
+  self->priv->rate = NULL;
+  self->priv->scale_filter = NULL;
 
   self->priv->remb_bitrate = -1;
   self->priv->tag_bitrate = -1;
 
   self->priv->max_bitrate = G_MAXINT;
   self->priv->min_bitrate = 0;
+
+  g_mutex_init (&self->priv->ladder_mutex);
+  self->priv->ladder_step = -1;
+
+  self->priv->latency_profile = KMS_LATENCY_PROFILE_DEFAULT;
 }
 
 static void
@@ -574,6 +714,7 @@ kms_enc_tree_bin_dispose (GObject * object)
 
   if (self->priv->remb_manager) {
     kms_utils_remb_event_manager_destroy (self->priv->remb_manager);
+    kms_census_remove (KMS_CENSUS_REMB_EVENT_MANAGER);
     self->priv->remb_manager = NULL;
   }
 
@@ -581,6 +722,17 @@ kms_enc_tree_bin_dispose (GObject * object)
   G_OBJECT_CLASS (kms_enc_tree_bin_parent_class)->dispose (object);
 }
 
+static void
+kms_enc_tree_bin_finalize (GObject * object)
+{
+  KmsEncTreeBin *self = KMS_ENC_TREE_BIN (object);
+
+  g_mutex_clear (&self->priv->ladder_mutex);
+
+  /* chain up */
+  G_OBJECT_CLASS (kms_enc_tree_bin_parent_class)->finalize (object);
+}
+
 static void
 kms_enc_tree_bin_class_init (KmsEncTreeBinClass * klass)
 {
@@ -597,6 +749,7 @@ kms_enc_tree_bin_class_init (KmsEncTreeBinClass * klass)
       GST_DEFAULT_NAME);
 
   gobject_class->dispose = kms_enc_tree_bin_dispose;
+  gobject_class->finalize = kms_enc_tree_bin_finalize;
 
   g_type_class_add_private (klass, sizeof (KmsEncTreeBinPrivate));
 }
@@ -19,6 +19,7 @@
 #define __KMS_ENC_TREE_BIN_H__
 
 #include "kmstreebin.h"
+#include "kmslatencyprofile.h"
 
 G_BEGIN_DECLS
 /* #defines don't like whitespacey bits */
@@ -53,6 +54,7 @@ struct _KmsEncTreeBinClass
 GType kms_enc_tree_bin_get_type (void);
 
 KmsEncTreeBin * kms_enc_tree_bin_new (const GstCaps * caps, gint target_bitrate, gint min_bitrate, gint max_bitrate, GstStructure *codec_configs);
+KmsEncTreeBin * kms_enc_tree_bin_new_full (const GstCaps * caps, gint target_bitrate, gint min_bitrate, gint max_bitrate, GstStructure *codec_configs, KmsLatencyProfile profile);
 void kms_enc_tree_bin_set_bitrate_limits (KmsEncTreeBin *self, gint min_bitrate, gint max_bitrate);
 gint kms_enc_tree_bin_get_min_bitrate (KmsEncTreeBin *self);
 gint kms_enc_tree_bin_get_max_bitrate (KmsEncTreeBin *self);
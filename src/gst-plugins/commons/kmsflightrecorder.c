@@ -0,0 +1,527 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "kmsflightrecorder.h"
+#include "kmselement.h"
+#include "kmsrefstruct.h"
+#include "kmsutils.h"
+#include <string.h>
+
+#define GST_DEFAULT_NAME "kmsflightrecorder"
+#define GST_CAT_DEFAULT kms_flight_recorder_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+#define SOURCE_LEN 32
+#define DETAIL_LEN 56
+
+typedef struct _KmsFlightRecord
+{
+  /* 0 while the record is being written */
+  volatile gsize seq;
+  gint64 time;
+  guint32 type;
+  guint64 a;
+  guint64 b;
+  gchar source[SOURCE_LEN];
+  gchar detail[DETAIL_LEN];
+} KmsFlightRecord;
+
+typedef struct _KmsFlightRecorder
+{
+  KmsRefStruct ref;
+  volatile gsize head;
+  guint mask;
+  KmsFlightRecord records[];
+} KmsFlightRecorder;
+
+typedef struct _KmsFlightDumpHeader
+{
+  gchar magic[4];
+  guint32 record_size;
+  guint32 n_records;
+  guint32 reserved;
+  gint64 real_time;
+  gint64 monotonic_time;
+} KmsFlightDumpHeader;
+
+typedef struct _KmsFlightDumpRecord
+{
+  guint64 seq;
+  gint64 time;
+  guint32 type;
+  guint32 reserved;
+  guint64 a;
+  guint64 b;
+  gchar source[SOURCE_LEN];
+  gchar detail[DETAIL_LEN];
+} KmsFlightDumpRecord;
+
+static const gchar *event_names[] = {
+  "state-changed",
+  "pad-linked",
+  "pad-unlinked",
+  "caps",
+  "keyframe-request",
+  "keyframe-suppressed",
+  "remb",
+  "flow-in",
+  "flow-out",
+  "error",
+  "warning"
+};
+
+/* Recorder found for an object, kept on it to avoid walking its parents */
+/* on every record. Only valid for the generation it was looked up in.   */
+typedef struct _KmsFlightRecorderCache
+{
+  KmsFlightRecorder *rec;
+  gint generation;
+} KmsFlightRecorderCache;
+
+/* Bumped when an element leaves a recorded pipeline */
+static volatile gint cache_generation = 0;
+
+G_DEFINE_QUARK (kms-flight-recorder, kms_flight_recorder);
+G_DEFINE_QUARK (kms-flight-recorder-cache, kms_flight_recorder_cache);
+
+static void
+kms_flight_recorder_cache_free (KmsFlightRecorderCache * cache)
+{
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (cache->rec));
+  g_slice_free (KmsFlightRecorderCache, cache);
+}
+
+static void
+kms_flight_recorder_element_removed (GstBin * bin, GstElement * element,
+    gpointer data)
+{
+  /* Objects below @element may have cached the recorder of @bin */
+  g_atomic_int_inc (&cache_generation);
+}
+
+void
+kms_flight_recorder_attach (GstElement * pipeline, guint n_records)
+{
+  KmsFlightRecorder *rec;
+  guint size;
+
+  g_return_if_fail (GST_IS_ELEMENT (pipeline));
+  g_return_if_fail (n_records > 0);
+
+  size = 1 << g_bit_storage (n_records - 1);
+  rec = g_malloc0 (sizeof (KmsFlightRecorder) +
+      size * sizeof (KmsFlightRecord));
+  rec->mask = size - 1;
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (rec), g_free);
+
+  g_object_set_qdata_full (G_OBJECT (pipeline), kms_flight_recorder_quark (),
+      rec, (GDestroyNotify) kms_ref_struct_unref);
+
+  if (GST_IS_BIN (pipeline)) {
+    g_signal_connect (pipeline, "element-removed",
+        G_CALLBACK (kms_flight_recorder_element_removed), NULL);
+  }
+}
+
+/* Returns a reference to the recorder of the top level bin of @object */
+static KmsFlightRecorder *
+kms_flight_recorder_lookup (GstObject * object)
+{
+  gint generation = g_atomic_int_get (&cache_generation);
+  KmsFlightRecorder *rec = NULL, *old = NULL;
+  KmsFlightRecorderCache *cache;
+  GstObject *top, *parent;
+
+  GST_OBJECT_LOCK (object);
+  cache = g_object_get_qdata (G_OBJECT (object),
+      kms_flight_recorder_cache_quark ());
+
+  if (cache != NULL && cache->generation == generation) {
+    rec = (KmsFlightRecorder *)
+        kms_ref_struct_ref (KMS_REF_STRUCT_CAST (cache->rec));
+  }
+
+  GST_OBJECT_UNLOCK (object);
+
+  if (rec != NULL) {
+    return rec;
+  }
+
+  top = gst_object_ref (object);
+
+  while ((parent = gst_object_get_parent (top)) != NULL) {
+    gst_object_unref (top);
+    top = parent;
+  }
+
+  rec = g_object_get_qdata (G_OBJECT (top), kms_flight_recorder_quark ());
+
+  if (rec == NULL || top == object) {
+    /* Nothing worth caching until @object is in a recorded pipeline */
+    gst_object_unref (top);
+    return rec != NULL ?
+        (KmsFlightRecorder *) kms_ref_struct_ref (KMS_REF_STRUCT_CAST (rec)) :
+        NULL;
+  }
+
+  kms_ref_struct_ref (KMS_REF_STRUCT_CAST (rec));
+  gst_object_unref (top);
+
+  GST_OBJECT_LOCK (object);
+  cache = g_object_get_qdata (G_OBJECT (object),
+      kms_flight_recorder_cache_quark ());
+
+  if (cache == NULL) {
+    cache = g_slice_new0 (KmsFlightRecorderCache);
+    g_object_set_qdata_full (G_OBJECT (object),
+        kms_flight_recorder_cache_quark (), cache,
+        (GDestroyNotify) kms_flight_recorder_cache_free);
+  } else {
+    old = cache->rec;
+  }
+
+  cache->rec = (KmsFlightRecorder *)
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (rec));
+  cache->generation = generation;
+
+  GST_OBJECT_UNLOCK (object);
+
+  if (old != NULL) {
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (old));
+  }
+
+  return rec;
+}
+
+static void
+kms_flight_recorder_write (KmsFlightRecorder * rec, GstObject * object,
+    KmsFlightEventType type, guint64 a, guint64 b, const gchar * detail)
+{
+  gsize seq = (gsize) g_atomic_pointer_add (&rec->head, 1) + 1;
+  KmsFlightRecord *r = &rec->records[seq & rec->mask];
+  GstObject *parent;
+
+  g_atomic_pointer_set (&r->seq, 0);
+
+  r->time = g_get_monotonic_time ();
+  r->type = type;
+  r->a = a;
+  r->b = b;
+
+  if (GST_IS_PAD (object) && (parent = gst_object_get_parent (object))) {
+    g_snprintf (r->source, SOURCE_LEN, "%s:%s", GST_OBJECT_NAME (parent),
+        GST_OBJECT_NAME (object));
+    gst_object_unref (parent);
+  } else {
+    g_strlcpy (r->source, GST_OBJECT_NAME (object), SOURCE_LEN);
+  }
+
+  g_strlcpy (r->detail, detail != NULL ? detail : "", DETAIL_LEN);
+
+  g_atomic_pointer_set (&r->seq, seq);
+}
+
+void
+kms_flight_recorder_record (gpointer object, KmsFlightEventType type,
+    guint64 a, guint64 b, const gchar * detail)
+{
+  KmsFlightRecorder *rec;
+
+  g_return_if_fail (GST_IS_OBJECT (object));
+
+  rec = kms_flight_recorder_lookup (GST_OBJECT (object));
+
+  if (rec != NULL) {
+    kms_flight_recorder_write (rec, GST_OBJECT (object), type, a, b, detail);
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (rec));
+  }
+}
+
+void
+kms_flight_recorder_record_caps (gpointer object, const GstCaps * caps)
+{
+  KmsFlightRecorder *rec;
+
+  g_return_if_fail (GST_IS_OBJECT (object));
+
+  rec = kms_flight_recorder_lookup (GST_OBJECT (object));
+
+  if (rec != NULL) {
+    gchar *str = gst_caps_to_string (caps);
+
+    kms_flight_recorder_write (rec, GST_OBJECT (object),
+        KMS_FLIGHT_EVENT_CAPS, 0, 0, str);
+    g_free (str);
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (rec));
+  }
+}
+
+void
+kms_flight_recorder_record_message (GstMessage * message)
+{
+  GstObject *src = GST_MESSAGE_SRC (message);
+  GError *err = NULL;
+
+  if (src == NULL) {
+    return;
+  }
+
+  switch (GST_MESSAGE_TYPE (message)) {
+    case GST_MESSAGE_STATE_CHANGED:{
+      GstState old_state, new_state;
+
+      /* Elements inside bins would flood the ring */
+      if (!KMS_IS_ELEMENT (src) && !GST_IS_PIPELINE (src)) {
+        return;
+      }
+
+      gst_message_parse_state_changed (message, &old_state, &new_state, NULL);
+      kms_flight_recorder_record (src, KMS_FLIGHT_EVENT_STATE_CHANGED,
+          old_state, new_state, NULL);
+      break;
+    }
+    case GST_MESSAGE_ERROR:
+      gst_message_parse_error (message, &err, NULL);
+      kms_flight_recorder_record (src, KMS_FLIGHT_EVENT_ERROR, err->code, 0,
+          err->message);
+      g_error_free (err);
+      break;
+    case GST_MESSAGE_WARNING:
+      gst_message_parse_warning (message, &err, NULL);
+      kms_flight_recorder_record (src, KMS_FLIGHT_EVENT_WARNING, err->code, 0,
+          err->message);
+      g_error_free (err);
+      break;
+    default:
+      break;
+  }
+}
+
+GBytes *
+kms_flight_recorder_dump (GstElement * pipeline)
+{
+  KmsFlightRecorder *rec;
+  KmsFlightDumpHeader *header;
+  KmsFlightDumpRecord *out;
+  gsize head, seq, first, n = 0;
+  guint8 *data;
+
+  g_return_val_if_fail (GST_IS_ELEMENT (pipeline), NULL);
+
+  rec = g_object_get_qdata (G_OBJECT (pipeline), kms_flight_recorder_quark ());
+
+  if (rec == NULL) {
+    return NULL;
+  }
+
+  data = g_malloc0 (sizeof (KmsFlightDumpHeader) +
+      (rec->mask + 1) * sizeof (KmsFlightDumpRecord));
+  header = (KmsFlightDumpHeader *) data;
+  out = (KmsFlightDumpRecord *) (data + sizeof (KmsFlightDumpHeader));
+
+  memcpy (header->magic, KMS_FLIGHT_RECORDER_MAGIC, sizeof (header->magic));
+  header->record_size = sizeof (KmsFlightDumpRecord);
+  header->real_time = g_get_real_time ();
+  header->monotonic_time = g_get_monotonic_time ();
+
+  head = (gsize) g_atomic_pointer_get (&rec->head);
+  first = head > rec->mask ? head - rec->mask : 1;
+
+  for (seq = first; seq <= head; seq++) {
+    KmsFlightRecord *r = &rec->records[seq & rec->mask];
+    KmsFlightDumpRecord *o = &out[n];
+
+    if ((gsize) g_atomic_pointer_get (&r->seq) != seq) {
+      /* Still being written or already overwritten */
+      continue;
+    }
+
+    o->seq = seq;
+    o->time = r->time;
+    o->type = r->type;
+    o->a = r->a;
+    o->b = r->b;
+    memcpy (o->source, r->source, SOURCE_LEN);
+    memcpy (o->detail, r->detail, DETAIL_LEN);
+
+    if ((gsize) g_atomic_pointer_get (&r->seq) != seq) {
+      continue;
+    }
+
+    o->source[SOURCE_LEN - 1] = '\0';
+    o->detail[DETAIL_LEN - 1] = '\0';
+    n++;
+  }
+
+  header->n_records = n;
+
+  return g_bytes_new_take (data, sizeof (KmsFlightDumpHeader) +
+      n * sizeof (KmsFlightDumpRecord));
+}
+
+static void
+kms_flight_recorder_append_text (GString * str,
+    const KmsFlightDumpRecord * r)
+{
+  switch (r->type) {
+    case KMS_FLIGHT_EVENT_STATE_CHANGED:
+      g_string_append_printf (str, "%s -> %s",
+          gst_element_state_get_name ((GstState) r->a),
+          gst_element_state_get_name ((GstState) r->b));
+      break;
+    case KMS_FLIGHT_EVENT_PAD_LINKED:
+    case KMS_FLIGHT_EVENT_PAD_UNLINKED:
+      g_string_append_printf (str, "peer %s", r->detail);
+      break;
+    case KMS_FLIGHT_EVENT_REMB:
+      g_string_append_printf (str, "ssrc %" G_GUINT64_FORMAT " bitrate %"
+          G_GUINT64_FORMAT " min %" G_GUINT64_FORMAT, r->a, r->b >> 32,
+          r->b & G_MAXUINT32);
+      break;
+    case KMS_FLIGHT_EVENT_FLOW_IN:
+    case KMS_FLIGHT_EVENT_FLOW_OUT:
+      g_string_append_printf (str, "%s %s %s",
+          r->a ? "FLOWING" : "NOT_FLOWING",
+          kms_element_pad_type_str ((KmsElementPadType) r->b), r->detail);
+      break;
+    case KMS_FLIGHT_EVENT_ERROR:
+    case KMS_FLIGHT_EVENT_WARNING:
+      g_string_append_printf (str, "code %" G_GUINT64_FORMAT ": %s", r->a,
+          r->detail);
+      break;
+    default:
+      g_string_append (str, r->detail);
+      break;
+  }
+}
+
+static gchar *
+kms_flight_recorder_decode (GBytes * bytes)
+{
+  const KmsFlightDumpHeader *header;
+  const KmsFlightDumpRecord *records;
+  GString *str = g_string_new (NULL);
+  gsize size;
+  guint i;
+
+  header = g_bytes_get_data (bytes, &size);
+  records = (const KmsFlightDumpRecord *) (header + 1);
+
+  for (i = 0; i < header->n_records; i++) {
+    const KmsFlightDumpRecord *r = &records[i];
+    gint64 real = header->real_time - (header->monotonic_time - r->time);
+    GDateTime *dt = g_date_time_new_from_unix_local (real / G_USEC_PER_SEC);
+    gchar *time = g_date_time_format (dt, "%F %T");
+
+    g_string_append_printf (str, "%s.%06" G_GINT64_FORMAT " %8"
+        G_GUINT64_FORMAT " %-19s %-32s ", time, real % G_USEC_PER_SEC, r->seq,
+        r->type < G_N_ELEMENTS (event_names) ? event_names[r->type] : "?",
+        r->source);
+    kms_flight_recorder_append_text (str, r);
+    g_string_append_c (str, '\n');
+
+    g_free (time);
+    g_date_time_unref (dt);
+  }
+
+  return g_string_free (str, FALSE);
+}
+
+gchar *
+kms_flight_recorder_dump_text (GstElement * pipeline)
+{
+  GBytes *bytes = kms_flight_recorder_dump (pipeline);
+  gchar *text;
+
+  if (bytes == NULL) {
+    return NULL;
+  }
+
+  text = kms_flight_recorder_decode (bytes);
+  g_bytes_unref (bytes);
+
+  return text;
+}
+
+gchar *
+kms_flight_recorder_dump_to_file (GstElement * pipeline, const gchar * dir,
+    const gchar * tag)
+{
+  GBytes *bytes = kms_flight_recorder_dump (pipeline);
+  GError *err = NULL;
+  gchar *name, *path;
+  gconstpointer data;
+  gsize size;
+
+  if (bytes == NULL) {
+    return NULL;
+  }
+
+  name = g_strdup_printf ("%" G_GINT64_FORMAT "-%s-%s.kfr",
+      g_get_real_time (), GST_OBJECT_NAME (pipeline), tag);
+  path = g_build_filename (dir, name, NULL);
+  g_free (name);
+
+  data = g_bytes_get_data (bytes, &size);
+
+  if (!g_file_set_contents (path, data, size, &err)) {
+    GST_WARNING_OBJECT (pipeline, "Cannot write flight record: %s",
+        err->message);
+    g_error_free (err);
+    g_free (path);
+    path = NULL;
+  }
+
+  g_bytes_unref (bytes);
+
+  return path;
+}
+
+static void
+kms_flight_recorder_utils_event (GstPad * pad, KmsUtilsEventType type,
+    guint64 a, guint64 b)
+{
+  switch (type) {
+    case KMS_UTILS_EVENT_KEYFRAME_REQUEST:
+      kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_KEYFRAME_REQUEST, a, b,
+          NULL);
+      break;
+    case KMS_UTILS_EVENT_KEYFRAME_SUPPRESSED:
+      kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_KEYFRAME_SUPPRESSED, a,
+          b, NULL);
+      break;
+    case KMS_UTILS_EVENT_REMB:
+      kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_REMB, a, b, NULL);
+      break;
+  }
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+
+  /* kmsutils can not depend on the recorder, it reports through a hook */
+  kms_utils_set_event_hook (kms_flight_recorder_utils_event);
+}
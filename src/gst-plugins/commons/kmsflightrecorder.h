@@ -0,0 +1,81 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_FLIGHT_RECORDER_H__
+#define __KMS_FLIGHT_RECORDER_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Per pipeline flight recorder. A fixed ring of binary records with the
+ * recent control events of a pipeline (state changes, links, caps,
+ * keyframe requests, REMB, media flow), cheap enough to be always on.
+ * Writers never block: they claim a slot with an atomic increment and
+ * readers discard the slots that were overwritten while being copied.
+ *
+ * Events are recorded in the ring of the top level bin of @object, and
+ * ignored if it has none.
+ */
+typedef enum
+{
+  KMS_FLIGHT_EVENT_STATE_CHANGED,
+  KMS_FLIGHT_EVENT_PAD_LINKED,
+  KMS_FLIGHT_EVENT_PAD_UNLINKED,
+  KMS_FLIGHT_EVENT_CAPS,
+  KMS_FLIGHT_EVENT_KEYFRAME_REQUEST,
+  KMS_FLIGHT_EVENT_KEYFRAME_SUPPRESSED,
+  KMS_FLIGHT_EVENT_REMB,
+  KMS_FLIGHT_EVENT_FLOW_IN,
+  KMS_FLIGHT_EVENT_FLOW_OUT,
+  KMS_FLIGHT_EVENT_ERROR,
+  KMS_FLIGHT_EVENT_WARNING
+} KmsFlightEventType;
+
+#define KMS_FLIGHT_RECORDER_DEFAULT_RECORDS 1024
+
+/*
+ * Binary dump layout, all fields in host byte order:
+ *   header: "KFR1", guint32 record size, guint32 number of records,
+ *           guint32 reserved, gint64 real time and gint64 monotonic
+ *           time of the dump in microseconds
+ *   records, oldest first: guint64 seq, gint64 monotonic time (us),
+ *           guint32 type, guint32 reserved, guint64 a, guint64 b,
+ *           gchar source[32], gchar detail[56]
+ * tools/flightrecorder/kms-flight-decode decodes it offline.
+ */
+#define KMS_FLIGHT_RECORDER_MAGIC "KFR1"
+
+/* @n_records is rounded up to a power of two */
+void kms_flight_recorder_attach (GstElement * pipeline, guint n_records);
+
+void kms_flight_recorder_record (gpointer object, KmsFlightEventType type,
+    guint64 a, guint64 b, const gchar * detail);
+void kms_flight_recorder_record_caps (gpointer object, const GstCaps * caps);
+void kms_flight_recorder_record_message (GstMessage * message);
+
+/* Both return NULL if @pipeline has no recorder */
+GBytes * kms_flight_recorder_dump (GstElement * pipeline);
+gchar * kms_flight_recorder_dump_text (GstElement * pipeline);
+
+/* Writes the binary dump to @dir, returns the file name or NULL */
+gchar * kms_flight_recorder_dump_to_file (GstElement * pipeline,
+    const gchar * dir, const gchar * tag);
+
+G_END_DECLS
+#endif /* __KMS_FLIGHT_RECORDER_H__ */
@@ -181,6 +181,24 @@ kms_i_rtp_connection_set_latency_callback (KmsIRtpConnection * self,
       user_data);
 }
 
+/* Returns FALSE if @self only implements the deprecated callback */
+gboolean
+kms_i_rtp_connection_set_latency_meta_callback (KmsIRtpConnection * self,
+    BufferLatencyMetaCallback cb, gpointer user_data)
+{
+  g_return_val_if_fail (KMS_IS_I_RTP_CONNECTION (self), FALSE);
+
+  if (KMS_I_RTP_CONNECTION_GET_INTERFACE (self)->set_latency_meta_callback ==
+      NULL) {
+    return FALSE;
+  }
+
+  KMS_I_RTP_CONNECTION_GET_INTERFACE (self)->set_latency_meta_callback (self,
+      cb, user_data);
+
+  return TRUE;
+}
+
 void
 kms_i_rtp_connection_collect_latency_stats (KmsIRtpConnection * self,
     gboolean enable)
@@ -60,6 +60,9 @@ struct _KmsIRtpConnectionInterface
 
   /* Signals */
   void (*connected_signal) (KmsIRtpConnection * self);
+
+  /* Added last to keep the layout of the vtable */
+  void (*set_latency_meta_callback) (KmsIRtpConnection *self, BufferLatencyMetaCallback cb, gpointer user_data);
 };
 
 GType kms_i_rtp_connection_get_type (void);
@@ -68,7 +71,9 @@ void kms_i_rtp_connection_add (KmsIRtpConnection *self, GstBin * bin, gboolean a
 void kms_i_rtp_connection_src_sync_state_with_parent (KmsIRtpConnection *self);
 void kms_i_rtp_connection_sink_sync_state_with_parent (KmsIRtpConnection *self);
 
+/* Deprecated: use kms_i_rtp_connection_set_latency_meta_callback */
 void kms_i_rtp_connection_set_latency_callback (KmsIRtpConnection *self, BufferLatencyCallback cb, gpointer user_data);
+gboolean kms_i_rtp_connection_set_latency_meta_callback (KmsIRtpConnection *self, BufferLatencyMetaCallback cb, gpointer user_data);
 void kms_i_rtp_connection_collect_latency_stats (KmsIRtpConnection *self, gboolean enable);
 
 GstPad * kms_i_rtp_connection_request_rtp_sink (KmsIRtpConnection *self);
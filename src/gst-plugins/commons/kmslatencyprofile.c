@@ -0,0 +1,78 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "kmslatencyprofile.h"
+
+/* Default keeps the values used before profiles were introduced */
+static const KmsLatencySettings latency_settings[] = {
+  /* KMS_LATENCY_PROFILE_DEFAULT */
+  {
+    .video_queue_time = G_GUINT64_CONSTANT (600000000),
+    .filter_queue_buffers = 1,
+    .mixer_latency = 150,
+    .jb_audio_latency = 100,
+    .jb_audio_min_latency = 40,
+    .jb_audio_max_latency = 300,
+    .jb_video_latency = 500,
+    .jb_video_min_latency = 100,
+    .jb_video_max_latency = 1000,
+    .enc_zero_latency = TRUE,
+    .enc_keyframe_interval = 0,
+  },
+  /* KMS_LATENCY_PROFILE_INTERACTIVE */
+  {
+    .video_queue_time = G_GUINT64_CONSTANT (200000000),
+    .filter_queue_buffers = 1,
+    .mixer_latency = 60,
+    .jb_audio_latency = 60,
+    .jb_audio_min_latency = 20,
+    .jb_audio_max_latency = 150,
+    .jb_video_latency = 150,
+    .jb_video_min_latency = 60,
+    .jb_video_max_latency = 400,
+    .enc_zero_latency = TRUE,
+    .enc_keyframe_interval = 30,
+  },
+  /* KMS_LATENCY_PROFILE_BROADCAST */
+  {
+    .video_queue_time = G_GUINT64_CONSTANT (2000000000),
+    .filter_queue_buffers = 10,
+    .mixer_latency = 300,
+    .jb_audio_latency = 300,
+    .jb_audio_min_latency = 100,
+    .jb_audio_max_latency = 1000,
+    .jb_video_latency = 1000,
+    .jb_video_min_latency = 300,
+    .jb_video_max_latency = 3000,
+    .enc_zero_latency = FALSE,
+    .enc_keyframe_interval = 120,
+  }
+};
+
+const KmsLatencySettings *
+kms_latency_profile_get_settings (KmsLatencyProfile profile)
+{
+  if (profile < KMS_LATENCY_PROFILE_DEFAULT
+      || profile > KMS_LATENCY_PROFILE_BROADCAST) {
+    profile = KMS_LATENCY_PROFILE_DEFAULT;
+  }
+
+  return &latency_settings[profile];
+}
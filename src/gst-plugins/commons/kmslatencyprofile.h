@@ -0,0 +1,56 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __KMS_LATENCY_PROFILE_H__
+#define __KMS_LATENCY_PROFILE_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum
+{
+  KMS_LATENCY_PROFILE_DEFAULT,
+  KMS_LATENCY_PROFILE_INTERACTIVE,
+  KMS_LATENCY_PROFILE_BROADCAST
+} KmsLatencyProfile;
+
+typedef struct _KmsLatencySettings KmsLatencySettings;
+
+struct _KmsLatencySettings
+{
+  /* Leaky queues in front of raw video consumers (ns) */
+  guint64 video_queue_time;
+  /* Buffers kept by the queue in front of filters */
+  guint filter_queue_buffers;
+  /* Latency reported by audio mixers (ms) */
+  guint mixer_latency;
+  /* Jitterbuffer latency once media arrives, and its adaptive bounds (ms) */
+  guint jb_audio_latency;
+  guint jb_audio_min_latency;
+  guint jb_audio_max_latency;
+  guint jb_video_latency;
+  guint jb_video_min_latency;
+  guint jb_video_max_latency;
+  /* Encoders: zero-latency tuning and keyframe interval (0 = codec default) */
+  gboolean enc_zero_latency;
+  guint enc_keyframe_interval;
+};
+
+const KmsLatencySettings * kms_latency_profile_get_settings (KmsLatencyProfile profile);
+
+G_END_DECLS
+#endif /* __KMS_LATENCY_PROFILE_H__ */
@@ -20,9 +20,14 @@
 
 #include <gst/gst.h>
 #include "kmsloop.h"
+#include "kmscensus.h"
 
 #define NAME "loop"
 
+#define KMS_LOOP_POOL_SIZE_ENV_VAR "KMS_LOOP_POOL_SIZE"
+#define KMS_LOOP_POOL_MAX_DEFAULT_SIZE 8
+#define KMS_LOOP_LAG_INTERVAL_MSEC 500
+
 GST_DEBUG_CATEGORY_STATIC (kms_loop_debug_category);
 #define GST_CAT_DEFAULT kms_loop_debug_category
 
@@ -48,8 +53,21 @@ struct _KmsLoopPrivate
   GCond cond;
   GMutex mutex;
   gboolean initialized;
+
+  /* Dispatch delay of the lag source, in microseconds */
+  gint64 last_tick;
+  gint64 lag;
+  gint64 max_lag;
 };
 
+typedef struct _KmsLoopPool
+{
+  KmsLoop **loops;
+  guint size;
+  gint next;
+} KmsLoopPool;
+
+
 #define KMS_LOOP_LOCK(elem) \
   (g_rec_mutex_lock (&KMS_LOOP ((elem))->priv->rmutex))
 #define KMS_LOOP_UNLOCK(elem) \
@@ -60,6 +78,8 @@ enum
 {
   PROP_0,
   PROP_CONTEXT,
+  PROP_LAG,
+  PROP_MAX_LAG,
   N_PROPERTIES
 };
 
@@ -75,12 +95,32 @@ quit_main_loop (KmsLoop * self)
   return G_SOURCE_REMOVE;
 }
 
+static gboolean
+measure_lag (KmsLoop * self)
+{
+  gint64 now = g_get_monotonic_time ();
+
+  KMS_LOOP_LOCK (self);
+
+  if (self->priv->last_tick != 0) {
+    self->priv->lag = MAX (0, now - self->priv->last_tick -
+        KMS_LOOP_LAG_INTERVAL_MSEC * G_TIME_SPAN_MILLISECOND);
+    self->priv->max_lag = MAX (self->priv->max_lag, self->priv->lag);
+  }
+  self->priv->last_tick = now;
+
+  KMS_LOOP_UNLOCK (self);
+
+  return G_SOURCE_CONTINUE;
+}
+
 static gpointer
 loop_thread_init (gpointer data)
 {
   KmsLoop *self = KMS_LOOP (data);
   GMainLoop *loop;
   GMainContext *context;
+  GSource *lag_source;
 
   KMS_LOOP_LOCK (self);
   self->priv->context = g_main_context_new ();
@@ -89,6 +129,10 @@ loop_thread_init (gpointer data)
   loop = g_main_loop_ref (self->priv->loop);
   KMS_LOOP_UNLOCK (self);
 
+  lag_source = g_timeout_source_new (KMS_LOOP_LAG_INTERVAL_MSEC);
+  g_source_set_callback (lag_source, (GSourceFunc) measure_lag, self, NULL);
+  g_source_attach (lag_source, context);
+
   /* unlock main process because context is already initialized */
   g_mutex_lock (&self->priv->mutex);
   self->priv->initialized = TRUE;
@@ -106,6 +150,8 @@ loop_thread_init (gpointer data)
 
 end:
   GST_DEBUG ("Thread finished");
+  g_source_destroy (lag_source);
+  g_source_unref (lag_source);
   g_main_loop_unref (loop);
   g_main_context_unref (context);
 
@@ -124,6 +170,12 @@ kms_loop_get_property (GObject * object, guint property_id, GValue * value,
     case PROP_CONTEXT:
       g_value_set_boxed (value, self->priv->context);
       break;
+    case PROP_LAG:
+      g_value_set_int64 (value, self->priv->lag);
+      break;
+    case PROP_MAX_LAG:
+      g_value_set_int64 (value, self->priv->max_lag);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -182,6 +234,8 @@ kms_loop_finalize (GObject * obj)
   g_mutex_clear (&self->priv->mutex);
   g_cond_clear (&self->priv->cond);
 
+  kms_census_remove (KMS_CENSUS_LOOP);
+
   G_OBJECT_CLASS (kms_loop_parent_class)->finalize (obj);
 }
 
@@ -200,6 +254,16 @@ kms_loop_class_init (KmsLoopClass * klass)
       "Main loop context",
       G_TYPE_MAIN_CONTEXT, (GParamFlags) (G_PARAM_READABLE));
 
+  obj_properties[PROP_LAG] = g_param_spec_int64 ("lag",
+      "Dispatch lag",
+      "Last measured delay (in microseconds) dispatching sources",
+      0, G_MAXINT64, 0, (GParamFlags) (G_PARAM_READABLE));
+
+  obj_properties[PROP_MAX_LAG] = g_param_spec_int64 ("max-lag",
+      "Maximum dispatch lag",
+      "Maximum measured delay (in microseconds) dispatching sources",
+      0, G_MAXINT64, 0, (GParamFlags) (G_PARAM_READABLE));
+
   g_object_class_install_properties (objclass, N_PROPERTIES, obj_properties);
 
   /* Registers a private structure for the instantiatable type */
@@ -216,6 +280,8 @@ kms_loop_init (KmsLoop * self)
   g_cond_init (&self->priv->cond);
   g_mutex_init (&self->priv->mutex);
 
+  kms_census_add (KMS_CENSUS_LOOP);
+
   self->priv->thread = g_thread_new ("KmsLoop", loop_thread_init, self);
 
   g_mutex_lock (&self->priv->mutex);
@@ -328,3 +394,91 @@ kms_loop_is_current_thread (KmsLoop * self)
 {
   return (g_thread_self () == self->priv->thread);
 }
+
+static gpointer
+kms_loop_pool_init (gpointer data)
+{
+  KmsLoopPool *pool = g_slice_new0 (KmsLoopPool);
+  const gchar *size_str = g_getenv (KMS_LOOP_POOL_SIZE_ENV_VAR);
+  guint i;
+
+  if (size_str != NULL) {
+    pool->size = g_ascii_strtoull (size_str, NULL, 10);
+  }
+
+  if (pool->size == 0) {
+    pool->size = CLAMP (g_get_num_processors (), 1,
+        KMS_LOOP_POOL_MAX_DEFAULT_SIZE);
+  }
+
+  GST_INFO ("Creating a pool of %u loops", pool->size);
+
+  pool->loops = g_new0 (KmsLoop *, pool->size);
+  for (i = 0; i < pool->size; i++) {
+    pool->loops[i] = kms_loop_new ();
+  }
+
+  return pool;
+}
+
+static KmsLoopPool *
+kms_loop_pool_get (void)
+{
+  static GOnce pool_once = G_ONCE_INIT;
+
+  return g_once (&pool_once, kms_loop_pool_init, NULL);
+}
+
+/*
+ * Loops are never destroyed, every user just keeps a reference to the one it
+ * is assigned. Users with the same @key share the same loop, a NULL key just
+ * takes the next loop of the pool.
+ */
+KmsLoop *
+kms_loop_pool_get_loop (gconstpointer key)
+{
+  KmsLoopPool *pool = kms_loop_pool_get ();
+  guint index;
+
+  if (key != NULL) {
+    /* Objects are aligned, so low bits of their address are not useful */
+    index = (GPOINTER_TO_SIZE (key) >> 4) % pool->size;
+  } else {
+    index = ((guint) g_atomic_int_add (&pool->next, 1)) % pool->size;
+  }
+
+  return g_object_ref (pool->loops[index]);
+}
+
+guint
+kms_loop_pool_get_size (void)
+{
+  return kms_loop_pool_get ()->size;
+}
+
+GstStructure *
+kms_loop_pool_get_stats (void)
+{
+  KmsLoopPool *pool = kms_loop_pool_get ();
+  GstStructure *stats;
+  guint i;
+
+  stats = gst_structure_new_empty ("loop-pool-stats");
+
+  for (i = 0; i < pool->size; i++) {
+    GstStructure *loop_stats;
+    gint64 lag, max_lag;
+    gchar *name;
+
+    g_object_get (pool->loops[i], "lag", &lag, "max-lag", &max_lag, NULL);
+    loop_stats = gst_structure_new ("loop-stats", "lag", G_TYPE_INT64, lag,
+        "max-lag", G_TYPE_INT64, max_lag, NULL);
+
+    name = g_strdup_printf ("loop-%u", i);
+    gst_structure_set (stats, name, GST_TYPE_STRUCTURE, loop_stats, NULL);
+    gst_structure_free (loop_stats);
+    g_free (name);
+  }
+
+  return stats;
+}
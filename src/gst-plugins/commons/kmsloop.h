@@ -88,5 +88,10 @@ gboolean kms_loop_remove (KmsLoop *self, guint source_id);
 
 gboolean kms_loop_is_current_thread (KmsLoop *self);
 
+/* Process wide pool of loops shared by elements */
+KmsLoop * kms_loop_pool_get_loop (gconstpointer key);
+guint kms_loop_pool_get_size (void);
+GstStructure * kms_loop_pool_get_stats (void);
+
 G_END_DECLS
 #endif
@@ -0,0 +1,81 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_PROBES_H__
+#define __KMS_PROBES_H__
+
+/*
+ * USDT probes of the "kurento" provider. They compile to a nop until a
+ * tracer attaches, so they may be placed on hot paths. Their names and
+ * arguments are an interface for the scripts in tools/bpftrace: add new
+ * arguments at the end. config.h must be included before this header.
+ *
+ * Every probe has a semaphore, defined once with KMS_PROBE_DEFINE at file
+ * scope (outside any C++ namespace) of each source file firing it. Tracers
+ * raise it while attached, so arguments that are costly to compute can be
+ * guarded with KMS_PROBE_ENABLED.
+ */
+
+#if defined (HAVE_SYS_SDT_H)
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define KMS_PROBE_DEFINE(name) \
+  static volatile unsigned short kurento_##name##_semaphore \
+  __attribute__ ((used, section (".probes")))
+#define KMS_PROBE_ENABLED(name) \
+  __builtin_expect (kurento_##name##_semaphore != 0, 0)
+
+#define KMS_PROBE(name) \
+  DTRACE_PROBE (kurento, name)
+#define KMS_PROBE1(name, a1) \
+  DTRACE_PROBE1 (kurento, name, a1)
+#define KMS_PROBE2(name, a1, a2) \
+  DTRACE_PROBE2 (kurento, name, a1, a2)
+#define KMS_PROBE3(name, a1, a2, a3) \
+  DTRACE_PROBE3 (kurento, name, a1, a2, a3)
+#define KMS_PROBE4(name, a1, a2, a3, a4) \
+  DTRACE_PROBE4 (kurento, name, a1, a2, a3, a4)
+#define KMS_PROBE5(name, a1, a2, a3, a4, a5) \
+  DTRACE_PROBE5 (kurento, name, a1, a2, a3, a4, a5)
+#define KMS_PROBE6(name, a1, a2, a3, a4, a5, a6) \
+  DTRACE_PROBE6 (kurento, name, a1, a2, a3, a4, a5, a6)
+#define KMS_PROBE7(name, a1, a2, a3, a4, a5, a6, a7) \
+  DTRACE_PROBE7 (kurento, name, a1, a2, a3, a4, a5, a6, a7)
+#define KMS_PROBE8(name, a1, a2, a3, a4, a5, a6, a7, a8) \
+  DTRACE_PROBE8 (kurento, name, a1, a2, a3, a4, a5, a6, a7, a8)
+
+#else
+
+#define KMS_PROBE_DEFINE(name) \
+  extern int kms_probe_##name##_unused
+#define KMS_PROBE_ENABLED(name) 0
+
+#define KMS_PROBE(name)
+#define KMS_PROBE1(name, a1)
+#define KMS_PROBE2(name, a1, a2)
+#define KMS_PROBE3(name, a1, a2, a3)
+#define KMS_PROBE4(name, a1, a2, a3, a4)
+#define KMS_PROBE5(name, a1, a2, a3, a4, a5)
+#define KMS_PROBE6(name, a1, a2, a3, a4, a5, a6)
+#define KMS_PROBE7(name, a1, a2, a3, a4, a5, a6, a7)
+#define KMS_PROBE8(name, a1, a2, a3, a4, a5, a6, a7, a8)
+
+#endif
+
+#endif /* __KMS_PROBES_H__ */
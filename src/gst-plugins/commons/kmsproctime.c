@@ -0,0 +1,244 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "kmsproctime.h"
+#include "kmselement.h"
+#include "kmstreebin.h"
+#include "kmsparsetreebin.h"
+#include "kmsdectreebin.h"
+#include "kmsenctreebin.h"
+#include "kmsrtppaytreebin.h"
+
+typedef struct _KmsProcTime
+{
+  GMutex mutex;
+
+  guint64 buffers;
+  GstClockTime total;
+  GstClockTime max;
+
+  guint64 queued;
+  GstClockTime queue_total;
+} KmsProcTime;
+
+G_DEFINE_QUARK (kms-proc-time, kms_proc_time);
+
+static gint enabled = FALSE;
+
+void
+kms_proc_time_enable (void)
+{
+  g_atomic_int_set (&enabled, TRUE);
+}
+
+static void
+kms_proc_time_destroy (KmsProcTime * pt)
+{
+  g_mutex_clear (&pt->mutex);
+  g_slice_free (KmsProcTime, pt);
+}
+
+static KmsProcTime *
+kms_proc_time_get (GstObject * bucket)
+{
+  KmsProcTime *pt;
+
+  GST_OBJECT_LOCK (bucket);
+
+  pt = g_object_get_qdata (G_OBJECT (bucket), kms_proc_time_quark ());
+
+  if (pt == NULL) {
+    pt = g_slice_new0 (KmsProcTime);
+    g_mutex_init (&pt->mutex);
+    g_object_set_qdata_full (G_OBJECT (bucket), kms_proc_time_quark (), pt,
+        (GDestroyNotify) kms_proc_time_destroy);
+  }
+
+  GST_OBJECT_UNLOCK (bucket);
+
+  return pt;
+}
+
+/* Time is charged to the nearest tree bin and KmsElement holding @element */
+static void
+kms_proc_time_add (GstElement * element, GstClockTime time, gboolean queue)
+{
+  GstObject *obj = gst_object_ref (element);
+  gboolean tree_found = FALSE;
+
+  /* Elements may be unparented concurrently, keep a ref on each level */
+  while (obj != NULL) {
+    gboolean is_tree = !tree_found && KMS_IS_TREE_BIN (obj);
+    gboolean is_element = KMS_IS_ELEMENT (obj);
+    GstObject *parent;
+
+    if (is_tree || is_element) {
+      KmsProcTime *pt = kms_proc_time_get (obj);
+
+      g_mutex_lock (&pt->mutex);
+
+      if (queue) {
+        pt->queued++;
+        pt->queue_total += time;
+      } else {
+        pt->buffers++;
+        pt->total += time;
+        pt->max = MAX (pt->max, time);
+      }
+
+      g_mutex_unlock (&pt->mutex);
+    }
+
+    if (is_element) {
+      break;
+    }
+
+    tree_found |= is_tree;
+    parent = gst_object_get_parent (obj);
+    gst_object_unref (obj);
+    obj = parent;
+  }
+
+  if (obj != NULL) {
+    gst_object_unref (obj);
+  }
+}
+
+void
+kms_proc_time_add_processing (GstElement * element, GstClockTime time)
+{
+  kms_proc_time_add (element, time, FALSE);
+}
+
+void
+kms_proc_time_add_queue (GstElement * element, GstClockTime time)
+{
+  kms_proc_time_add (element, time, TRUE);
+}
+
+static const gchar *
+kms_proc_time_get_bucket_type (GstObject * bucket)
+{
+  if (KMS_IS_ELEMENT (bucket)) {
+    return "element";
+  } else if (KMS_IS_PARSE_TREE_BIN (bucket)) {
+    return "parser";
+  } else if (KMS_IS_DEC_TREE_BIN (bucket)) {
+    return "decoder";
+  } else if (KMS_IS_ENC_TREE_BIN (bucket)) {
+    return "encoder";
+  } else if (KMS_IS_RTP_PAY_TREE_BIN (bucket)) {
+    return "payloader";
+  } else {
+    return "treebin";
+  }
+}
+
+static void
+kms_proc_time_add_bucket_stats (GstStructure * stats, GstObject * bucket,
+    const gchar * name)
+{
+  KmsProcTime *pt;
+  GstStructure *bucket_stats;
+
+  pt = g_object_get_qdata (G_OBJECT (bucket), kms_proc_time_quark ());
+
+  if (pt == NULL) {
+    return;
+  }
+
+  g_mutex_lock (&pt->mutex);
+
+  bucket_stats = gst_structure_new (name,
+      "type", G_TYPE_STRING, kms_proc_time_get_bucket_type (bucket),
+      "buffers", G_TYPE_UINT64, pt->buffers,
+      "avg", G_TYPE_UINT64, pt->buffers > 0 ? pt->total / pt->buffers : 0,
+      "max", G_TYPE_UINT64, pt->max,
+      "queue-avg", G_TYPE_UINT64,
+      pt->queued > 0 ? pt->queue_total / pt->queued : 0, NULL);
+
+  g_mutex_unlock (&pt->mutex);
+
+  gst_structure_set (stats, name, GST_TYPE_STRUCTURE, bucket_stats, NULL);
+  gst_structure_free (bucket_stats);
+}
+
+GstStructure *
+kms_proc_time_get_stats (GstElement * element)
+{
+  GstStructure *stats;
+  GValue item = G_VALUE_INIT;
+  GstIterator *it;
+  gboolean done = FALSE;
+
+  if (!g_atomic_int_get (&enabled)) {
+    return NULL;
+  }
+
+  stats = gst_structure_new_empty (KMS_PROC_TIME_STATS_FIELD);
+
+  if (!GST_IS_BIN (element)) {
+    goto end;
+  }
+
+  it = gst_bin_iterate_recurse (GST_BIN (element));
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:{
+        GstObject *child = g_value_get_object (&item);
+
+        if (KMS_IS_TREE_BIN (child)) {
+          GST_OBJECT_LOCK (child);
+          kms_proc_time_add_bucket_stats (stats, child,
+              GST_OBJECT_NAME (child));
+          GST_OBJECT_UNLOCK (child);
+        }
+
+        g_value_reset (&item);
+        break;
+      }
+      case GST_ITERATOR_RESYNC:
+        gst_structure_remove_all_fields (stats);
+        gst_iterator_resync (it);
+        break;
+      case GST_ITERATOR_ERROR:
+      case GST_ITERATOR_DONE:
+        done = TRUE;
+        break;
+    }
+  }
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+end:
+  GST_OBJECT_LOCK (element);
+  kms_proc_time_add_bucket_stats (stats, GST_OBJECT_CAST (element), "element");
+  GST_OBJECT_UNLOCK (element);
+
+  if (gst_structure_n_fields (stats) == 0) {
+    gst_structure_free (stats);
+    return NULL;
+  }
+
+  return stats;
+}
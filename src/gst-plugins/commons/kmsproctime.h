@@ -0,0 +1,40 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_PROC_TIME_H__
+#define __KMS_PROC_TIME_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define KMS_PROC_TIME_STATS_FIELD "processing-times"
+
+/*
+ * Processing time accounting. The kmsproctime tracer charges the time
+ * spent in every element to the nearest enclosing tree bin and KmsElement,
+ * and KmsElement reports it along with its stats.
+ */
+void kms_proc_time_enable (void);
+void kms_proc_time_add_processing (GstElement * element, GstClockTime time);
+void kms_proc_time_add_queue (GstElement * element, GstClockTime time);
+
+/* NULL if the tracer is not enabled or nothing was accounted for @element */
+GstStructure * kms_proc_time_get_stats (GstElement * element);
+
+G_END_DECLS
+#endif /* __KMS_PROC_TIME_H__ */
@@ -14,13 +14,20 @@
  * limitations under the License.
  *
  */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
 
 #include "kmsremb.h"
 #include "kmsrtcp.h"
+#include "kmsprobes.h"
+#include "kmscensus.h"
 #include "constants.h"
 
 #define GST_CAT_DEFAULT kmsutils
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+KMS_PROBE_DEFINE (remb_local_computed);
 #define GST_DEFAULT_NAME "kmsremb"
 
 #define REMB_MIN 30000          /* bps */
@@ -266,6 +273,15 @@ kms_remb_local_update (KmsRembLocal * rl)
     rl->probed = TRUE;
   }
 
+  if (fraction_lost == 0 && bitrate > rl->remb) {
+    /* The sender is going over the estimation without losses, usually */
+    /* because it is probing. The measured rate is a lower bound of the */
+    /* path capacity, so take it instead of ramping up to it. */
+    GST_TRACE_OBJECT (KMS_REMB_BASE (rl)->rtpsess,
+        "P) Probe accepted (%" G_GUINT64_FORMAT ")", bitrate);
+    rl->remb = bitrate;
+  }
+
   packets_rcv_interval_top =
       MAX (rl->packets_recv_interval_top, packets_rcv_interval);
   rl->fraction_lost_record =
@@ -335,6 +351,8 @@ kms_remb_local_update (KmsRembLocal * rl)
       ", bitrate: %" G_GUINT64_FORMAT "," " max_br: %" G_GUINT32_FORMAT
       ", avg_br: %" G_GUINT32_FORMAT, rl->remb, rl->threshold, fraction_lost,
       rl->fraction_lost_record, bitrate, rl->max_br, rl->avg_br);
+  KMS_PROBE5 (remb_local_computed, KMS_REMB_BASE (rl)->rtpsess, rl->remb,
+      bitrate, fraction_lost, rl->fraction_lost_record);
 
   return TRUE;
 }
@@ -443,6 +461,7 @@ kms_remb_local_destroy (KmsRembLocal * rl)
 
   if (rl->event_manager != NULL) {
     kms_utils_remb_event_manager_destroy (rl->event_manager);
+    kms_census_remove (KMS_CENSUS_REMB_EVENT_MANAGER);
   }
 
   g_slist_free_full (rl->remote_sessions,
@@ -567,6 +586,16 @@ kms_remb_local_get_params (KmsRembLocal * rl, GstStructure ** params)
 /* KmsRembRemote begin */
 
 #define DEFAULT_REMB_ON_CONNECT 300000  /* bps */
+#define DEFAULT_REMB_PROBE_FACTOR 2.0
+#define DEFAULT_REMB_PROBE_STEPS 4
+#define DEFAULT_REMB_PROBE_DELAY 5000   /* ms */
+
+/* Time the encoder is kept at the probed rate before checking the REMB */
+#define REMB_PROBE_STEP_TIME (3 * RTCP_MIN_INTERVAL * GST_MSECOND)
+/* Fraction of the probed rate the REMB must reach to keep probing */
+#define REMB_PROBE_SUCCESS_FACTOR 0.8
+/* A REMB below this fraction of the previous one is a drop */
+#define REMB_PROBE_DROP_FACTOR 0.7
 
 static void
 send_remb_event (KmsRembRemote * rm, guint bitrate, guint ssrc)
@@ -581,6 +610,8 @@ send_remb_event (KmsRembRemote * rm, guint bitrate, guint ssrc)
 
   br = bitrate;
 
+  KMS_REMB_BASE_LOCK (rm);
+
   if (rm->min_bw > 0) {
     min = rm->min_bw * 1000;
     br = MAX (br, min);
@@ -591,6 +622,8 @@ send_remb_event (KmsRembRemote * rm, guint bitrate, guint ssrc)
     br = MIN (br, max);
   }
 
+  KMS_REMB_BASE_UNLOCK (rm);
+
   GST_TRACE_OBJECT (KMS_REMB_BASE (rm)->rtpsess,
       "bitrate: %" G_GUINT32_FORMAT ", ssrc: %" G_GUINT32_FORMAT
       ", range [%" G_GUINT32_FORMAT ", %" G_GUINT32_FORMAT
@@ -605,16 +638,123 @@ send_remb_event_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
 {
   KmsRembRemote *rm = user_data;
   GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+  gint remb_on_connect;
 
   if (GST_EVENT_TYPE (event) != GST_EVENT_CAPS) {
     return GST_PAD_PROBE_OK;
   };
 
-  send_remb_event (rm, rm->remb_on_connect, rm->local_ssrc);
+  KMS_REMB_BASE_LOCK (rm);
+  remb_on_connect = rm->remb_on_connect;
+  KMS_REMB_BASE_UNLOCK (rm);
+
+  send_remb_event (rm, remb_on_connect, rm->local_ssrc);
 
   return GST_PAD_PROBE_REMOVE;
 }
 
+/* Backs off and arms the next probe after probe_delay */
+static void
+kms_remb_remote_stop_probe (KmsRembRemote * rm, guint remb, GstClockTime now)
+{
+  GST_DEBUG_OBJECT (KMS_REMB_BASE (rm)->rtpsess,
+      "Probe finished, REMB: %" G_GUINT32_FORMAT ", probing again in %d ms",
+      remb, rm->probe_delay);
+
+  rm->probe_bitrate = 0;
+  rm->probe_steps_left = 0;
+  rm->probe_time = now + rm->probe_delay * GST_MSECOND;
+}
+
+static gboolean
+kms_remb_remote_start_probe_step (KmsRembRemote * rm, guint bitrate,
+    GstClockTime now)
+{
+  guint probe;
+
+  probe = bitrate * rm->probe_factor;
+
+  if (rm->max_bw > 0) {
+    probe = MIN (probe, rm->max_bw * 1000);
+  }
+
+  if (rm->probe_steps_left <= 0 || probe <= bitrate) {
+    /* Out of steps or already at the configured max bandwidth */
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (KMS_REMB_BASE (rm)->rtpsess,
+      "Probing %" G_GUINT32_FORMAT " bps, %d steps left", probe,
+      rm->probe_steps_left);
+
+  rm->probe_bitrate = probe;
+  rm->probe_steps_left--;
+  rm->probe_step_time = now;
+
+  return TRUE;
+}
+
+/*
+ * Raises the encoder target over the received REMB in steps of
+ * probe_factor, at session start and some time after a drop. While the
+ * receiver keeps up without losses its REMB follows the probed rate and
+ * the next step is tried; the probe ends as soon as it does not.
+ */
+static guint
+kms_remb_remote_probe (KmsRembRemote * rm, guint remb, guint br_send)
+{
+  GstClockTime now;
+
+  if (rm->probe_factor <= 1.0 || rm->probe_steps <= 0) {
+    return br_send;
+  }
+
+  now = kms_utils_get_time_nsecs ();
+
+  if (rm->probe_bitrate > 0) {
+    if (rm->remb > 0 && remb < rm->remb * REMB_PROBE_DROP_FACTOR) {
+      /* The probe is causing congestion */
+      kms_remb_remote_stop_probe (rm, remb, now);
+      return br_send;
+    }
+
+    if (now - rm->probe_step_time < REMB_PROBE_STEP_TIME) {
+      return MAX (br_send, rm->probe_bitrate);
+    }
+
+    if (remb < rm->probe_bitrate * REMB_PROBE_SUCCESS_FACTOR ||
+        !kms_remb_remote_start_probe_step (rm, MAX (remb, rm->probe_bitrate),
+            now)) {
+      kms_remb_remote_stop_probe (rm, remb, now);
+      return br_send;
+    }
+
+    return MAX (br_send, rm->probe_bitrate);
+  }
+
+  if (rm->remb > 0 && remb < rm->remb * REMB_PROBE_DROP_FACTOR) {
+    GST_DEBUG_OBJECT (KMS_REMB_BASE (rm)->rtpsess,
+        "REMB dropped from %" G_GUINT32_FORMAT " to %" G_GUINT32_FORMAT
+        ", probing again in %d ms", rm->remb, remb, rm->probe_delay);
+    rm->probe_time = now + rm->probe_delay * GST_MSECOND;
+    return br_send;
+  }
+
+  if (rm->probe_time == GST_CLOCK_TIME_NONE || now < rm->probe_time) {
+    return br_send;
+  }
+
+  rm->probe_time = GST_CLOCK_TIME_NONE;
+  rm->probe_steps_left = rm->probe_steps;
+
+  if (!kms_remb_remote_start_probe_step (rm, MAX (remb, br_send), now)) {
+    kms_remb_remote_stop_probe (rm, remb, now);
+    return br_send;
+  }
+
+  return rm->probe_bitrate;
+}
+
 static void
 kms_remb_remote_update (KmsRembRemote * rm,
     KmsRTCPPSFBAFBREMBPacket * remb_packet)
@@ -631,6 +771,8 @@ kms_remb_remote_update (KmsRembRemote * rm,
         " A inconsistent management could take place", remb_packet->n_ssrcs);
   }
 
+  KMS_REMB_BASE_LOCK (rm);
+
   br_send = remb_packet->bitrate;
   if (!rm->probed) {
     if ((remb_packet->bitrate < rm->remb_on_connect)
@@ -638,14 +780,20 @@ kms_remb_remote_update (KmsRembRemote * rm,
       GST_DEBUG_OBJECT (KMS_REMB_BASE (rm)->rtpsess,
           "Not probed: sending remb_on_connect value");
       br_send = rm->remb_on_connect;
-      rm->remb = remb_packet->bitrate;
+      g_atomic_int_set (&rm->remb, remb_packet->bitrate);
     } else {
       rm->probed = TRUE;
     }
   }
 
+  br_send = kms_remb_remote_probe (rm, remb_packet->bitrate, br_send);
+  /* Read by the endpoints without taking the manager lock */
+  g_atomic_int_set (&rm->remb, remb_packet->bitrate);
+
+  KMS_REMB_BASE_UNLOCK (rm);
+
+  /* Not locked, the event may reach code that updates the limits */
   send_remb_event (rm, br_send, remb_packet->ssrcs[0]);
-  rm->remb = remb_packet->bitrate;
 }
 
 static void
@@ -760,6 +908,12 @@ kms_remb_remote_create (GObject * rtpsess, guint local_ssrc,
   rm->max_bw = max_bw;
 
   rm->remb_on_connect = DEFAULT_REMB_ON_CONNECT;
+  rm->probe_factor = DEFAULT_REMB_PROBE_FACTOR;
+  rm->probe_steps = DEFAULT_REMB_PROBE_STEPS;
+  rm->probe_delay = DEFAULT_REMB_PROBE_DELAY;
+
+  /* Probe as soon as the first REMB is received */
+  rm->probe_time = 0;
 
   rm->pad_event = g_object_ref (pad);
   gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
@@ -772,20 +926,54 @@ void
 kms_remb_remote_set_params (KmsRembRemote * rm, GstStructure * params)
 {
   gint auxi;
+  gfloat auxf;
   gboolean is_set;
 
+  KMS_REMB_BASE_LOCK (rm);
+
   is_set =
       gst_structure_get (params, "remb-on-connect", G_TYPE_INT, &auxi, NULL);
   if (is_set) {
     rm->remb_on_connect = auxi;
   }
+
+  is_set = gst_structure_get (params, "probe-factor", G_TYPE_FLOAT, &auxf,
+      NULL);
+  if (is_set) {
+    rm->probe_factor = auxf;
+  }
+
+  is_set = gst_structure_get (params, "probe-steps", G_TYPE_INT, &auxi, NULL);
+  if (is_set) {
+    rm->probe_steps = auxi;
+  }
+
+  is_set = gst_structure_get (params, "probe-delay", G_TYPE_INT, &auxi, NULL);
+  if (is_set) {
+    rm->probe_delay = auxi;
+  }
+
+  KMS_REMB_BASE_UNLOCK (rm);
 }
 
 void
 kms_remb_remote_get_params (KmsRembRemote * rm, GstStructure ** params)
 {
+  KMS_REMB_BASE_LOCK (rm);
   gst_structure_set (*params,
-      "remb-on-connect", G_TYPE_INT, rm->remb_on_connect, NULL);
+      "remb-on-connect", G_TYPE_INT, rm->remb_on_connect,
+      "probe-factor", G_TYPE_FLOAT, rm->probe_factor,
+      "probe-steps", G_TYPE_INT, rm->probe_steps,
+      "probe-delay", G_TYPE_INT, rm->probe_delay, NULL);
+  KMS_REMB_BASE_UNLOCK (rm);
+}
+
+void
+kms_remb_remote_set_max_bw (KmsRembRemote * rm, guint max_bw)
+{
+  KMS_REMB_BASE_LOCK (rm);
+  rm->max_bw = max_bw;
+  KMS_REMB_BASE_UNLOCK (rm);
 }
 
 /* KmsRembRemote end */
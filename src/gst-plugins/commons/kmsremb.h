@@ -92,10 +92,19 @@ struct _KmsRembRemote
   guint max_bw;
 
   gint remb_on_connect;
+  gfloat probe_factor;
+  gint probe_steps;
+  gint probe_delay;
 
   guint remb;
   gboolean probed;
   GstPad *pad_event;
+
+  /* Bandwidth probing */
+  guint probe_bitrate;
+  gint probe_steps_left;
+  GstClockTime probe_step_time;
+  GstClockTime probe_time;
 };
 
 KmsRembRemote * kms_remb_remote_create (GObject *rtpsess,
@@ -103,6 +112,7 @@ KmsRembRemote * kms_remb_remote_create (GObject *rtpsess,
 void kms_remb_remote_destroy (KmsRembRemote *rm);
 void kms_remb_remote_set_params (KmsRembRemote *rm, GstStructure *params);
 void kms_remb_remote_get_params (KmsRembRemote *rm, GstStructure **params);
+void kms_remb_remote_set_max_bw (KmsRembRemote *rm, guint max_bw);
 /* KmsRembRemote end */
 
 G_END_DECLS
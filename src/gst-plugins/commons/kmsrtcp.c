@@ -164,7 +164,9 @@ kms_rtcp_psfb_afb_remb_get_packet (KmsRTCPPSFBAFBPacket * afb_packet,
   br_mantissa = (fci[0] & 0x03) << 16;
   br_mantissa += (fci[1] << 8);
   br_mantissa += (fci[2]);
-  remb_packet->bitrate = br_mantissa << br_exp;
+  /* Shifting 32 bits or more is undefined, clamp instead */
+  remb_packet->bitrate = MIN ((br_exp < 32 ?
+          (guint64) br_mantissa << br_exp : G_MAXUINT64), G_MAXUINT32);
   fci += 3;
 
   length = fci_end - fci;
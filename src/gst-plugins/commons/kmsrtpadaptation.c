@@ -0,0 +1,196 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtpadaptation.h"
+
+/* Retransmission history is sized to cover RTT + margin at current bitrate */
+#define RTX_HISTORY_MARGIN 200  /* ms */
+#define RTX_MEMORY_LIMIT_DEFAULT 256    /* MiB */
+/* Used to charge histories before their packet size is known */
+#define RTX_INITIAL_PACKET_SIZE 1200    /* bytes */
+
+#define FEC_NACK_ONLY_RTT 100   /* ms */
+#define FEC_MIN_LOSS 1          /* % */
+#define FEC_LOSS_FACTOR 2
+#define FEC_MAX_PERCENTAGE 50   /* % */
+#define FEC_PERCENTAGE_STEP 5   /* % */
+
+#define JB_JITTER_FACTOR 4
+#define JB_LATENCY_MARGIN 20    /* ms */
+#define JB_LATENCY_GROW_STEP 50 /* ms */
+#define JB_LATENCY_SHRINK_STEP 10       /* ms */
+
+static GMutex rtx_memory_mutex;
+static guint64 rtx_memory_used = 0;
+static guint64 rtx_memory_limit = 0;
+
+guint64
+kms_rtx_history_get_memory_limit (void)
+{
+  static gsize init = 0;
+
+  if (g_once_init_enter (&init)) {
+    const gchar *env = g_getenv (KMS_RTX_MEMORY_LIMIT_ENV);
+    guint64 limit = RTX_MEMORY_LIMIT_DEFAULT;
+
+    if (env != NULL && g_ascii_strtoull (env, NULL, 10) > 0) {
+      limit = g_ascii_strtoull (env, NULL, 10);
+    }
+
+    rtx_memory_limit = limit * 1024 * 1024;
+
+    g_once_init_leave (&init, 1);
+  }
+
+  return rtx_memory_limit;
+}
+
+/* Moves the memory accounted in @reserved to @memory, returns what fits */
+static guint64
+rtx_memory_reserve (guint64 * reserved, guint64 memory)
+{
+  guint64 limit = kms_rtx_history_get_memory_limit ();
+  guint64 available;
+
+  g_mutex_lock (&rtx_memory_mutex);
+
+  rtx_memory_used -= *reserved;
+  available = limit > rtx_memory_used ? limit - rtx_memory_used : 0;
+  memory = MIN (memory, available);
+  rtx_memory_used += memory;
+  *reserved = memory;
+
+  g_mutex_unlock (&rtx_memory_mutex);
+
+  return memory;
+}
+
+guint
+kms_rtx_history_get_initial_size (guint64 * reserved, guint size)
+{
+  guint64 memory;
+
+  memory = rtx_memory_reserve (reserved,
+      (guint64) size * RTX_INITIAL_PACKET_SIZE);
+
+  return MAX (memory / RTX_INITIAL_PACKET_SIZE, KMS_RTX_HISTORY_MIN_SIZE);
+}
+
+/*
+ * @rtt is in NTP short format (16.16 seconds), @bitrate in bps. When the
+ * budget runs out a history keeps what still fits, but never less than
+ * KMS_RTX_HISTORY_MIN_SIZE packets.
+ */
+guint
+kms_rtx_history_get_size (guint64 * reserved, guint rtt, guint64 bitrate,
+    guint avg_packet_size)
+{
+  guint64 window, memory;
+  guint size;
+
+  avg_packet_size = MAX (avg_packet_size, 1);
+  window = ((guint64) rtt * 1000 >> 16) + RTX_HISTORY_MARGIN;
+  memory = bitrate / 8 * window / 1000;
+  size = CLAMP (memory / avg_packet_size, KMS_RTX_HISTORY_MIN_SIZE,
+      KMS_RTX_HISTORY_MAX_SIZE);
+
+  memory = rtx_memory_reserve (reserved, (guint64) size * avg_packet_size);
+
+  return MAX (memory / avg_packet_size, KMS_RTX_HISTORY_MIN_SIZE);
+}
+
+void
+kms_rtx_history_release (guint64 * reserved)
+{
+  rtx_memory_reserve (reserved, 0);
+}
+
+/*
+ * @rtt is in NTP short format, @fraction_lost in 1/256 units and @bitrate,
+ * which includes the overhead of @current, in bps. @available_bw is the
+ * estimated bandwidth or 0 if unknown.
+ */
+guint
+kms_fec_get_percentage (guint current, gboolean nack, guint rtt,
+    guint fraction_lost, guint64 bitrate, guint available_bw)
+{
+  guint rtt_ms, loss, percentage;
+  guint64 media_bitrate;
+
+  if (rtt == 0 || bitrate == 0) {
+    return current;
+  }
+
+  rtt_ms = (guint64) rtt * 1000 >> 16;
+  loss = fraction_lost * 100 / 256;
+
+  if (nack && rtt_ms < FEC_NACK_ONLY_RTT) {
+    /* Retransmissions arrive in time, do not waste bandwidth on FEC */
+    percentage = 0;
+  } else if (loss < FEC_MIN_LOSS) {
+    percentage = 0;
+  } else {
+    percentage = MIN (loss * FEC_LOSS_FACTOR, FEC_MAX_PERCENTAGE);
+  }
+
+  media_bitrate = MAX (bitrate * 100 / (100 + current), 1);
+
+  if (available_bw > 0) {
+    guint max_percentage = 0;
+
+    if (available_bw > media_bitrate) {
+      max_percentage = MIN ((available_bw - media_bitrate) * 100 /
+          media_bitrate, FEC_MAX_PERCENTAGE);
+    }
+
+    percentage = MIN (percentage, max_percentage);
+  }
+
+  if (percentage != 0 && percentage != current &&
+      ABS ((gint) percentage - (gint) current) < FEC_PERCENTAGE_STEP) {
+    return current;
+  }
+
+  return percentage;
+}
+
+guint
+kms_jitter_buffer_get_latency (guint latency, guint min_latency,
+    guint max_latency, guint jitter, guint rtx_rtt, gboolean growing)
+{
+  guint target;
+
+  if (rtx_rtt > 0) {
+    min_latency = MAX (min_latency, rtx_rtt + JB_LATENCY_MARGIN);
+  }
+
+  target = jitter * JB_JITTER_FACTOR + JB_LATENCY_MARGIN;
+
+  if (growing) {
+    target = MAX (target, latency + JB_LATENCY_GROW_STEP);
+  }
+
+  target = CLAMP (target, min_latency, MAX (min_latency, max_latency));
+
+  if (target > latency) {
+    target = MIN (target, latency + JB_LATENCY_GROW_STEP);
+  } else if (latency > JB_LATENCY_SHRINK_STEP) {
+    target = MAX (target, latency - JB_LATENCY_SHRINK_STEP);
+  }
+
+  return target;
+}
@@ -0,0 +1,58 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __KMS_RTP_ADAPTATION_H__
+#define __KMS_RTP_ADAPTATION_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* Policies used by RTP endpoints to adapt to the feedback of the network */
+
+#define KMS_RTX_HISTORY_MIN_SIZE 32             /* packets */
+#define KMS_RTX_HISTORY_MAX_SIZE 8192           /* packets */
+#define KMS_RTX_MEMORY_LIMIT_ENV "KMS_RTX_MEMORY_LIMIT"     /* MiB */
+
+/*
+ * Retransmission history memory is shared by all the endpoints of the
+ * process. @reserved holds the bytes accounted to a history, it must be
+ * released with kms_rtx_history_release.
+ */
+guint kms_rtx_history_get_initial_size (guint64 *reserved, guint size);
+guint kms_rtx_history_get_size (guint64 *reserved, guint rtt,
+  guint64 bitrate, guint avg_packet_size);
+void kms_rtx_history_release (guint64 *reserved);
+guint64 kms_rtx_history_get_memory_limit (void);
+
+/*
+ * FEC protection follows receiver reported losses. Returns the percentage
+ * to use instead of @current, or @current if the change is not worth it.
+ */
+guint kms_fec_get_percentage (guint current, gboolean nack, guint rtt,
+  guint fraction_lost, guint64 bitrate, guint available_bw);
+
+/*
+ * Jitter buffer latency follows the interarrival jitter within
+ * [@min_latency, @max_latency], all in ms. It grows fast when packets
+ * arrive late (@growing) and shrinks slowly to avoid audible or visible
+ * playout jumps. A non zero @rtx_rtt leaves room for retransmissions.
+ */
+guint kms_jitter_buffer_get_latency (guint latency, guint min_latency,
+  guint max_latency, guint jitter, guint rtx_rtt, gboolean growing);
+
+G_END_DECLS
+#endif /* __KMS_RTP_ADAPTATION_H__ */
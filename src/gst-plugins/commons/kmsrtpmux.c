@@ -0,0 +1,1038 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <gio/gio.h>
+
+#ifdef __linux__
+#include <linux/filter.h>
+#endif
+
+#include "kmsrtpmux.h"
+#include "kmsloop.h"
+#include "kmsrefstruct.h"
+
+#define GST_DEFAULT_NAME "kmsrtpmux"
+#define GST_CAT_DEFAULT kms_rtp_mux_debug
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+/* Port range used by the demuxer, as "min-max". A range starting at 0 */
+/* opens max + 1 ports chosen by the system.                            */
+#define KMS_RTP_MUX_PORTS_ENV_VAR "KMS_RTP_MUX_PORTS"
+#define DEFAULT_MIN_PORT 40000
+#define DEFAULT_N_PORTS 4
+#define MAX_N_PORTS 64
+
+/* Sockets opened with SO_REUSEPORT on every port, each one served from */
+/* its own thread.                                                      */
+#define KMS_RTP_MUX_SHARDS_ENV_VAR "KMS_RTP_MUX_SHARDS"
+#define DEFAULT_N_SHARDS 1
+#define MAX_N_SHARDS 16
+
+#define MAX_PACKET_SIZE 2048
+/* Packets read from a socket before letting other sockets be served */
+#define MAX_PACKETS_PER_DISPATCH 64
+
+#define RTP_VERSION 2
+#define RTP_HEADER_SIZE 12
+#define RTCP_HEADER_SIZE 8
+
+typedef struct _KmsRtpMuxKey
+{
+  guint8 addr[16];              /* IPv6 or IPv4-mapped IPv6 address */
+  guint16 port;
+  guint32 ssrc;
+} KmsRtpMuxKey;
+
+typedef struct _KmsRtpMuxRoute
+{
+  KmsRefStruct ref;
+
+  guint id;
+  guint32 ssrc;
+  gboolean has_remote;
+  GSocketAddress *remote_addr;
+  /* Last remote that could not be learnt, so that it is not retried */
+  /* with the write lock on every packet                             */
+  KmsRtpMuxKey rejected;
+  guint port_index;
+
+  KmsRtpMuxRecvFunc func;
+  gpointer user_data;
+  GDestroyNotify notify;
+
+  /* Keys of the routing table pointing to this route */
+  GSList *keys;
+} KmsRtpMuxRoute;
+
+typedef struct _KmsRtpMuxSocket
+{
+  KmsRtpMux *mux;
+  guint port_index;
+  guint port;
+  GSocket *socket;
+  GSource *source;
+  KmsLoop *loop;
+
+  /* Only written from the shard thread */
+  guint64 received;
+  guint64 dropped;
+} KmsRtpMuxSocket;
+
+struct _KmsRtpMux
+{
+  /* Packets look routes up concurrently from every shard */
+  GRWLock lock;
+
+  GSocketFamily family;
+  guint n_ports;
+  guint n_shards;
+  /* Ports whose shards are steered by SSRC, kernel hash is used otherwise */
+  guint n_steered;
+  /* n_ports * n_shards, shards of a port are contiguous */
+  KmsRtpMuxSocket *sockets;
+
+  GHashTable *routes;           /* id -> route */
+  GHashTable *table;            /* KmsRtpMuxKey -> route */
+  guint next_id;
+  guint next_port;
+};
+
+G_LOCK_DEFINE_STATIC (mux);
+static KmsRtpMux *mux_instance = NULL;
+static guint mux_refcount = 0;
+
+static guint
+kms_rtp_mux_key_hash (const KmsRtpMuxKey * key)
+{
+  const guint8 *p = (const guint8 *) key;
+  guint hash = 2166136261u;
+  guint i;
+
+  /* FNV-1a */
+  for (i = 0; i < sizeof (KmsRtpMuxKey); i++) {
+    hash = (hash ^ p[i]) * 16777619u;
+  }
+
+  return hash;
+}
+
+static gboolean
+kms_rtp_mux_key_equal (const KmsRtpMuxKey * k1, const KmsRtpMuxKey * k2)
+{
+  return memcmp (k1, k2, sizeof (KmsRtpMuxKey)) == 0;
+}
+
+static gboolean
+kms_rtp_mux_key_from_sockaddr (KmsRtpMuxKey * key,
+    const struct sockaddr_storage *from)
+{
+  /* Keys are compared as raw memory, padding included */
+  memset (key, 0, sizeof (KmsRtpMuxKey));
+
+  if (from->ss_family == AF_INET6) {
+    const struct sockaddr_in6 *in6 = (const struct sockaddr_in6 *) from;
+
+    memcpy (key->addr, &in6->sin6_addr, 16);
+    key->port = g_ntohs (in6->sin6_port);
+  } else if (from->ss_family == AF_INET) {
+    const struct sockaddr_in *in = (const struct sockaddr_in *) from;
+
+    key->addr[10] = key->addr[11] = 0xff;
+    memcpy (key->addr + 12, &in->sin_addr, 4);
+    key->port = g_ntohs (in->sin_port);
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+kms_rtp_mux_key_from_inet_address (KmsRtpMuxKey * key, GInetAddress * addr,
+    guint port)
+{
+  memset (key, 0, sizeof (KmsRtpMuxKey));
+
+  if (g_inet_address_get_family (addr) == G_SOCKET_FAMILY_IPV4) {
+    key->addr[10] = key->addr[11] = 0xff;
+    memcpy (key->addr + 12, g_inet_address_to_bytes (addr), 4);
+  } else {
+    memcpy (key->addr, g_inet_address_to_bytes (addr), 16);
+  }
+
+  key->port = port;
+}
+
+static gboolean
+kms_rtp_mux_key_is_ipv4 (const KmsRtpMuxKey * key)
+{
+  static const guint8 prefix[12] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xff,
+    0xff
+  };
+
+  return memcmp (key->addr, prefix, sizeof (prefix)) == 0;
+}
+
+static GSocketAddress *
+kms_rtp_mux_key_to_socket_address (KmsRtpMux * mux, const KmsRtpMuxKey * key)
+{
+  GSocketAddress *addr;
+  GInetAddress *inet;
+
+  if (mux->family == G_SOCKET_FAMILY_IPV6) {
+    /* Dual stack socket, IPv4 peers are reached through mapped addresses */
+    inet = g_inet_address_new_from_bytes (key->addr, G_SOCKET_FAMILY_IPV6);
+  } else if (kms_rtp_mux_key_is_ipv4 (key)) {
+    inet = g_inet_address_new_from_bytes (key->addr + 12,
+        G_SOCKET_FAMILY_IPV4);
+  } else {
+    return NULL;
+  }
+
+  addr = g_inet_socket_address_new (inet, key->port);
+  g_object_unref (inet);
+
+  return addr;
+}
+
+static gboolean
+kms_rtp_mux_parse_packet (GstBuffer * buffer, gboolean * is_rtcp,
+    guint32 * ssrc)
+{
+  guint8 header[RTP_HEADER_SIZE];
+  gsize size;
+
+  size = gst_buffer_extract (buffer, 0, header, sizeof (header));
+
+  if (size < RTCP_HEADER_SIZE || (header[0] >> 6) != RTP_VERSION) {
+    return FALSE;
+  }
+
+  /* rfc5761: RTCP packet types take the 192-223 range */
+  *is_rtcp = header[1] >= 192 && header[1] <= 223;
+
+  if (*is_rtcp) {
+    *ssrc = GST_READ_UINT32_BE (header + 4);
+  } else if (size >= RTP_HEADER_SIZE) {
+    *ssrc = GST_READ_UINT32_BE (header + 8);
+  } else {
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static void
+kms_rtp_mux_route_destroy (KmsRtpMuxRoute * route)
+{
+  if (route->notify != NULL) {
+    route->notify (route->user_data);
+  }
+
+  g_clear_object (&route->remote_addr);
+  g_slist_free (route->keys);
+
+  g_slice_free (KmsRtpMuxRoute, route);
+}
+
+/* Returns FALSE if @key is already routed, it is then left unchanged */
+static gboolean
+kms_rtp_mux_insert_key (KmsRtpMux * mux, KmsRtpMuxRoute * route,
+    const KmsRtpMuxKey * key)
+{
+  KmsRtpMuxRoute *other;
+  KmsRtpMuxKey *k;
+
+  other = g_hash_table_lookup (mux->table, key);
+
+  if (other != NULL) {
+    return other == route;
+  }
+
+  k = g_memdup (key, sizeof (KmsRtpMuxKey));
+  g_hash_table_insert (mux->table, k, route);
+  route->keys = g_slist_prepend (route->keys, k);
+
+  return TRUE;
+}
+
+/* Returns FALSE if the route key for @remote belongs to another route */
+static gboolean
+kms_rtp_mux_route_set_remote (KmsRtpMux * mux, KmsRtpMuxRoute * route,
+    const KmsRtpMuxKey * remote)
+{
+  KmsRtpMuxKey key = *remote;
+
+  if (route->ssrc != 0) {
+    key.ssrc = route->ssrc;
+  }
+
+  if (!kms_rtp_mux_insert_key (mux, route, &key)) {
+    return FALSE;
+  }
+
+  route->has_remote = TRUE;
+  route->remote_addr = kms_rtp_mux_key_to_socket_address (mux, remote);
+
+  if (route->ssrc != 0) {
+    /* RTCP from the remote may come with an SSRC not seen in RTP. It goes */
+    /* to the first route of the remote if several share its address.     */
+    key.ssrc = 0;
+    if (!kms_rtp_mux_insert_key (mux, route, &key)) {
+      GST_DEBUG ("Route %u shares its remote address, RTCP without a known"
+          " SSRC goes to another route", route->id);
+    }
+  }
+
+  return TRUE;
+}
+
+/* Must be called with the lock held, @learn tells if it is a write lock */
+static KmsRtpMuxRoute *
+kms_rtp_mux_lookup (KmsRtpMux * mux, KmsRtpMuxKey * key, guint32 ssrc,
+    gboolean learn, gboolean * need_learn)
+{
+  KmsRtpMuxRoute *route;
+  KmsRtpMuxKey pending;
+
+  key->ssrc = ssrc;
+  route = g_hash_table_lookup (mux->table, key);
+
+  if (route != NULL) {
+    return route;
+  }
+
+  /* Routes waiting for their remote port are keyed by host and SSRC */
+  pending = *key;
+  pending.port = 0;
+  route = g_hash_table_lookup (mux->table, &pending);
+
+  if (route != NULL && !route->has_remote) {
+    if (kms_rtp_mux_key_equal (&route->rejected, key)) {
+      return NULL;
+    }
+
+    if (!learn) {
+      *need_learn = TRUE;
+      return NULL;
+    }
+
+    key->ssrc = 0;
+    if (!kms_rtp_mux_route_set_remote (mux, route, key)) {
+      key->ssrc = ssrc;
+      route->rejected = *key;
+      GST_DEBUG ("Route %u can not learn its remote port %u", route->id,
+          key->port);
+      return NULL;
+    }
+    GST_DEBUG ("Route %u learnt its remote port %u", route->id, key->port);
+
+    return route;
+  }
+
+  key->ssrc = 0;
+
+  return g_hash_table_lookup (mux->table, key);
+}
+
+static void
+kms_rtp_mux_dispatch (KmsRtpMuxSocket * s, GstBuffer * buffer,
+    const struct sockaddr_storage *from)
+{
+  KmsRtpMux *mux = s->mux;
+  KmsRtpMuxRoute *route = NULL;
+  gboolean need_learn = FALSE;
+  KmsRtpMuxKey key;
+  gboolean is_rtcp;
+  guint32 ssrc;
+  gboolean valid;
+
+  valid = kms_rtp_mux_parse_packet (buffer, &is_rtcp, &ssrc) &&
+      kms_rtp_mux_key_from_sockaddr (&key, from);
+
+  s->received++;
+
+  if (valid) {
+    g_rw_lock_reader_lock (&mux->lock);
+    route = kms_rtp_mux_lookup (mux, &key, ssrc, FALSE, &need_learn);
+
+    if (route != NULL) {
+      /* Answer from the port the remote is sending to */
+      g_atomic_int_set (&route->port_index, s->port_index);
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (route));
+    }
+
+    g_rw_lock_reader_unlock (&mux->lock);
+  }
+
+  if (need_learn) {
+    /* Only the first packet of routes without remote port gets here */
+    g_rw_lock_writer_lock (&mux->lock);
+    route = kms_rtp_mux_lookup (mux, &key, ssrc, TRUE, &need_learn);
+
+    if (route != NULL) {
+      route->port_index = s->port_index;
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (route));
+    }
+
+    g_rw_lock_writer_unlock (&mux->lock);
+  }
+
+  if (route == NULL) {
+    s->dropped++;
+    GST_LOG ("Dropping unroutable packet on port %u", s->port);
+    gst_buffer_unref (buffer);
+    return;
+  }
+
+  route->func (buffer, is_rtcp, route->user_data);
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (route));
+}
+
+static gboolean
+kms_rtp_mux_socket_ready (GSocket * socket, GIOCondition condition,
+    KmsRtpMuxSocket * s)
+{
+  gint fd = g_socket_get_fd (socket);
+  guint i;
+
+  for (i = 0; i < MAX_PACKETS_PER_DISPATCH; i++) {
+    struct sockaddr_storage from;
+    socklen_t from_len = sizeof (from);
+    GstBuffer *buffer;
+    GstMapInfo info;
+    gssize len;
+
+    buffer = gst_buffer_new_allocate (NULL, MAX_PACKET_SIZE, NULL);
+    gst_buffer_map (buffer, &info, GST_MAP_WRITE);
+    len = recvfrom (fd, info.data, info.size, MSG_TRUNC,
+        (struct sockaddr *) &from, &from_len);
+    gst_buffer_unmap (buffer, &info);
+
+    if (len < 0) {
+      gst_buffer_unref (buffer);
+
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        GST_WARNING ("Error receiving on port %u: %s", s->port,
+            g_strerror (errno));
+      }
+
+      break;
+    }
+
+    if (len > MAX_PACKET_SIZE) {
+      GST_WARNING ("Dropping truncated packet of %" G_GSSIZE_FORMAT
+          " bytes on port %u", len, s->port);
+      gst_buffer_unref (buffer);
+      continue;
+    }
+
+    gst_buffer_set_size (buffer, len);
+    kms_rtp_mux_dispatch (s, buffer, &from);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+#if defined (SO_ATTACH_REUSEPORT_CBPF)
+/* Steers every packet to shard SSRC % n_shards so each stream is always */
+/* handled by the same thread and keeps its order. The kernel runs the   */
+/* program with the UDP payload at offset 0, so RTP and RTCP are told    */
+/* apart as in kms_rtp_mux_parse_packet.                                  */
+static gboolean
+kms_rtp_mux_attach_steering (GSocket * socket, guint n_shards)
+{
+  struct sock_filter code[] = {
+    /* A = payload type */
+    BPF_STMT (BPF_LD | BPF_B | BPF_ABS, 1),
+    BPF_JUMP (BPF_JMP | BPF_JGE | BPF_K, 192, 0, 3),
+    BPF_JUMP (BPF_JMP | BPF_JGT | BPF_K, 223, 2, 0),
+    /* RTCP: A = sender SSRC */
+    BPF_STMT (BPF_LD | BPF_W | BPF_ABS, 4),
+    BPF_JUMP (BPF_JMP | BPF_JA, 1, 0, 0),
+    /* RTP: A = SSRC */
+    BPF_STMT (BPF_LD | BPF_W | BPF_ABS, 8),
+    BPF_STMT (BPF_ALU | BPF_MOD | BPF_K, n_shards),
+    BPF_STMT (BPF_RET | BPF_A, 0),
+  };
+  struct sock_fprog prog = { G_N_ELEMENTS (code), code };
+
+  if (setsockopt (g_socket_get_fd (socket), SOL_SOCKET,
+          SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof (prog)) < 0) {
+    GST_WARNING ("Can not attach SSRC steering program: %s",
+        g_strerror (errno));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+#endif
+
+/* SSRC steering is attached if @steered is not NULL, it then tells if */
+/* it could be.                                                        */
+static GSocket *
+kms_rtp_mux_create_socket (guint port, guint n_shards, gboolean * steered,
+    GSocketFamily * family)
+{
+  GSocketAddress *addr;
+  GInetAddress *any;
+  GSocket *socket;
+  GError *err = NULL;
+
+  /* GLib makes IPv6 sockets dual stack */
+  *family = G_SOCKET_FAMILY_IPV6;
+  socket = g_socket_new (*family, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+
+  if (socket == NULL) {
+    *family = G_SOCKET_FAMILY_IPV4;
+    socket = g_socket_new (*family, G_SOCKET_TYPE_DATAGRAM,
+        G_SOCKET_PROTOCOL_UDP, &err);
+  }
+
+  if (socket == NULL) {
+    GST_ERROR ("Can not create socket: %s", err->message);
+    g_error_free (err);
+    return NULL;
+  }
+
+  g_socket_set_blocking (socket, FALSE);
+
+  if (n_shards > 1) {
+#if defined (SO_REUSEPORT)
+    gint one = 1;
+
+    if (setsockopt (g_socket_get_fd (socket), SOL_SOCKET, SO_REUSEPORT, &one,
+            sizeof (one)) < 0) {
+      GST_ERROR ("Can not share port %u: %s", port, g_strerror (errno));
+      g_object_unref (socket);
+      return NULL;
+    }
+#if defined (SO_ATTACH_REUSEPORT_CBPF)
+    /* The program is shared by the whole group, attaching it once is enough */
+    if (steered != NULL) {
+      *steered = kms_rtp_mux_attach_steering (socket, n_shards);
+    }
+#else
+    if (steered != NULL) {
+      GST_WARNING ("SSRC steering not supported, kernel hash is used");
+      *steered = FALSE;
+    }
+#endif
+#else
+    GST_ERROR ("SO_REUSEPORT not supported, port %u can not be shared", port);
+    g_object_unref (socket);
+    return NULL;
+#endif
+  }
+
+  any = g_inet_address_new_any (*family);
+  addr = g_inet_socket_address_new (any, port);
+  g_object_unref (any);
+
+  if (!g_socket_bind (socket, addr, FALSE, &err)) {
+    GST_ERROR ("Can not bind port %u: %s", port, err->message);
+    g_error_free (err);
+    g_object_unref (socket);
+    socket = NULL;
+  }
+
+  g_object_unref (addr);
+
+  return socket;
+}
+
+static guint
+kms_rtp_mux_get_n_shards (void)
+{
+  const gchar *env = g_getenv (KMS_RTP_MUX_SHARDS_ENV_VAR);
+  guint64 n;
+
+  if (env == NULL) {
+    return DEFAULT_N_SHARDS;
+  }
+
+  n = g_ascii_strtoull (env, NULL, 10);
+
+  if (n == 0 || n > MAX_N_SHARDS) {
+    GST_WARNING ("Invalid %s value '%s', using %u", KMS_RTP_MUX_SHARDS_ENV_VAR,
+        env, DEFAULT_N_SHARDS);
+    return DEFAULT_N_SHARDS;
+  }
+
+  return n;
+}
+
+static void
+kms_rtp_mux_get_port_range (guint * min_port, guint * n_ports)
+{
+  const gchar *env = g_getenv (KMS_RTP_MUX_PORTS_ENV_VAR);
+  guint min, max;
+
+  *min_port = DEFAULT_MIN_PORT;
+  *n_ports = DEFAULT_N_PORTS;
+
+  if (env == NULL) {
+    return;
+  }
+
+  if (sscanf (env, "%u-%u", &min, &max) != 2 || max < min ||
+      max > G_MAXUINT16 || max - min >= MAX_N_PORTS) {
+    GST_WARNING ("Invalid %s value '%s', using %u-%u",
+        KMS_RTP_MUX_PORTS_ENV_VAR, env, DEFAULT_MIN_PORT,
+        DEFAULT_MIN_PORT + DEFAULT_N_PORTS - 1);
+    return;
+  }
+
+  *min_port = min;
+  *n_ports = max - min + 1;
+}
+
+static void
+kms_rtp_mux_socket_close (KmsRtpMuxSocket * s)
+{
+  if (s->source != NULL) {
+    g_source_destroy (s->source);
+    g_source_unref (s->source);
+  }
+
+  /* Waits for the receiving thread to finish */
+  g_clear_object (&s->loop);
+
+  if (s->socket != NULL) {
+    g_socket_close (s->socket, NULL);
+    g_object_unref (s->socket);
+  }
+
+  memset (s, 0, sizeof (KmsRtpMuxSocket));
+}
+
+static guint
+kms_rtp_mux_get_socket_port (GSocket * socket)
+{
+  GSocketAddress *addr;
+  guint port;
+
+  addr = g_socket_get_local_address (socket, NULL);
+
+  if (addr == NULL) {
+    return 0;
+  }
+
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
+
+  return port;
+}
+
+/* @port 0 lets the system choose it */
+static gboolean
+kms_rtp_mux_open_port (KmsRtpMux * mux, guint port)
+{
+  KmsRtpMuxSocket *shards = &mux->sockets[mux->n_ports * mux->n_shards];
+  gboolean steered = FALSE;
+  guint i;
+
+  for (i = 0; i < mux->n_shards; i++) {
+    KmsRtpMuxSocket *s = &shards[i];
+    GMainContext *context;
+    GSocketFamily family;
+
+    s->socket = kms_rtp_mux_create_socket (port, mux->n_shards,
+        i == 0 ? &steered : NULL, &family);
+
+    if (s->socket == NULL) {
+      goto error;
+    }
+
+    if (port == 0) {
+      /* The other shards share the port the system gave to the first one */
+      port = kms_rtp_mux_get_socket_port (s->socket);
+
+      if (port == 0) {
+        GST_ERROR ("Can not get the port chosen by the system");
+        goto error;
+      }
+    }
+
+    if (mux->n_ports == 0 && i == 0) {
+      mux->family = family;
+    } else if (family != mux->family) {
+      GST_WARNING ("Port %u has a different address family, not used", port);
+      goto error;
+    }
+
+    s->mux = mux;
+    s->port_index = mux->n_ports;
+    s->port = port;
+
+    /* A thread per shard, the kernel spreads packets among them */
+    s->loop = kms_loop_new ();
+    g_object_get (s->loop, "context", &context, NULL);
+    s->source = g_socket_create_source (s->socket, G_IO_IN, NULL);
+    g_source_set_callback (s->source, (GSourceFunc) kms_rtp_mux_socket_ready,
+        s, NULL);
+    g_source_attach (s->source, context);
+    g_main_context_unref (context);
+  }
+
+  mux->n_ports++;
+
+  if (steered) {
+    mux->n_steered++;
+  }
+
+  return TRUE;
+
+error:
+  for (i = 0; i < mux->n_shards; i++) {
+    kms_rtp_mux_socket_close (&shards[i]);
+  }
+
+  return FALSE;
+}
+
+static KmsRtpMux *
+kms_rtp_mux_new (void)
+{
+  KmsRtpMux *mux = g_slice_new0 (KmsRtpMux);
+  guint i, min_port, n_ports;
+
+  g_rw_lock_init (&mux->lock);
+
+  mux->routes = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) kms_ref_struct_unref);
+  mux->table = g_hash_table_new_full ((GHashFunc) kms_rtp_mux_key_hash,
+      (GEqualFunc) kms_rtp_mux_key_equal, g_free, NULL);
+
+  kms_rtp_mux_get_port_range (&min_port, &n_ports);
+  mux->n_shards = kms_rtp_mux_get_n_shards ();
+  mux->sockets = g_new0 (KmsRtpMuxSocket, n_ports * mux->n_shards);
+
+  for (i = 0; i < n_ports; i++) {
+    kms_rtp_mux_open_port (mux, min_port == 0 ? 0 : min_port + i);
+  }
+
+  GST_INFO ("RTP demuxer receiving on %u ports from %u, %u shards each",
+      mux->n_ports, min_port, mux->n_shards);
+
+  return mux;
+}
+
+static void
+kms_rtp_mux_destroy (KmsRtpMux * mux)
+{
+  guint i;
+
+  for (i = 0; i < mux->n_ports * mux->n_shards; i++) {
+    kms_rtp_mux_socket_close (&mux->sockets[i]);
+  }
+
+  g_free (mux->sockets);
+
+  g_hash_table_unref (mux->table);
+  g_hash_table_unref (mux->routes);
+
+  g_rw_lock_clear (&mux->lock);
+
+  g_slice_free (KmsRtpMux, mux);
+}
+
+KmsRtpMux *
+kms_rtp_mux_get (void)
+{
+  KmsRtpMux *mux;
+
+  G_LOCK (mux);
+
+  if (mux_instance == NULL) {
+    mux_instance = kms_rtp_mux_new ();
+  }
+
+  mux_refcount++;
+  mux = mux_instance;
+
+  G_UNLOCK (mux);
+
+  return mux;
+}
+
+/* Must not be called from a receive callback */
+void
+kms_rtp_mux_unref (KmsRtpMux * mux)
+{
+  gboolean destroy = FALSE;
+
+  g_return_if_fail (mux != NULL);
+
+  G_LOCK (mux);
+
+  if (--mux_refcount == 0) {
+    mux_instance = NULL;
+    destroy = TRUE;
+  }
+
+  G_UNLOCK (mux);
+
+  if (destroy) {
+    kms_rtp_mux_destroy (mux);
+  }
+}
+
+guint
+kms_rtp_mux_get_n_ports (KmsRtpMux * mux)
+{
+  return mux->n_ports;
+}
+
+guint
+kms_rtp_mux_get_port (KmsRtpMux * mux, guint index)
+{
+  g_return_val_if_fail (index < mux->n_ports, 0);
+
+  return mux->sockets[index * mux->n_shards].port;
+}
+
+guint
+kms_rtp_mux_add_route (KmsRtpMux * mux, const gchar * remote_host,
+    guint remote_port, guint32 ssrc, KmsRtpMuxRecvFunc func,
+    gpointer user_data, GDestroyNotify notify)
+{
+  GInetAddress *inet;
+  KmsRtpMuxRoute *route;
+  KmsRtpMuxKey key;
+  gboolean added;
+  guint id;
+
+  g_return_val_if_fail (func != NULL, 0);
+
+  if (mux->n_ports == 0) {
+    GST_ERROR ("No ports available to receive on");
+    return 0;
+  }
+
+  if (remote_host == NULL) {
+    /* Otherwise any host sending the SSRC first would take the stream */
+    GST_WARNING ("Remote address is needed to route packets");
+    return 0;
+  }
+
+  if (remote_port == 0 && ssrc == 0) {
+    GST_WARNING ("Either remote port or SSRC is needed to route packets");
+    return 0;
+  }
+
+  inet = g_inet_address_new_from_string (remote_host);
+
+  if (inet == NULL) {
+    GST_WARNING ("Invalid remote address '%s'", remote_host);
+    return 0;
+  }
+
+  route = g_slice_new0 (KmsRtpMuxRoute);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (route),
+      (GDestroyNotify) kms_rtp_mux_route_destroy);
+  route->ssrc = ssrc;
+  route->func = func;
+  route->user_data = user_data;
+  route->notify = notify;
+
+  g_rw_lock_writer_lock (&mux->lock);
+
+  if (++mux->next_id == 0) {
+    mux->next_id++;
+  }
+
+  id = route->id = mux->next_id;
+
+  kms_rtp_mux_key_from_inet_address (&key, inet, remote_port);
+
+  if (remote_port != 0) {
+    added = kms_rtp_mux_route_set_remote (mux, route, &key);
+  } else {
+    key.ssrc = ssrc;
+    added = kms_rtp_mux_insert_key (mux, route, &key);
+  }
+
+  if (added) {
+    route->port_index = mux->next_port++ % mux->n_ports;
+    g_hash_table_insert (mux->routes, GUINT_TO_POINTER (id), route);
+  }
+
+  g_rw_lock_writer_unlock (&mux->lock);
+
+  g_object_unref (inet);
+
+  if (!added) {
+    GST_WARNING ("%s:%u, ssrc %" G_GUINT32_FORMAT " is already routed, route"
+        " not added", remote_host, remote_port, ssrc);
+    /* Ownership of user_data stays with the caller */
+    route->notify = NULL;
+    kms_ref_struct_unref (KMS_REF_STRUCT_CAST (route));
+    return 0;
+  }
+
+  GST_DEBUG ("Added route %u (%s:%u, ssrc %" G_GUINT32_FORMAT ")", id,
+      remote_host, remote_port, ssrc);
+
+  return id;
+}
+
+/* user_data passed to the route may still be used by a callback running */
+/* while this function returns. Use the destroy notify to release it.    */
+void
+kms_rtp_mux_remove_route (KmsRtpMux * mux, guint route_id)
+{
+  KmsRtpMuxRoute *route;
+  GSList *l;
+
+  g_rw_lock_writer_lock (&mux->lock);
+
+  route = g_hash_table_lookup (mux->routes, GUINT_TO_POINTER (route_id));
+
+  if (route != NULL) {
+    for (l = route->keys; l != NULL; l = l->next) {
+      g_hash_table_remove (mux->table, l->data);
+    }
+
+    g_slist_free (route->keys);
+    route->keys = NULL;
+
+    g_hash_table_remove (mux->routes, GUINT_TO_POINTER (route_id));
+  }
+
+  g_rw_lock_writer_unlock (&mux->lock);
+}
+
+guint
+kms_rtp_mux_get_route_port (KmsRtpMux * mux, guint route_id)
+{
+  KmsRtpMuxRoute *route;
+  guint port = 0;
+
+  g_rw_lock_reader_lock (&mux->lock);
+
+  route = g_hash_table_lookup (mux->routes, GUINT_TO_POINTER (route_id));
+
+  if (route != NULL) {
+    port = kms_rtp_mux_get_port (mux, g_atomic_int_get (&route->port_index));
+  }
+
+  g_rw_lock_reader_unlock (&mux->lock);
+
+  return port;
+}
+
+/* @buffer is not consumed */
+gboolean
+kms_rtp_mux_send (KmsRtpMux * mux, guint route_id, GstBuffer * buffer)
+{
+  KmsRtpMuxRoute *route;
+  GSocketAddress *addr = NULL;
+  GSocket *socket = NULL;
+  GError *err = NULL;
+  GstMapInfo info;
+  gssize ret;
+
+  g_rw_lock_reader_lock (&mux->lock);
+
+  route = g_hash_table_lookup (mux->routes, GUINT_TO_POINTER (route_id));
+
+  if (route != NULL && route->remote_addr != NULL) {
+    guint port_index = g_atomic_int_get (&route->port_index);
+
+    /* Any shard of the port sends from it */
+    addr = g_object_ref (route->remote_addr);
+    socket = g_object_ref (mux->sockets[port_index * mux->n_shards].socket);
+  }
+
+  g_rw_lock_reader_unlock (&mux->lock);
+
+  if (addr == NULL) {
+    GST_LOG ("Route %u has no remote address yet", route_id);
+    return FALSE;
+  }
+
+  gst_buffer_map (buffer, &info, GST_MAP_READ);
+  ret = g_socket_send_to (socket, addr, (const gchar *) info.data, info.size,
+      NULL, &err);
+  gst_buffer_unmap (buffer, &info);
+
+  if (ret < 0) {
+    GST_DEBUG ("Can not send on route %u: %s", route_id, err->message);
+    g_error_free (err);
+  }
+
+  g_object_unref (socket);
+  g_object_unref (addr);
+
+  return ret >= 0;
+}
+
+GstStructure *
+kms_rtp_mux_get_stats (KmsRtpMux * mux)
+{
+  guint64 received = 0, dropped = 0;
+  GstStructure *stats;
+  guint i;
+
+  g_rw_lock_reader_lock (&mux->lock);
+
+  stats = gst_structure_new ("rtp-mux-stats",
+      "ports", G_TYPE_UINT, mux->n_ports,
+      "shards", G_TYPE_UINT, mux->n_shards,
+      "steered-ports", G_TYPE_UINT, mux->n_steered,
+      "routes", G_TYPE_UINT, g_hash_table_size (mux->routes), NULL);
+
+  g_rw_lock_reader_unlock (&mux->lock);
+
+  for (i = 0; i < mux->n_ports * mux->n_shards; i++) {
+    gchar *name = g_strdup_printf ("shard-%u-%u", mux->sockets[i].port,
+        i % mux->n_shards);
+
+    /* Shows how well the kernel spreads the load among threads */
+    gst_structure_set (stats, name, G_TYPE_UINT64, mux->sockets[i].received,
+        NULL);
+    g_free (name);
+
+    received += mux->sockets[i].received;
+    dropped += mux->sockets[i].dropped;
+  }
+
+  gst_structure_set (stats, "packets-received", G_TYPE_UINT64, received,
+      "packets-dropped", G_TYPE_UINT64, dropped, NULL);
+
+  return stats;
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
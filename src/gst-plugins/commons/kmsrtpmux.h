@@ -0,0 +1,64 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTP_MUX_H__
+#define __KMS_RTP_MUX_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Process wide RTP/RTCP demuxer. It receives on a small fixed set of UDP
+ * ports and hands every packet to the route that matches its remote
+ * address and SSRC, so endpoints do not need sockets of their own. RTP and
+ * RTCP share the port (rtcp-mux).
+ *
+ * Each port may be opened several times with SO_REUSEPORT, each socket
+ * served from its own thread and the kernel steering packets by SSRC, so
+ * a single heavy sender does not cap ingress at one core. Routes may then
+ * be called from several threads, but one SSRC always from the same one.
+ */
+typedef struct _KmsRtpMux KmsRtpMux;
+
+typedef void (*KmsRtpMuxRecvFunc) (GstBuffer * buffer, gboolean is_rtcp,
+    gpointer user_data);
+
+KmsRtpMux * kms_rtp_mux_get (void);
+void kms_rtp_mux_unref (KmsRtpMux * mux);
+
+guint kms_rtp_mux_get_n_ports (KmsRtpMux * mux);
+guint kms_rtp_mux_get_port (KmsRtpMux * mux, guint index);
+
+/* @remote_port may be 0 when only the host and SSRC are known. The port */
+/* is then learnt from the first packet with @ssrc coming from the host. */
+/* @ssrc may be 0 to match any SSRC coming from @remote_host:@remote_port */
+/* Returns 0, without calling @notify, if the same address and SSRC are  */
+/* already routed.                                                       */
+guint kms_rtp_mux_add_route (KmsRtpMux * mux, const gchar * remote_host,
+    guint remote_port, guint32 ssrc, KmsRtpMuxRecvFunc func,
+    gpointer user_data, GDestroyNotify notify);
+void kms_rtp_mux_remove_route (KmsRtpMux * mux, guint route_id);
+guint kms_rtp_mux_get_route_port (KmsRtpMux * mux, guint route_id);
+
+gboolean kms_rtp_mux_send (KmsRtpMux * mux, guint route_id,
+    GstBuffer * buffer);
+
+GstStructure * kms_rtp_mux_get_stats (KmsRtpMux * mux);
+
+G_END_DECLS
+#endif /* __KMS_RTP_MUX_H__ */
@@ -45,9 +45,11 @@ typedef struct _ProbeData
   gpointer user_data;
   GDestroyNotify destroy_data;
 
-  gboolean locked;
+  gboolean legacy;              /* cb is a BufferLatencyCallback */
 } ProbeData;
 
+G_DEFINE_QUARK (kms-stats-latency-mark, kms_stats_latency_mark);
+
 static BufferLatencyValues *
 buffer_latency_values_new (gboolean is_valid, KmsMediaType type)
 {
@@ -69,8 +71,8 @@ buffer_latency_values_destroy (BufferLatencyValues * blv)
 
 static ProbeData *
 probe_data_new (BufferCb invoke_cb, gpointer invoke_data,
-    GDestroyNotify destroy_invoke, GCallback cb, gboolean locked,
-    gpointer user_data, GDestroyNotify destroy_data)
+    GDestroyNotify destroy_invoke, GCallback cb, gpointer user_data,
+    GDestroyNotify destroy_data)
 {
   ProbeData *pdata;
 
@@ -84,7 +86,7 @@ probe_data_new (BufferCb invoke_cb, gpointer invoke_data,
   pdata->user_data = user_data;
   pdata->destroy_data = destroy_data;
 
-  pdata->locked = locked;
+  pdata->legacy = FALSE;
 
   return pdata;
 }
@@ -186,7 +188,7 @@ kms_stats_add_buffer_latency_meta_probe (GstPad * pad, gboolean is_valid,
   blv = buffer_latency_values_new (is_valid, type);
 
   pdata = probe_data_new (buffer_latency_probe_cb, blv,
-      (GDestroyNotify) buffer_latency_values_destroy, NULL, FALSE, NULL, NULL);
+      (GDestroyNotify) buffer_latency_values_destroy, NULL, NULL, NULL);
 
   return gst_pad_add_probe (pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
@@ -231,17 +233,61 @@ kms_stats_add_buffer_update_latency_meta_probe (GstPad * pad, gboolean is_valid,
   blv = buffer_latency_values_new (is_valid, type);
 
   pdata = probe_data_new (buffer_update_latency_probe_cb, blv,
-      (GDestroyNotify) buffer_latency_values_destroy, NULL, FALSE, NULL, NULL);
+      (GDestroyNotify) buffer_latency_values_destroy, NULL, NULL, NULL);
 
   return gst_pad_add_probe (pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
       process_buffer_probe_cb, pdata, (GDestroyNotify) probe_data_destroy);
 }
 
+static void
+legacy_list_add_mark (GQuark id, KmsRefStruct * data, KmsList * list)
+{
+  kms_list_append (list, g_strdup (g_quark_to_string (id)),
+      kms_ref_struct_ref (data));
+}
+
+static void
+buffer_latency_legacy_notify (GstPad * pad, KmsBufferLatencyMeta * blmeta,
+    GstClockTimeDiff diff, ProbeData * pdata)
+{
+  BufferLatencyCallback func = (BufferLatencyCallback) pdata->cb;
+  KmsListIter iter;
+  gpointer key, value;
+  KmsList *list;
+  guint n_marks;
+
+  list = kms_list_new_full (g_str_equal, g_free,
+      (GDestroyNotify) kms_ref_struct_unref);
+  kms_buffer_latency_meta_foreach_mark (blmeta,
+      (KmsBufferLatencyMarkFunc) legacy_list_add_mark, list);
+  n_marks = kms_list_length (list);
+
+  func (pad, blmeta->type, diff, list, pdata->user_data);
+
+  if (kms_list_length (list) == n_marks) {
+    /* Nothing to intern, the callback only read the marks */
+    kms_list_unref (list);
+    return;
+  }
+
+  /* Keep the marks added by the callback */
+  kms_list_iter_init (&iter, list);
+  while (kms_list_iter_next (&iter, &key, &value)) {
+    GQuark id = g_quark_from_string (key);
+
+    if (kms_buffer_latency_meta_lookup_mark (blmeta, id) == NULL) {
+      kms_buffer_latency_meta_add_mark (blmeta, id, value);
+    }
+  }
+
+  kms_list_unref (list);
+}
+
 static gboolean
 buffer_for_each_meta_cb (GstBuffer * buffer, GstMeta ** meta, ProbeData * pdata)
 {
-  BufferLatencyCallback func = (BufferLatencyCallback) pdata->cb;
+  BufferLatencyMetaCallback func = (BufferLatencyMetaCallback) pdata->cb;
   GstPad *pad = GST_PAD (pdata->invoke_data);
   KmsBufferLatencyMeta *blmeta;
   GstClockTimeDiff diff;
@@ -266,14 +312,10 @@ buffer_for_each_meta_cb (GstBuffer * buffer, GstMeta ** meta, ProbeData * pdata)
   now = kms_utils_get_time_nsecs ();
   diff = GST_CLOCK_DIFF (blmeta->ts, now);
 
-  if (pdata->locked) {
-    KMS_BUFFER_LATENCY_DATA_LOCK (blmeta);
-  }
-
-  func (pad, blmeta->type, diff, blmeta->data, pdata->user_data);
-
-  if (pdata->locked) {
-    KMS_BUFFER_LATENCY_DATA_UNLOCK (blmeta);
+  if (G_UNLIKELY (pdata->legacy)) {
+    buffer_latency_legacy_notify (pad, blmeta, diff, pdata);
+  } else {
+    func (pad, blmeta->type, diff, blmeta, pdata->user_data);
   }
 
   return TRUE;
@@ -286,21 +328,39 @@ buffer_latency_calculation_cb (GstBuffer * buffer, ProbeData * pdata)
       (GstBufferForeachMetaFunc) buffer_for_each_meta_cb, pdata);
 }
 
-gulong
-kms_stats_add_buffer_latency_notification_probe (GstPad * pad,
-    BufferLatencyCallback cb, gboolean locked, gpointer user_data,
-    GDestroyNotify destroy_data)
+static gulong
+add_buffer_latency_notification_probe (GstPad * pad, GCallback cb,
+    gboolean legacy, gpointer user_data, GDestroyNotify destroy_data)
 {
   ProbeData *pdata;
 
   pdata = probe_data_new (buffer_latency_calculation_cb, pad, NULL,
-      G_CALLBACK (cb), locked, user_data, destroy_data);
+      cb, user_data, destroy_data);
+  pdata->legacy = legacy;
 
   return gst_pad_add_probe (pad,
       GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_BUFFER_LIST,
       process_buffer_probe_cb, pdata, (GDestroyNotify) probe_data_destroy);
 }
 
+gulong
+kms_stats_add_buffer_latency_notification_probe_full (GstPad * pad,
+    BufferLatencyMetaCallback cb, gpointer user_data,
+    GDestroyNotify destroy_data)
+{
+  return add_buffer_latency_notification_probe (pad, G_CALLBACK (cb), FALSE,
+      user_data, destroy_data);
+}
+
+gulong
+kms_stats_add_buffer_latency_notification_probe (GstPad * pad,
+    BufferLatencyCallback cb, gboolean locked, gpointer user_data,
+    GDestroyNotify destroy_data)
+{
+  return add_buffer_latency_notification_probe (pad, G_CALLBACK (cb), TRUE,
+      user_data, destroy_data);
+}
+
 KmsStatsProbe *
 kms_stats_probe_new (GstPad * pad, KmsMediaType type)
 {
@@ -323,6 +383,18 @@ kms_stats_probe_destroy (KmsStatsProbe * probe)
   g_slice_free (KmsStatsProbe, probe);
 }
 
+void
+kms_stats_probe_add_latency_full (KmsStatsProbe * probe,
+    BufferLatencyMetaCallback callback, gpointer user_data,
+    GDestroyNotify destroy_data)
+{
+  kms_stats_probe_remove (probe);
+
+  probe->probe_id =
+      kms_stats_add_buffer_latency_notification_probe_full (probe->pad,
+      callback, user_data, destroy_data);
+}
+
 void
 kms_stats_probe_add_latency (KmsStatsProbe * probe,
     BufferLatencyCallback callback, gboolean locked, gpointer user_data,
@@ -330,8 +402,8 @@ kms_stats_probe_add_latency (KmsStatsProbe * probe,
 {
   kms_stats_probe_remove (probe);
 
-  probe->probe_id = kms_stats_add_buffer_latency_notification_probe (probe->pad,
-      callback, locked, user_data, destroy_data);
+  probe->probe_id = add_buffer_latency_notification_probe (probe->pad,
+      G_CALLBACK (callback), TRUE, user_data, destroy_data);
 }
 
 void
@@ -375,6 +447,33 @@ kms_stats_create_id_for_pad (GstElement * obj, GstPad * pad)
   return id;
 }
 
+/*
+ * Elements mark buffers with their name. It is interned the first time and
+ * kept in the element, so buffers never go through the quark table.
+ */
+GQuark
+kms_stats_get_element_latency_mark (GstElement * obj)
+{
+  gpointer mark;
+  gchar *name;
+  GQuark id;
+
+  mark = g_object_get_qdata (G_OBJECT (obj), kms_stats_latency_mark_quark ());
+
+  if (G_LIKELY (mark != NULL)) {
+    return GPOINTER_TO_UINT (mark);
+  }
+
+  name = gst_element_get_name (obj);
+  id = g_quark_from_string (name);
+  g_free (name);
+
+  g_object_set_qdata (G_OBJECT (obj), kms_stats_latency_mark_quark (),
+      GUINT_TO_POINTER (id));
+
+  return id;
+}
+
 static void
 kms_stats_stream_e2e_avg_stat_destroy (StreamE2EAvgStat * stat)
 {
@@ -21,6 +21,7 @@
 #include "kmsmediatype.h"
 #include "kmslist.h"
 #include "kmsrefstruct.h"
+#include "kmsbufferlacentymeta.h"
 
 G_BEGIN_DECLS
 
@@ -42,16 +43,27 @@ GstStructure * kms_stats_get_element_stats (GstStructure *stats);
 
 /* buffer latency */
 typedef void (*BufferLatencyCallback) (GstPad * pad, KmsMediaType type, GstClockTimeDiff t, KmsList *data, gpointer user_data);
+typedef void (*BufferLatencyMetaCallback) (GstPad * pad, KmsMediaType type, GstClockTimeDiff t, KmsBufferLatencyMeta *meta, gpointer user_data);
 gulong kms_stats_add_buffer_latency_meta_probe (GstPad * pad, gboolean is_valid, KmsMediaType type);
 gulong kms_stats_add_buffer_update_latency_meta_probe (GstPad * pad, gboolean is_valid, KmsMediaType type);
-gulong kms_stats_add_buffer_latency_notification_probe (GstPad * pad, BufferLatencyCallback cb, gboolean locked, gpointer user_data, GDestroyNotify destroy_data);
+gulong kms_stats_add_buffer_latency_notification_probe_full (GstPad * pad, BufferLatencyMetaCallback cb, gpointer user_data, GDestroyNotify destroy_data);
+
+/*
+ * Deprecated: marks are copied into a new list for every buffer, and marks
+ * added to the list are copied back to the buffer. @locked is ignored. Use
+ * kms_stats_add_buffer_latency_notification_probe_full instead.
+ */
+gulong kms_stats_add_buffer_latency_notification_probe (GstPad * pad, BufferLatencyCallback cb, gboolean locked, gpointer user_data, GDestroyNotify destroy_data) __attribute__ ((deprecated));
 
 typedef struct _KmsStatsProbe KmsStatsProbe;
 
 KmsStatsProbe * kms_stats_probe_new (GstPad *pad, KmsMediaType type);
 void kms_stats_probe_destroy (KmsStatsProbe *probe);
+void kms_stats_probe_add_latency_full (KmsStatsProbe *probe, BufferLatencyMetaCallback callback,
+  gpointer user_data, GDestroyNotify destroy_data);
+/* Deprecated: use kms_stats_probe_add_latency_full */
 void kms_stats_probe_add_latency (KmsStatsProbe *probe, BufferLatencyCallback callback,
-  gboolean locked, gpointer user_data, GDestroyNotify destroy_data);
+  gboolean locked, gpointer user_data, GDestroyNotify destroy_data) __attribute__ ((deprecated));
 void kms_stats_probe_latency_meta_set_valid (KmsStatsProbe *probe, gboolean is_valid);
 void kms_stats_probe_remove (KmsStatsProbe *probe);
 gboolean kms_stats_probe_watches (KmsStatsProbe *probe, GstPad *pad);
@@ -64,6 +76,7 @@ typedef struct _StreamE2EAvgStat
 } StreamE2EAvgStat;
 
 gchar * kms_stats_create_id_for_pad (GstElement * obj, GstPad * pad);
+GQuark kms_stats_get_element_latency_mark (GstElement * obj);
 StreamE2EAvgStat * kms_stats_stream_e2e_avg_stat_new (KmsMediaType type);
 
 #define kms_stats_stream_e2e_avg_stat_ref(obj) \
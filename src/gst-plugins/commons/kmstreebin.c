@@ -21,6 +21,7 @@
 
 #include "kmstreebin.h"
 #include "kmsutils.h"
+#include "kmscensus.h"
 
 #define GST_DEFAULT_NAME "treebin"
 #define GST_CAT_DEFAULT kms_tree_bin_debug
@@ -166,6 +167,8 @@ kms_tree_bin_finalize (GObject * object)
 
   g_mutex_clear (&self->priv->input_caps_mutex);
 
+  kms_census_remove (KMS_CENSUS_TREE_BIN);
+
   /* chain up */
   G_OBJECT_CLASS (kms_tree_bin_parent_class)->finalize (object);
 }
@@ -178,6 +181,8 @@ kms_tree_bin_init (KmsTreeBin * self)
 
   self->priv = KMS_TREE_BIN_GET_PRIVATE (self);
 
+  kms_census_add (KMS_CENSUS_TREE_BIN);
+
   g_mutex_init (&self->priv->input_caps_mutex);
 
   self->priv->output_tee = gst_element_factory_make ("tee", NULL);
@@ -14,10 +14,14 @@
  * limitations under the License.
  *
  */
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
 
 #include "kmsutils.h"
 #include "constants.h"
 #include "kmsagnosticcaps.h"
+#include "kmsprobes.h"
 #include <gst/video/video-event.h>
 #ifdef _WIN32
 #include <rpc.h>
@@ -29,6 +33,10 @@
 
 #define GST_CAT_DEFAULT kmsutils
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+
+KMS_PROBE_DEFINE (keyframe_request_sent);
+KMS_PROBE_DEFINE (keyframe_request_suppressed);
+KMS_PROBE_DEFINE (remb_min_updated);
 #define GST_DEFAULT_NAME "kmsutils"
 
 #define LAST_KEY_FRAME_REQUEST_TIME "last-key-frame-request-time"
@@ -39,6 +47,8 @@ G_DEFINE_QUARK (KMS_KEY_ID, kms_key_id);
 
 #define DEFAULT_KEYFRAME_DISPERSION GST_SECOND  /* 1s */
 
+static KmsUtilsEventHook event_hook = NULL;
+
 #define UUID_STR_SIZE 37        /* 36-byte string (plus tailing '\0') */
 #define BEGIN_CERTIFICATE "-----BEGIN CERTIFICATE-----"
 #define END_CERTIFICATE "-----END CERTIFICATE-----"
@@ -473,6 +483,23 @@ kms_utils_manage_gaps (GstPad * pad)
       gap_detection_probe, NULL, NULL);
 }
 
+void
+kms_utils_set_event_hook (KmsUtilsEventHook hook)
+{
+  g_atomic_pointer_set (&event_hook, hook);
+}
+
+static void
+kms_utils_notify_event (GstPad * pad, KmsUtilsEventType type, guint64 a,
+    guint64 b)
+{
+  KmsUtilsEventHook hook = g_atomic_pointer_get (&event_hook);
+
+  if (hook != NULL) {
+    hook (pad, type, a, b);
+  }
+}
+
 static gboolean
 check_last_request_time (GstPad * pad)
 {
@@ -525,9 +552,14 @@ control_duplicates (GstPad * pad, GstPadProbeInfo * info, gpointer data)
   if (gst_video_event_is_force_key_unit (event)) {
     if (check_last_request_time (pad)) {
       GST_TRACE_OBJECT (pad, "Sending keyframe request");
+      KMS_PROBE2 (keyframe_request_sent, pad, GST_OBJECT_NAME (pad));
+      kms_utils_notify_event (pad, KMS_UTILS_EVENT_KEYFRAME_REQUEST, 0, 0);
       return GST_PAD_PROBE_OK;
     } else {
       GST_TRACE_OBJECT (pad, "Dropping keyframe request");
+      KMS_PROBE2 (keyframe_request_suppressed, pad, GST_OBJECT_NAME (pad));
+      kms_utils_notify_event (pad, KMS_UTILS_EVENT_KEYFRAME_SUPPRESSED, 0,
+          0);
       return GST_PAD_PROBE_DROP;
     }
   }
@@ -889,6 +921,7 @@ remb_event_manager_update_min (RembEventManager * manager, guint bitrate,
   GstClockTime time = kms_utils_get_time_nsecs ();
 
   gboolean new_br = TRUE;
+  guint remb_min;
 
   g_mutex_lock (&manager->mutex);
   last_value = g_hash_table_lookup (manager->remb_hash,
@@ -920,8 +953,14 @@ remb_event_manager_update_min (RembEventManager * manager, guint bitrate,
 
   GST_TRACE_OBJECT (manager->pad, "remb_min: %" G_GUINT32_FORMAT,
       manager->remb_min);
+  KMS_PROBE4 (remb_min_updated, manager->pad, ssrc, bitrate,
+      manager->remb_min);
+  remb_min = manager->remb_min;
 
   g_mutex_unlock (&manager->mutex);
+
+  kms_utils_notify_event (manager->pad, KMS_UTILS_EVENT_REMB, ssrc,
+      ((guint64) bitrate << 32) | remb_min);
 }
 
 static GstPadProbeReturn
@@ -75,6 +75,18 @@ void kms_utils_remb_event_manager_set_callback (RembEventManager * manager, Remb
 void kms_utils_remb_event_manager_set_clear_interval (RembEventManager * manager, GstClockTime interval);
 GstClockTime kms_utils_remb_event_manager_get_clear_interval (RembEventManager * manager);
 
+/* Control events of pads handled here, reported to the hook if any so */
+/* that kmsutils does not depend on the modules recording them          */
+typedef enum
+{
+  KMS_UTILS_EVENT_KEYFRAME_REQUEST,
+  KMS_UTILS_EVENT_KEYFRAME_SUPPRESSED,
+  KMS_UTILS_EVENT_REMB          /* a: ssrc, b: bitrate << 32 | min */
+} KmsUtilsEventType;
+
+typedef void (*KmsUtilsEventHook) (GstPad * pad, KmsUtilsEventType type, guint64 a, guint64 b);
+void kms_utils_set_event_hook (KmsUtilsEventHook hook);
+
 /* time */
 GstClockTime kms_utils_get_time_nsecs ();
 
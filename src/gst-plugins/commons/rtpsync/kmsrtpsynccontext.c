@@ -16,6 +16,7 @@
  */
 
 #include "kmsrtpsynccontext.h"
+#include "kmsrtpsynctrace.h"
 #include <glib/gstdio.h>
 
 #define GST_DEFAULT_NAME "rtpsynccontext"
@@ -44,8 +45,7 @@ struct _KmsRtpSyncContextPrivate
   GstClockTime base_ntp_ns_time;
   GstClockTime base_sync_time;
 
-  FILE *stats_file;
-  GMutex stats_mutex;
+  KmsRtpSyncTrace *stats_trace;
 };
 
 static void
@@ -55,12 +55,10 @@ kms_rtp_sync_context_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (self, "finalize");
 
-  if (self->priv->stats_file) {
-    fclose (self->priv->stats_file);
+  if (self->priv->stats_trace) {
+    kms_rtp_sync_trace_close (self->priv->stats_trace);
   }
 
-  g_mutex_clear (&self->priv->stats_mutex);
-
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -84,7 +82,6 @@ static void
 kms_rtp_sync_context_init (KmsRtpSyncContext * self)
 {
   self->priv = KMS_RTP_SYNC_CONTEXT_GET_PRIVATE (self);
-  g_mutex_init (&self->priv->stats_mutex);
 }
 
 static void
@@ -108,7 +105,7 @@ kms_rtp_sync_context_init_stats_file (KmsRtpSyncContext * self,
   g_date_time_unref (datetime);
 
   stats_file_name =
-      g_strdup_printf ("%s/%s_%s.csv", stats_files_dir, date_str,
+      g_strdup_printf ("%s/%s_%s.rtpsync", stats_files_dir, date_str,
       stats_file_suffix_name);
   g_free (date_str);
 
@@ -118,15 +115,14 @@ kms_rtp_sync_context_init_stats_file (KmsRtpSyncContext * self,
     goto end;
   }
 
-  self->priv->stats_file = g_fopen (stats_file_name, "w+");
+  /* Binary records, see tools/rtpsync/kms-rtpsync-csv to read them */
+  self->priv->stats_trace = kms_rtp_sync_trace_new (stats_file_name);
 
-  if (self->priv->stats_file == NULL) {
+  if (self->priv->stats_trace == NULL) {
     GST_ERROR_OBJECT (self, "Stats file '%s' cannot be created",
         stats_file_name);
   } else {
     GST_INFO_OBJECT (self, "Stats file '%s' created", stats_file_name);
-    g_fprintf (self->priv->stats_file,
-        "ENTRY_TS,THREAD,SSRC,CLOCK_RATE,PTS_ORIG,PTS,DTS,EXT_RTP,SR_NTP_NS,SR_EXT_RTP\n");
   }
 
 end:
@@ -170,18 +166,10 @@ kms_rtp_sync_context_write_stats (KmsRtpSyncContext * self, guint32 ssrc,
     guint32 clock_rate, guint64 pts_orig, guint64 pts, guint64 dts,
     guint64 ext_ts, guint64 last_sr_ntp_ns_time, guint64 last_sr_ext_ts)
 {
-  if (self->priv->stats_file == NULL) {
+  if (self->priv->stats_trace == NULL) {
     return FALSE;
   }
 
-  g_mutex_lock (&self->priv->stats_mutex);
-  g_fprintf (self->priv->stats_file,
-      "%" G_GUINT64_FORMAT ",%p,%" G_GUINT32_FORMAT ",%" G_GUINT32_FORMAT ",%"
-      G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%"
-      G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT "\n",
-      g_get_real_time (), g_thread_self (), ssrc, clock_rate, pts_orig,
-      pts, dts, ext_ts, last_sr_ntp_ns_time, last_sr_ext_ts);
-  g_mutex_unlock (&self->priv->stats_mutex);
-
-  return TRUE;
+  return kms_rtp_sync_trace_write (self->priv->stats_trace, ssrc, clock_rate,
+      pts_orig, pts, dts, ext_ts, last_sr_ntp_ns_time, last_sr_ext_ts);
 }
@@ -0,0 +1,321 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "kmsrtpsynctrace.h"
+#include <glib/gstdio.h>
+#include <errno.h>
+
+#define GST_DEFAULT_NAME "rtpsynctrace"
+GST_DEBUG_CATEGORY_STATIC (kms_rtp_sync_trace_debug_category);
+#define GST_CAT_DEFAULT kms_rtp_sync_trace_debug_category
+
+#define RING_SIZE 4096          /* records, power of two */
+#define WRITER_PERIOD_USEC (100 * G_TIME_SPAN_MILLISECOND)
+
+typedef struct _KmsRtpSyncTraceRecord
+{
+  gint64 entry_ts;
+  guint64 thread;
+  guint32 ssrc;
+  guint32 clock_rate;
+  guint64 pts_orig;
+  guint64 pts;
+  guint64 dts;
+  guint64 ext_ts;
+  guint64 sr_ntp_ns;
+  guint64 sr_ext_ts;
+} KmsRtpSyncTraceRecord;
+
+G_STATIC_ASSERT (sizeof (KmsRtpSyncTraceRecord) == 72);
+
+typedef struct _KmsRtpSyncTraceSlot
+{
+  KmsRtpSyncTrace *trace;
+  KmsRtpSyncTraceRecord record;
+} KmsRtpSyncTraceSlot;
+
+/* Single producer (its thread), single consumer (the writer) */
+typedef struct _KmsRtpSyncTraceRing
+{
+  volatile guint head;
+  volatile guint tail;
+  volatile gint dead;
+  guint dropped;
+  guint reported;
+  KmsRtpSyncTraceSlot slots[RING_SIZE];
+} KmsRtpSyncTraceRing;
+
+struct _KmsRtpSyncTrace
+{
+  FILE *file;
+  volatile gint closed;
+};
+
+/* Protects the lists and the writer state */
+static GMutex trace_mutex;
+static GSList *rings;
+static GSList *traces;
+static gboolean writer_running;
+
+/* Serializes the consumers of the rings */
+static GMutex drain_mutex;
+
+static void
+kms_rtp_sync_trace_ring_release (gpointer data)
+{
+  KmsRtpSyncTraceRing *ring = data;
+  gboolean free_ring;
+
+  /* Same order as flush, which may be draining a copy of the list */
+  g_mutex_lock (&drain_mutex);
+  g_mutex_lock (&trace_mutex);
+
+  /* Without a writer every trace was closed and drained, so nothing */
+  /* is left in the ring. Otherwise the writer frees it once drained */
+  free_ring = !writer_running;
+
+  if (free_ring) {
+    rings = g_slist_remove (rings, ring);
+  } else {
+    g_atomic_int_set (&ring->dead, 1);
+  }
+
+  g_mutex_unlock (&trace_mutex);
+  g_mutex_unlock (&drain_mutex);
+
+  if (free_ring) {
+    g_free (ring);
+  }
+}
+
+static GPrivate ring_key = G_PRIVATE_INIT (kms_rtp_sync_trace_ring_release);
+
+static KmsRtpSyncTraceRing *
+kms_rtp_sync_trace_get_ring (void)
+{
+  KmsRtpSyncTraceRing *ring = g_private_get (&ring_key);
+
+  if (G_LIKELY (ring != NULL)) {
+    return ring;
+  }
+
+  ring = g_malloc0 (sizeof (KmsRtpSyncTraceRing));
+  g_private_set (&ring_key, ring);
+
+  g_mutex_lock (&trace_mutex);
+  rings = g_slist_prepend (rings, ring);
+  g_mutex_unlock (&trace_mutex);
+
+  return ring;
+}
+
+gboolean
+kms_rtp_sync_trace_write (KmsRtpSyncTrace * trace, guint32 ssrc,
+    guint32 clock_rate, guint64 pts_orig, guint64 pts, guint64 dts,
+    guint64 ext_ts, guint64 last_sr_ntp_ns_time, guint64 last_sr_ext_ts)
+{
+  KmsRtpSyncTraceRing *ring = kms_rtp_sync_trace_get_ring ();
+  KmsRtpSyncTraceSlot *slot;
+  guint head = ring->head;
+
+  if (head - g_atomic_int_get (&ring->tail) >= RING_SIZE) {
+    ring->dropped++;
+    return FALSE;
+  }
+
+  slot = &ring->slots[head & (RING_SIZE - 1)];
+  slot->trace = trace;
+  slot->record.entry_ts = g_get_real_time ();
+  slot->record.thread = GPOINTER_TO_SIZE (g_thread_self ());
+  slot->record.ssrc = ssrc;
+  slot->record.clock_rate = clock_rate;
+  slot->record.pts_orig = pts_orig;
+  slot->record.pts = pts;
+  slot->record.dts = dts;
+  slot->record.ext_ts = ext_ts;
+  slot->record.sr_ntp_ns = last_sr_ntp_ns_time;
+  slot->record.sr_ext_ts = last_sr_ext_ts;
+
+  /* Publishes the record */
+  g_atomic_int_set (&ring->head, head + 1);
+
+  return TRUE;
+}
+
+static void
+kms_rtp_sync_trace_drain_ring (KmsRtpSyncTraceRing * ring)
+{
+  guint head = g_atomic_int_get (&ring->head);
+  guint tail = ring->tail;
+  guint dropped = ring->dropped;
+
+  for (; tail != head; tail++) {
+    KmsRtpSyncTraceSlot *slot = &ring->slots[tail & (RING_SIZE - 1)];
+
+    if (fwrite (&slot->record, sizeof (KmsRtpSyncTraceRecord), 1,
+            slot->trace->file) != 1) {
+      GST_WARNING ("Cannot write RTP sync trace");
+    }
+  }
+
+  g_atomic_int_set (&ring->tail, tail);
+
+  if (dropped != ring->reported) {
+    GST_WARNING ("%u RTP sync records dropped by a thread",
+        dropped - ring->reported);
+    ring->reported = dropped;
+  }
+}
+
+static void
+kms_rtp_sync_trace_fflush (KmsRtpSyncTrace * trace)
+{
+  fflush (trace->file);
+}
+
+void
+kms_rtp_sync_trace_flush (void)
+{
+  GSList *closed = NULL, *to_drain, *l, *next;
+
+  g_mutex_lock (&drain_mutex);
+
+  /* Closed traces are picked before draining: records written before */
+  /* closing them are already visible in the rings                    */
+  g_mutex_lock (&trace_mutex);
+  for (l = traces; l != NULL; l = next) {
+    KmsRtpSyncTrace *trace = l->data;
+
+    next = l->next;
+
+    if (g_atomic_int_get (&trace->closed)) {
+      traces = g_slist_delete_link (traces, l);
+      closed = g_slist_prepend (closed, trace);
+    }
+  }
+  to_drain = g_slist_copy (rings);
+  g_mutex_unlock (&trace_mutex);
+
+  for (l = to_drain; l != NULL; l = l->next) {
+    KmsRtpSyncTraceRing *ring = l->data;
+
+    /* Dead is read first, so no record is left behind */
+    if (g_atomic_int_get (&ring->dead)) {
+      kms_rtp_sync_trace_drain_ring (ring);
+
+      g_mutex_lock (&trace_mutex);
+      rings = g_slist_remove (rings, ring);
+      g_mutex_unlock (&trace_mutex);
+
+      g_free (ring);
+    } else {
+      kms_rtp_sync_trace_drain_ring (ring);
+    }
+  }
+  g_slist_free (to_drain);
+
+  for (l = closed; l != NULL; l = l->next) {
+    KmsRtpSyncTrace *trace = l->data;
+
+    fclose (trace->file);
+    g_slice_free (KmsRtpSyncTrace, trace);
+  }
+  g_slist_free (closed);
+
+  g_mutex_lock (&trace_mutex);
+  g_slist_foreach (traces, (GFunc) kms_rtp_sync_trace_fflush, NULL);
+  g_mutex_unlock (&trace_mutex);
+
+  g_mutex_unlock (&drain_mutex);
+}
+
+static gpointer
+kms_rtp_sync_trace_writer (gpointer data)
+{
+  gboolean running = TRUE;
+
+  while (running) {
+    g_usleep (WRITER_PERIOD_USEC);
+    kms_rtp_sync_trace_flush ();
+
+    g_mutex_lock (&trace_mutex);
+    if (traces == NULL) {
+      /* Closed traces are already written, the next one restarts us */
+      writer_running = FALSE;
+      running = FALSE;
+    }
+    g_mutex_unlock (&trace_mutex);
+  }
+
+  return NULL;
+}
+
+KmsRtpSyncTrace *
+kms_rtp_sync_trace_new (const gchar * path)
+{
+  KmsRtpSyncTrace *trace;
+  guint32 record_size = sizeof (KmsRtpSyncTraceRecord);
+  GThread *writer;
+  FILE *file;
+
+  file = g_fopen (path, "wb");
+  if (file == NULL) {
+    GST_ERROR ("Cannot open RTP sync trace '%s': %s", path,
+        g_strerror (errno));
+    return NULL;
+  }
+
+  if (fwrite (KMS_RTP_SYNC_TRACE_MAGIC, 4, 1, file) != 1
+      || fwrite (&record_size, sizeof (record_size), 1, file) != 1) {
+    GST_ERROR ("Cannot write RTP sync trace header to '%s'", path);
+    fclose (file);
+    return NULL;
+  }
+
+  trace = g_slice_new0 (KmsRtpSyncTrace);
+  trace->file = file;
+
+  g_mutex_lock (&trace_mutex);
+  traces = g_slist_prepend (traces, trace);
+  if (!writer_running) {
+    writer_running = TRUE;
+    writer = g_thread_new ("rtpsynctrace", kms_rtp_sync_trace_writer, NULL);
+    g_thread_unref (writer);
+  }
+  g_mutex_unlock (&trace_mutex);
+
+  GST_INFO ("RTP sync trace: %s", path);
+
+  return trace;
+}
+
+void
+kms_rtp_sync_trace_close (KmsRtpSyncTrace * trace)
+{
+  g_return_if_fail (trace != NULL);
+
+  g_atomic_int_set (&trace->closed, 1);
+}
+
+static void init_debug (void) __attribute__ ((constructor));
+
+static void
+init_debug (void)
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+      GST_DEFAULT_NAME);
+}
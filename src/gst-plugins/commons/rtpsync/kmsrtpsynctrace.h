@@ -0,0 +1,53 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef __KMS_RTP_SYNC_TRACE_H__
+#define __KMS_RTP_SYNC_TRACE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Binary trace of the synchronization of every RTP buffer. Streaming
+ * threads only copy a fixed size record into a ring of their own, and a
+ * background thread drains all the rings to the trace files. Records are
+ * dropped, never waited for, when a ring is full.
+ *
+ * File layout, host byte order: "KRS1", guint32 record size, then records
+ * of gint64 entry time (us), guint64 thread, guint32 ssrc, guint32 clock
+ * rate, and guint64 pts_orig, pts, dts, ext_ts, sr_ntp_ns, sr_ext_ts.
+ * tools/rtpsync/kms-rtpsync-csv converts it to the CSV format of old.
+ */
+#define KMS_RTP_SYNC_TRACE_MAGIC "KRS1"
+
+typedef struct _KmsRtpSyncTrace KmsRtpSyncTrace;
+
+KmsRtpSyncTrace * kms_rtp_sync_trace_new (const gchar * path);
+
+/* The file is closed once the pending records are written */
+void kms_rtp_sync_trace_close (KmsRtpSyncTrace * trace);
+
+/* Returns FALSE if the record was dropped */
+gboolean kms_rtp_sync_trace_write (KmsRtpSyncTrace * trace, guint32 ssrc,
+    guint32 clock_rate, guint64 pts_orig, guint64 pts, guint64 dts,
+    guint64 ext_ts, guint64 last_sr_ntp_ns_time, guint64 last_sr_ext_ts);
+
+/* Writes the pending records of all the traces */
+void kms_rtp_sync_trace_flush (void);
+
+G_END_DECLS
+#endif /* __KMS_RTP_SYNC_TRACE_H__ */
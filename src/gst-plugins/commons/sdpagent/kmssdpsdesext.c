@@ -70,20 +70,45 @@ enum
 
 static guint obj_signals[LAST_SIGNAL] = { 0 };
 
-static const gchar *crypto_suites[] = {
-  "AES_CM_128_HMAC_SHA1_32",
-  "AES_CM_128_HMAC_SHA1_80",
-  "AES_256_CM_HMAC_SHA1_32",
-  "AES_256_CM_HMAC_SHA1_80"
+/* Values of the srtpenc/srtpdec cipher and auth enumerations */
+#define SRTP_CIPHER_AES_128_ICM 1
+#define SRTP_CIPHER_AES_256_ICM 2
+#define SRTP_CIPHER_AES_128_GCM 3
+#define SRTP_CIPHER_AES_256_GCM 4
+
+#define SRTP_AUTH_NULL 0
+#define SRTP_AUTH_HMAC_SHA1_32 1
+#define SRTP_AUTH_HMAC_SHA1_80 2
+
+typedef struct _SrtpCryptoSuiteInfo
+{
+  const gchar *name;
+  guint cipher;
+  guint auth;
+  guint key_size;               /* master key + salt, in bytes */
+} SrtpCryptoSuiteInfo;
+
+/* Indexed by SrtpCryptoSuite */
+static const SrtpCryptoSuiteInfo crypto_suites[] = {
+  {"AES_CM_128_HMAC_SHA1_32", SRTP_CIPHER_AES_128_ICM, SRTP_AUTH_HMAC_SHA1_32,
+      30},
+  {"AES_CM_128_HMAC_SHA1_80", SRTP_CIPHER_AES_128_ICM, SRTP_AUTH_HMAC_SHA1_80,
+      30},
+  {"AES_256_CM_HMAC_SHA1_32", SRTP_CIPHER_AES_256_ICM, SRTP_AUTH_HMAC_SHA1_32,
+      46},
+  {"AES_256_CM_HMAC_SHA1_80", SRTP_CIPHER_AES_256_ICM, SRTP_AUTH_HMAC_SHA1_80,
+      46},
+  {"AEAD_AES_128_GCM", SRTP_CIPHER_AES_128_GCM, SRTP_AUTH_NULL, 28},
+  {"AEAD_AES_256_GCM", SRTP_CIPHER_AES_256_GCM, SRTP_AUTH_NULL, 44}
 };
 
 static const gchar *
 srtp_crypto_suite_to_str (SrtpCryptoSuite crypto)
 {
-  int suite = crypto;
+  guint suite = crypto;
 
-  if (suite <= G_N_ELEMENTS (crypto_suites)) {
-    return crypto_suites[crypto];
+  if (suite < G_N_ELEMENTS (crypto_suites)) {
+    return crypto_suites[crypto].name;
   } else {
     return NULL;
   }
@@ -95,7 +120,7 @@ srtp_crypto_suite_from_str (const gchar * str, SrtpCryptoSuite * crypto)
   guint i;
 
   for (i = 0; i < G_N_ELEMENTS (crypto_suites); i++) {
-    if (g_strcmp0 (str, crypto_suites[i]) == 0) {
+    if (g_strcmp0 (str, crypto_suites[i].name) == 0) {
       *crypto = i;
       return TRUE;
     }
@@ -104,6 +129,28 @@ srtp_crypto_suite_from_str (const gchar * str, SrtpCryptoSuite * crypto)
   return FALSE;
 }
 
+static gint
+compare_key_preference (const GValue * k1, const GValue * k2)
+{
+  SrtpCryptoSuite c1, c2;
+  gboolean aead1, aead2;
+
+  aead1 = kms_sdp_sdes_ext_get_parameters_from_key (k1, KMS_SDES_CRYPTO,
+      G_TYPE_UINT, &c1, NULL) && kms_sdp_sdes_ext_crypto_is_aead (c1);
+  aead2 = kms_sdp_sdes_ext_get_parameters_from_key (k2, KMS_SDES_CRYPTO,
+      G_TYPE_UINT, &c2, NULL) && kms_sdp_sdes_ext_crypto_is_aead (c2);
+
+  /* AEAD suites encrypt and authenticate in a single pass, so they go */
+  /* first. Other keys keep their relative order (stable sort).        */
+  return aead2 - aead1;
+}
+
+static void
+sort_keys_by_preference (GArray * keys)
+{
+  g_array_sort (keys, (GCompareFunc) compare_key_preference);
+}
+
 static const GstStructure *
 get_structure_from_value (const GValue * val)
 {
@@ -311,6 +358,7 @@ kms_sdp_sdes_ext_add_offer_attributes (KmsISdpMediaExtension * ext,
   g_signal_emit (G_OBJECT (ext), obj_signals[SIGNAL_ON_OFFER_KEYS], 0, &keys);
 
   if (keys != NULL) {
+    sort_keys_by_preference (keys);
     ret = kms_sdp_sdes_ext_add_offer_crypto_attrs (ext, offer, keys, error);
     g_array_unref (keys);
   } else {
@@ -562,6 +610,9 @@ kms_sdp_sdes_ext_add_answer_attributes (KmsISdpMediaExtension * ext,
     goto end;
   }
 
+  /* Offer the preferred suites first to the key selection */
+  sort_keys_by_preference (keys);
+
   g_signal_emit (G_OBJECT (ext), obj_signals[SIGNAL_ON_ANSWER_KEYS], 0, keys,
       &key, &supported);
 
@@ -742,3 +793,35 @@ kms_sdp_sdes_ext_get_parameters_from_key (const GValue * key,
 
   return ret;
 }
+
+gboolean
+kms_sdp_sdes_ext_crypto_is_aead (SrtpCryptoSuite crypto)
+{
+  return crypto == KMS_SDES_EXT_AEAD_AES_128_GCM ||
+      crypto == KMS_SDES_EXT_AEAD_AES_256_GCM;
+}
+
+gboolean
+kms_sdp_sdes_ext_get_srtp_params (SrtpCryptoSuite crypto, guint * cipher,
+    guint * auth, guint * key_size)
+{
+  guint suite = crypto;
+
+  if (suite >= G_N_ELEMENTS (crypto_suites)) {
+    return FALSE;
+  }
+
+  if (cipher != NULL) {
+    *cipher = crypto_suites[suite].cipher;
+  }
+
+  if (auth != NULL) {
+    *auth = crypto_suites[suite].auth;
+  }
+
+  if (key_size != NULL) {
+    *key_size = crypto_suites[suite].key_size;
+  }
+
+  return TRUE;
+}
@@ -91,7 +91,9 @@ typedef enum {
   KMS_SDES_EXT_AES_CM_128_HMAC_SHA1_32, /* from rfc4568 */
   KMS_SDES_EXT_AES_CM_128_HMAC_SHA1_80, /* from rfc4568 */
   KMS_SDES_EXT_AES_256_CM_HMAC_SHA1_32, /* from rfc6188 */
-  KMS_SDES_EXT_AES_256_CM_HMAC_SHA1_80  /* from rfc6188 */
+  KMS_SDES_EXT_AES_256_CM_HMAC_SHA1_80, /* from rfc6188 */
+  KMS_SDES_EXT_AEAD_AES_128_GCM,        /* from rfc7714 */
+  KMS_SDES_EXT_AEAD_AES_256_GCM         /* from rfc7714 */
 } SrtpCryptoSuite;
 
 #define kms_sdp_sdes_ext_create_key(tag, key, crypto, val) \
@@ -104,6 +106,13 @@ gboolean kms_sdp_sdes_ext_create_key_detailed (guint tag, const gchar *key,
 gboolean kms_sdp_sdes_ext_get_parameters_from_key (const GValue *key,
   const char *first_param, ...);
 
+gboolean kms_sdp_sdes_ext_crypto_is_aead (SrtpCryptoSuite crypto);
+
+/* Values for the rtp/rtcp cipher and auth properties of srtpenc and the */
+/* caps of srtpdec, and the master key + salt size the suite expects     */
+gboolean kms_sdp_sdes_ext_get_srtp_params (SrtpCryptoSuite crypto,
+  guint *cipher, guint *auth, guint *key_size);
+
 G_END_DECLS
 
 #endif /* _KMS_SDP_SDES_EXT_H_ */
@@ -26,12 +26,25 @@
 #include "kmsdectreebin.h"
 #include "kmsenctreebin.h"
 #include "kmsrtppaytreebin.h"
+#include "kmslatencyprofile.h"
+#include "kmsprobes.h"
+#include "kmsflightrecorder.h"
+#include "kms-core-enumtypes.h"
 
 #define PLUGIN_NAME "agnosticbin"
 
 #define UNLINKING_DATA "unlinking-data"
 G_DEFINE_QUARK (UNLINKING_DATA, unlinking_data);
 
+#define BITRATE_TIER "kms-bitrate-tier"
+G_DEFINE_QUARK (BITRATE_TIER, bitrate_tier);
+
+#define PAD_TIER_DATA "kms-pad-tier-data"
+G_DEFINE_QUARK (PAD_TIER_DATA, pad_tier_data);
+
+#define LEAKY_QUEUE "kms-leaky-queue"
+G_DEFINE_QUARK (LEAKY_QUEUE, leaky_queue);
+
 #define KMS_AGNOSTIC_PAD_STARTED (GST_PAD_FLAG_LAST << 1)
 
 static GstStaticCaps static_raw_audio_caps =
@@ -42,6 +55,10 @@ GST_STATIC_CAPS (KMS_AGNOSTIC_RAW_VIDEO_CAPS);
 #define GST_CAT_DEFAULT kms_agnostic_bin2_debug
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
+KMS_PROBE_DEFINE (agnosticbin_bin_created);
+KMS_PROBE_DEFINE (agnosticbin_bin_destroyed);
+KMS_PROBE_DEFINE (agnosticbin_destroyed);
+
 #define kms_agnostic_bin2_parent_class parent_class
 G_DEFINE_TYPE (KmsAgnosticBin2, kms_agnostic_bin2, GST_TYPE_BIN);
 
@@ -66,7 +83,19 @@ G_DEFINE_TYPE (KmsAgnosticBin2, kms_agnostic_bin2, GST_TYPE_BIN);
 #define TARGET_BITRATE_DEFAULT 300000
 #define MIN_BITRATE_DEFAULT 0
 #define MAX_BITRATE_DEFAULT G_MAXINT
-#define LEAKY_TIME 600000000    /*600 ms */
+
+#define DEFAULT_BITRATE_TIERS NULL
+#define DEFAULT_LATENCY_PROFILE KMS_LATENCY_PROFILE_DEFAULT
+#define TIER_HYSTERESIS_FACTOR 0.1
+#define DEFAULT_TIER_SWITCH_INTERVAL 5000  /* ms */
+
+/* Bitrate tier assigned to the consumer linked to a src pad */
+typedef struct _KmsAgnosticPadTier
+{
+  gint tier;
+  gboolean transcoded;
+  GstClockTime last_switch;
+} KmsAgnosticPadTier;
 
 struct _KmsAgnosticBin2Private
 {
@@ -90,6 +119,13 @@ struct _KmsAgnosticBin2Private
 
   GstStructure *codec_config;
   gboolean bitrate_unlimited;
+
+  /* Sorted upper limits (bps) of each tier but the last one */
+  GArray *tiers;
+  gchar *tiers_str;
+  guint tier_switch_interval;   /* ms */
+
+  KmsLatencyProfile latency_profile;
 };
 
 enum
@@ -98,6 +134,9 @@ enum
   PROP_MIN_BITRATE,
   PROP_MAX_BITRATE,
   PROP_CODEC_CONFIG,
+  PROP_BITRATE_TIERS,
+  PROP_TIER_SWITCH_INTERVAL,
+  PROP_LATENCY_PROFILE,
   N_PROPERTIES
 };
 
@@ -116,15 +155,197 @@ static gboolean kms_agnostic_bin2_process_pad (KmsAgnosticBin2 * self,
     GstPad * pad);
 
 static GstBin *kms_agnostic_bin2_find_or_create_bin_for_caps (KmsAgnosticBin2 *
-    self, GstCaps * caps);
+    self, GstCaps * caps, gint tier);
 
 static void
 kms_agnostic_bin2_insert_bin (KmsAgnosticBin2 * self, GstBin * bin)
 {
   g_hash_table_insert (self->priv->bins, GST_OBJECT_NAME (bin),
       g_object_ref (bin));
+  KMS_PROBE3 (agnosticbin_bin_created, self, bin, GST_OBJECT_NAME (bin));
+}
+
+/* Bitrate tiers begin */
+
+static KmsAgnosticPadTier *
+kms_agnostic_pad_tier_new (gint tier)
+{
+  KmsAgnosticPadTier *pad_tier = g_slice_new0 (KmsAgnosticPadTier);
+
+  pad_tier->tier = tier;
+
+  return pad_tier;
+}
+
+static void
+kms_agnostic_pad_tier_destroy (KmsAgnosticPadTier * pad_tier)
+{
+  g_slice_free (KmsAgnosticPadTier, pad_tier);
+}
+
+static void
+kms_agnostic_bin2_set_bin_tier (GstBin * bin, gint tier)
+{
+  /* Stored with an offset so that tier 0 can be told apart from no tier */
+  g_object_set_qdata (G_OBJECT (bin), bitrate_tier_quark (),
+      GINT_TO_POINTER (tier + 1));
+}
+
+static gboolean
+kms_agnostic_bin2_get_bin_tier (GstBin * bin, gint * tier)
+{
+  gpointer data = g_object_get_qdata (G_OBJECT (bin), bitrate_tier_quark ());
+
+  if (data == NULL) {
+    return FALSE;
+  }
+
+  *tier = GPOINTER_TO_INT (data) - 1;
+
+  return TRUE;
+}
+
+static gint
+kms_agnostic_bin2_get_tier_lower_bound (KmsAgnosticBin2 * self, gint tier)
+{
+  if (tier <= 0) {
+    return 0;
+  }
+
+  return g_array_index (self->priv->tiers, gint, tier - 1);
+}
+
+static gint
+kms_agnostic_bin2_get_tier_upper_bound (KmsAgnosticBin2 * self, gint tier)
+{
+  if (tier >= self->priv->tiers->len) {
+    return G_MAXINT;
+  }
+
+  return g_array_index (self->priv->tiers, gint, tier);
+}
+
+static void
+kms_agnostic_bin2_get_tier_limits (KmsAgnosticBin2 * self, gint tier,
+    gint * min_bitrate, gint * max_bitrate)
+{
+  *min_bitrate = MAX (self->priv->min_bitrate,
+      kms_agnostic_bin2_get_tier_lower_bound (self, tier));
+  *max_bitrate = MIN (self->priv->max_bitrate,
+      kms_agnostic_bin2_get_tier_upper_bound (self, tier));
+
+  if (*min_bitrate > *max_bitrate) {
+    /* Tier is out of the configured range, stick to the closest limit */
+    *min_bitrate = *max_bitrate;
+  }
+}
+
+static gint
+kms_agnostic_bin2_get_tier_for_bitrate (KmsAgnosticBin2 * self, guint bitrate)
+{
+  gint tier;
+
+  for (tier = 0; tier < self->priv->tiers->len; tier++) {
+    if (bitrate < g_array_index (self->priv->tiers, gint, tier)) {
+      break;
+    }
+  }
+
+  return tier;
 }
 
+/*
+ * Choose the tier for a consumer reporting @bitrate. A consumer only leaves
+ * its current tier when the bitrate goes beyond the tier bounds by more than
+ * TIER_HYSTERESIS_FACTOR, so that a REMB oscillating around a boundary does
+ * not make it bounce between encoders.
+ */
+static gint
+kms_agnostic_bin2_select_tier (KmsAgnosticBin2 * self, gint current,
+    guint bitrate)
+{
+  gint tier = kms_agnostic_bin2_get_tier_for_bitrate (self, bitrate);
+
+  current = MIN (current, self->priv->tiers->len);
+
+  while (tier > current && bitrate <
+      kms_agnostic_bin2_get_tier_lower_bound (self, tier) *
+      (1 + TIER_HYSTERESIS_FACTOR)) {
+    tier--;
+  }
+
+  while (tier < current && bitrate >=
+      kms_agnostic_bin2_get_tier_lower_bound (self, tier + 1) *
+      (1 - TIER_HYSTERESIS_FACTOR)) {
+    tier++;
+  }
+
+  return tier;
+}
+
+static gint
+compare_bitrates (gconstpointer a, gconstpointer b)
+{
+  return *((const gint *) a) - *((const gint *) b);
+}
+
+static void
+kms_agnostic_bin2_parse_tiers (KmsAgnosticBin2 * self, const gchar * str)
+{
+  gchar **values;
+  GString *normalized;
+  guint i;
+
+  g_array_set_size (self->priv->tiers, 0);
+  g_clear_pointer (&self->priv->tiers_str, g_free);
+
+  if (str == NULL) {
+    return;
+  }
+
+  values = g_strsplit (str, ",", -1);
+  for (i = 0; values[i] != NULL; i++) {
+    gchar *end = NULL;
+    gint64 v = g_ascii_strtoll (g_strstrip (values[i]), &end, 10);
+    gint bitrate;
+
+    if (end == values[i] || *end != '\0' || v <= 0 || v > G_MAXINT) {
+      GST_WARNING_OBJECT (self, "Ignoring invalid bitrate tier '%s'",
+          values[i]);
+      continue;
+    }
+
+    bitrate = v;
+    g_array_append_val (self->priv->tiers, bitrate);
+  }
+  g_strfreev (values);
+
+  g_array_sort (self->priv->tiers, compare_bitrates);
+
+  normalized = g_string_new (NULL);
+  for (i = 0; i < self->priv->tiers->len; i++) {
+    gint v = g_array_index (self->priv->tiers, gint, i);
+
+    if (i > 0 && v == g_array_index (self->priv->tiers, gint, i - 1)) {
+      g_array_remove_index (self->priv->tiers, i--);
+      continue;
+    }
+
+    g_string_append_printf (normalized, "%s%d", i > 0 ? "," : "", v);
+  }
+
+  if (self->priv->tiers->len > 0) {
+    self->priv->tiers_str = g_string_free (normalized, FALSE);
+  } else {
+    g_string_free (normalized, TRUE);
+  }
+
+  GST_DEBUG_OBJECT (self, "Configured %u bitrate tiers: %s",
+      self->priv->tiers->len + 1, self->priv->tiers_str);
+}
+
+/* Bitrate tiers end */
+
 /*
  * This function sends a dummy event to force blocked probe to be called
  */
@@ -419,7 +640,13 @@ kms_agnostic_bin2_link_to_tee (KmsAgnosticBin2 * self, GstPad * pad,
     GstElement *mediator = kms_utils_create_mediator_element (caps);
 
     if (kms_utils_caps_are_video (caps)) {
-      g_object_set (queue, "leaky", 2, "max-size-time", LEAKY_TIME, NULL);
+      const KmsLatencySettings *settings =
+          kms_latency_profile_get_settings (self->priv->latency_profile);
+
+      g_object_set (queue, "leaky", 2, "max-size-time",
+          settings->video_queue_time, NULL);
+      g_object_set_qdata (G_OBJECT (queue), leaky_queue_quark (),
+          GINT_TO_POINTER (TRUE));
     }
 
     remove_element_on_unlinked (convert, "src", "sink");
@@ -499,7 +726,8 @@ check_bin (KmsTreeBin * tree_bin, const GstCaps * caps)
 }
 
 static GstBin *
-kms_agnostic_bin2_find_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps)
+kms_agnostic_bin2_find_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps,
+    gint tier)
 {
   GList *bins, *l;
   GstBin *bin = NULL;
@@ -515,6 +743,12 @@ kms_agnostic_bin2_find_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps)
   bins = g_hash_table_get_values (self->priv->bins);
   for (l = bins; l != NULL && bin == NULL; l = l->next) {
     KmsTreeBin *tree_bin = KMS_TREE_BIN (l->data);
+    gint bin_tier;
+
+    if (kms_agnostic_bin2_get_bin_tier (GST_BIN (tree_bin), &bin_tier)
+        && bin_tier != tier) {
+      continue;
+    }
 
     if (check_bin (tree_bin, caps)) {
       bin = GST_BIN_CAST (tree_bin);
@@ -583,7 +817,8 @@ kms_agnostic_bin2_get_or_create_dec_bin (KmsAgnosticBin2 * self, GstCaps * caps)
     GstBin *dec_bin;
 
     GST_DEBUG ("Raw caps: %" GST_PTR_FORMAT, raw_caps);
-    dec_bin = kms_agnostic_bin2_find_bin_for_caps (self, raw_caps);
+    /* Decoding is shared by all the tiers */
+    dec_bin = kms_agnostic_bin2_find_bin_for_caps (self, raw_caps, 0);
 
     if (dec_bin == NULL) {
       dec_bin = kms_agnostic_bin2_create_dec_bin (self, raw_caps);
@@ -604,7 +839,8 @@ kms_agnostic_bin2_get_or_create_dec_bin (KmsAgnosticBin2 * self, GstCaps * caps)
 }
 
 static GstBin *
-kms_agnostic_bin2_create_rtp_pay_bin (KmsAgnosticBin2 * self, GstCaps * caps)
+kms_agnostic_bin2_create_rtp_pay_bin (KmsAgnosticBin2 * self, GstCaps * caps,
+    gint tier)
 {
   KmsRtpPayTreeBin *bin;
   GstBin *enc_bin;
@@ -626,10 +862,16 @@ kms_agnostic_bin2_create_rtp_pay_bin (KmsAgnosticBin2 * self, GstCaps * caps)
   input_caps = gst_pad_query_caps (sink, NULL);
   g_object_unref (sink);
 
-  enc_bin = kms_agnostic_bin2_find_or_create_bin_for_caps (self, input_caps);
+  enc_bin =
+      kms_agnostic_bin2_find_or_create_bin_for_caps (self, input_caps, tier);
   kms_agnostic_bin2_insert_bin (self, GST_BIN (bin));
   gst_caps_unref (input_caps);
 
+  /* Payloader only belongs to a tier when it is fed by an encoder */
+  if (enc_bin != NULL && kms_agnostic_bin2_get_bin_tier (enc_bin, &tier)) {
+    kms_agnostic_bin2_set_bin_tier (GST_BIN (bin), tier);
+  }
+
   output_tee = kms_tree_bin_get_output_tee (KMS_TREE_BIN (enc_bin));
   gst_element_link (output_tee, input_element);
 
@@ -637,14 +879,16 @@ kms_agnostic_bin2_create_rtp_pay_bin (KmsAgnosticBin2 * self, GstCaps * caps)
 }
 
 static GstBin *
-kms_agnostic_bin2_create_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps)
+kms_agnostic_bin2_create_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps,
+    gint tier)
 {
   GstBin *dec_bin;
   KmsEncTreeBin *enc_bin;
   GstElement *input_element, *output_tee;
+  gint min_bitrate, max_bitrate;
 
   if (kms_utils_caps_are_rtp (caps)) {
-    return kms_agnostic_bin2_create_rtp_pay_bin (self, caps);
+    return kms_agnostic_bin2_create_rtp_pay_bin (self, caps, tier);
   }
 
   dec_bin = kms_agnostic_bin2_get_or_create_dec_bin (self, caps);
@@ -656,14 +900,16 @@ kms_agnostic_bin2_create_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps)
     return dec_bin;
   }
 
+  kms_agnostic_bin2_get_tier_limits (self, tier, &min_bitrate, &max_bitrate);
   enc_bin =
-      kms_enc_tree_bin_new (caps, TARGET_BITRATE_DEFAULT,
-      self->priv->min_bitrate, self->priv->max_bitrate,
-      self->priv->codec_config);
+      kms_enc_tree_bin_new_full (caps, TARGET_BITRATE_DEFAULT, min_bitrate,
+      max_bitrate, self->priv->codec_config, self->priv->latency_profile);
   if (enc_bin == NULL) {
     return NULL;
   }
 
+  kms_agnostic_bin2_set_bin_tier (GST_BIN (enc_bin), tier);
+
   gst_bin_add (GST_BIN (self), GST_ELEMENT (enc_bin));
   gst_element_sync_state_with_parent (GST_ELEMENT (enc_bin));
 
@@ -678,14 +924,14 @@ kms_agnostic_bin2_create_bin_for_caps (KmsAgnosticBin2 * self, GstCaps * caps)
 
 static GstBin *
 kms_agnostic_bin2_find_or_create_bin_for_caps (KmsAgnosticBin2 * self,
-    GstCaps * caps)
+    GstCaps * caps, gint tier)
 {
   GstBin *bin;
 
-  bin = kms_agnostic_bin2_find_bin_for_caps (self, caps);
+  bin = kms_agnostic_bin2_find_bin_for_caps (self, caps, tier);
 
   if (bin == NULL) {
-    bin = kms_agnostic_bin2_create_bin_for_caps (self, caps);
+    bin = kms_agnostic_bin2_create_bin_for_caps (self, caps, tier);
     GST_DEBUG_OBJECT (self, "Created bin: %" GST_PTR_FORMAT, bin);
   }
 
@@ -702,8 +948,10 @@ kms_agnostic_bin2_find_or_create_bin_for_caps (KmsAgnosticBin2 * self,
 static void
 kms_agnostic_bin2_link_pad (KmsAgnosticBin2 * self, GstPad * pad, GstPad * peer)
 {
+  KmsAgnosticPadTier *pad_tier;
   GstCaps *caps;
   GstBin *bin;
+  gint tier = 0;
 
   GST_INFO_OBJECT (self, "Linking: %" GST_PTR_FORMAT, pad);
 
@@ -713,12 +961,21 @@ kms_agnostic_bin2_link_pad (KmsAgnosticBin2 * self, GstPad * pad, GstPad * peer)
     goto end;
   }
 
+  pad_tier = g_object_get_qdata (G_OBJECT (pad), pad_tier_data_quark ());
+  if (pad_tier != NULL) {
+    pad_tier->tier = tier = MIN (pad_tier->tier, self->priv->tiers->len);
+  }
+
   GST_DEBUG ("Query caps are: %" GST_PTR_FORMAT, caps);
-  bin = kms_agnostic_bin2_find_or_create_bin_for_caps (self, caps);
+  bin = kms_agnostic_bin2_find_or_create_bin_for_caps (self, caps, tier);
 
   if (bin != NULL) {
     GstElement *tee = kms_tree_bin_get_output_tee (KMS_TREE_BIN (bin));
 
+    if (pad_tier != NULL) {
+      pad_tier->transcoded = kms_agnostic_bin2_get_bin_tier (bin, &tier);
+    }
+
     if (!kms_utils_caps_are_rtp (caps)) {
       kms_utils_drop_until_keyframe (pad, TRUE);
     }
@@ -846,6 +1103,8 @@ static void
 remove_bin (gpointer key, gpointer value, gpointer agnosticbin)
 {
   GST_DEBUG_OBJECT (agnosticbin, "Removing %" GST_PTR_FORMAT, value);
+  KMS_PROBE3 (agnosticbin_bin_destroyed, agnosticbin, value,
+      GST_OBJECT_NAME (value));
   gst_bin_remove (GST_BIN (agnosticbin), value);
   gst_element_set_state (value, GST_STATE_NULL);
 }
@@ -867,6 +1126,8 @@ kms_agnostic_bin2_configure_input (KmsAgnosticBin2 * self, const GstCaps * caps)
 
   parse_bin = kms_parse_tree_bin_new (caps);
   self->priv->input_bin = GST_BIN (parse_bin);
+  KMS_PROBE3 (agnosticbin_bin_created, self, parse_bin,
+      GST_OBJECT_NAME (parse_bin));
 
   parser = kms_parse_tree_bin_get_parser (KMS_PARSE_TREE_BIN (parse_bin));
   parser_src = gst_element_get_static_pad (parser, "src");
@@ -913,6 +1174,8 @@ kms_agnostic_bin2_sink_caps_probe (GstPad * pad, GstPadProbeInfo * info,
     return GST_PAD_PROBE_OK;
   }
 
+  kms_flight_recorder_record_caps (self, new_caps);
+
   KMS_AGNOSTIC_BIN2_LOCK (self);
   current_caps = self->priv->input_caps;
   self->priv->input_caps = gst_caps_copy (new_caps);
@@ -980,6 +1243,58 @@ kms_agnostic_bin2_src_reconfigure_probe (GstPad * pad, GstPadProbeInfo * info,
   return ret;
 }
 
+static GstPadProbeReturn
+kms_agnostic_bin2_src_remb_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  KmsAgnosticBin2 *self = KMS_AGNOSTIC_BIN2 (user_data);
+  GstEvent *event = gst_pad_probe_info_get_event (info);
+  KmsAgnosticPadTier *pad_tier;
+  guint bitrate, ssrc;
+  GstClockTime now;
+  gint tier;
+
+  if (!kms_utils_remb_event_upstream_parse (event, &bitrate, &ssrc)) {
+    return GST_PAD_PROBE_OK;
+  }
+
+  KMS_AGNOSTIC_BIN2_LOCK (self);
+
+  pad_tier = g_object_get_qdata (G_OBJECT (pad), pad_tier_data_quark ());
+  if (self->priv->tiers->len == 0 || pad_tier == NULL
+      || !pad_tier->transcoded) {
+    goto end;
+  }
+
+  tier = kms_agnostic_bin2_select_tier (self, pad_tier->tier, bitrate);
+  if (tier == pad_tier->tier) {
+    goto end;
+  }
+
+  now = kms_utils_get_time_nsecs ();
+  if (pad_tier->last_switch != 0
+      && now - pad_tier->last_switch <
+      self->priv->tier_switch_interval * GST_MSECOND) {
+    GST_TRACE_OBJECT (pad, "Tier switch to %d delayed", tier);
+    goto end;
+  }
+
+  GST_DEBUG_OBJECT (pad, "Moving from bitrate tier %d to %d (REMB: %"
+      G_GUINT32_FORMAT " bps)", pad_tier->tier, tier, bitrate);
+
+  pad_tier->tier = tier;
+  pad_tier->last_switch = now;
+
+  /* The event continues to the encoder of the new tier */
+  remove_target_pad (pad);
+  kms_agnostic_bin2_process_pad (self, pad);
+
+end:
+  KMS_AGNOSTIC_BIN2_UNLOCK (self);
+
+  return GST_PAD_PROBE_OK;
+}
+
 static void
 kms_agnostic_bin2_src_unlinked (GstPad * pad, GstPad * peer,
     KmsAgnosticBin2 * self)
@@ -1008,8 +1323,17 @@ kms_agnostic_bin2_request_new_pad (GstElement * element,
 
   GST_OBJECT_FLAG_UNSET (pad, KMS_AGNOSTIC_PAD_STARTED);
 
+  KMS_AGNOSTIC_BIN2_LOCK (self);
+  g_object_set_qdata_full (G_OBJECT (pad), pad_tier_data_quark (),
+      kms_agnostic_pad_tier_new (kms_agnostic_bin2_get_tier_for_bitrate (self,
+              TARGET_BITRATE_DEFAULT)),
+      (GDestroyNotify) kms_agnostic_pad_tier_destroy);
+  KMS_AGNOSTIC_BIN2_UNLOCK (self);
+
   gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM,
       kms_agnostic_bin2_src_reconfigure_probe, element, NULL);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_UPSTREAM,
+      kms_agnostic_bin2_src_remb_probe, element, NULL);
 
   g_signal_connect (pad, "unlinked",
       G_CALLBACK (kms_agnostic_bin2_src_unlinked), self);
@@ -1037,6 +1361,7 @@ kms_agnostic_bin2_dispose (GObject * object)
   KmsAgnosticBin2 *self = KMS_AGNOSTIC_BIN2 (object);
 
   GST_DEBUG_OBJECT (object, "dispose");
+  KMS_PROBE1 (agnosticbin_destroyed, self);
 
   KMS_AGNOSTIC_BIN2_LOCK (self);
   g_thread_pool_free (self->priv->remove_pool, FALSE, FALSE);
@@ -1072,6 +1397,8 @@ kms_agnostic_bin2_finalize (GObject * object)
   g_rec_mutex_clear (&self->priv->thread_mutex);
 
   g_hash_table_unref (self->priv->bins);
+  g_array_free (self->priv->tiers, TRUE);
+  g_free (self->priv->tiers_str);
 
   /* chain up */
   G_OBJECT_CLASS (kms_agnostic_bin2_parent_class)->finalize (object);
@@ -1085,10 +1412,54 @@ kms_agnostic_bin_set_encoders_bitrate (KmsAgnosticBin2 * self)
   bins = g_hash_table_get_values (self->priv->bins);
   for (l = bins; l != NULL; l = l->next) {
     if (KMS_IS_ENC_TREE_BIN (l->data)) {
+      gint min_bitrate, max_bitrate, tier = 0;
+
+      kms_agnostic_bin2_get_bin_tier (GST_BIN (l->data), &tier);
+      kms_agnostic_bin2_get_tier_limits (self, tier, &min_bitrate,
+          &max_bitrate);
       kms_enc_tree_bin_set_bitrate_limits (KMS_ENC_TREE_BIN (l->data),
-          self->priv->min_bitrate, self->priv->max_bitrate);
+          min_bitrate, max_bitrate);
+    }
+  }
+}
+
+/* Encoders keep their configuration, only queues are updated */
+static void
+kms_agnostic_bin2_apply_latency_profile (KmsAgnosticBin2 * self)
+{
+  const KmsLatencySettings *settings =
+      kms_latency_profile_get_settings (self->priv->latency_profile);
+  GValue item = G_VALUE_INIT;
+  gboolean done = FALSE;
+  GstIterator *it;
+
+  it = gst_bin_iterate_elements (GST_BIN (self));
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:{
+        GstElement *element = g_value_get_object (&item);
+
+        if (g_object_get_qdata (G_OBJECT (element), leaky_queue_quark ())) {
+          g_object_set (element, "max-size-time", settings->video_queue_time,
+              NULL);
+        }
+
+        g_value_reset (&item);
+        break;
+      }
+      case GST_ITERATOR_RESYNC:
+        gst_iterator_resync (it);
+        break;
+      case GST_ITERATOR_ERROR:
+      case GST_ITERATOR_DONE:
+        done = TRUE;
+        break;
     }
   }
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
 }
 
 void
@@ -1147,6 +1518,23 @@ kms_agnostic_bin2_set_property (GObject * object, guint property_id,
       self->priv->codec_config = g_value_dup_boxed (value);
       KMS_AGNOSTIC_BIN2_UNLOCK (self);
       break;
+    case PROP_BITRATE_TIERS:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      kms_agnostic_bin2_parse_tiers (self, g_value_get_string (value));
+      kms_agnostic_bin_set_encoders_bitrate (self);
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
+    case PROP_TIER_SWITCH_INTERVAL:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      self->priv->tier_switch_interval = g_value_get_uint (value);
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
+    case PROP_LATENCY_PROFILE:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      self->priv->latency_profile = g_value_get_enum (value);
+      kms_agnostic_bin2_apply_latency_profile (self);
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1179,6 +1567,21 @@ kms_agnostic_bin2_get_property (GObject * object, guint property_id,
       g_value_set_boxed (value, self->priv->codec_config);
       KMS_AGNOSTIC_BIN2_UNLOCK (self);
       break;
+    case PROP_BITRATE_TIERS:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      g_value_set_string (value, self->priv->tiers_str);
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
+    case PROP_TIER_SWITCH_INTERVAL:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      g_value_set_uint (value, self->priv->tier_switch_interval);
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
+    case PROP_LATENCY_PROFILE:
+      KMS_AGNOSTIC_BIN2_LOCK (self);
+      g_value_set_enum (value, self->priv->latency_profile);
+      KMS_AGNOSTIC_BIN2_UNLOCK (self);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1229,6 +1632,26 @@ kms_agnostic_bin2_class_init (KmsAgnosticBin2Class * klass)
       g_param_spec_boxed ("codec-config", "codec config",
           "Codec configuration", GST_TYPE_STRUCTURE, G_PARAM_READWRITE));
 
+  g_object_class_install_property (gobject_class, PROP_BITRATE_TIERS,
+      g_param_spec_string ("bitrate-tiers", "Bitrate tiers",
+          "Comma separated list of bitrates (bps) splitting consumers in "
+          "tiers, each one with its own encoder. Consumers are assigned to "
+          "a tier based on their REMB. Empty means a single tier",
+          DEFAULT_BITRATE_TIERS, G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_TIER_SWITCH_INTERVAL,
+      g_param_spec_uint ("bitrate-tier-switch-interval",
+          "Bitrate tier switch interval",
+          "Minimum time (ms) a consumer stays in a bitrate tier before "
+          "moving to another one", 0, G_MAXUINT, DEFAULT_TIER_SWITCH_INTERVAL,
+          G_PARAM_READWRITE));
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_PROFILE,
+      g_param_spec_enum ("latency-profile", "Latency profile",
+          "Set of latency related values applied to queues and to new "
+          "encoders", KMS_TYPE_LATENCY_PROFILE, DEFAULT_LATENCY_PROFILE,
+          G_PARAM_READWRITE));
+
   GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, PLUGIN_NAME, 0, PLUGIN_NAME);
 
   g_type_class_add_private (klass, sizeof (KmsAgnosticBin2Private));
@@ -1350,6 +1773,10 @@ kms_agnostic_bin2_init (KmsAgnosticBin2 * self)
   self->priv->min_bitrate = MIN_BITRATE_DEFAULT;
   self->priv->max_bitrate = MAX_BITRATE_DEFAULT;
   self->priv->bitrate_unlimited = FALSE;
+  self->priv->tiers = g_array_new (FALSE, FALSE, sizeof (gint));
+  self->priv->tiers_str = NULL;
+  self->priv->tier_switch_interval = DEFAULT_TIER_SWITCH_INTERVAL;
+  self->priv->latency_profile = DEFAULT_LATENCY_PROFILE;
 }
 
 gboolean
@@ -22,13 +22,14 @@
 #include <gst/gst.h>
 
 #include "kmsaudiomixer.h"
-#include "kmsloop.h"
 #include "kmsrefstruct.h"
 #include "kmsagnosticbin.h"
+#include "kmslatencyprofile.h"
+#include "kms-core-enumtypes.h"
 
 #define PLUGIN_NAME "kmsaudiomixer"
 
-#define LATENCY 150             //ms
+#define DEFAULT_LATENCY_PROFILE KMS_LATENCY_PROFILE_DEFAULT
 
 #define KMS_AUDIO_MIXER_LOCK(mixer) \
   (g_rec_mutex_lock (&(mixer)->priv->mutex))
@@ -69,8 +70,16 @@ struct _KmsAudioMixerPrivate
   GHashTable *agnostics;
   GHashTable *typefinds;
   GstCaps *filtercaps;
-  KmsLoop *loop;
   guint count;
+  KmsLatencyProfile latency_profile;
+  guint latency;                /* ms */
+};
+
+enum
+{
+  PROP_0,
+  PROP_LATENCY_PROFILE,
+  N_PROPERTIES
 };
 
 #define RAW_AUDIO_CAPS "audio/x-raw;"
@@ -103,15 +112,19 @@ G_DEFINE_TYPE_WITH_CODE (KmsAudioMixer, kms_audio_mixer,
 static GstPadProbeReturn
 cb_latency (GstPad * pad, GstPadProbeInfo * info, gpointer data)
 {
+  KmsAudioMixer *self = KMS_AUDIO_MIXER (data);
+  GstClockTime latency;
+
   if (GST_QUERY_TYPE (GST_PAD_PROBE_INFO_QUERY (info)) != GST_QUERY_LATENCY) {
     return GST_PAD_PROBE_OK;
   }
 
+  latency = g_atomic_int_get (&self->priv->latency) * GST_MSECOND;
+
   GST_LOG_OBJECT (pad, "Modifing latency query. New latency %" G_GUINT64_FORMAT,
-      LATENCY * GST_MSECOND);
+      latency);
 
-  gst_query_set_latency (GST_PAD_PROBE_INFO_QUERY (info),
-      TRUE, 0, LATENCY * GST_MSECOND);
+  gst_query_set_latency (GST_PAD_PROBE_INFO_QUERY (info), TRUE, 0, latency);
 
   return GST_PAD_PROBE_HANDLED;
 }
@@ -170,7 +183,7 @@ link_new_agnosticbin (gchar * key, GstElement * adder, GstElement * agnosticbin)
 
   gst_pad_add_probe (sinkpad,
       GST_PAD_PROBE_TYPE_QUERY_UPSTREAM,
-      (GstPadProbeCallback) cb_latency, NULL, NULL);
+      (GstPadProbeCallback) cb_latency, self, NULL);
 
   capsfilter = kms_audio_selector_create_capsfilter (self);
 
@@ -229,7 +242,7 @@ link_new_adder (gchar * key, GstElement * agnosticbin, GstElement * adder)
 
   gst_pad_add_probe (sinkpad,
       GST_PAD_PROBE_TYPE_QUERY_UPSTREAM,
-      (GstPadProbeCallback) cb_latency, NULL, NULL);
+      (GstPadProbeCallback) cb_latency, self, NULL);
 
   capsfilter = kms_audio_selector_create_capsfilter (self);
 
@@ -486,8 +499,6 @@ kms_audio_mixer_dispose (GObject * object)
     self->priv->filtercaps = NULL;
   }
 
-  g_clear_object (&self->priv->loop);
-
   KMS_AUDIO_MIXER_UNLOCK (self);
 
   G_OBJECT_CLASS (kms_audio_mixer_parent_class)->dispose (object);
@@ -533,6 +544,8 @@ kms_audio_mixer_have_type (GstElement * typefind, guint arg0, GstCaps * caps,
 
   audiorate = gst_element_factory_make ("audiorate", NULL);
   agnosticbin = gst_element_factory_make ("agnosticbin", NULL);
+  g_object_set (agnosticbin, "latency-profile", self->priv->latency_profile,
+      NULL);
   g_object_set_qdata_full (G_OBJECT (agnosticbin), key_sink_pad_name_quark (),
       g_strdup (padname), g_free);
 
@@ -830,7 +843,8 @@ kms_audio_mixer_add_src_pad (KmsAudioMixer * self, const char *padname)
 
   g_object_set (tee, "allow-not-linked", TRUE, NULL);
   g_object_set (fakesink, "sync", FALSE, "async", FALSE, NULL);
-  g_object_set (adder, "latency", LATENCY * GST_MSECOND, NULL);
+  g_object_set (adder, "latency",
+      g_atomic_int_get (&self->priv->latency) * GST_MSECOND, NULL);
 
   g_object_set_qdata_full (G_OBJECT (adder), key_sink_pad_name_quark (),
       g_strdup (padname), g_free);
@@ -857,7 +871,7 @@ kms_audio_mixer_add_src_pad (KmsAudioMixer * self, const char *padname)
 
   gst_pad_add_probe (sinkpad,
       GST_PAD_PROBE_TYPE_QUERY_UPSTREAM,
-      (GstPadProbeCallback) cb_latency, NULL, NULL);
+      (GstPadProbeCallback) cb_latency, self, NULL);
 
   GST_DEBUG ("Linking %" GST_PTR_FORMAT " to %" GST_PTR_FORMAT, srcpad,
       sinkpad);
@@ -1021,6 +1035,83 @@ kms_audio_mixer_release_pad (GstElement * element, GstPad * pad)
   gst_element_remove_pad (element, pad);
 }
 
+static void
+set_adder_latency (gchar * key, GstElement * adder, KmsAudioMixer * self)
+{
+  g_object_set (adder, "latency",
+      g_atomic_int_get (&self->priv->latency) * GST_MSECOND, NULL);
+}
+
+static void
+set_agnosticbin_latency_profile (gchar * key, GstElement * agnosticbin,
+    KmsAudioMixer * self)
+{
+  g_object_set (agnosticbin, "latency-profile", self->priv->latency_profile,
+      NULL);
+}
+
+static void
+kms_audio_mixer_set_latency_profile (KmsAudioMixer * self,
+    KmsLatencyProfile profile)
+{
+  const KmsLatencySettings *settings;
+
+  settings = kms_latency_profile_get_settings (profile);
+
+  KMS_AUDIO_MIXER_LOCK (self);
+
+  self->priv->latency_profile = profile;
+  g_atomic_int_set (&self->priv->latency, settings->mixer_latency);
+
+  if (self->priv->adders != NULL) {
+    g_hash_table_foreach (self->priv->adders, (GHFunc) set_adder_latency,
+        self);
+  }
+
+  if (self->priv->agnostics != NULL) {
+    g_hash_table_foreach (self->priv->agnostics,
+        (GHFunc) set_agnosticbin_latency_profile, self);
+  }
+
+  KMS_AUDIO_MIXER_UNLOCK (self);
+
+  gst_bin_recalculate_latency (GST_BIN (self));
+}
+
+static void
+kms_audio_mixer_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  KmsAudioMixer *self = KMS_AUDIO_MIXER (object);
+
+  switch (property_id) {
+    case PROP_LATENCY_PROFILE:
+      kms_audio_mixer_set_latency_profile (self, g_value_get_enum (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+kms_audio_mixer_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  KmsAudioMixer *self = KMS_AUDIO_MIXER (object);
+
+  switch (property_id) {
+    case PROP_LATENCY_PROFILE:
+      KMS_AUDIO_MIXER_LOCK (self);
+      g_value_set_enum (value, self->priv->latency_profile);
+      KMS_AUDIO_MIXER_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
 static void
 kms_audio_mixer_class_init (KmsAudioMixerClass * klass)
 {
@@ -1043,6 +1134,14 @@ kms_audio_mixer_class_init (KmsAudioMixerClass * klass)
 
   gobject_class->dispose = GST_DEBUG_FUNCPTR (kms_audio_mixer_dispose);
   gobject_class->finalize = GST_DEBUG_FUNCPTR (kms_audio_mixer_finalize);
+  gobject_class->set_property = kms_audio_mixer_set_property;
+  gobject_class->get_property = kms_audio_mixer_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_PROFILE,
+      g_param_spec_enum ("latency-profile", "Latency profile",
+          "Latency profile used to size the mixing latency",
+          KMS_TYPE_LATENCY_PROFILE, DEFAULT_LATENCY_PROFILE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   /* Registers a private structure for the instantiatable type */
   g_type_class_add_private (klass, sizeof (KmsAudioMixerPrivate));
@@ -1061,7 +1160,9 @@ kms_audio_mixer_init (KmsAudioMixer * self)
       g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 
   g_rec_mutex_init (&self->priv->mutex);
-  self->priv->loop = kms_loop_new ();
+  self->priv->latency_profile = DEFAULT_LATENCY_PROFILE;
+  self->priv->latency =
+      kms_latency_profile_get_settings (DEFAULT_LATENCY_PROFILE)->mixer_latency;
 }
 
 gboolean
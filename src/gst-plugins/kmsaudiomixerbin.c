@@ -23,9 +23,13 @@
 
 #include "kmsaudiomixerbin.h"
 #include "kmsloop.h"
+#include "kmslatencyprofile.h"
+#include "kms-core-enumtypes.h"
 
 #define PLUGIN_NAME "audiomixerbin"
 
+#define DEFAULT_LATENCY_PROFILE KMS_LATENCY_PROFILE_DEFAULT
+
 #define KMS_AUDIO_MIXER_BIN_PROBE_ID_KEY "kms-audio-mixer-bin-probe-id"
 G_DEFINE_QUARK (KMS_AUDIO_MIXER_BIN_PROBE_ID_KEY,
     kms_audio_mixer_bin_probe_id_key);
@@ -52,8 +56,17 @@ struct _KmsAudioMixerBinPrivate
   GstElement *adder;
   GRecMutex mutex;
   KmsLoop *loop;
+  GHashTable *sources;          /* pending ids of sources added to loop */
   GstPad *srcpad;
   guint count;
+  KmsLatencyProfile latency_profile;
+};
+
+enum
+{
+  PROP_0,
+  PROP_LATENCY_PROFILE,
+  N_PROPERTIES
 };
 
 #define RAW_AUDIO_CAPS "audio/x-raw;"
@@ -237,6 +250,11 @@ kms_audio_mixer_bin_have_type (GstElement * typefind, guint arg0,
 
   agnosticbin = gst_element_factory_make ("agnosticbin", NULL);
 
+  KMS_AUDIO_MIXER_BIN_LOCK (self);
+  g_object_set (agnosticbin, "latency-profile", self->priv->latency_profile,
+      NULL);
+  KMS_AUDIO_MIXER_BIN_UNLOCK (self);
+
   gst_bin_add_many (GST_BIN (self), agnosticbin, NULL);
   gst_element_sync_state_with_parent (agnosticbin);
 
@@ -306,6 +324,11 @@ remove_elements (RefCounter * refdata)
 
   data = (ProbeData *) refdata->data;
 
+  KMS_AUDIO_MIXER_BIN_LOCK (data->audiomixer);
+  g_hash_table_remove (data->audiomixer->priv->sources,
+      GUINT_TO_POINTER (g_source_get_id (g_main_current_source ())));
+  KMS_AUDIO_MIXER_BIN_UNLOCK (data->audiomixer);
+
   kms_audio_mixer_bin_unlink_elements (data->audiomixer, data->typefind,
       data->agnosticbin);
   kms_audio_mixer_bin_remove_elements (data->audiomixer, data->typefind,
@@ -393,6 +416,7 @@ event_probe_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
 {
   RefCounter *refdata;
   ProbeData *data;
+  guint source_id;
   gulong *id;
 
   if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_DATA (info)) != GST_EVENT_EOS)
@@ -408,9 +432,13 @@ event_probe_cb (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
 
   /* We can not access to some GstPad functions because of mutex deadlocks */
   /* So we are going to manage all the stuff in a separate thread */
-  kms_loop_idle_add_full (data->audiomixer->priv->loop, G_PRIORITY_DEFAULT,
-      (GSourceFunc) remove_elements, ref_counter_inc (refdata),
-      (GDestroyNotify) ref_counter_dec);
+  KMS_AUDIO_MIXER_BIN_LOCK (data->audiomixer);
+  source_id = kms_loop_idle_add_full (data->audiomixer->priv->loop,
+      G_PRIORITY_DEFAULT, (GSourceFunc) remove_elements,
+      ref_counter_inc (refdata), (GDestroyNotify) ref_counter_dec);
+  g_hash_table_add (data->audiomixer->priv->sources,
+      GUINT_TO_POINTER (source_id));
+  KMS_AUDIO_MIXER_BIN_UNLOCK (data->audiomixer);
 
   return GST_PAD_PROBE_DROP;
 }
@@ -622,6 +650,26 @@ kms_audio_mixer_bin_tear_down (KmsAudioMixerBin * self)
   }
 }
 
+static void
+kms_audio_mixer_bin_remove_sources (KmsAudioMixerBin * self)
+{
+  GList *ids, *l;
+
+  if (self->priv->loop == NULL) {
+    return;
+  }
+
+  /* The loop is shared with other elements and outlives this mixer */
+  ids = g_hash_table_get_keys (self->priv->sources);
+  g_hash_table_remove_all (self->priv->sources);
+
+  for (l = ids; l != NULL; l = l->next) {
+    kms_loop_remove (self->priv->loop, GPOINTER_TO_UINT (l->data));
+  }
+
+  g_list_free (ids);
+}
+
 static void
 kms_audio_mixer_bin_dispose (GObject * object)
 {
@@ -632,6 +680,7 @@ kms_audio_mixer_bin_dispose (GObject * object)
   KMS_AUDIO_MIXER_BIN_LOCK (self);
 
   kms_audio_mixer_bin_tear_down (self);
+  kms_audio_mixer_bin_remove_sources (self);
   g_clear_object (&self->priv->loop);
 
   KMS_AUDIO_MIXER_BIN_UNLOCK (self);
@@ -646,11 +695,77 @@ kms_audio_mixer_bin_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (self, "finalize");
 
+  g_hash_table_unref (self->priv->sources);
   g_rec_mutex_clear (&self->priv->mutex);
 
   G_OBJECT_CLASS (kms_audio_mixer_bin_parent_class)->finalize (object);
 }
 
+static void
+set_agnosticbin_latency_profile (const GValue * item, gpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  KmsLatencyProfile profile = GPOINTER_TO_INT (user_data);
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+          "latency-profile") != NULL) {
+    g_object_set (element, "latency-profile", profile, NULL);
+  }
+}
+
+static void
+kms_audio_mixer_bin_set_latency_profile (KmsAudioMixerBin * self,
+    KmsLatencyProfile profile)
+{
+  GstIterator *it;
+
+  KMS_AUDIO_MIXER_BIN_LOCK (self);
+  self->priv->latency_profile = profile;
+  KMS_AUDIO_MIXER_BIN_UNLOCK (self);
+
+  /* Encoders created from now on inside the agnosticbins use the profile */
+  it = gst_bin_iterate_elements (GST_BIN (self));
+  while (gst_iterator_foreach (it, set_agnosticbin_latency_profile,
+          GINT_TO_POINTER (profile)) == GST_ITERATOR_RESYNC) {
+    gst_iterator_resync (it);
+  }
+  gst_iterator_free (it);
+}
+
+static void
+kms_audio_mixer_bin_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  KmsAudioMixerBin *self = KMS_AUDIO_MIXER_BIN (object);
+
+  switch (property_id) {
+    case PROP_LATENCY_PROFILE:
+      kms_audio_mixer_bin_set_latency_profile (self, g_value_get_enum (value));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+kms_audio_mixer_bin_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  KmsAudioMixerBin *self = KMS_AUDIO_MIXER_BIN (object);
+
+  switch (property_id) {
+    case PROP_LATENCY_PROFILE:
+      KMS_AUDIO_MIXER_BIN_LOCK (self);
+      g_value_set_enum (value, self->priv->latency_profile);
+      KMS_AUDIO_MIXER_BIN_UNLOCK (self);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
 static void
 kms_audio_mixer_bin_class_init (KmsAudioMixerBinClass * klass)
 {
@@ -673,6 +788,14 @@ kms_audio_mixer_bin_class_init (KmsAudioMixerBinClass * klass)
 
   gobject_class->dispose = GST_DEBUG_FUNCPTR (kms_audio_mixer_bin_dispose);
   gobject_class->finalize = GST_DEBUG_FUNCPTR (kms_audio_mixer_bin_finalize);
+  gobject_class->set_property = kms_audio_mixer_bin_set_property;
+  gobject_class->get_property = kms_audio_mixer_bin_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_LATENCY_PROFILE,
+      g_param_spec_enum ("latency-profile", "Latency profile",
+          "Latency profile used by the encoders of the mixed streams",
+          KMS_TYPE_LATENCY_PROFILE, DEFAULT_LATENCY_PROFILE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   /* Registers a private structure for the instantiatable type */
   g_type_class_add_private (klass, sizeof (KmsAudioMixerBinPrivate));
@@ -696,7 +819,9 @@ kms_audio_mixer_bin_init (KmsAudioMixerBin * self)
   gst_element_sync_state_with_parent (self->priv->adder);
 
   g_rec_mutex_init (&self->priv->mutex);
-  self->priv->loop = kms_loop_new ();
+  self->priv->loop = kms_loop_pool_get_loop (self);
+  self->priv->sources = g_hash_table_new (NULL, NULL);
+  self->priv->latency_profile = DEFAULT_LATENCY_PROFILE;
 }
 
 gboolean
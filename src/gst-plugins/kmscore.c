@@ -32,6 +32,9 @@
 #include <kmsdummyrtp.h>
 #include <kmsdummysdp.h>
 #include <kmsdummyuri.h>
+#include <kmsproctimetracer.h>
+#include <kmsnetimpairment.h>
+#include <kmsrtploadgen.h>
 
 static gboolean
 kurento_init (GstPlugin * kurento)
@@ -81,6 +84,15 @@ kurento_init (GstPlugin * kurento)
   if (!kms_dummy_uri_plugin_init (kurento))
     return FALSE;
 
+  if (!kms_proc_time_tracer_plugin_init (kurento))
+    return FALSE;
+
+  if (!kms_net_impairment_plugin_init (kurento))
+    return FALSE;
+
+  if (!kms_rtp_load_gen_plugin_init (kurento))
+    return FALSE;
+
   return TRUE;
 }
 
@@ -54,6 +54,7 @@ struct _KmsFilterElementPrivate
   GRecMutex mutex;
   gchar *filter_factory;
   GstElement *filter;
+  GstElement *queue;
   KmsFilterType filter_type;
 };
 
@@ -75,6 +76,40 @@ G_DEFINE_TYPE_WITH_CODE (KmsFilterElement, kms_filter_element,
     GST_DEBUG_CATEGORY_INIT (kms_filter_element_debug_category, PLUGIN_NAME,
         0, "debug category for filterelement element"));
 
+static guint
+kms_filter_element_get_queue_size (KmsFilterElement * self)
+{
+  const KmsLatencySettings *settings;
+
+  settings =
+      kms_latency_profile_get_settings (kms_element_get_latency_profile
+      (KMS_ELEMENT (self)));
+
+  return settings->filter_queue_buffers;
+}
+
+static void
+kms_filter_element_latency_profile_changed (KmsFilterElement * self,
+    GParamSpec * pspec, gpointer data)
+{
+  GstElement *queue;
+
+  KMS_FILTER_ELEMENT_LOCK (self);
+  queue = self->priv->queue;
+  if (queue != NULL) {
+    gst_object_ref (queue);
+  }
+  KMS_FILTER_ELEMENT_UNLOCK (self);
+
+  if (queue == NULL) {
+    return;
+  }
+
+  g_object_set (queue, "max-size-buffers",
+      kms_filter_element_get_queue_size (self), NULL);
+  gst_object_unref (queue);
+}
+
 static void
 kms_filter_element_connect_filter (KmsFilterElement * self,
     KmsElementPadType type, GstElement * filter, GstElement * agnosticbin)
@@ -82,12 +117,17 @@ kms_filter_element_connect_filter (KmsFilterElement * self,
   GstElement *queue = gst_element_factory_make ("queue", NULL);
   GstPad *target = gst_element_get_static_pad (queue, "sink");
 
-  g_object_set (queue, "leaky", 2, "max-size-buffers", 1, NULL);
+  g_object_set (queue, "leaky", 2, "max-size-buffers",
+      kms_filter_element_get_queue_size (self), NULL);
 
   gst_bin_add_many (GST_BIN (self), queue, filter, NULL);
 
   self->priv->filter = filter;
 
+  KMS_FILTER_ELEMENT_LOCK (self);
+  self->priv->queue = queue;
+  KMS_FILTER_ELEMENT_UNLOCK (self);
+
   gst_element_link_many (queue, filter, agnosticbin, NULL);
   gst_element_sync_state_with_parent (filter);
   gst_element_sync_state_with_parent (queue);
@@ -367,7 +407,11 @@ kms_filter_element_init (KmsFilterElement * self)
   g_rec_mutex_init (&self->priv->mutex);
 
   self->priv->filter = NULL;
+  self->priv->queue = NULL;
   self->priv->filter_factory = NULL;
+
+  g_signal_connect (self, "notify::latency-profile",
+      G_CALLBACK (kms_filter_element_latency_profile_changed), NULL);
 }
 
 gboolean
@@ -0,0 +1,677 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kmsnetimpairment.h"
+
+#define PLUGIN_NAME "netimpairment"
+
+GST_DEBUG_CATEGORY_STATIC (kms_net_impairment_debug);
+#define GST_CAT_DEFAULT kms_net_impairment_debug
+#define kms_net_impairment_parent_class parent_class
+
+G_DEFINE_TYPE_WITH_CODE (KmsNetImpairment, kms_net_impairment,
+    GST_TYPE_ELEMENT,
+    GST_DEBUG_CATEGORY_INIT (kms_net_impairment_debug,
+        PLUGIN_NAME, 0, "debug category for " PLUGIN_NAME " element"));
+
+#define KMS_NET_IMPAIRMENT_GET_PRIVATE(obj) ( \
+  G_TYPE_INSTANCE_GET_PRIVATE (               \
+    (obj),                                    \
+    KMS_TYPE_NET_IMPAIRMENT,                  \
+    KmsNetImpairmentPrivate                   \
+  )                                           \
+)
+
+#define KMS_NET_IMPAIRMENT_LOCK(obj) (                        \
+  g_mutex_lock (&KMS_NET_IMPAIRMENT (obj)->priv->mutex)       \
+)
+
+#define KMS_NET_IMPAIRMENT_UNLOCK(obj) (                      \
+  g_mutex_unlock (&KMS_NET_IMPAIRMENT (obj)->priv->mutex)     \
+)
+
+#define DEFAULT_LOSS 0.0
+#define DEFAULT_BURST_LOSS 0.0
+#define DEFAULT_BURST_LENGTH 5
+#define DEFAULT_DELAY 0
+#define DEFAULT_JITTER 0
+#define DEFAULT_REORDER 0.0
+#define DEFAULT_BANDWIDTH 0
+#define DEFAULT_MAX_QUEUE 1000
+#define DEFAULT_SEED 0
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+enum
+{
+  PROP_0,
+  PROP_LOSS,
+  PROP_BURST_LOSS,
+  PROP_BURST_LENGTH,
+  PROP_DELAY,
+  PROP_JITTER,
+  PROP_REORDER,
+  PROP_BANDWIDTH,
+  PROP_MAX_QUEUE,
+  PROP_SEED,
+  PROP_STATS,
+  N_PROPERTIES
+};
+
+typedef struct _KmsNetImpairmentItem
+{
+  GstMiniObject *object;
+  gint64 release;               /* monotonic, us */
+} KmsNetImpairmentItem;
+
+struct _KmsNetImpairmentPrivate
+{
+  GstPad *sinkpad;
+  GstPad *srcpad;
+
+  GMutex mutex;
+  GCond cond;
+
+  /* KmsNetImpairmentItem sorted by release time */
+  GQueue queue;
+  gboolean flushing;
+  GstFlowReturn srcresult;
+
+  GRand *rand;
+  gboolean in_burst;
+  gint64 last_release;
+  gint64 link_free;
+
+  /* Properties */
+  gdouble loss;
+  gdouble burst_loss;
+  guint burst_length;
+  guint delay;                  /* ms */
+  guint jitter;                 /* ms */
+  gdouble reorder;
+  guint bandwidth;              /* bps */
+  guint max_queue;
+  guint seed;
+
+  /* Stats */
+  guint64 received;
+  guint64 lost;
+  guint64 burst_lost;
+  guint64 queue_dropped;
+  guint64 reordered;
+  guint64 sent;
+};
+
+static void
+kms_net_impairment_item_free (KmsNetImpairmentItem * item)
+{
+  gst_mini_object_unref (item->object);
+  g_slice_free (KmsNetImpairmentItem, item);
+}
+
+static void
+kms_net_impairment_clear_queue (KmsNetImpairment * self)
+{
+  KmsNetImpairmentItem *item;
+
+  while ((item = g_queue_pop_head (&self->priv->queue)) != NULL) {
+    kms_net_impairment_item_free (item);
+  }
+
+  self->priv->last_release = 0;
+  self->priv->link_free = 0;
+  self->priv->in_burst = FALSE;
+}
+
+/* Must be called with the lock held */
+static void
+kms_net_impairment_enqueue (KmsNetImpairment * self, GstMiniObject * object,
+    gint64 release, gboolean skip_ahead)
+{
+  KmsNetImpairmentItem *item = g_slice_new (KmsNetImpairmentItem);
+  GList *l;
+
+  item->object = object;
+  item->release = release;
+
+  /* Serialized events are never overtaken */
+  for (l = self->priv->queue.tail; l != NULL; l = l->prev) {
+    KmsNetImpairmentItem *prev = l->data;
+
+    if (!skip_ahead || !GST_IS_BUFFER (prev->object)
+        || prev->release <= release) {
+      break;
+    }
+  }
+
+  if (l == NULL) {
+    g_queue_push_head (&self->priv->queue, item);
+  } else {
+    g_queue_insert_after (&self->priv->queue, l, item);
+  }
+
+  g_cond_signal (&self->priv->cond);
+}
+
+/* Must be called with the lock held. Returns TRUE if the buffer is lost */
+static gboolean
+kms_net_impairment_lose (KmsNetImpairment * self)
+{
+  KmsNetImpairmentPrivate *priv = self->priv;
+
+  /* Gilbert-Elliott: a burst starts with probability burst-loss and */
+  /* every packet inside it is lost. Bursts last burst-length packets */
+  /* on average.                                                       */
+  if (!priv->in_burst && priv->burst_loss > 0.0
+      && g_rand_double (priv->rand) < priv->burst_loss) {
+    priv->in_burst = TRUE;
+  }
+
+  if (priv->in_burst) {
+    if (g_rand_double (priv->rand) * priv->burst_length < 1.0) {
+      priv->in_burst = FALSE;
+    }
+    priv->burst_lost++;
+    return TRUE;
+  }
+
+  if (priv->loss > 0.0 && g_rand_double (priv->rand) < priv->loss) {
+    priv->lost++;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+static GstFlowReturn
+kms_net_impairment_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  KmsNetImpairment *self = KMS_NET_IMPAIRMENT (parent);
+  KmsNetImpairmentPrivate *priv = self->priv;
+  GstFlowReturn ret;
+  gboolean skip_ahead = FALSE;
+  gint64 now, release;
+
+  KMS_NET_IMPAIRMENT_LOCK (self);
+
+  ret = priv->flushing ? GST_FLOW_FLUSHING : priv->srcresult;
+  if (ret != GST_FLOW_OK) {
+    KMS_NET_IMPAIRMENT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
+  priv->received++;
+
+  if (kms_net_impairment_lose (self)) {
+    KMS_NET_IMPAIRMENT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  if (priv->max_queue > 0 && priv->queue.length >= priv->max_queue) {
+    /* Tail drop, as a router whose buffer is full */
+    priv->queue_dropped++;
+    KMS_NET_IMPAIRMENT_UNLOCK (self);
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  now = g_get_monotonic_time ();
+
+  if (priv->reorder > 0.0 && g_rand_double (priv->rand) < priv->reorder) {
+    /* Sent right away, ahead of the delayed ones */
+    priv->reordered++;
+    skip_ahead = TRUE;
+    release = now;
+  } else {
+    release = now + priv->delay * G_TIME_SPAN_MILLISECOND;
+
+    if (priv->jitter > 0) {
+      release += g_rand_int_range (priv->rand,
+          -(gint32) priv->jitter * 1000, priv->jitter * 1000 + 1);
+    }
+
+    /* Jitter alone does not reorder */
+    release = MAX (release, priv->last_release);
+
+    if (priv->bandwidth > 0) {
+      /* Leaves once its last bit is on the wire */
+      release = MAX (release, priv->link_free) +
+          gst_buffer_get_size (buffer) * 8 * G_USEC_PER_SEC / priv->bandwidth;
+      priv->link_free = release;
+    }
+
+    priv->last_release = release;
+  }
+
+  kms_net_impairment_enqueue (self, GST_MINI_OBJECT_CAST (buffer), release,
+      skip_ahead);
+
+  KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+  return GST_FLOW_OK;
+}
+
+static void
+kms_net_impairment_loop (KmsNetImpairment * self)
+{
+  KmsNetImpairmentPrivate *priv = self->priv;
+  KmsNetImpairmentItem *item;
+  GstMiniObject *object;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  KMS_NET_IMPAIRMENT_LOCK (self);
+
+  while (!priv->flushing && g_queue_is_empty (&priv->queue)) {
+    g_cond_wait (&priv->cond, &priv->mutex);
+  }
+
+  if (priv->flushing) {
+    KMS_NET_IMPAIRMENT_UNLOCK (self);
+    gst_pad_pause_task (priv->srcpad);
+    return;
+  }
+
+  item = g_queue_peek_head (&priv->queue);
+  if (item->release > g_get_monotonic_time ()) {
+    /* Woken up earlier if something with a sooner release arrives */
+    g_cond_wait_until (&priv->cond, &priv->mutex, item->release);
+    KMS_NET_IMPAIRMENT_UNLOCK (self);
+    return;
+  }
+
+  g_queue_pop_head (&priv->queue);
+  object = gst_mini_object_ref (item->object);
+  kms_net_impairment_item_free (item);
+
+  if (GST_IS_BUFFER (object)) {
+    priv->sent++;
+  }
+
+  KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+  if (GST_IS_BUFFER (object)) {
+    ret = gst_pad_push (priv->srcpad, GST_BUFFER_CAST (object));
+  } else if (!gst_pad_push_event (priv->srcpad, GST_EVENT_CAST (object))) {
+    GST_DEBUG_OBJECT (self, "Event not handled downstream");
+  }
+
+  if (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED) {
+    /* A network does not care whether anybody listens */
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Pausing task, reason %s", gst_flow_get_name (ret));
+
+  KMS_NET_IMPAIRMENT_LOCK (self);
+  priv->srcresult = ret;
+  KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+  gst_pad_pause_task (priv->srcpad);
+}
+
+static gboolean
+kms_net_impairment_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  KmsNetImpairment *self = KMS_NET_IMPAIRMENT (parent);
+  gboolean ret;
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      KMS_NET_IMPAIRMENT_LOCK (self);
+      self->priv->flushing = TRUE;
+      g_cond_signal (&self->priv->cond);
+      KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+      ret = gst_pad_push_event (self->priv->srcpad, event);
+      gst_pad_pause_task (self->priv->srcpad);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      ret = gst_pad_push_event (self->priv->srcpad, event);
+
+      KMS_NET_IMPAIRMENT_LOCK (self);
+      kms_net_impairment_clear_queue (self);
+      self->priv->flushing = FALSE;
+      self->priv->srcresult = GST_FLOW_OK;
+      KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+      gst_pad_start_task (self->priv->srcpad,
+          (GstTaskFunction) kms_net_impairment_loop, self, NULL);
+      break;
+    default:
+      if (!GST_EVENT_IS_SERIALIZED (event)) {
+        ret = gst_pad_event_default (pad, parent, event);
+        break;
+      }
+
+      /* Kept in order with the buffers around it */
+      KMS_NET_IMPAIRMENT_LOCK (self);
+      if (self->priv->flushing) {
+        KMS_NET_IMPAIRMENT_UNLOCK (self);
+        gst_event_unref (event);
+        ret = FALSE;
+        break;
+      }
+      kms_net_impairment_enqueue (self, GST_MINI_OBJECT_CAST (event),
+          MAX (self->priv->last_release, g_get_monotonic_time ()), FALSE);
+      KMS_NET_IMPAIRMENT_UNLOCK (self);
+      ret = TRUE;
+      break;
+  }
+
+  return ret;
+}
+
+static gboolean
+kms_net_impairment_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  KmsNetImpairment *self = KMS_NET_IMPAIRMENT (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      if (active) {
+        KMS_NET_IMPAIRMENT_LOCK (self);
+        self->priv->flushing = FALSE;
+        self->priv->srcresult = GST_FLOW_OK;
+        KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+        res = gst_pad_start_task (pad,
+            (GstTaskFunction) kms_net_impairment_loop, self, NULL);
+      } else {
+        KMS_NET_IMPAIRMENT_LOCK (self);
+        self->priv->flushing = TRUE;
+        g_cond_signal (&self->priv->cond);
+        KMS_NET_IMPAIRMENT_UNLOCK (self);
+
+        res = gst_pad_stop_task (pad);
+
+        KMS_NET_IMPAIRMENT_LOCK (self);
+        kms_net_impairment_clear_queue (self);
+        KMS_NET_IMPAIRMENT_UNLOCK (self);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+
+  return res;
+}
+
+static GstStructure *
+kms_net_impairment_get_stats (KmsNetImpairment * self)
+{
+  KmsNetImpairmentPrivate *priv = self->priv;
+
+  return gst_structure_new ("stats",
+      "received", G_TYPE_UINT64, priv->received,
+      "lost", G_TYPE_UINT64, priv->lost,
+      "burst-lost", G_TYPE_UINT64, priv->burst_lost,
+      "queue-dropped", G_TYPE_UINT64, priv->queue_dropped,
+      "reordered", G_TYPE_UINT64, priv->reordered,
+      "sent", G_TYPE_UINT64, priv->sent,
+      "queued", G_TYPE_UINT, priv->queue.length, NULL);
+}
+
+static void
+kms_net_impairment_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  KmsNetImpairment *self = KMS_NET_IMPAIRMENT (object);
+
+  KMS_NET_IMPAIRMENT_LOCK (self);
+
+  switch (property_id) {
+    case PROP_LOSS:
+      self->priv->loss = g_value_get_double (value);
+      break;
+    case PROP_BURST_LOSS:
+      self->priv->burst_loss = g_value_get_double (value);
+      break;
+    case PROP_BURST_LENGTH:
+      self->priv->burst_length = g_value_get_uint (value);
+      break;
+    case PROP_DELAY:
+      self->priv->delay = g_value_get_uint (value);
+      break;
+    case PROP_JITTER:
+      self->priv->jitter = g_value_get_uint (value);
+      break;
+    case PROP_REORDER:
+      self->priv->reorder = g_value_get_double (value);
+      break;
+    case PROP_BANDWIDTH:
+      self->priv->bandwidth = g_value_get_uint (value);
+      break;
+    case PROP_MAX_QUEUE:
+      self->priv->max_queue = g_value_get_uint (value);
+      break;
+    case PROP_SEED:
+      self->priv->seed = g_value_get_uint (value);
+      if (self->priv->seed != 0) {
+        g_rand_set_seed (self->priv->rand, self->priv->seed);
+      }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  KMS_NET_IMPAIRMENT_UNLOCK (self);
+}
+
+static void
+kms_net_impairment_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  KmsNetImpairment *self = KMS_NET_IMPAIRMENT (object);
+
+  KMS_NET_IMPAIRMENT_LOCK (self);
+
+  switch (property_id) {
+    case PROP_LOSS:
+      g_value_set_double (value, self->priv->loss);
+      break;
+    case PROP_BURST_LOSS:
+      g_value_set_double (value, self->priv->burst_loss);
+      break;
+    case PROP_BURST_LENGTH:
+      g_value_set_uint (value, self->priv->burst_length);
+      break;
+    case PROP_DELAY:
+      g_value_set_uint (value, self->priv->delay);
+      break;
+    case PROP_JITTER:
+      g_value_set_uint (value, self->priv->jitter);
+      break;
+    case PROP_REORDER:
+      g_value_set_double (value, self->priv->reorder);
+      break;
+    case PROP_BANDWIDTH:
+      g_value_set_uint (value, self->priv->bandwidth);
+      break;
+    case PROP_MAX_QUEUE:
+      g_value_set_uint (value, self->priv->max_queue);
+      break;
+    case PROP_SEED:
+      g_value_set_uint (value, self->priv->seed);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, kms_net_impairment_get_stats (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  KMS_NET_IMPAIRMENT_UNLOCK (self);
+}
+
+static void
+kms_net_impairment_finalize (GObject * object)
+{
+  KmsNetImpairment *self = KMS_NET_IMPAIRMENT (object);
+
+  kms_net_impairment_clear_queue (self);
+  g_rand_free (self->priv->rand);
+  g_mutex_clear (&self->priv->mutex);
+  g_cond_clear (&self->priv->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+kms_net_impairment_init (KmsNetImpairment * self)
+{
+  self->priv = KMS_NET_IMPAIRMENT_GET_PRIVATE (self);
+
+  self->priv->sinkpad = gst_pad_new_from_static_template (&sinktemplate,
+      "sink");
+  gst_pad_set_chain_function (self->priv->sinkpad, kms_net_impairment_chain);
+  gst_pad_set_event_function (self->priv->sinkpad,
+      kms_net_impairment_sink_event);
+  GST_PAD_SET_PROXY_CAPS (self->priv->sinkpad);
+  GST_PAD_SET_PROXY_ALLOCATION (self->priv->sinkpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->sinkpad);
+
+  self->priv->srcpad = gst_pad_new_from_static_template (&srctemplate, "src");
+  gst_pad_set_activatemode_function (self->priv->srcpad,
+      kms_net_impairment_activate_mode);
+  GST_PAD_SET_PROXY_CAPS (self->priv->srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->srcpad);
+
+  g_mutex_init (&self->priv->mutex);
+  g_cond_init (&self->priv->cond);
+  g_queue_init (&self->priv->queue);
+  self->priv->flushing = TRUE;
+  self->priv->rand = g_rand_new ();
+
+  self->priv->loss = DEFAULT_LOSS;
+  self->priv->burst_loss = DEFAULT_BURST_LOSS;
+  self->priv->burst_length = DEFAULT_BURST_LENGTH;
+  self->priv->delay = DEFAULT_DELAY;
+  self->priv->jitter = DEFAULT_JITTER;
+  self->priv->reorder = DEFAULT_REORDER;
+  self->priv->bandwidth = DEFAULT_BANDWIDTH;
+  self->priv->max_queue = DEFAULT_MAX_QUEUE;
+  self->priv->seed = DEFAULT_SEED;
+}
+
+static void
+kms_net_impairment_class_init (KmsNetImpairmentClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->finalize = kms_net_impairment_finalize;
+  gobject_class->set_property = kms_net_impairment_set_property;
+  gobject_class->get_property = kms_net_impairment_get_property;
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "Network impairment",
+      "Generic/Network",
+      "Loses, delays, reorders and rate limits buffers like a bad network "
+      "would. Meant for testing",
+      "Kurento <kurento@googlegroups.com>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&srctemplate));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&sinktemplate));
+
+  GST_DEBUG_REGISTER_FUNCPTR (kms_net_impairment_chain);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_net_impairment_sink_event);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_net_impairment_activate_mode);
+
+  g_object_class_install_property (gobject_class, PROP_LOSS,
+      g_param_spec_double ("loss", "Loss",
+          "Probability of losing each buffer", 0.0, 1.0, DEFAULT_LOSS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BURST_LOSS,
+      g_param_spec_double ("burst-loss", "Burst loss",
+          "Probability of starting a loss burst on each buffer", 0.0, 1.0,
+          DEFAULT_BURST_LOSS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BURST_LENGTH,
+      g_param_spec_uint ("burst-length", "Burst length",
+          "Mean length of the loss bursts, in buffers", 1, G_MAXUINT,
+          DEFAULT_BURST_LENGTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_DELAY,
+      g_param_spec_uint ("delay", "Delay", "Delay added to every buffer (ms)",
+          0, G_MAXUINT / 1000, DEFAULT_DELAY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_JITTER,
+      g_param_spec_uint ("jitter", "Jitter",
+          "Maximum random variation of the delay (ms)", 0,
+          G_MAXINT32 / 1000, DEFAULT_JITTER,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REORDER,
+      g_param_spec_double ("reorder", "Reorder",
+          "Probability of sending a buffer ahead of the delayed ones", 0.0,
+          1.0, DEFAULT_REORDER, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BANDWIDTH,
+      g_param_spec_uint ("bandwidth", "Bandwidth",
+          "Link capacity in bps (0 = unlimited)", 0, G_MAXUINT,
+          DEFAULT_BANDWIDTH, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MAX_QUEUE,
+      g_param_spec_uint ("max-queue", "Max queue",
+          "Buffers queued before dropping new ones (0 = unlimited)", 0,
+          G_MAXUINT, DEFAULT_MAX_QUEUE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SEED,
+      g_param_spec_uint ("seed", "Seed",
+          "Seed of the random generator, for reproducible runs (0 = random)",
+          0, G_MAXUINT, DEFAULT_SEED,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Stats",
+          "Counters of the buffers received, lost, dropped and sent",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_type_class_add_private (klass, sizeof (KmsNetImpairmentPrivate));
+}
+
+gboolean
+kms_net_impairment_plugin_init (GstPlugin * plugin)
+{
+  return gst_element_register (plugin, PLUGIN_NAME, GST_RANK_NONE,
+      KMS_TYPE_NET_IMPAIRMENT);
+}
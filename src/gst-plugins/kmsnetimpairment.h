@@ -0,0 +1,67 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_NET_IMPAIRMENT_H__
+#define __KMS_NET_IMPAIRMENT_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+/*
+ * Test element that behaves like a bad network link: it loses buffers
+ * (independently and in bursts), delays them with jitter, sends some ahead
+ * of the rest and limits the throughput to a given bandwidth. Runs with
+ * the same seed are reproducible. For example, a lossy uplink to a local
+ * RtpEndpoint:
+ *
+ *   rtploadgen name=peer peer.rtp_src ! netimpairment loss=0.02 delay=40 jitter=10 \
+ *       bandwidth=1000000 ! udpsink host=127.0.0.1 port=5004
+ */
+#define KMS_TYPE_NET_IMPAIRMENT \
+  (kms_net_impairment_get_type())
+#define KMS_NET_IMPAIRMENT(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),KMS_TYPE_NET_IMPAIRMENT,KmsNetImpairment))
+#define KMS_NET_IMPAIRMENT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),KMS_TYPE_NET_IMPAIRMENT,KmsNetImpairmentClass))
+#define KMS_IS_NET_IMPAIRMENT(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),KMS_TYPE_NET_IMPAIRMENT))
+#define KMS_IS_NET_IMPAIRMENT_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),KMS_TYPE_NET_IMPAIRMENT))
+#define KMS_NET_IMPAIRMENT_CAST(obj) ((KmsNetImpairment*)(obj))
+
+typedef struct _KmsNetImpairment KmsNetImpairment;
+typedef struct _KmsNetImpairmentClass KmsNetImpairmentClass;
+typedef struct _KmsNetImpairmentPrivate KmsNetImpairmentPrivate;
+
+struct _KmsNetImpairment
+{
+  GstElement element;
+
+  KmsNetImpairmentPrivate *priv;
+};
+
+struct _KmsNetImpairmentClass
+{
+  GstElementClass parent_class;
+};
+
+GType kms_net_impairment_get_type (void);
+
+gboolean kms_net_impairment_plugin_init (GstPlugin * plugin);
+
+G_END_DECLS
+#endif /* __KMS_NET_IMPAIRMENT_H__ */
@@ -0,0 +1,315 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#define GST_USE_UNSTABLE_API
+#include <gst/gst.h>
+#include <gst/gsttracer.h>
+
+#include "kmsproctimetracer.h"
+#include "kmsproctime.h"
+
+#define PLUGIN_NAME "kmsproctime"
+
+/* Entries kept per queue, older ones are forgotten */
+#define MAX_QUEUE_ENTRIES 1024
+
+GST_DEBUG_CATEGORY_STATIC (kms_proc_time_tracer_debug_category);
+#define GST_CAT_DEFAULT kms_proc_time_tracer_debug_category
+
+struct _KmsProcTimeTracer
+{
+  GstTracer parent;
+};
+
+struct _KmsProcTimeTracerClass
+{
+  GstTracerClass parent_class;
+};
+
+G_DEFINE_TYPE_WITH_CODE (KmsProcTimeTracer, kms_proc_time_tracer,
+    GST_TYPE_TRACER,
+    GST_DEBUG_CATEGORY_INIT (kms_proc_time_tracer_debug_category, PLUGIN_NAME,
+        0, "debug category for processing time tracer"));
+
+/* A push in progress on the current thread */
+typedef struct _PushFrame
+{
+  GstPad *pad;
+  GstElement *element;          /* Element receiving the buffer */
+  GstClockTime start;
+  GstClockTime children;        /* Time spent in nested pushes */
+} PushFrame;
+
+typedef struct _QueueEntry
+{
+  gconstpointer buffer;         /* Only compared, never dereferenced */
+  GstClockTime ts;
+} QueueEntry;
+
+typedef struct _QueueData
+{
+  GMutex mutex;
+  GQueue entries;
+} QueueData;
+
+static GPrivate push_stack = G_PRIVATE_INIT ((GDestroyNotify) g_array_unref);
+static GType queue_type = G_TYPE_INVALID;
+
+G_DEFINE_QUARK (kms-proc-time-queue-data, queue_data);
+
+static void
+queue_data_destroy (QueueData * data)
+{
+  g_queue_foreach (&data->entries, (GFunc) g_free, NULL);
+  g_queue_clear (&data->entries);
+  g_mutex_clear (&data->mutex);
+  g_slice_free (QueueData, data);
+}
+
+static QueueData *
+get_queue_data (GstElement * queue)
+{
+  QueueData *data;
+
+  GST_OBJECT_LOCK (queue);
+
+  data = g_object_get_qdata (G_OBJECT (queue), queue_data_quark ());
+
+  if (data == NULL) {
+    data = g_slice_new0 (QueueData);
+    g_mutex_init (&data->mutex);
+    g_queue_init (&data->entries);
+    g_object_set_qdata_full (G_OBJECT (queue), queue_data_quark (), data,
+        (GDestroyNotify) queue_data_destroy);
+  }
+
+  GST_OBJECT_UNLOCK (queue);
+
+  return data;
+}
+
+static gboolean
+is_queue (GstElement * element)
+{
+  if (G_UNLIKELY (queue_type == G_TYPE_INVALID)) {
+    /* Not registered until coreelements is loaded */
+    queue_type = g_type_from_name ("GstQueue");
+  }
+
+  return queue_type != G_TYPE_INVALID
+      && G_OBJECT_TYPE (element) == queue_type;
+}
+
+static GstElement *
+get_pad_element (GstPad * pad)
+{
+  GstObject *parent;
+
+  if (pad == NULL) {
+    return NULL;
+  }
+
+  parent = GST_OBJECT_PARENT (pad);
+
+  /* Internal pads of ghost pads belong to the ghost pad */
+  if (parent != NULL && GST_IS_PAD (parent)) {
+    parent = GST_OBJECT_PARENT (parent);
+  }
+
+  if (parent == NULL || !GST_IS_ELEMENT (parent)) {
+    return NULL;
+  }
+
+  return GST_ELEMENT_CAST (parent);
+}
+
+static void
+queue_enter (GstElement * queue, GstBuffer * buffer, GstClockTime ts)
+{
+  QueueData *data = get_queue_data (queue);
+  QueueEntry *entry = g_new (QueueEntry, 1);
+
+  entry->buffer = buffer;
+  entry->ts = ts;
+
+  g_mutex_lock (&data->mutex);
+
+  g_queue_push_tail (&data->entries, entry);
+
+  if (data->entries.length > MAX_QUEUE_ENTRIES) {
+    g_free (g_queue_pop_head (&data->entries));
+  }
+
+  g_mutex_unlock (&data->mutex);
+}
+
+static void
+queue_exit (GstElement * queue, GstBuffer * buffer, GstClockTime ts)
+{
+  QueueData *data = get_queue_data (queue);
+  GstClockTime residency = GST_CLOCK_TIME_NONE;
+  QueueEntry *entry;
+
+  g_mutex_lock (&data->mutex);
+
+  /* Queues are FIFO, entries before the buffer were dropped by it */
+  while ((entry = g_queue_pop_head (&data->entries)) != NULL) {
+    gboolean found = entry->buffer == buffer;
+
+    if (found) {
+      residency = ts - entry->ts;
+    }
+
+    g_free (entry);
+
+    if (found) {
+      break;
+    }
+  }
+
+  g_mutex_unlock (&data->mutex);
+
+  if (GST_CLOCK_TIME_IS_VALID (residency)) {
+    kms_proc_time_add_queue (queue, residency);
+  }
+}
+
+static GArray *
+get_push_stack (void)
+{
+  GArray *stack = g_private_get (&push_stack);
+
+  if (stack == NULL) {
+    stack = g_array_new (FALSE, FALSE, sizeof (PushFrame));
+    g_private_set (&push_stack, stack);
+  }
+
+  return stack;
+}
+
+static void
+push_pre (GstPad * pad, GstBuffer * buffer, GstClockTime ts)
+{
+  GArray *stack = get_push_stack ();
+  PushFrame frame;
+
+  frame.pad = pad;
+  frame.element = get_pad_element (GST_PAD_PEER (pad));
+  frame.start = ts;
+  frame.children = 0;
+
+  if (buffer != NULL) {
+    GstElement *src = get_pad_element (pad);
+
+    if (src != NULL && is_queue (src)) {
+      queue_exit (src, buffer, ts);
+    }
+
+    if (frame.element != NULL && is_queue (frame.element)) {
+      queue_enter (frame.element, buffer, ts);
+    }
+  }
+
+  g_array_append_val (stack, frame);
+}
+
+static void
+push_post (GstPad * pad, GstClockTime ts)
+{
+  GArray *stack = get_push_stack ();
+  GstClockTime elapsed;
+  PushFrame *frame = NULL;
+
+  /* Pushes are nested, so the frame of this pad is the last one */
+  while (stack->len > 0) {
+    frame = &g_array_index (stack, PushFrame, stack->len - 1);
+
+    if (frame->pad == pad) {
+      break;
+    }
+
+    GST_WARNING ("Unmatched push on %" GST_PTR_FORMAT, frame->pad);
+    g_array_set_size (stack, stack->len - 1);
+  }
+
+  if (stack->len == 0) {
+    return;
+  }
+
+  elapsed = ts - frame->start;
+
+  if (frame->element != NULL && elapsed > frame->children) {
+    kms_proc_time_add_processing (frame->element, elapsed - frame->children);
+  }
+
+  g_array_set_size (stack, stack->len - 1);
+
+  if (stack->len > 0) {
+    g_array_index (stack, PushFrame, stack->len - 1).children += elapsed;
+  }
+}
+
+static void
+do_push_buffer_pre (GstTracer * self, GstClockTime ts, GstPad * pad,
+    GstBuffer * buffer)
+{
+  push_pre (pad, buffer, ts);
+}
+
+static void
+do_push_buffer_list_pre (GstTracer * self, GstClockTime ts, GstPad * pad,
+    GstBufferList * list)
+{
+  push_pre (pad, NULL, ts);
+}
+
+static void
+do_push_buffer_post (GstTracer * self, GstClockTime ts, GstPad * pad,
+    GstFlowReturn res)
+{
+  push_post (pad, ts);
+}
+
+static void
+kms_proc_time_tracer_class_init (KmsProcTimeTracerClass * klass)
+{
+}
+
+static void
+kms_proc_time_tracer_init (KmsProcTimeTracer * self)
+{
+  GstTracer *tracer = GST_TRACER (self);
+
+  kms_proc_time_enable ();
+  gst_tracing_register_hook (tracer, "pad-push-pre",
+      G_CALLBACK (do_push_buffer_pre));
+  gst_tracing_register_hook (tracer, "pad-push-post",
+      G_CALLBACK (do_push_buffer_post));
+  gst_tracing_register_hook (tracer, "pad-push-list-pre",
+      G_CALLBACK (do_push_buffer_list_pre));
+  gst_tracing_register_hook (tracer, "pad-push-list-post",
+      G_CALLBACK (do_push_buffer_post));
+}
+
+gboolean
+kms_proc_time_tracer_plugin_init (GstPlugin * plugin)
+{
+  return gst_tracer_register (plugin, PLUGIN_NAME, KMS_TYPE_PROC_TIME_TRACER);
+}
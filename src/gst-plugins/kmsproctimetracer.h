@@ -0,0 +1,59 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#ifndef _KMS_PROC_TIME_TRACER_H_
+#define _KMS_PROC_TIME_TRACER_H_
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+#define KMS_TYPE_PROC_TIME_TRACER (kms_proc_time_tracer_get_type())
+#define KMS_PROC_TIME_TRACER(obj) (             \
+  G_TYPE_CHECK_INSTANCE_CAST (                  \
+    (obj),                                      \
+    KMS_TYPE_PROC_TIME_TRACER,                  \
+    KmsProcTimeTracer                           \
+  )                                             \
+)
+#define KMS_PROC_TIME_TRACER_CLASS(klass) (     \
+  G_TYPE_CHECK_CLASS_CAST (                     \
+    (klass),                                    \
+    KMS_TYPE_PROC_TIME_TRACER,                  \
+    KmsProcTimeTracerClass                      \
+  )                                             \
+)
+#define KMS_IS_PROC_TIME_TRACER(obj) (          \
+  G_TYPE_CHECK_INSTANCE_TYPE (                  \
+    (obj),                                      \
+    KMS_TYPE_PROC_TIME_TRACER                   \
+    )                                           \
+)
+typedef struct _KmsProcTimeTracer KmsProcTimeTracer;
+typedef struct _KmsProcTimeTracerClass KmsProcTimeTracerClass;
+
+/*
+ * Measures the time each element spends processing buffers, excluding
+ * the time spent downstream of it, and the time buffers wait in queues.
+ * It is enabled with GST_TRACERS=kmsproctime and the results are added
+ * to the stats of every KmsElement. Structures are private because the
+ * tracer API is still unstable.
+ */
+GType kms_proc_time_tracer_get_type (void);
+
+gboolean kms_proc_time_tracer_plugin_init (GstPlugin * plugin);
+
+G_END_DECLS
+#endif
@@ -0,0 +1,1148 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include <config.h>
+#endif
+
+#include "kmsrtploadgen.h"
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+#include <commons/kmsrtcp.h>
+#include <string.h>
+
+#define PLUGIN_NAME "rtploadgen"
+
+GST_DEBUG_CATEGORY_STATIC (kms_rtp_load_gen_debug);
+#define GST_CAT_DEFAULT kms_rtp_load_gen_debug
+#define kms_rtp_load_gen_parent_class parent_class
+
+G_DEFINE_TYPE_WITH_CODE (KmsRtpLoadGen, kms_rtp_load_gen,
+    GST_TYPE_ELEMENT,
+    GST_DEBUG_CATEGORY_INIT (kms_rtp_load_gen_debug,
+        PLUGIN_NAME, 0, "debug category for " PLUGIN_NAME " element"));
+
+#define KMS_RTP_LOAD_GEN_GET_PRIVATE(obj) ( \
+  G_TYPE_INSTANCE_GET_PRIVATE (             \
+    (obj),                                  \
+    KMS_TYPE_RTP_LOAD_GEN,                  \
+    KmsRtpLoadGenPrivate                    \
+  )                                         \
+)
+
+#define KMS_RTP_LOAD_GEN_LOCK(obj) (                        \
+  g_mutex_lock (&KMS_RTP_LOAD_GEN (obj)->priv->mutex)       \
+)
+
+#define KMS_RTP_LOAD_GEN_UNLOCK(obj) (                      \
+  g_mutex_unlock (&KMS_RTP_LOAD_GEN (obj)->priv->mutex)     \
+)
+
+#define DEFAULT_N_STREAMS 1
+#define DEFAULT_CODEC KMS_RTP_LOAD_GEN_CODEC_VP8
+#define DEFAULT_PAYLOAD 96
+#define DEFAULT_SSRC 0
+#define DEFAULT_BITRATE 500000
+#define DEFAULT_FRAMERATE 30
+#define DEFAULT_KEYFRAME_INTERVAL 2000
+#define DEFAULT_MTU 1200
+#define DEFAULT_RTCP_INTERVAL 1000
+#define DEFAULT_REMB_BITRATE 0
+#define DEFAULT_ADAPT_TO_REMB FALSE
+
+#define MAX_STREAMS 256
+#define AUDIO_FRAME_DURATION (20 * G_TIME_SPAN_MILLISECOND)
+#define KEYFRAME_SIZE_FACTOR 4
+#define MIN_FRAME_SIZE 16
+
+/* Packets kept to answer NACKs, power of two */
+#define HISTORY_SIZE 1024
+
+/* Seconds between 1900 (NTP) and 1970 (Unix) */
+#define NTP_UNIX_OFFSET G_GUINT64_CONSTANT (2208988800)
+
+typedef enum
+{
+  KMS_RTP_LOAD_GEN_CODEC_VP8,
+  KMS_RTP_LOAD_GEN_CODEC_H264,
+  KMS_RTP_LOAD_GEN_CODEC_OPUS
+} KmsRtpLoadGenCodec;
+
+typedef struct _KmsRtpLoadGenCodecInfo
+{
+  const gchar *encoding_name;
+  const gchar *media;
+  gint clock_rate;
+  gboolean video;
+} KmsRtpLoadGenCodecInfo;
+
+static const KmsRtpLoadGenCodecInfo codecs[] = {
+  {"VP8", "video", 90000, TRUE},
+  {"H264", "video", 90000, TRUE},
+  {"OPUS", "audio", 48000, FALSE},
+};
+
+#define KMS_TYPE_RTP_LOAD_GEN_CODEC (kms_rtp_load_gen_codec_get_type ())
+
+static GType
+kms_rtp_load_gen_codec_get_type (void)
+{
+  static gsize type = 0;
+  static const GEnumValue values[] = {
+    {KMS_RTP_LOAD_GEN_CODEC_VP8, "VP8", "vp8"},
+    {KMS_RTP_LOAD_GEN_CODEC_H264, "H.264", "h264"},
+    {KMS_RTP_LOAD_GEN_CODEC_OPUS, "Opus", "opus"},
+    {0, NULL, NULL}
+  };
+
+  if (g_once_init_enter (&type)) {
+    g_once_init_leave (&type,
+        g_enum_register_static ("KmsRtpLoadGenCodec", values));
+  }
+
+  return type;
+}
+
+static GstStaticPadTemplate rtp_src_template =
+GST_STATIC_PAD_TEMPLATE ("rtp_src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtp"));
+
+static GstStaticPadTemplate rtcp_src_template =
+GST_STATIC_PAD_TEMPLATE ("rtcp_src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtcp"));
+
+static GstStaticPadTemplate rtcp_sink_template =
+GST_STATIC_PAD_TEMPLATE ("rtcp_sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS ("application/x-rtcp"));
+
+enum
+{
+  PROP_0,
+  PROP_N_STREAMS,
+  PROP_CODEC,
+  PROP_PAYLOAD,
+  PROP_SSRC,
+  PROP_BITRATE,
+  PROP_FRAMERATE,
+  PROP_KEYFRAME_INTERVAL,
+  PROP_MTU,
+  PROP_RTCP_INTERVAL,
+  PROP_REMB_BITRATE,
+  PROP_ADAPT_TO_REMB,
+  PROP_STATS,
+  N_PROPERTIES
+};
+
+typedef struct _KmsRtpLoadGenStream
+{
+  guint32 ssrc;
+  guint16 seq;
+  guint32 ts;
+  guint64 frames;
+  gint64 last_keyframe;
+  gboolean force_keyframe;
+  guint packets;
+  guint octets;
+
+  GstBuffer *history[HISTORY_SIZE];
+  GArray *nacks;                /* guint16 */
+} KmsRtpLoadGenStream;
+
+struct _KmsRtpLoadGenPrivate
+{
+  GstPad *rtp_srcpad;
+  GstPad *rtcp_srcpad;
+  GstPad *rtcp_sinkpad;
+
+  GMutex mutex;
+  GCond cond;
+  gboolean flushing;
+
+  /* Only used from the streaming thread */
+  gboolean rtp_events_sent;
+  gboolean rtcp_events_sent;
+
+  KmsRtpLoadGenStream *streams;
+  guint pending_nacks;
+  gint64 start_time;
+  gint64 next_frame;
+  gint64 next_rtcp;
+  gint64 frame_duration;        /* us */
+
+  /* Media SSRCs of the peer, reported in our REMB */
+  guint32 remote_ssrcs[KMS_RTCP_PSFB_AFB_REMB_MAX_SSRCS_COUNT];
+  guint n_remote_ssrcs;
+  guint remb_received;
+
+  /* Properties */
+  guint n_streams;
+  KmsRtpLoadGenCodec codec;
+  guint payload;
+  guint ssrc;
+  guint bitrate;
+  guint framerate;
+  guint keyframe_interval;
+  guint mtu;
+  guint rtcp_interval;
+  guint remb_bitrate;
+  gboolean adapt_to_remb;
+
+  /* Stats */
+  guint64 packets;
+  guint64 bytes;
+  guint64 frames;
+  guint64 keyframes;
+  guint64 nacks;
+  guint64 retransmissions;
+  guint64 keyframe_requests;
+  guint64 rembs_received;
+  guint64 rembs_sent;
+};
+
+static void
+kms_rtp_load_gen_free_streams (KmsRtpLoadGen * self)
+{
+  guint i, j;
+
+  if (self->priv->streams == NULL) {
+    return;
+  }
+
+  for (i = 0; i < self->priv->n_streams; i++) {
+    KmsRtpLoadGenStream *stream = &self->priv->streams[i];
+
+    for (j = 0; j < HISTORY_SIZE; j++) {
+      gst_buffer_replace (&stream->history[j], NULL);
+    }
+    g_array_free (stream->nacks, TRUE);
+  }
+
+  g_free (self->priv->streams);
+  self->priv->streams = NULL;
+  self->priv->pending_nacks = 0;
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_load_gen_create_streams (KmsRtpLoadGen * self)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+  guint32 ssrc = priv->ssrc != 0 ? priv->ssrc : g_random_int ();
+  guint i;
+
+  kms_rtp_load_gen_free_streams (self);
+
+  priv->streams = g_new0 (KmsRtpLoadGenStream, priv->n_streams);
+
+  for (i = 0; i < priv->n_streams; i++) {
+    KmsRtpLoadGenStream *stream = &priv->streams[i];
+
+    stream->ssrc = ssrc + i;
+    stream->seq = g_random_int ();
+    stream->ts = g_random_int ();
+    stream->nacks = g_array_new (FALSE, FALSE, sizeof (guint16));
+  }
+
+  if (codecs[priv->codec].video) {
+    priv->frame_duration = G_USEC_PER_SEC / priv->framerate;
+  } else {
+    priv->frame_duration = AUDIO_FRAME_DURATION;
+  }
+
+  priv->start_time = g_get_monotonic_time ();
+  priv->next_frame = priv->start_time;
+  priv->next_rtcp = priv->start_time + priv->rtcp_interval *
+      G_TIME_SPAN_MILLISECOND;
+  priv->n_remote_ssrcs = 0;
+  priv->remb_received = 0;
+}
+
+static KmsRtpLoadGenStream *
+kms_rtp_load_gen_get_stream (KmsRtpLoadGen * self, guint32 ssrc)
+{
+  guint i;
+
+  if (self->priv->streams == NULL) {
+    return NULL;
+  }
+
+  for (i = 0; i < self->priv->n_streams; i++) {
+    if (self->priv->streams[i].ssrc == ssrc) {
+      return &self->priv->streams[i];
+    }
+  }
+
+  return NULL;
+}
+
+/* Writes the codec header of a packet, returns its size */
+static guint
+kms_rtp_load_gen_write_header (KmsRtpLoadGenCodec codec, guint8 * data,
+    gboolean first, gboolean last, gboolean fragmented, gboolean keyframe)
+{
+  guint8 nal_type = keyframe ? 5 : 1;
+
+  switch (codec) {
+    case KMS_RTP_LOAD_GEN_CODEC_VP8:
+      /* Payload descriptor, S bit on the first packet of the frame */
+      data[0] = first ? 0x10 : 0x00;
+      return 1;
+    case KMS_RTP_LOAD_GEN_CODEC_H264:
+      if (!fragmented) {
+        data[0] = (3 << 5) | nal_type;
+        return 1;
+      }
+      /* FU-A */
+      data[0] = (3 << 5) | 28;
+      data[1] = (first ? 0x80 : 0) | (last ? 0x40 : 0) | nal_type;
+      return 2;
+    case KMS_RTP_LOAD_GEN_CODEC_OPUS:
+      /* TOC: 20 ms fullband hybrid frame, mono */
+      data[0] = 0x78;
+      return 1;
+  }
+
+  return 0;
+}
+
+static void
+kms_rtp_load_gen_write_vp8_frame_header (guint8 * data, gsize frame_size,
+    gboolean keyframe)
+{
+  guint32 first_part_size = MIN (frame_size / 2, 0x7ffff);
+
+  /* Frame tag: key frame bit (inverted), version 0, shown */
+  data[0] = (keyframe ? 0 : 1) | (1 << 4) | ((first_part_size & 0x7) << 5);
+  data[1] = (first_part_size >> 3) & 0xff;
+  data[2] = (first_part_size >> 11) & 0xff;
+
+  if (!keyframe) {
+    return;
+  }
+
+  /* Start code and a 320x240 size, enough for parsers to pick it up */
+  data[3] = 0x9d;
+  data[4] = 0x01;
+  data[5] = 0x2a;
+  GST_WRITE_UINT16_LE (data + 6, 320);
+  GST_WRITE_UINT16_LE (data + 8, 240);
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_load_gen_add_frame (KmsRtpLoadGen * self,
+    KmsRtpLoadGenStream * stream, GstBufferList * list, gint64 now)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+  const KmsRtpLoadGenCodecInfo *info = &codecs[priv->codec];
+  gboolean keyframe = FALSE, fragmented;
+  guint bitrate = priv->bitrate;
+  gsize frame_size, max_payload, offset = 0;
+
+  if (info->video) {
+    keyframe = stream->frames == 0 || stream->force_keyframe ||
+        (priv->keyframe_interval > 0 && now - stream->last_keyframe >=
+        priv->keyframe_interval * G_TIME_SPAN_MILLISECOND);
+  }
+
+  if (priv->adapt_to_remb && priv->remb_received > 0) {
+    bitrate = MIN (bitrate, priv->remb_received / priv->n_streams);
+  }
+
+  frame_size = (guint64) bitrate * priv->frame_duration / G_USEC_PER_SEC / 8;
+  frame_size = MAX (frame_size, MIN_FRAME_SIZE);
+  if (keyframe) {
+    frame_size *= KEYFRAME_SIZE_FACTOR;
+    stream->force_keyframe = FALSE;
+    stream->last_keyframe = now;
+    priv->keyframes++;
+  }
+
+  /* RTP fixed header plus the largest codec header */
+  max_payload = priv->mtu - 12 - 2;
+  fragmented = frame_size + 1 > max_payload;
+
+  while (offset < frame_size) {
+    GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+    gsize chunk = MIN (frame_size - offset, max_payload);
+    gboolean first = offset == 0, last = offset + chunk >= frame_size;
+    GstBuffer *buffer;
+    guint8 *data;
+    guint header;
+
+    buffer = gst_rtp_buffer_new_allocate (chunk + 2, 0, 0);
+    gst_rtp_buffer_map (buffer, GST_MAP_WRITE, &rtp);
+    data = gst_rtp_buffer_get_payload (&rtp);
+
+    header = kms_rtp_load_gen_write_header (priv->codec, data, first, last,
+        fragmented, keyframe);
+    memset (data + header, stream->seq & 0xff, chunk);
+
+    if (first && priv->codec == KMS_RTP_LOAD_GEN_CODEC_VP8) {
+      kms_rtp_load_gen_write_vp8_frame_header (data + header, frame_size,
+          keyframe);
+    }
+
+    gst_rtp_buffer_set_payload_type (&rtp, priv->payload);
+    gst_rtp_buffer_set_ssrc (&rtp, stream->ssrc);
+    gst_rtp_buffer_set_seq (&rtp, stream->seq);
+    gst_rtp_buffer_set_timestamp (&rtp, stream->ts);
+    gst_rtp_buffer_set_marker (&rtp, info->video && last);
+    gst_rtp_buffer_unmap (&rtp);
+
+    gst_buffer_resize (buffer, 0, 12 + header + chunk);
+    GST_BUFFER_PTS (buffer) = (now - priv->start_time) * GST_USECOND;
+
+    gst_buffer_replace (&stream->history[stream->seq & (HISTORY_SIZE - 1)],
+        buffer);
+    gst_buffer_list_add (list, buffer);
+
+    stream->seq++;
+    stream->packets++;
+    stream->octets += chunk;
+    priv->packets++;
+    priv->bytes += gst_buffer_get_size (buffer);
+
+    offset += chunk;
+  }
+
+  stream->ts += info->clock_rate / (G_USEC_PER_SEC / priv->frame_duration);
+  stream->frames++;
+  priv->frames++;
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_load_gen_add_retransmissions (KmsRtpLoadGen * self,
+    GstBufferList * list)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+  guint i, j;
+
+  if (priv->pending_nacks == 0) {
+    return;
+  }
+
+  for (i = 0; i < priv->n_streams; i++) {
+    KmsRtpLoadGenStream *stream = &priv->streams[i];
+
+    for (j = 0; j < stream->nacks->len; j++) {
+      guint16 seq = g_array_index (stream->nacks, guint16, j);
+      GstBuffer *buffer = stream->history[seq & (HISTORY_SIZE - 1)];
+      GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+      gboolean found = FALSE;
+
+      if (buffer != NULL && gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp)) {
+        found = gst_rtp_buffer_get_seq (&rtp) == seq;
+        gst_rtp_buffer_unmap (&rtp);
+      }
+
+      if (found) {
+        gst_buffer_list_add (list, gst_buffer_ref (buffer));
+        priv->retransmissions++;
+      } else {
+        GST_DEBUG_OBJECT (self, "Packet %u of %u not in history", seq,
+            stream->ssrc);
+      }
+    }
+
+    g_array_set_size (stream->nacks, 0);
+  }
+
+  priv->pending_nacks = 0;
+}
+
+/* Starts a new compound packet, the previous one is added to @list */
+static void
+kms_rtp_load_gen_next_rtcp (KmsRtpLoadGen * self, GstBufferList * list,
+    GstRTCPBuffer * rtcp)
+{
+  GstBuffer *buffer = rtcp->buffer;
+
+  if (buffer != NULL) {
+    /* Unmapping trims the buffer to the packets added */
+    gst_rtcp_buffer_unmap (rtcp);
+    gst_buffer_list_add (list, buffer);
+  }
+
+  gst_rtcp_buffer_map (gst_rtcp_buffer_new (self->priv->mtu),
+      GST_MAP_READWRITE, rtcp);
+}
+
+/* Must be called with the lock held */
+static GstBufferList *
+kms_rtp_load_gen_create_rtcp (KmsRtpLoadGen * self)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GstBufferList *list;
+  GstBuffer *buffer;
+  gint64 real_time = g_get_real_time ();
+  guint64 ntp_time;
+  guint i;
+
+  ntp_time = ((real_time / G_USEC_PER_SEC + NTP_UNIX_OFFSET) << 32) |
+      (((real_time % G_USEC_PER_SEC) << 32) / G_USEC_PER_SEC);
+
+  list = gst_buffer_list_new ();
+  kms_rtp_load_gen_next_rtcp (self, list, &rtcp);
+
+  /* SRs of all the streams may not fit in the MTU, they are split */
+  for (i = 0; i < priv->n_streams; i++) {
+    KmsRtpLoadGenStream *stream = &priv->streams[i];
+
+    if (!gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR, &packet)) {
+      kms_rtp_load_gen_next_rtcp (self, list, &rtcp);
+
+      if (!gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR, &packet)) {
+        GST_WARNING_OBJECT (self, "MTU too small for a SR");
+        break;
+      }
+    }
+
+    gst_rtcp_packet_sr_set_sender_info (&packet, stream->ssrc, ntp_time,
+        stream->ts, stream->packets, stream->octets);
+  }
+
+  if (priv->remb_bitrate > 0 && priv->n_remote_ssrcs > 0) {
+    gboolean added;
+
+    added = gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_PSFB, &packet);
+
+    if (!added) {
+      /* Compound packets start with a report, an empty RR is enough */
+      kms_rtp_load_gen_next_rtcp (self, list, &rtcp);
+
+      if (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_RR, &packet)) {
+        gst_rtcp_packet_rr_set_ssrc (&packet, priv->streams[0].ssrc);
+      }
+
+      added = gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_PSFB, &packet);
+    }
+
+    if (added) {
+      KmsRTCPPSFBAFBREMBPacket remb_packet;
+
+      remb_packet.bitrate = priv->remb_bitrate;
+      remb_packet.n_ssrcs = priv->n_remote_ssrcs;
+      memcpy (remb_packet.ssrcs, priv->remote_ssrcs,
+          priv->n_remote_ssrcs * sizeof (guint32));
+
+      if (kms_rtcp_psfb_afb_remb_marshall_packet (&packet, &remb_packet,
+              priv->streams[0].ssrc)) {
+        priv->rembs_sent++;
+      } else {
+        gst_rtcp_packet_remove (&packet);
+      }
+    }
+  }
+
+  buffer = rtcp.buffer;
+  gst_rtcp_buffer_unmap (&rtcp);
+  gst_buffer_list_add (list, buffer);
+
+  return list;
+}
+
+static void
+kms_rtp_load_gen_push_stream_events (KmsRtpLoadGen * self, GstPad * pad,
+    GstCaps * caps)
+{
+  GstSegment segment;
+  gchar *stream_id;
+
+  stream_id = gst_pad_create_stream_id (pad, GST_ELEMENT (self),
+      GST_OBJECT_NAME (pad));
+  gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+
+  gst_pad_push_event (pad, gst_event_new_caps (caps));
+  gst_caps_unref (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+}
+
+static void
+kms_rtp_load_gen_loop (KmsRtpLoadGen * self)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstBufferList *rtcp = NULL;
+  GstBufferList *list;
+  gint64 now;
+  guint i;
+
+  if (!priv->rtp_events_sent) {
+    const KmsRtpLoadGenCodecInfo *info = &codecs[priv->codec];
+
+    kms_rtp_load_gen_push_stream_events (self, priv->rtp_srcpad,
+        gst_caps_new_simple ("application/x-rtp",
+            "media", G_TYPE_STRING, info->media,
+            "clock-rate", G_TYPE_INT, info->clock_rate,
+            "encoding-name", G_TYPE_STRING, info->encoding_name,
+            "payload", G_TYPE_INT, priv->payload, NULL));
+    priv->rtp_events_sent = TRUE;
+  }
+
+  KMS_RTP_LOAD_GEN_LOCK (self);
+
+  now = g_get_monotonic_time ();
+  while (!priv->flushing && priv->pending_nacks == 0 && now < priv->next_frame) {
+    g_cond_wait_until (&priv->cond, &priv->mutex, priv->next_frame);
+    now = g_get_monotonic_time ();
+  }
+
+  if (priv->flushing) {
+    KMS_RTP_LOAD_GEN_UNLOCK (self);
+    gst_pad_pause_task (priv->rtp_srcpad);
+    return;
+  }
+
+  list = gst_buffer_list_new ();
+  kms_rtp_load_gen_add_retransmissions (self, list);
+
+  if (now >= priv->next_frame) {
+    for (i = 0; i < priv->n_streams; i++) {
+      kms_rtp_load_gen_add_frame (self, &priv->streams[i], list, now);
+    }
+
+    priv->next_frame += priv->frame_duration;
+    if (now - priv->next_frame > G_USEC_PER_SEC) {
+      GST_WARNING_OBJECT (self, "Cannot keep up, skipping frames");
+      priv->next_frame = now;
+    }
+  }
+
+  if (now >= priv->next_rtcp) {
+    rtcp = kms_rtp_load_gen_create_rtcp (self);
+    priv->next_rtcp = now + priv->rtcp_interval * G_TIME_SPAN_MILLISECOND;
+  }
+
+  KMS_RTP_LOAD_GEN_UNLOCK (self);
+
+  if (gst_buffer_list_length (list) > 0) {
+    ret = gst_pad_push_list (priv->rtp_srcpad, list);
+  } else {
+    gst_buffer_list_unref (list);
+  }
+
+  if (rtcp != NULL) {
+    if (!priv->rtcp_events_sent) {
+      kms_rtp_load_gen_push_stream_events (self, priv->rtcp_srcpad,
+          gst_caps_new_empty_simple ("application/x-rtcp"));
+      priv->rtcp_events_sent = TRUE;
+    }
+
+    gst_pad_push_list (priv->rtcp_srcpad, rtcp);
+  }
+
+  if (ret == GST_FLOW_OK || ret == GST_FLOW_NOT_LINKED) {
+    return;
+  }
+
+  GST_DEBUG_OBJECT (self, "Pausing task, reason %s", gst_flow_get_name (ret));
+  gst_pad_pause_task (priv->rtp_srcpad);
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_load_gen_add_remote_ssrc (KmsRtpLoadGen * self, guint32 ssrc)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+  guint i;
+
+  for (i = 0; i < priv->n_remote_ssrcs; i++) {
+    if (priv->remote_ssrcs[i] == ssrc) {
+      return;
+    }
+  }
+
+  if (priv->n_remote_ssrcs < KMS_RTCP_PSFB_AFB_REMB_MAX_SSRCS_COUNT) {
+    GST_DEBUG_OBJECT (self, "Remote media SSRC %u", ssrc);
+    priv->remote_ssrcs[priv->n_remote_ssrcs++] = ssrc;
+  }
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_load_gen_process_nack (KmsRtpLoadGen * self, GstRTCPPacket * packet)
+{
+  KmsRtpLoadGenStream *stream;
+  guint8 *fci;
+  guint i, len;
+
+  stream = kms_rtp_load_gen_get_stream (self,
+      gst_rtcp_packet_fb_get_media_ssrc (packet));
+  if (stream == NULL) {
+    return;
+  }
+
+  fci = gst_rtcp_packet_fb_get_fci (packet);
+  len = gst_rtcp_packet_fb_get_fci_length (packet);
+
+  /* Each FCI word is a lost packet id and a bitmask of the next 16 */
+  for (i = 0; i < len; i++, fci += 4) {
+    guint16 pid = GST_READ_UINT16_BE (fci);
+    guint16 blp = GST_READ_UINT16_BE (fci + 2);
+    guint bit;
+
+    g_array_append_val (stream->nacks, pid);
+    for (bit = 0; bit < 16; bit++) {
+      if (blp & (1 << bit)) {
+        guint16 seq = pid + bit + 1;
+
+        g_array_append_val (stream->nacks, seq);
+      }
+    }
+  }
+
+  self->priv->nacks++;
+  self->priv->pending_nacks++;
+  g_cond_signal (&self->priv->cond);
+}
+
+/* Must be called with the lock held */
+static void
+kms_rtp_load_gen_process_remb (KmsRtpLoadGen * self, GstRTCPPacket * packet)
+{
+  guint8 *fci = gst_rtcp_packet_fb_get_fci (packet);
+  guint len = gst_rtcp_packet_fb_get_fci_length (packet);
+  guint64 bitrate;
+  guint8 exp;
+
+  if (len < 2 || memcmp (fci, "REMB", 4) != 0) {
+    return;
+  }
+
+  /* The exponent has 6 bits, the result may not fit in 32 */
+  exp = fci[5] >> 2;
+  bitrate = ((fci[5] & 0x3) << 16) | (fci[6] << 8) | fci[7];
+  bitrate = exp < 32 ? bitrate << exp : G_MAXUINT64;
+
+  self->priv->remb_received = MIN (bitrate, G_MAXUINT32);
+  self->priv->rembs_received++;
+
+  GST_TRACE_OBJECT (self, "REMB received: %u bps", self->priv->remb_received);
+}
+
+static GstFlowReturn
+kms_rtp_load_gen_rtcp_chain (GstPad * pad, GstObject * parent,
+    GstBuffer * buffer)
+{
+  KmsRtpLoadGen *self = KMS_RTP_LOAD_GEN (parent);
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  KmsRtpLoadGenStream *stream;
+  GstRTCPPacket packet;
+  guint32 ssrc;
+  gboolean more;
+
+  if (!gst_rtcp_buffer_map (buffer, GST_MAP_READ, &rtcp)) {
+    GST_DEBUG_OBJECT (self, "Not an RTCP buffer");
+    gst_buffer_unref (buffer);
+    return GST_FLOW_OK;
+  }
+
+  KMS_RTP_LOAD_GEN_LOCK (self);
+
+  for (more = gst_rtcp_buffer_get_first_packet (&rtcp, &packet); more;
+      more = gst_rtcp_packet_move_to_next (&packet)) {
+    switch (gst_rtcp_packet_get_type (&packet)) {
+      case GST_RTCP_TYPE_SR:
+        gst_rtcp_packet_sr_get_sender_info (&packet, &ssrc, NULL, NULL, NULL,
+            NULL);
+        kms_rtp_load_gen_add_remote_ssrc (self, ssrc);
+        break;
+      case GST_RTCP_TYPE_RTPFB:
+        if (gst_rtcp_packet_fb_get_type (&packet) == GST_RTCP_RTPFB_TYPE_NACK) {
+          kms_rtp_load_gen_process_nack (self, &packet);
+        }
+        break;
+      case GST_RTCP_TYPE_PSFB:
+        switch (gst_rtcp_packet_fb_get_type (&packet)) {
+          case GST_RTCP_PSFB_TYPE_PLI:
+          case GST_RTCP_PSFB_TYPE_FIR:
+            /* FIR carries the SSRC in the FCI, but there is one per packet */
+            stream = kms_rtp_load_gen_get_stream (self,
+                gst_rtcp_packet_fb_get_media_ssrc (&packet));
+            if (stream == NULL
+                && gst_rtcp_packet_fb_get_fci_length (&packet) >= 2) {
+              stream = kms_rtp_load_gen_get_stream (self,
+                  GST_READ_UINT32_BE (gst_rtcp_packet_fb_get_fci (&packet)));
+            }
+            if (stream != NULL) {
+              stream->force_keyframe = TRUE;
+              self->priv->keyframe_requests++;
+            }
+            break;
+          case GST_RTCP_PSFB_TYPE_AFB:
+            kms_rtp_load_gen_process_remb (self, &packet);
+            break;
+          default:
+            break;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  KMS_RTP_LOAD_GEN_UNLOCK (self);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+static gboolean
+kms_rtp_load_gen_rtcp_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  /* Nothing to forward them to */
+  gst_event_unref (event);
+
+  return TRUE;
+}
+
+static gboolean
+kms_rtp_load_gen_activate_mode (GstPad * pad, GstObject * parent,
+    GstPadMode mode, gboolean active)
+{
+  KmsRtpLoadGen *self = KMS_RTP_LOAD_GEN (parent);
+  gboolean res;
+
+  switch (mode) {
+    case GST_PAD_MODE_PUSH:
+      if (active) {
+        KMS_RTP_LOAD_GEN_LOCK (self);
+        kms_rtp_load_gen_create_streams (self);
+        self->priv->flushing = FALSE;
+        self->priv->rtp_events_sent = FALSE;
+        self->priv->rtcp_events_sent = FALSE;
+        KMS_RTP_LOAD_GEN_UNLOCK (self);
+
+        res = gst_pad_start_task (pad,
+            (GstTaskFunction) kms_rtp_load_gen_loop, self, NULL);
+      } else {
+        KMS_RTP_LOAD_GEN_LOCK (self);
+        self->priv->flushing = TRUE;
+        g_cond_signal (&self->priv->cond);
+        KMS_RTP_LOAD_GEN_UNLOCK (self);
+
+        res = gst_pad_stop_task (pad);
+
+        KMS_RTP_LOAD_GEN_LOCK (self);
+        kms_rtp_load_gen_free_streams (self);
+        KMS_RTP_LOAD_GEN_UNLOCK (self);
+      }
+      break;
+    default:
+      res = FALSE;
+      break;
+  }
+
+  return res;
+}
+
+static GstStructure *
+kms_rtp_load_gen_get_stats (KmsRtpLoadGen * self)
+{
+  KmsRtpLoadGenPrivate *priv = self->priv;
+
+  return gst_structure_new ("stats",
+      "packets", G_TYPE_UINT64, priv->packets,
+      "bytes", G_TYPE_UINT64, priv->bytes,
+      "frames", G_TYPE_UINT64, priv->frames,
+      "keyframes", G_TYPE_UINT64, priv->keyframes,
+      "nacks-received", G_TYPE_UINT64, priv->nacks,
+      "retransmissions", G_TYPE_UINT64, priv->retransmissions,
+      "keyframe-requests", G_TYPE_UINT64, priv->keyframe_requests,
+      "rembs-received", G_TYPE_UINT64, priv->rembs_received,
+      "remb-received", G_TYPE_UINT, priv->remb_received,
+      "rembs-sent", G_TYPE_UINT64, priv->rembs_sent, NULL);
+}
+
+static void
+kms_rtp_load_gen_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  KmsRtpLoadGen *self = KMS_RTP_LOAD_GEN (object);
+
+  KMS_RTP_LOAD_GEN_LOCK (self);
+
+  switch (property_id) {
+    case PROP_N_STREAMS:
+      if (self->priv->streams != NULL) {
+        GST_WARNING_OBJECT (self, "Streams cannot change while running");
+      } else {
+        self->priv->n_streams = g_value_get_uint (value);
+      }
+      break;
+    case PROP_CODEC:
+      self->priv->codec = g_value_get_enum (value);
+      break;
+    case PROP_PAYLOAD:
+      self->priv->payload = g_value_get_uint (value);
+      break;
+    case PROP_SSRC:
+      self->priv->ssrc = g_value_get_uint (value);
+      break;
+    case PROP_BITRATE:
+      self->priv->bitrate = g_value_get_uint (value);
+      break;
+    case PROP_FRAMERATE:
+      self->priv->framerate = g_value_get_uint (value);
+      break;
+    case PROP_KEYFRAME_INTERVAL:
+      self->priv->keyframe_interval = g_value_get_uint (value);
+      break;
+    case PROP_MTU:
+      self->priv->mtu = g_value_get_uint (value);
+      break;
+    case PROP_RTCP_INTERVAL:
+      self->priv->rtcp_interval = g_value_get_uint (value);
+      break;
+    case PROP_REMB_BITRATE:
+      self->priv->remb_bitrate = g_value_get_uint (value);
+      break;
+    case PROP_ADAPT_TO_REMB:
+      self->priv->adapt_to_remb = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  KMS_RTP_LOAD_GEN_UNLOCK (self);
+}
+
+static void
+kms_rtp_load_gen_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  KmsRtpLoadGen *self = KMS_RTP_LOAD_GEN (object);
+
+  KMS_RTP_LOAD_GEN_LOCK (self);
+
+  switch (property_id) {
+    case PROP_N_STREAMS:
+      g_value_set_uint (value, self->priv->n_streams);
+      break;
+    case PROP_CODEC:
+      g_value_set_enum (value, self->priv->codec);
+      break;
+    case PROP_PAYLOAD:
+      g_value_set_uint (value, self->priv->payload);
+      break;
+    case PROP_SSRC:
+      g_value_set_uint (value, self->priv->ssrc);
+      break;
+    case PROP_BITRATE:
+      g_value_set_uint (value, self->priv->bitrate);
+      break;
+    case PROP_FRAMERATE:
+      g_value_set_uint (value, self->priv->framerate);
+      break;
+    case PROP_KEYFRAME_INTERVAL:
+      g_value_set_uint (value, self->priv->keyframe_interval);
+      break;
+    case PROP_MTU:
+      g_value_set_uint (value, self->priv->mtu);
+      break;
+    case PROP_RTCP_INTERVAL:
+      g_value_set_uint (value, self->priv->rtcp_interval);
+      break;
+    case PROP_REMB_BITRATE:
+      g_value_set_uint (value, self->priv->remb_bitrate);
+      break;
+    case PROP_ADAPT_TO_REMB:
+      g_value_set_boolean (value, self->priv->adapt_to_remb);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, kms_rtp_load_gen_get_stats (self));
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+
+  KMS_RTP_LOAD_GEN_UNLOCK (self);
+}
+
+static void
+kms_rtp_load_gen_finalize (GObject * object)
+{
+  KmsRtpLoadGen *self = KMS_RTP_LOAD_GEN (object);
+
+  kms_rtp_load_gen_free_streams (self);
+  g_mutex_clear (&self->priv->mutex);
+  g_cond_clear (&self->priv->cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+kms_rtp_load_gen_init (KmsRtpLoadGen * self)
+{
+  self->priv = KMS_RTP_LOAD_GEN_GET_PRIVATE (self);
+
+  self->priv->rtp_srcpad =
+      gst_pad_new_from_static_template (&rtp_src_template, "rtp_src");
+  gst_pad_set_activatemode_function (self->priv->rtp_srcpad,
+      kms_rtp_load_gen_activate_mode);
+  gst_pad_use_fixed_caps (self->priv->rtp_srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->rtp_srcpad);
+
+  self->priv->rtcp_srcpad =
+      gst_pad_new_from_static_template (&rtcp_src_template, "rtcp_src");
+  gst_pad_use_fixed_caps (self->priv->rtcp_srcpad);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->rtcp_srcpad);
+
+  self->priv->rtcp_sinkpad =
+      gst_pad_new_from_static_template (&rtcp_sink_template, "rtcp_sink");
+  gst_pad_set_chain_function (self->priv->rtcp_sinkpad,
+      kms_rtp_load_gen_rtcp_chain);
+  gst_pad_set_event_function (self->priv->rtcp_sinkpad,
+      kms_rtp_load_gen_rtcp_sink_event);
+  gst_element_add_pad (GST_ELEMENT (self), self->priv->rtcp_sinkpad);
+
+  g_mutex_init (&self->priv->mutex);
+  g_cond_init (&self->priv->cond);
+  self->priv->flushing = TRUE;
+
+  self->priv->n_streams = DEFAULT_N_STREAMS;
+  self->priv->codec = DEFAULT_CODEC;
+  self->priv->payload = DEFAULT_PAYLOAD;
+  self->priv->ssrc = DEFAULT_SSRC;
+  self->priv->bitrate = DEFAULT_BITRATE;
+  self->priv->framerate = DEFAULT_FRAMERATE;
+  self->priv->keyframe_interval = DEFAULT_KEYFRAME_INTERVAL;
+  self->priv->mtu = DEFAULT_MTU;
+  self->priv->rtcp_interval = DEFAULT_RTCP_INTERVAL;
+  self->priv->remb_bitrate = DEFAULT_REMB_BITRATE;
+  self->priv->adapt_to_remb = DEFAULT_ADAPT_TO_REMB;
+}
+
+static void
+kms_rtp_load_gen_class_init (KmsRtpLoadGenClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+
+  gobject_class->finalize = kms_rtp_load_gen_finalize;
+  gobject_class->set_property = kms_rtp_load_gen_set_property;
+  gobject_class->get_property = kms_rtp_load_gen_get_property;
+
+  gst_element_class_set_details_simple (gstelement_class,
+      "RTP load generator",
+      "Source/Network",
+      "Sends synthetic RTP streams like a remote peer would, answering "
+      "NACK, PLI and FIR and sending REMB. Meant for testing",
+      "Kurento <kurento@googlegroups.com>");
+
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtp_src_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtcp_src_template));
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_static_pad_template_get (&rtcp_sink_template));
+
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_load_gen_rtcp_chain);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_load_gen_rtcp_sink_event);
+  GST_DEBUG_REGISTER_FUNCPTR (kms_rtp_load_gen_activate_mode);
+
+  g_object_class_install_property (gobject_class, PROP_N_STREAMS,
+      g_param_spec_uint ("n-streams", "Number of streams",
+          "Streams sent, each one with its own SSRC", 1, MAX_STREAMS,
+          DEFAULT_N_STREAMS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_CODEC,
+      g_param_spec_enum ("codec", "Codec",
+          "Codec announced in the caps and used to packetize. Frame "
+          "contents are not decodable", KMS_TYPE_RTP_LOAD_GEN_CODEC,
+          DEFAULT_CODEC, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_PAYLOAD,
+      g_param_spec_uint ("payload", "Payload type", "RTP payload type", 0,
+          127, DEFAULT_PAYLOAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_SSRC,
+      g_param_spec_uint ("ssrc", "SSRC",
+          "SSRC of the first stream, the rest follow it (0 = random)", 0,
+          G_MAXUINT32, DEFAULT_SSRC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_BITRATE,
+      g_param_spec_uint ("bitrate", "Bitrate",
+          "Target bitrate of each stream (bps)", 0, G_MAXUINT,
+          DEFAULT_BITRATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_FRAMERATE,
+      g_param_spec_uint ("framerate", "Framerate",
+          "Video frames per second, audio always uses 20 ms frames", 1, 240,
+          DEFAULT_FRAMERATE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_KEYFRAME_INTERVAL,
+      g_param_spec_uint ("keyframe-interval", "Keyframe interval",
+          "Time between keyframes (ms, 0 = only when requested)", 0,
+          G_MAXUINT / 1000, DEFAULT_KEYFRAME_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_MTU,
+      g_param_spec_uint ("mtu", "MTU", "Maximum RTP and RTCP packet size",
+          64, 65536, DEFAULT_MTU, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_RTCP_INTERVAL,
+      g_param_spec_uint ("rtcp-interval", "RTCP interval",
+          "Time between sender reports (ms)", 1, G_MAXUINT / 1000,
+          DEFAULT_RTCP_INTERVAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_REMB_BITRATE,
+      g_param_spec_uint ("remb-bitrate", "REMB bitrate",
+          "Bitrate reported in REMB for the media received (bps, "
+          "0 = no REMB)", 0, G_MAXUINT, DEFAULT_REMB_BITRATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_ADAPT_TO_REMB,
+      g_param_spec_boolean ("adapt-to-remb", "Adapt to REMB",
+          "Split the REMB received among the streams when lower than "
+          "the bitrate", DEFAULT_ADAPT_TO_REMB,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Stats",
+          "Counters of the packets sent and the feedback received",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_type_class_add_private (klass, sizeof (KmsRtpLoadGenPrivate));
+}
+
+gboolean
+kms_rtp_load_gen_plugin_init (GstPlugin * plugin)
+{
+  return gst_element_register (plugin, PLUGIN_NAME, GST_RANK_NONE,
+      KMS_TYPE_RTP_LOAD_GEN);
+}
@@ -0,0 +1,70 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __KMS_RTP_LOAD_GEN_H__
+#define __KMS_RTP_LOAD_GEN_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+/*
+ * Test element that acts as the remote peer of an RtpEndpoint. It sends
+ * n-streams synthetic RTP streams (valid payload headers, meaningless
+ * frame contents) with sender reports on rtcp_src, and reads the RTCP
+ * received on rtcp_sink: NACKs are answered from a history of the last
+ * packets, PLI and FIR force a keyframe and, with adapt-to-remb, REMB caps
+ * the bitrate. A REMB of remb-bitrate is sent for the SSRCs seen in the
+ * peer's sender reports.
+ *
+ *   rtploadgen name=peer n-streams=10 peer.rtp_src ! udpsink port=5004
+ *   peer.rtcp_src ! udpsink port=5005
+ *   udpsrc port=6005 ! peer.rtcp_sink
+ */
+#define KMS_TYPE_RTP_LOAD_GEN \
+  (kms_rtp_load_gen_get_type())
+#define KMS_RTP_LOAD_GEN(obj) \
+  (G_TYPE_CHECK_INSTANCE_CAST((obj),KMS_TYPE_RTP_LOAD_GEN,KmsRtpLoadGen))
+#define KMS_RTP_LOAD_GEN_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_CAST((klass),KMS_TYPE_RTP_LOAD_GEN,KmsRtpLoadGenClass))
+#define KMS_IS_RTP_LOAD_GEN(obj) \
+  (G_TYPE_CHECK_INSTANCE_TYPE((obj),KMS_TYPE_RTP_LOAD_GEN))
+#define KMS_IS_RTP_LOAD_GEN_CLASS(klass) \
+  (G_TYPE_CHECK_CLASS_TYPE((klass),KMS_TYPE_RTP_LOAD_GEN))
+#define KMS_RTP_LOAD_GEN_CAST(obj) ((KmsRtpLoadGen*)(obj))
+
+typedef struct _KmsRtpLoadGen KmsRtpLoadGen;
+typedef struct _KmsRtpLoadGenClass KmsRtpLoadGenClass;
+typedef struct _KmsRtpLoadGenPrivate KmsRtpLoadGenPrivate;
+
+struct _KmsRtpLoadGen
+{
+  GstElement element;
+
+  KmsRtpLoadGenPrivate *priv;
+};
+
+struct _KmsRtpLoadGenClass
+{
+  GstElementClass parent_class;
+};
+
+GType kms_rtp_load_gen_get_type (void);
+
+gboolean kms_rtp_load_gen_plugin_init (GstPlugin * plugin);
+
+G_END_DECLS
+#endif /* __KMS_RTP_LOAD_GEN_H__ */
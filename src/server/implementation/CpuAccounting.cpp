@@ -0,0 +1,338 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/gst.h>
+
+#include "CpuAccounting.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define GST_CAT_DEFAULT kurento_cpu_accounting
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoCpuAccounting"
+
+/* Minimum time between two samples used to compute the usage */
+const int CPU_ACCOUNTING_SAMPLE_PERIOD = 1000; /* milliseconds */
+
+/* Fields of /proc/<pid>/stat, see proc(5) */
+#define STAT_FIELD_UTIME 14
+#define STAT_FIELD_STIME 15
+#define STAT_FIELD_NUM_THREADS 20
+
+namespace kurento
+{
+
+static bool
+readStat (const std::string &path, std::vector<std::string> &fields)
+{
+  std::string stat, field;
+  std::ifstream stat_file (path);
+  size_t pos;
+
+  if (!std::getline (stat_file, stat) ) {
+    return false;
+  }
+
+  /* The command name may contain spaces, fields are counted after it */
+  pos = stat.rfind (')');
+
+  if (pos == std::string::npos) {
+    return false;
+  }
+
+  /* pid and comm are fields 1 and 2 */
+  fields.assign (2, "");
+  std::istringstream tokens (stat.substr (pos + 1) );
+
+  while (tokens >> field) {
+    fields.push_back (field);
+  }
+
+  return fields.size() > STAT_FIELD_NUM_THREADS;
+}
+
+static int64_t
+getCpuTime (const std::vector<std::string> &fields)
+{
+  static const long ticks = sysconf (_SC_CLK_TCK);
+  int64_t cpuTime;
+
+  cpuTime = atoll (fields[STAT_FIELD_UTIME - 1].c_str() ) +
+            atoll (fields[STAT_FIELD_STIME - 1].c_str() );
+
+  return cpuTime * 1000 / ticks;
+}
+
+static bool
+readThreadCpuTime (pid_t tid, int64_t &cpuTime)
+{
+  std::vector<std::string> fields;
+
+  if (!readStat ("/proc/self/task/" + std::to_string (tid) + "/stat",
+                 fields) ) {
+    return false;
+  }
+
+  cpuTime = getCpuTime (fields);
+
+  return true;
+}
+
+CpuAccounting::CpuAccounting ()
+{
+  std::vector<std::string> fields;
+
+  processSample.time = std::chrono::steady_clock::now ();
+
+  if (readStat ("/proc/self/stat", fields) ) {
+    processSample.cpuTime = getCpuTime (fields);
+  }
+}
+
+std::shared_ptr<CpuAccounting>
+CpuAccounting::getCpuAccounting ()
+{
+  static std::shared_ptr<CpuAccounting> accounting (new CpuAccounting () );
+
+  return accounting;
+}
+
+void
+CpuAccounting::addOwner (const void *owner)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  accounts[owner].sample.time = std::chrono::steady_clock::now ();
+}
+
+void
+CpuAccounting::removeOwner (const void *owner)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+  auto it = accounts.find (owner);
+
+  if (it == accounts.end () ) {
+    return;
+  }
+
+  for (auto thread : it->second.threads) {
+    owners.erase (thread.first);
+  }
+
+  accounts.erase (it);
+}
+
+void
+CpuAccounting::leave (Account &account, pid_t tid, int64_t cpuTime)
+{
+  auto it = account.threads.find (tid);
+
+  if (it == account.threads.end () ) {
+    return;
+  }
+
+  if (cpuTime < 0) {
+    cpuTime = it->second.last;
+  }
+
+  account.cpuTime += std::max<int64_t> (cpuTime - it->second.start, 0);
+  account.threads.erase (it);
+  owners.erase (tid);
+}
+
+void
+CpuAccounting::threadEnter (const void *owner)
+{
+  pid_t tid = syscall (SYS_gettid);
+  int64_t cpuTime;
+
+  if (!readThreadCpuTime (tid, cpuTime) ) {
+    GST_WARNING ("Cannot read CPU time of thread %d", tid);
+    cpuTime = -1;
+  }
+
+  std::unique_lock <std::mutex> lock (mutex);
+  auto account = accounts.find (owner);
+  auto previous = owners.find (tid);
+
+  if (account == accounts.end () ) {
+    return;
+  }
+
+  /* A pooled thread that missed its leave */
+  if (previous != owners.end () ) {
+    auto previousAccount = accounts.find (previous->second);
+
+    if (previousAccount != accounts.end () ) {
+      leave (previousAccount->second, tid, cpuTime);
+    } else {
+      owners.erase (previous);
+    }
+  }
+
+  if (cpuTime < 0) {
+    return;
+  }
+
+  GST_TRACE ("Thread %d enters %p", tid, owner);
+  account->second.threads[tid] = {cpuTime, cpuTime};
+  owners[tid] = owner;
+}
+
+void
+CpuAccounting::threadLeave (const void *owner)
+{
+  pid_t tid = syscall (SYS_gettid);
+  int64_t cpuTime;
+
+  if (!readThreadCpuTime (tid, cpuTime) ) {
+    cpuTime = -1;
+  }
+
+  std::unique_lock <std::mutex> lock (mutex);
+  auto account = accounts.find (owner);
+
+  if (account == accounts.end () ) {
+    return;
+  }
+
+  GST_TRACE ("Thread %d leaves %p", tid, owner);
+  leave (account->second, tid, cpuTime);
+}
+
+void
+CpuAccounting::updateSample (Sample &sample, int64_t cpuTime)
+{
+  auto now = std::chrono::steady_clock::now ();
+  int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>
+                    (now - sample.time).count ();
+
+  if (elapsed < CPU_ACCOUNTING_SAMPLE_PERIOD) {
+    return;
+  }
+
+  sample.usage = 100.0 * std::max<int64_t> (cpuTime - sample.cpuTime, 0) /
+                 elapsed;
+  sample.time = now;
+  sample.cpuTime = cpuTime;
+}
+
+CpuAccounting::Usage
+CpuAccounting::getUsage (const void *owner)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+  std::map <pid_t, int64_t> cpuTimes;
+  Usage usage;
+  auto it = accounts.find (owner);
+
+  if (it == accounts.end () ) {
+    return usage;
+  }
+
+  for (auto thread : it->second.threads) {
+    cpuTimes[thread.first] = -1;
+  }
+
+  lock.unlock ();
+
+  for (auto &thread : cpuTimes) {
+    if (!readThreadCpuTime (thread.first, thread.second) ) {
+      thread.second = -1;
+    }
+  }
+
+  lock.lock ();
+
+  /* The owner may have been removed meanwhile */
+  it = accounts.find (owner);
+
+  if (it == accounts.end () ) {
+    return usage;
+  }
+
+  Account &account = it->second;
+
+  usage.cpuTime = account.cpuTime;
+
+  for (auto thread = account.threads.begin ();
+       thread != account.threads.end ();) {
+    auto read = cpuTimes.find (thread->first);
+    int64_t cpuTime;
+
+    if (read == cpuTimes.end () ) {
+      /* Entered after the times were read */
+      cpuTime = thread->second.last;
+    } else {
+      cpuTime = read->second;
+    }
+
+    if (cpuTime < 0) {
+      /* The thread exited without telling */
+      account.cpuTime += thread->second.last - thread->second.start;
+      usage.cpuTime += thread->second.last - thread->second.start;
+      owners.erase (thread->first);
+      thread = account.threads.erase (thread);
+      continue;
+    }
+
+    thread->second.last = std::max (cpuTime, thread->second.start);
+    usage.cpuTime += thread->second.last - thread->second.start;
+    ++thread;
+  }
+
+  updateSample (account.sample, usage.cpuTime);
+  usage.threads = account.threads.size ();
+  usage.usage = account.sample.usage;
+
+  return usage;
+}
+
+CpuAccounting::Usage
+CpuAccounting::getProcessUsage ()
+{
+  std::vector<std::string> fields;
+  Usage usage;
+
+  if (!readStat ("/proc/self/stat", fields) ) {
+    GST_WARNING ("Cannot read process stats");
+    return usage;
+  }
+
+  usage.cpuTime = getCpuTime (fields);
+  usage.threads = atoi (fields[STAT_FIELD_NUM_THREADS - 1].c_str() );
+
+  std::unique_lock <std::mutex> lock (mutex);
+  updateSample (processSample, usage.cpuTime);
+  usage.usage = processSample.usage;
+
+  return usage;
+}
+
+CpuAccounting::StaticConstructor CpuAccounting::staticConstructor;
+
+CpuAccounting::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+}
+
+} // kurento
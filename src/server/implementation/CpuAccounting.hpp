@@ -0,0 +1,104 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __CPU_ACCOUNTING_HPP__
+#define __CPU_ACCOUNTING_HPP__
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <sys/types.h>
+
+namespace kurento
+{
+
+/*
+ * Attributes the CPU time of streaming threads to their owner (a
+ * pipeline). Threads are bound while they run one of its tasks, as told by
+ * the stream-status messages, and their time is read from
+ * /proc/self/task/<tid>/stat. Pooled threads may serve several owners
+ * along their life, only the time spent between enter and leave counts.
+ */
+class CpuAccounting
+{
+public:
+  struct Usage {
+    int threads = 0;
+    /* milliseconds */
+    int64_t cpuTime = 0;
+    /* percentage of one core since the previous sample */
+    double usage = 0;
+  };
+
+  ~CpuAccounting () {};
+
+  static std::shared_ptr<CpuAccounting> getCpuAccounting ();
+
+  void addOwner (const void *owner);
+  void removeOwner (const void *owner);
+
+  /* Must be called from the thread being attributed */
+  void threadEnter (const void *owner);
+  void threadLeave (const void *owner);
+
+  Usage getUsage (const void *owner);
+  Usage getProcessUsage ();
+
+private:
+  CpuAccounting ();
+
+  struct Sample {
+    std::chrono::steady_clock::time_point time;
+    int64_t cpuTime = 0;
+    double usage = 0;
+  };
+
+  struct Thread {
+    int64_t start;
+    int64_t last;
+  };
+
+  struct Account {
+    /* Time of the threads that already left */
+    int64_t cpuTime = 0;
+    std::map <pid_t, Thread> threads;
+    Sample sample;
+  };
+
+  void updateSample (Sample &sample, int64_t cpuTime);
+  /* @cpuTime is negative if it could not be read */
+  void leave (Account &account, pid_t tid, int64_t cpuTime);
+
+  std::map <const void *, Account> accounts;
+  std::map <pid_t, const void *> owners;
+  Sample processSample;
+  /* Not held while reading /proc */
+  std::mutex mutex;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
+};
+
+} // kurento
+
+#endif /* __CPU_ACCOUNTING_HPP__ */
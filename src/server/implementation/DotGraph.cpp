@@ -17,6 +17,7 @@
 
 #include "DotGraph.hpp"
 #include <string.h>
+#include <json/json.h>
 
 namespace kurento
 {
@@ -61,4 +62,119 @@ generateDotGraph (GstBin *bin, std::shared_ptr<GstreamerDotDetails> details)
   return retString;
 }
 
+static Json::Value
+padToJson (GstPad *pad)
+{
+  Json::Value json;
+  GstPad *peer;
+  GstCaps *caps;
+
+  json["name"] = GST_OBJECT_NAME (pad);
+  json["direction"] = GST_PAD_IS_SRC (pad) ? "src" : "sink";
+
+  peer = gst_pad_get_peer (pad);
+
+  if (peer != NULL) {
+    gchar *name = g_strdup_printf ("%s:%s", GST_DEBUG_PAD_NAME (peer) );
+
+    json["peer"] = name;
+    g_free (name);
+    g_object_unref (peer);
+  }
+
+  caps = gst_pad_get_current_caps (pad);
+
+  if (caps != NULL) {
+    gchar *str = gst_caps_to_string (caps);
+
+    json["caps"] = str;
+    g_free (str);
+    gst_caps_unref (caps);
+  }
+
+  return json;
+}
+
+static Json::Value
+elementToJson (GstElement *element)
+{
+  Json::Value json;
+  Json::Value pads (Json::arrayValue);
+  GstIterator *it;
+  GValue item = G_VALUE_INIT;
+  gboolean done = FALSE;
+
+  json["name"] = GST_OBJECT_NAME (element);
+  json["type"] = G_OBJECT_TYPE_NAME (element);
+  json["state"] = gst_element_state_get_name (GST_STATE (element) );
+
+  it = gst_element_iterate_pads (element);
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item) ) {
+    case GST_ITERATOR_OK:
+      pads.append (padToJson (GST_PAD (g_value_get_object (&item) ) ) );
+      g_value_reset (&item);
+      break;
+
+    case GST_ITERATOR_RESYNC:
+      pads.clear ();
+      gst_iterator_resync (it);
+      break;
+
+    case GST_ITERATOR_ERROR:
+    case GST_ITERATOR_DONE:
+      done = TRUE;
+      break;
+    }
+  }
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  json["pads"] = pads;
+
+  if (GST_IS_BIN (element) ) {
+    Json::Value children (Json::arrayValue);
+
+    it = gst_bin_iterate_elements (GST_BIN (element) );
+    done = FALSE;
+
+    while (!done) {
+      switch (gst_iterator_next (it, &item) ) {
+      case GST_ITERATOR_OK:
+        children.append (elementToJson (GST_ELEMENT (g_value_get_object (
+                                          &item) ) ) );
+        g_value_reset (&item);
+        break;
+
+      case GST_ITERATOR_RESYNC:
+        children.clear ();
+        gst_iterator_resync (it);
+        break;
+
+      case GST_ITERATOR_ERROR:
+      case GST_ITERATOR_DONE:
+        done = TRUE;
+        break;
+      }
+    }
+
+    g_value_unset (&item);
+    gst_iterator_free (it);
+
+    json["children"] = children;
+  }
+
+  return json;
+}
+
+std::string
+generateJsonGraph (GstBin *bin)
+{
+  Json::FastWriter writer;
+
+  return writer.write (elementToJson (GST_ELEMENT (bin) ) );
+}
+
 } /* kurento */
@@ -28,6 +28,10 @@ namespace kurento
 std::string
 generateDotGraph (GstBin *bin, std::shared_ptr<GstreamerDotDetails> details);
 
+/* Elements, pads, links and current caps, cheaper than dot to generate */
+std::string
+generateJsonGraph (GstBin *bin);
+
 } /* kurento */
 
 #endif /* __KMS_DOT_GRAPH_H__ */
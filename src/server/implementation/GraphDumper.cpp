@@ -0,0 +1,239 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "GraphDumper.hpp"
+#include "DotGraph.hpp"
+#include <KurentoException.hpp>
+#include <future>
+#include <gio/gio.h>
+
+#define GST_CAT_DEFAULT kurento_graph_dumper
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoGraphDumper"
+
+namespace kurento
+{
+
+void
+GraphDumper::startWorker (Worker &worker)
+{
+  worker.work = std::shared_ptr< boost::asio::io_service::work >
+                ( new boost::asio::io_service::work (worker.io_service) );
+  worker.thread = std::thread ( [&worker] () {
+    worker.io_service.run ();
+  });
+}
+
+void
+GraphDumper::stopWorker (Worker &worker)
+{
+  worker.work.reset ();
+  worker.io_service.stop ();
+
+  try {
+    if (std::this_thread::get_id() != worker.thread.get_id() ) {
+      worker.thread.join();
+    } else {
+      worker.thread.detach();
+    }
+  } catch (std::system_error &e) {
+    GST_ERROR ("Error joining: %s", e.what() );
+  }
+}
+
+GraphDumper::GraphDumper ()
+{
+  startWorker (dumps);
+  startWorker (requests);
+}
+
+GraphDumper::~GraphDumper ()
+{
+  stopWorker (dumps);
+  stopWorker (requests);
+}
+
+std::shared_ptr<GraphDumper>
+GraphDumper::getGraphDumper ()
+{
+  static std::shared_ptr<GraphDumper> dumper (new GraphDumper () );
+
+  return dumper;
+}
+
+static void
+writeJson (GstBin *bin, const std::string &dir, const std::string &tag)
+{
+  std::string json = generateJsonGraph (bin);
+  GError *err = NULL;
+  GFile *file;
+  GFileOutputStream *fstream;
+  GOutputStream *stream;
+  GZlibCompressor *compressor;
+  gchar *name, *path;
+
+  name = g_strdup_printf ("%" G_GINT64_FORMAT "-%s-%s.json.gz",
+                          g_get_real_time (), GST_OBJECT_NAME (bin), tag.c_str() );
+  path = g_build_filename (dir.c_str(), name, NULL);
+  file = g_file_new_for_path (path);
+  g_free (name);
+
+  fstream = g_file_replace (file, NULL, FALSE, G_FILE_CREATE_NONE, NULL, &err);
+
+  if (fstream == NULL) {
+    GST_WARNING ("Cannot create %s: %s", path, err->message);
+    g_error_free (err);
+    g_object_unref (file);
+    g_free (path);
+    return;
+  }
+
+  compressor = g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+  stream = g_converter_output_stream_new (G_OUTPUT_STREAM (fstream),
+                                          G_CONVERTER (compressor) );
+
+  if (!g_output_stream_write_all (stream, json.data(), json.size(), NULL,
+                                  NULL, &err) ||
+      !g_output_stream_close (stream, NULL, &err) ) {
+    GST_WARNING ("Cannot write %s: %s", path, err->message);
+    g_error_free (err);
+  }
+
+  g_object_unref (stream);
+  g_object_unref (compressor);
+  g_object_unref (fstream);
+  g_object_unref (file);
+  g_free (path);
+}
+
+bool
+GraphDumper::dumpOnError (GstBin *bin, GQuark domain, int code,
+                          const std::string &tag, const Limits &limits)
+{
+  const gchar *dir = g_getenv ("GST_DEBUG_DUMP_DOT_DIR");
+  auto now = std::chrono::steady_clock::now ();
+  std::unique_lock <std::mutex> lock (mutex);
+  auto it = buckets.find (bin);
+
+  if (it == buckets.end () ) {
+    Bucket bucket;
+
+    bucket.tokens = limits.burst;
+    bucket.last = now;
+    it = buckets.insert (std::make_pair (bin, bucket) ).first;
+  }
+
+  Bucket &bucket = it->second;
+  auto error = std::make_pair (domain, code);
+  auto error_it = bucket.errors.find (error);
+
+  bucket.tokens = std::min<double> (limits.burst, bucket.tokens +
+                                    std::chrono::duration<double> (now - bucket.last) / limits.interval);
+  bucket.last = now;
+
+  if (error_it != bucket.errors.end () &&
+      now - error_it->second < limits.interval) {
+    GST_DEBUG ("Error %s:%d of %s already dumped",
+               domain != 0 ? g_quark_to_string (domain) : "none", code,
+               GST_OBJECT_NAME (bin) );
+    return false;
+  }
+
+  if (bucket.tokens < 1) {
+    GST_DEBUG ("Too many dumps of %s", GST_OBJECT_NAME (bin) );
+    return false;
+  }
+
+  bucket.tokens -= 1;
+  bucket.errors[error] = now;
+  lock.unlock ();
+
+  if (dir == NULL) {
+    /* Nothing to write, but the caller may still log */
+    return true;
+  }
+
+  std::string dirPath = dir;
+
+  gst_object_ref (bin);
+  dumps.io_service.post ([bin, dirPath, tag, limits] () {
+    if (limits.json) {
+      writeJson (bin, dirPath, tag);
+    } else {
+      gst_debug_bin_to_dot_file_with_ts (bin, GST_DEBUG_GRAPH_SHOW_ALL,
+                                         tag.c_str() );
+    }
+
+    gst_object_unref (bin);
+  });
+
+  return true;
+}
+
+void
+GraphDumper::forget (GstBin *bin)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  buckets.erase (bin);
+}
+
+std::string
+GraphDumper::generate (GstBin *bin,
+                       std::shared_ptr<GstreamerDotDetails> details)
+{
+  auto task = std::make_shared<std::packaged_task<std::string () >> (
+  [bin, details] () {
+    return generateDotGraph (bin, details);
+  });
+  std::future<std::string> result = task->get_future ();
+
+  if (std::this_thread::get_id() == requests.thread.get_id() ) {
+    return generateDotGraph (bin, details);
+  }
+
+  if (requests.io_service.stopped () ) {
+    throw KurentoException (MEDIA_OBJECT_NOT_AVAILABLE,
+                            "Graph dumper is stopped");
+  }
+
+  gst_object_ref (bin);
+  requests.io_service.post ([task, bin] () {
+    (*task) ();
+    gst_object_unref (bin);
+  });
+
+  try {
+    return result.get ();
+  } catch (std::future_error &e) {
+    /* The task was dropped because the worker stopped */
+    GST_WARNING ("Graph of %s not generated: %s", GST_OBJECT_NAME (bin),
+                 e.what () );
+    throw KurentoException (MEDIA_OBJECT_NOT_AVAILABLE,
+                            "Graph dumper is stopped");
+  }
+}
+
+GraphDumper::StaticConstructor GraphDumper::staticConstructor;
+
+GraphDumper::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+}
+
+} // kurento
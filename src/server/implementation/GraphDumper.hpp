@@ -0,0 +1,101 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __GRAPH_DUMPER_HPP__
+#define __GRAPH_DUMPER_HPP__
+
+#include <map>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <string>
+#include <boost/asio.hpp>
+#include <gst/gst.h>
+#include <GstreamerDotDetails.hpp>
+
+namespace kurento
+{
+
+/*
+ * Generates pipeline graphs out of the bus and RPC threads. Dumps on error
+ * are limited per pipeline with a token bucket, and an error (domain and
+ * code) already dumped is not dumped again until a whole interval has
+ * passed. They run on their own thread so they never delay generate ().
+ */
+class GraphDumper
+{
+public:
+  struct Limits {
+    /* Dumps allowed in a row */
+    int burst = 3;
+    /* Time to regain one dump, and to dump the same error again */
+    std::chrono::seconds interval = std::chrono::seconds (60);
+    /* gzipped JSON topology instead of dot */
+    bool json = false;
+  };
+
+  ~GraphDumper ();
+
+  static std::shared_ptr<GraphDumper> getGraphDumper ();
+
+  /* Writes the graph to GST_DEBUG_DUMP_DOT_DIR, false if rate limited */
+  bool dumpOnError (GstBin *bin, GQuark domain, int code,
+                    const std::string &tag, const Limits &limits);
+  void forget (GstBin *bin);
+
+  /* Blocks until the dumper thread generates the graph, throws
+   * KurentoException if the dumper is stopped meanwhile */
+  std::string generate (GstBin *bin,
+                        std::shared_ptr<GstreamerDotDetails> details);
+
+private:
+  GraphDumper ();
+
+  struct Bucket {
+    double tokens;
+    std::chrono::steady_clock::time_point last;
+    std::map <std::pair<GQuark, int>, std::chrono::steady_clock::time_point>
+    errors;
+  };
+
+  struct Worker {
+    boost::asio::io_service io_service;
+    std::shared_ptr< boost::asio::io_service::work > work;
+    std::thread thread;
+  };
+
+  static void startWorker (Worker &worker);
+  static void stopWorker (Worker &worker);
+
+  std::map <GstBin *, Bucket> buckets;
+  std::mutex mutex;
+
+  Worker dumps;
+  Worker requests;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
+};
+
+} // kurento
+
+#endif /* __GRAPH_DUMPER_HPP__ */
@@ -15,14 +15,17 @@
  *
  */
 
+#include <config.h>
 #include "MediaSet.hpp"
 
 #include <gst/gst.h>
 #include <KurentoException.hpp>
 #include <MediaPipelineImpl.hpp>
 #include <ServerManagerImpl.hpp>
+#include <commons/kmsprobes.h>
 
 #include <functional>
+#include <algorithm>
 
 /* This is included to avoid problems with slots and lamdas */
 #include <type_traits>
@@ -34,6 +37,12 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
 const int MEDIASET_THREADS_DEFAULT = 1;
 
+KMS_PROBE_DEFINE (media_object_created);
+KMS_PROBE_DEFINE (media_object_ref);
+KMS_PROBE_DEFINE (media_object_unref);
+KMS_PROBE_DEFINE (media_object_destroyed);
+KMS_PROBE_DEFINE (media_object_release);
+
 namespace kurento
 {
 
@@ -239,6 +248,14 @@ MediaSet::ref (MediaObjectImpl *mediaObjectPtr)
 
   objectsMap[mediaObject->getId()] = std::weak_ptr<MediaObjectImpl> (mediaObject);
 
+  Census &typeCensus = census[mediaObject->getType ()];
+  typeCensus.max = std::max (++typeCensus.live, typeCensus.max);
+
+  if (KMS_PROBE_ENABLED (media_object_created) ) {
+    KMS_PROBE2 (media_object_created, mediaObjectPtr,
+                mediaObject->getId().c_str() );
+  }
+
   if (mediaObject->getParent() ) {
     std::shared_ptr<MediaObjectImpl> parent = std::dynamic_pointer_cast
         <MediaObjectImpl> (mediaObject->getParent() );
@@ -285,6 +302,11 @@ MediaSet::ref (const std::string &sessionId,
 
   sessionMap[sessionId][mediaObject->getId()] = mediaObject;
   reverseSessionMap[mediaObject->getId()].insert (sessionId);
+
+  if (KMS_PROBE_ENABLED (media_object_ref) ) {
+    KMS_PROBE3 (media_object_ref, mediaObject.get(), sessionId.c_str(),
+                mediaObject->getId().c_str() );
+  }
 }
 
 void
@@ -442,6 +464,11 @@ MediaSet::unref (const std::string &sessionId,
     eventIt->second.erase (mediaObject->getId() );
   }
 
+  if (KMS_PROBE_ENABLED (media_object_unref) ) {
+    KMS_PROBE4 (media_object_unref, mediaObject.get(), sessionId.c_str(),
+                mediaObject->getId().c_str(), released);
+  }
+
   if (released) {
     post (std::bind (call_release, mediaObject) );
   }
@@ -477,7 +504,9 @@ void MediaSet::releasePointer (MediaObjectImpl *mediaObject)
   std::unique_lock <std::recursive_mutex> lock (recMutex);
   std::string id = mediaObject->getId();
 
+  KMS_PROBE2 (media_object_destroyed, mediaObject, id.c_str() );
   objectsMap.erase (id );
+  census[mediaObject->getType ()].live--;
 
   post (std::bind (async_delete, mediaObject, id) );
 
@@ -497,6 +526,11 @@ void MediaSet::release (std::shared_ptr< MediaObjectImpl > mediaObject)
 
   auto it = reverseSessionMap.find (mediaObject->getId() );
 
+  if (KMS_PROBE_ENABLED (media_object_release) ) {
+    KMS_PROBE2 (media_object_release, mediaObject.get(),
+                mediaObject->getId().c_str() );
+  }
+
   if (it == reverseSessionMap.end() ) {
     /* Already released */
     return;
@@ -647,6 +681,14 @@ MediaSet::getSessions ()
   return ret;
 }
 
+std::map<std::string, MediaSet::Census>
+MediaSet::getCensus ()
+{
+  std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+  return census;
+}
+
 std::list<std::shared_ptr<MediaObjectImpl>>
     MediaSet::getPipelines (const std::string &sessionId)
 {
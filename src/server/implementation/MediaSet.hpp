@@ -72,6 +72,14 @@ public:
     const std::string &sessionId, const std::string &mediaObjectRef);
 
   std::vector<std::string> getSessions ();
+
+  /* Live instances of a type and their high-water mark */
+  struct Census {
+    int64_t live = 0;
+    int64_t max = 0;
+  };
+
+  std::map<std::string, Census> getCensus ();
   std::list<std::shared_ptr<MediaObjectImpl>> getPipelines (
         const std::string &sessionId = "");
   std::list<std::shared_ptr<MediaObjectImpl>> getChildren (
@@ -125,6 +133,8 @@ private:
 
   std::map<std::string, std::unordered_set<std::string>> reverseSessionMap;
 
+  std::map<std::string, Census> census;
+
   std::shared_ptr<WorkerPool> workers;
 
   static std::chrono::seconds collectorInterval;
@@ -0,0 +1,285 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/gst.h>
+
+#include "StatsScheduler.hpp"
+#include "UUIDGenerator.hpp"
+#include "Stats.hpp"
+#include <vector>
+
+#define GST_CAT_DEFAULT kurento_stats_scheduler
+GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
+#define GST_DEFAULT_NAME "KurentoStatsScheduler"
+
+const int STATS_SCHEDULER_TICK = 100; /* milliseconds */
+
+namespace kurento
+{
+
+StatsScheduler::StatsScheduler () : clock (std::chrono::steady_clock::now),
+  threaded (true), timer (io_service)
+{
+  work = std::shared_ptr< boost::asio::io_service::work >
+         ( new boost::asio::io_service::work (io_service) );
+  thread = std::thread ( [this] () {
+    io_service.run ();
+  });
+}
+
+StatsScheduler::StatsScheduler (Clock clock) : clock (clock),
+  threaded (false), timer (io_service)
+{
+}
+
+StatsScheduler::~StatsScheduler ()
+{
+  if (!threaded) {
+    return;
+  }
+
+  work.reset ();
+  io_service.stop ();
+
+  try {
+    if (std::this_thread::get_id() != thread.get_id() ) {
+      thread.join();
+    } else {
+      thread.detach();
+    }
+  } catch (std::system_error &e) {
+    GST_ERROR ("Error joining: %s", e.what() );
+  }
+}
+
+std::shared_ptr<StatsScheduler>
+StatsScheduler::getScheduler ()
+{
+  static std::shared_ptr<StatsScheduler> scheduler (new StatsScheduler () );
+
+  return scheduler;
+}
+
+std::string
+StatsScheduler::subscribe (const void *source, Sampler sampler,
+                           Notifier notifier, int interval,
+                           const std::set<StatsType::type> &types)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+  std::string subscriptionId = generateUUID ();
+  Subscription subscription;
+
+  interval = std::max (interval, STATS_SCHEDULER_TICK);
+
+  subscription.source = source;
+  subscription.sampler = sampler;
+  subscription.notifier = notifier;
+  subscription.types = types;
+  subscription.interval = std::chrono::milliseconds (interval);
+  subscription.next = clock () + subscription.interval;
+
+  subscriptions[subscriptionId] = subscription;
+
+  GST_DEBUG ("Stats subscription %s every %d ms", subscriptionId.c_str (),
+             interval);
+
+  if (threaded && !ticking) {
+    ticking = true;
+    io_service.post (std::bind (&StatsScheduler::scheduleTick, this) );
+  }
+
+  return subscriptionId;
+}
+
+/* Waits for a notifier that is running in another thread to return */
+void
+StatsScheduler::waitNotifier (std::unique_lock <std::mutex> &lock,
+                              std::function<bool () > running)
+{
+  while (running () && notifyingThread != std::this_thread::get_id () ) {
+    notified.wait (lock);
+  }
+}
+
+bool
+StatsScheduler::unsubscribe (const void *source,
+                             const std::string &subscriptionId)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+  auto it = subscriptions.find (subscriptionId);
+
+  if (it == subscriptions.end () || it->second.source != source) {
+    /* Subscriptions can only be cancelled by the object that made them */
+    return false;
+  }
+
+  subscriptions.erase (it);
+
+  waitNotifier (lock, [this, &subscriptionId] () {
+    return notifyingId == subscriptionId;
+  });
+
+  return true;
+}
+
+void
+StatsScheduler::unsubscribeAll (const void *source)
+{
+  std::unique_lock <std::mutex> lock (mutex);
+
+  for (auto it = subscriptions.begin (); it != subscriptions.end (); ) {
+    if (it->second.source == source) {
+      it = subscriptions.erase (it);
+    } else {
+      ++it;
+    }
+  }
+
+  waitNotifier (lock, [this, source] () {
+    return notifyingSource == source;
+  });
+}
+
+void
+StatsScheduler::scheduleTick ()
+{
+  timer.expires_from_now (boost::posix_time::milliseconds (
+                            STATS_SCHEDULER_TICK) );
+  timer.async_wait (std::bind (&StatsScheduler::tick, this,
+                               std::placeholders::_1) );
+}
+
+void
+StatsScheduler::tick (const boost::system::error_code &error)
+{
+  if (error) {
+    return;
+  }
+
+  dispatch ();
+
+  std::unique_lock <std::mutex> lock (mutex);
+
+  if (subscriptions.empty () ) {
+    ticking = false;
+  } else {
+    scheduleTick ();
+  }
+}
+
+void
+StatsScheduler::dispatch ()
+{
+  std::unique_lock <std::mutex> dispatchLock (dispatchMutex);
+  std::map <const void *, std::vector<std::pair<std::string, Subscription>>>
+      due;
+  std::chrono::steady_clock::time_point now;
+
+  now = clock ();
+
+  std::unique_lock <std::mutex> lock (mutex);
+
+  for (auto &it : subscriptions) {
+    Subscription &subscription = it.second;
+
+    if (subscription.next > now) {
+      continue;
+    }
+
+    subscription.next += subscription.interval;
+
+    if (subscription.next <= now) {
+      /* We are late, do not try to catch up */
+      subscription.next = now + subscription.interval;
+    }
+
+    due[subscription.source].push_back (it);
+  }
+
+  lock.unlock ();
+
+  for (auto &group : due) {
+    StatsMap report;
+    bool alive;
+
+    try {
+      alive = group.second.front ().second.sampler (report);
+    } catch (std::exception &e) {
+      GST_WARNING ("Error sampling stats: %s", e.what () );
+      continue;
+    }
+
+    if (!alive) {
+      lock.lock ();
+
+      for (auto &it : group.second) {
+        subscriptions.erase (it.first);
+      }
+
+      lock.unlock ();
+      continue;
+    }
+
+    for (auto &it : group.second) {
+      StatsMap filtered;
+
+      lock.lock ();
+
+      if (subscriptions.find (it.first) == subscriptions.end () ) {
+        /* Cancelled after being sampled */
+        lock.unlock ();
+        continue;
+      }
+
+      notifyingId = it.first;
+      notifyingSource = it.second.source;
+      notifyingThread = std::this_thread::get_id ();
+      lock.unlock ();
+
+      for (auto &stat : report) {
+        if (it.second.types.empty () ||
+            it.second.types.count (stat.second->getType ()->getValue () ) ) {
+          filtered[stat.first] = stat.second;
+        }
+      }
+
+      try {
+        it.second.notifier (it.first, filtered);
+      } catch (std::exception &e) {
+        GST_WARNING ("Error notifying stats of %s: %s", it.first.c_str (),
+                     e.what () );
+      }
+
+      lock.lock ();
+      notifyingId.clear ();
+      notifyingSource = nullptr;
+      notifyingThread = std::thread::id ();
+      lock.unlock ();
+      notified.notify_all ();
+    }
+  }
+}
+
+StatsScheduler::StaticConstructor StatsScheduler::staticConstructor;
+
+StatsScheduler::StaticConstructor::StaticConstructor()
+{
+  GST_DEBUG_CATEGORY_INIT (GST_CAT_DEFAULT, GST_DEFAULT_NAME, 0,
+                           GST_DEFAULT_NAME);
+}
+
+} // kurento
@@ -0,0 +1,119 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __STATS_SCHEDULER_HPP__
+#define __STATS_SCHEDULER_HPP__
+
+#include <map>
+#include <set>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <boost/asio.hpp>
+#include "StatsType.hpp"
+
+namespace kurento
+{
+
+class Stats;
+
+/*
+ * Runs periodic stats subscriptions from a single timer thread. Every
+ * source is sampled once per tick no matter how many subscriptions are
+ * due for it, and the resulting report is handed to all of them after
+ * keeping the stats types each one asked for.
+ */
+class StatsScheduler
+{
+public:
+  typedef std::map <std::string, std::shared_ptr<Stats>> StatsMap;
+
+  /* Fills the report, returns false when the source does not exist anymore */
+  typedef std::function<bool (StatsMap &) > Sampler;
+  typedef std::function<void (const std::string &, const StatsMap &) >
+  Notifier;
+  typedef std::function<std::chrono::steady_clock::time_point () > Clock;
+
+  /* Without a timer thread, subscriptions only run when dispatch is called */
+  StatsScheduler (Clock clock);
+  ~StatsScheduler ();
+
+  static std::shared_ptr<StatsScheduler> getScheduler ();
+
+  /* Samples and notifies the subscriptions due at the time of the clock */
+  void dispatch ();
+
+  std::string subscribe (const void *source, Sampler sampler,
+                         Notifier notifier, int interval,
+                         const std::set<StatsType::type> &types);
+  /* Once it returns, the notifier of the subscription is not called again,
+   * unless it is called from that notifier */
+  bool unsubscribe (const void *source, const std::string &subscriptionId);
+  void unsubscribeAll (const void *source);
+
+private:
+  StatsScheduler ();
+
+  struct Subscription {
+    const void *source;
+    Sampler sampler;
+    Notifier notifier;
+    std::set<StatsType::type> types;
+    std::chrono::milliseconds interval;
+    std::chrono::steady_clock::time_point next;
+  };
+
+  void scheduleTick ();
+  void tick (const boost::system::error_code &error);
+  void waitNotifier (std::unique_lock <std::mutex> &lock,
+                     std::function<bool () > running);
+
+  Clock clock;
+  bool threaded;
+
+  std::map <std::string, Subscription> subscriptions;
+  std::mutex mutex;
+  bool ticking = false;
+
+  /* Serializes dispatch, notifiers run with no lock held */
+  std::mutex dispatchMutex;
+  /* Notifier being run, protected by mutex */
+  std::string notifyingId;
+  const void *notifyingSource = nullptr;
+  std::thread::id notifyingThread;
+  std::condition_variable notified;
+
+  boost::asio::io_service io_service;
+  std::shared_ptr< boost::asio::io_service::work > work;
+  boost::asio::deadline_timer timer;
+  std::thread thread;
+
+  class StaticConstructor
+  {
+  public:
+    StaticConstructor();
+  };
+
+  static StaticConstructor staticConstructor;
+};
+
+} // kurento
+
+#endif /* __STATS_SCHEDULER_HPP__ */
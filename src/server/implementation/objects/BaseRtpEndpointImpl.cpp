@@ -41,6 +41,7 @@ why the gst_bus_source_dispatch is not triggered some times after gstrtpdtmfdepa
 #include "RTCOutboundRTPStreamStats.hpp"
 #include "EndpointStats.hpp"
 #include "kmsstats.h"
+#include "kmsproctime.h"
 #include "kmsutils.h"
 
 #define GST_CAT_DEFAULT kurento_base_rtp_endpoint_impl
@@ -481,6 +482,15 @@ BaseRtpEndpointImpl::getRembParams ()
   /* REMB remote begin */
   gst_structure_get (params, "remb-on-connect", G_TYPE_INT, &auxi, NULL);
   ret->setRembOnConnect (auxi);
+
+  gst_structure_get (params, "probe-factor", G_TYPE_FLOAT, &auxf, NULL);
+  ret->setProbeFactor (auxf);
+
+  gst_structure_get (params, "probe-steps", G_TYPE_INT, &auxi, NULL);
+  ret->setProbeSteps (auxi);
+
+  gst_structure_get (params, "probe-delay", G_TYPE_INT, &auxi, NULL);
+  ret->setProbeDelay (auxi);
   /* REMB remote end */
 
   gst_structure_free (params);
@@ -553,6 +563,27 @@ BaseRtpEndpointImpl::setRembParams (std::shared_ptr<RembParams> rembParams)
                       rembParams->getRembOnConnect() );
   }
 
+  if (rembParams->isSetProbeFactor () ) {
+    gst_structure_set (params, "probe-factor", G_TYPE_FLOAT,
+                       rembParams->getProbeFactor(), NULL);
+    GST_DEBUG_OBJECT (element, "New 'probe-factor' value %g",
+                      rembParams->getProbeFactor() );
+  }
+
+  if (rembParams->isSetProbeSteps () ) {
+    gst_structure_set (params, "probe-steps", G_TYPE_INT,
+                       rembParams->getProbeSteps(), NULL);
+    GST_DEBUG_OBJECT (element, "New 'probe-steps' value %d",
+                      rembParams->getProbeSteps() );
+  }
+
+  if (rembParams->isSetProbeDelay () ) {
+    gst_structure_set (params, "probe-delay", G_TYPE_INT,
+                       rembParams->getProbeDelay(), NULL);
+    GST_DEBUG_OBJECT (element, "New 'probe-delay' value %d",
+                      rembParams->getProbeDelay() );
+  }
+
   /* REMB remote end */
 
   g_object_set (G_OBJECT (element), REMB_PARAMS, params, NULL);
@@ -608,6 +639,8 @@ createRTCInboundRTPStreamStats (const GstStructure *stats)
 static std::shared_ptr<RTCOutboundRTPStreamStats>
 createRTCOutboundRTPStreamStats (const GstStructure *stats)
 {
+  std::shared_ptr<RTCOutboundRTPStreamStats> rtcStats;
+  guint rtxSize, rtxRequests, rtxHits, rtxMisses;
   guint64 bytesSent, packetsSent, bitRate;
   guint pliCount, firCount, remb, rtt, fractionLost;
   float roundTripTime;
@@ -636,11 +669,24 @@ createRTCOutboundRTPStreamStats (const GstStructure *stats)
     GST_TRACE ("No remb stats collected");
   }
 
-  return std::make_shared <RTCOutboundRTPStreamStats> ("",
-         std::make_shared <StatsType> (StatsType::outboundrtp), 0.0, "",
-         "", false, "", "", "", firCount, pliCount, 0, 0, remb, packetLost,
-         (float) fractionLost, packetsSent, bytesSent, (float) bitRate,
-         roundTripTime);
+  rtcStats = std::make_shared <RTCOutboundRTPStreamStats> ("",
+             std::make_shared <StatsType> (StatsType::outboundrtp), 0.0, "",
+             "", false, "", "", "", firCount, pliCount, 0, 0, remb, packetLost,
+             (float) fractionLost, packetsSent, bytesSent, (float) bitRate,
+             roundTripTime);
+
+  /* Only present when retransmissions are enabled */
+  if (gst_structure_get (stats, "rtx-history-size", G_TYPE_UINT, &rtxSize,
+                         "rtx-requests", G_TYPE_UINT, &rtxRequests, "rtx-hits",
+                         G_TYPE_UINT, &rtxHits, "rtx-misses", G_TYPE_UINT, &rtxMisses,
+                         NULL) ) {
+    rtcStats->setRtxHistorySize (rtxSize);
+    rtcStats->setRtxRequests (rtxRequests);
+    rtcStats->setRtxHits (rtxHits);
+    rtcStats->setRtxMisses (rtxMisses);
+  }
+
+  return rtcStats;
 }
 
 static std::shared_ptr<RTCRTPStreamStats>
@@ -781,10 +827,11 @@ BaseRtpEndpointImpl::collectEndpointStats (std::map
     double timestamp)
 {
   std::shared_ptr<Stats> endpointStats;
-  GstStructure *e2e_stats;
+  GstStructure *e2e_stats, *processing;
 
   std::vector<std::shared_ptr<MediaLatencyStat>> inputStats;
   std::vector<std::shared_ptr<MediaLatencyStat>> e2eStats;
+  std::vector<std::shared_ptr<ElementProcessingStat>> processingTimes;
 
   if (gst_structure_get (stats, "e2e-latencies", GST_TYPE_STRUCTURE,
                          &e2e_stats, NULL) ) {
@@ -796,6 +843,14 @@ BaseRtpEndpointImpl::collectEndpointStats (std::map
                   std::make_shared <StatsType> (StatsType::endpoint), timestamp,
                   0.0, 0.0, inputStats, 0.0, 0.0, e2eStats);
 
+  if (gst_structure_get (stats, KMS_PROC_TIME_STATS_FIELD, GST_TYPE_STRUCTURE,
+                         &processing, NULL) ) {
+    collectProcessingStats (processingTimes, processing);
+    gst_structure_free (processing);
+    std::dynamic_pointer_cast <EndpointStats> (endpointStats)->setProcessingTime
+    (processingTimes);
+  }
+
   setDeprecatedProperties (std::dynamic_pointer_cast <EndpointStats>
                            (endpointStats) );
 
@@ -32,9 +32,12 @@
 #include <ElementConnectionData.hpp>
 #include <DotGraph.hpp>
 #include <GstreamerDotDetails.hpp>
+#include <StatsScheduler.hpp>
 #include <StatsType.hpp>
 #include "ElementStats.hpp"
 #include "kmsstats.h"
+#include "kmselement.h"
+#include "kmsproctime.h"
 #include <SignalHandler.hpp>
 
 #define GST_CAT_DEFAULT kurento_media_element_impl
@@ -45,6 +48,7 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 
 #define MIN_OUTPUT_BITRATE "min-output-bitrate"
 #define MAX_OUTPUT_BITRATE "max-output-bitrate"
+#define OUTPUT_BITRATE_TIERS "output-bitrate-tiers"
 
 #define TYPE_VIDEO "video_"
 #define TYPE_AUDIO "audio_"
@@ -580,6 +584,16 @@ MediaElementImpl::MediaElementImpl (const boost::property_tree::ptree &config,
   } catch (boost::property_tree::ptree_error &e) {
   }
 
+  //read default configuration for output bitrate tiers
+  try {
+    std::string tiers =
+      getConfigValue<std::string, MediaElement> ("outputBitrateTiers");
+    GST_DEBUG ("Output bitrate tiers configured to %s", tiers.c_str() );
+    g_object_set (G_OBJECT (element), OUTPUT_BITRATE_TIERS, tiers.c_str(),
+                  NULL);
+  } catch (boost::property_tree::ptree_error &e) {
+  }
+
 }
 
 MediaElementImpl::~MediaElementImpl ()
@@ -588,6 +602,8 @@ MediaElementImpl::~MediaElementImpl ()
 
   GST_LOG ("Deleting media element %s", getName().c_str () );
 
+  StatsScheduler::getScheduler ()->unsubscribeAll (this);
+
   if (padAddedHandlerId) {
     g_signal_handler_disconnect (element, padAddedHandlerId);
   }
@@ -1266,6 +1282,86 @@ std::map <std::string, std::shared_ptr<Stats>>
   return generateStats (NULL);
 }
 
+void
+MediaElementImpl::collectStats (std::map <std::string, std::shared_ptr<Stats>>
+                                &report, double timestamp)
+{
+  std::map <std::string, std::shared_ptr<Stats>> elementReport;
+  GstElement *gstElement = getGstreamerElement ();
+  GstStructure *stats;
+
+  /* Through the signal, handlers connected to it may complete the stats */
+  g_signal_emit_by_name (gstElement, "stats", NULL, &stats);
+
+  fillStatsReport (elementReport, stats, timestamp);
+
+  gst_structure_free (stats);
+
+  /* Stats ids are only unique inside their element */
+  for (auto it : elementReport) {
+    if (it.first == getId () ) {
+      report[it.first] = it.second;
+    } else {
+      report[getId () + "_" + it.first] = it.second;
+    }
+  }
+}
+
+std::string
+MediaElementImpl::subscribeStats (int interval)
+{
+  return subscribeStats (interval,
+                         std::vector<std::shared_ptr<StatsType>> () );
+}
+
+std::string
+MediaElementImpl::subscribeStats (int interval,
+                                  const std::vector<std::shared_ptr<StatsType>> &statsTypes)
+{
+  std::weak_ptr<MediaElementImpl> weak =
+    std::dynamic_pointer_cast<MediaElementImpl> (shared_from_this () );
+  std::set<StatsType::type> types;
+
+  for (auto type : statsTypes) {
+    types.insert (type->getValue () );
+  }
+
+  return StatsScheduler::getScheduler ()->subscribe (this,
+  [weak] (StatsScheduler::StatsMap & report) {
+    std::shared_ptr<MediaElementImpl> self = weak.lock ();
+
+    if (!self) {
+      return false;
+    }
+
+    report = self->getStats ();
+
+    return true;
+  },
+  [weak] (const std::string & subscriptionId,
+  const StatsScheduler::StatsMap & report) {
+    std::shared_ptr<MediaElementImpl> self = weak.lock ();
+
+    if (!self) {
+      return;
+    }
+
+    StatsReport event (self, StatsReport::getName (), subscriptionId, report);
+
+    self->signalStatsReport (event);
+  }, interval, types);
+}
+
+void
+MediaElementImpl::unsubscribeStats (const std::string &subscriptionId)
+{
+  if (!StatsScheduler::getScheduler ()->unsubscribe (this, subscriptionId) ) {
+    throw KurentoException (MEDIA_OBJECT_ILLEGAL_PARAM_ERROR,
+                            "Stats subscription " + subscriptionId +
+                            " not found in " + getId () );
+  }
+}
+
 std::map <std::string, std::shared_ptr<Stats>>
     MediaElementImpl::getStats (std::shared_ptr<MediaType> mediaType)
 {
@@ -1339,6 +1435,41 @@ MediaElementImpl::collectLatencyStats (
   }
 }
 
+void
+MediaElementImpl::collectProcessingStats (
+  std::vector<std::shared_ptr<ElementProcessingStat>> &processingStats,
+  const GstStructure *stats)
+{
+  gint i, fields;
+
+  fields = gst_structure_n_fields (stats);
+
+  for (i = 0; i < fields; i ++) {
+    const GstStructure *bin;
+    const gchar *fieldname;
+    const GValue *val;
+    const gchar *type;
+    guint64 buffers = 0, avg = 0, max = 0, queueAvg = 0;
+
+    fieldname = gst_structure_nth_field_name (stats, i);
+    val = gst_structure_get_value (stats, fieldname);
+
+    if (!GST_VALUE_HOLDS_STRUCTURE (val) ) {
+      GST_DEBUG ("Ignore unexpected value for field %s", fieldname);
+      continue;
+    }
+
+    bin = gst_value_get_structure (val);
+    type = gst_structure_get_string (bin, "type");
+    gst_structure_get (bin, "buffers", G_TYPE_UINT64, &buffers, "avg",
+                       G_TYPE_UINT64, &avg, "max", G_TYPE_UINT64, &max, "queue-avg",
+                       G_TYPE_UINT64, &queueAvg, NULL);
+
+    processingStats.push_back (std::make_shared <ElementProcessingStat>
+                               (fieldname, type != NULL ? type : "", buffers, avg, max, queueAvg) );
+  }
+}
+
 static void
 setDeprecatedProperties (std::shared_ptr<ElementStats> eStats)
 {
@@ -1382,6 +1513,8 @@ MediaElementImpl::fillStatsReport (std::map
   }
 
   std::vector<std::shared_ptr<MediaLatencyStat>> inputLatencies;
+  std::vector<std::shared_ptr<ElementProcessingStat>> processingTimes;
+  GstStructure *processing;
 
   if (gst_structure_get (gst_value_get_structure (value), "input-latencies",
                          GST_TYPE_STRUCTURE, &latencies, NULL) ) {
@@ -1389,6 +1522,12 @@ MediaElementImpl::fillStatsReport (std::map
     gst_structure_free (latencies);
   }
 
+  if (gst_structure_get (gst_value_get_structure (value),
+                         KMS_PROC_TIME_STATS_FIELD, GST_TYPE_STRUCTURE, &processing, NULL) ) {
+    collectProcessingStats (processingTimes, processing);
+    gst_structure_free (processing);
+  }
+
   if (report.find (getId () ) != report.end() ) {
     std::shared_ptr<ElementStats> eStats =
       std::dynamic_pointer_cast <ElementStats> (report[getId ()]);
@@ -1400,6 +1539,11 @@ MediaElementImpl::fillStatsReport (std::map
     report[getId ()] = elementStats;
   }
 
+  if (!processingTimes.empty () ) {
+    std::dynamic_pointer_cast <ElementStats> (report[getId ()])->setProcessingTime
+    (processingTimes);
+  }
+
   setDeprecatedProperties (std::dynamic_pointer_cast <ElementStats>
                            (report[getId ()]) );
 }
@@ -21,6 +21,7 @@
 #include "MediaElement.hpp"
 #include "MediaType.hpp"
 #include "MediaLatencyStat.hpp"
+#include "ElementProcessingStat.hpp"
 #include <EventHandler.hpp>
 #include <gst/gst.h>
 #include <mutex>
@@ -29,6 +30,7 @@
 #include "MediaFlowOutStateChange.hpp"
 #include "MediaFlowInStateChange.hpp"
 #include "MediaFlowState.hpp"
+#include "StatsReport.hpp"
 #include "commons/kmselement.h"
 
 namespace kurento
@@ -100,6 +102,16 @@ public:
   virtual std::map <std::string, std::shared_ptr<Stats>> getStats (
         std::shared_ptr<MediaType> mediaType) override;
 
+  /* Adds stats of this element to a report shared with other elements */
+  void collectStats (std::map <std::string, std::shared_ptr<Stats>> &report,
+                     double timestamp);
+
+  virtual std::string subscribeStats (int interval) override;
+  virtual std::string subscribeStats (int interval,
+                                      const std::vector<std::shared_ptr<StatsType>>
+                                      &statsTypes) override;
+  virtual void unsubscribeStats (const std::string &subscriptionId) override;
+
   virtual std::vector<std::shared_ptr<ElementConnectionData>>
       getSourceConnections () override;
   virtual std::vector<std::shared_ptr<ElementConnectionData>>
@@ -172,6 +184,7 @@ public:
   sigc::signal<void, ElementDisconnected> signalElementDisconnected;
   sigc::signal<void, MediaFlowOutStateChange> signalMediaFlowOutStateChange;
   sigc::signal<void, MediaFlowInStateChange> signalMediaFlowInStateChange;
+  sigc::signal<void, StatsReport> signalStatsReport;
 
   virtual void invoke (std::shared_ptr<MediaObjectImpl> obj,
                        const std::string &methodName, const Json::Value &params,
@@ -189,6 +202,9 @@ protected:
   virtual void postConstructor () override;
   void collectLatencyStats (std::vector<std::shared_ptr<MediaLatencyStat>>
                             &latencyStats, const GstStructure *stats);
+  void collectProcessingStats (std::vector
+                               <std::shared_ptr<ElementProcessingStat>> &processingStats,
+                               const GstStructure *stats);
   virtual void fillStatsReport (std::map <std::string, std::shared_ptr<Stats>>
                                 &report, const GstStructure *stats, double timestamp);
 
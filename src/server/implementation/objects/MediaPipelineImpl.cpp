@@ -22,13 +22,23 @@
 #include <gst/gst.h>
 #include <DotGraph.hpp>
 #include <GstreamerDotDetails.hpp>
+#include <LatencyProfile.hpp>
 #include <SignalHandler.hpp>
+#include <MediaSet.hpp>
+#include <StatsScheduler.hpp>
+#include <CpuAccounting.hpp>
+#include <GraphDumper.hpp>
+#include <CpuUsage.hpp>
+#include "MediaElementImpl.hpp"
 #include "kmselement.h"
+#include "kmsflightrecorder.h"
 
 #define GST_CAT_DEFAULT kurento_media_pipeline_impl
 GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 #define GST_DEFAULT_NAME "KurentoMediaPipelineImpl"
 
+#define MAX_STATS_BASELINES 16
+
 namespace kurento
 {
 void
@@ -40,9 +50,13 @@ MediaPipelineImpl::busMessage (GstMessage *message)
     gchar *debug = NULL;
 
     GST_ERROR ("Error on bus: %" GST_PTR_FORMAT, message);
-    gst_debug_bin_to_dot_file_with_ts (GST_BIN (pipeline),
-                                       GST_DEBUG_GRAPH_SHOW_ALL, "error");
     gst_message_parse_error (message, &err, &debug);
+
+    if (GraphDumper::getGraphDumper ()->dumpOnError (GST_BIN (pipeline),
+        err ? err->domain : 0, err ? err->code : 0, "error", errorDumpLimits) ) {
+      dumpFlightRecord ("error");
+    }
+
     std::string errorMessage;
 
     if (err) {
@@ -77,6 +91,77 @@ MediaPipelineImpl::busMessage (GstMessage *message)
   }
 }
 
+void
+MediaPipelineImpl::dumpFlightRecord (const std::string &tag)
+{
+  const gchar *dir = g_getenv ("GST_DEBUG_DUMP_DOT_DIR");
+  gchar *text, *path;
+
+  text = kms_flight_recorder_dump_text (pipeline);
+
+  if (text != NULL) {
+    GST_WARNING ("Flight record of %s:\n%s", getId().c_str(), text);
+    g_free (text);
+  }
+
+  /* Saved along with the dot files, see kms-flight-decode */
+  if (dir == NULL) {
+    return;
+  }
+
+  path = kms_flight_recorder_dump_to_file (pipeline, dir, tag.c_str() );
+
+  if (path != NULL) {
+    GST_INFO ("Flight record of %s saved to %s", getId().c_str(), path);
+    g_free (path);
+  }
+}
+
+std::string
+MediaPipelineImpl::getFlightRecord ()
+{
+  std::string record;
+  gchar *text;
+
+  text = kms_flight_recorder_dump_text (pipeline);
+
+  if (text != NULL) {
+    record = text;
+    g_free (text);
+  }
+
+  return record;
+}
+
+static void
+flight_recorder_cb (GstBus *bus, GstMessage *message, gpointer data)
+{
+  kms_flight_recorder_record_message (message);
+}
+
+/* Called from the streaming thread that enters or leaves a task */
+static void
+stream_status_cb (GstBus *bus, GstMessage *message, gpointer pipeline)
+{
+  GstStreamStatusType type;
+  GstElement *owner;
+
+  gst_message_parse_stream_status (message, &type, &owner);
+
+  switch (type) {
+  case GST_STREAM_STATUS_TYPE_ENTER:
+    CpuAccounting::getCpuAccounting ()->threadEnter (pipeline);
+    break;
+
+  case GST_STREAM_STATUS_TYPE_LEAVE:
+    CpuAccounting::getCpuAccounting ()->threadLeave (pipeline);
+    break;
+
+  default:
+    break;
+  }
+}
+
 void MediaPipelineImpl::postConstructor ()
 {
   GstBus *bus;
@@ -85,6 +170,14 @@ void MediaPipelineImpl::postConstructor ()
 
   bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline) );
   gst_bus_add_signal_watch (bus);
+
+  CpuAccounting::getCpuAccounting ()->addOwner (pipeline);
+  gst_bus_enable_sync_message_emission (bus);
+  streamStatusHandler = g_signal_connect (bus, "sync-message::stream-status",
+                                          G_CALLBACK (stream_status_cb), pipeline);
+  flightRecorderHandler = g_signal_connect (bus, "sync-message",
+                          G_CALLBACK (flight_recorder_cb), NULL);
+
   busMessageHandler = register_signal_handler (G_OBJECT (bus), "message",
                       std::function <void (GstBus *, GstMessage *) > (std::bind (
                             &MediaPipelineImpl::busMessage, this,
@@ -110,9 +203,21 @@ MediaPipelineImpl::MediaPipelineImpl (const boost::property_tree::ptree &config)
   gst_pipeline_use_clock (GST_PIPELINE (pipeline), clock);
   g_object_unref (clock);
 
+  kms_flight_recorder_attach (pipeline, KMS_FLIGHT_RECORDER_DEFAULT_RECORDS);
+
+  errorDumpLimits.burst = getConfigValue <int, MediaPipeline> ("errorDumpBurst",
+                          errorDumpLimits.burst);
+  errorDumpLimits.interval = std::chrono::seconds (
+                               getConfigValue <int, MediaPipeline> ("errorDumpInterval",
+                                   errorDumpLimits.interval.count () ) );
+  errorDumpLimits.json = getConfigValue <bool, MediaPipeline> ("errorDumpJson",
+                         errorDumpLimits.json);
+
   gst_element_set_state (pipeline, GST_STATE_PLAYING);
 
   busMessageHandler = 0;
+  streamStatusHandler = 0;
+  flightRecorderHandler = 0;
 
   rtp_socket_reuse_audio = NULL;
   rtcp_socket_reuse_audio = NULL;
@@ -124,6 +229,8 @@ MediaPipelineImpl::~MediaPipelineImpl ()
 {
   GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline) );
 
+  StatsScheduler::getScheduler ()->unsubscribeAll (this);
+
   gst_element_set_state (pipeline, GST_STATE_NULL);
 
   if (rtp_socket_reuse_audio != NULL) { //ru-bu
@@ -150,6 +257,18 @@ MediaPipelineImpl::~MediaPipelineImpl ()
     unregister_signal_handler (bus, busMessageHandler);
   }
 
+  if (flightRecorderHandler > 0) {
+    g_signal_handler_disconnect (bus, flightRecorderHandler);
+  }
+
+  if (streamStatusHandler > 0) {
+    g_signal_handler_disconnect (bus, streamStatusHandler);
+    gst_bus_disable_sync_message_emission (bus);
+  }
+
+  CpuAccounting::getCpuAccounting ()->removeOwner (pipeline);
+  GraphDumper::getGraphDumper ()->forget (GST_BIN (pipeline) );
+
   gst_bus_remove_signal_watch (bus);
   g_object_unref (bus);
   g_object_unref (pipeline);
@@ -158,14 +277,14 @@ MediaPipelineImpl::~MediaPipelineImpl ()
 std::string MediaPipelineImpl::getGstreamerDot (
   std::shared_ptr<GstreamerDotDetails> details)
 {
-  return generateDotGraph (GST_BIN (pipeline), details);
+  return GraphDumper::getGraphDumper ()->generate (GST_BIN (pipeline), details);
 }
 
 std::string MediaPipelineImpl::getGstreamerDot()
 {
-  return generateDotGraph (GST_BIN (pipeline),
-                           std::shared_ptr <GstreamerDotDetails> (new GstreamerDotDetails (
-                                 GstreamerDotDetails::SHOW_VERBOSE) ) );
+  return GraphDumper::getGraphDumper ()->generate (GST_BIN (pipeline),
+         std::shared_ptr <GstreamerDotDetails> (new GstreamerDotDetails (
+               GstreamerDotDetails::SHOW_VERBOSE) ) );
 }
 
 bool
@@ -218,6 +337,243 @@ MediaPipelineImpl::setLatencyStats (bool latencyStats)
   gst_iterator_free (it);
 }
 
+static void
+collectChildrenStats (std::shared_ptr<MediaObjectImpl> obj,
+                      std::map <std::string, std::shared_ptr<Stats>> &report,
+                      double timestamp)
+{
+  for (auto child : MediaSet::getMediaSet ()->getChildren (obj) ) {
+    std::shared_ptr<MediaElementImpl> element =
+      std::dynamic_pointer_cast<MediaElementImpl> (child);
+
+    if (element) {
+      element->collectStats (report, timestamp);
+    }
+
+    /* Elements like hub ports are children of other elements */
+    collectChildrenStats (child, report, timestamp);
+  }
+}
+
+std::map <std::string, std::shared_ptr<Stats>>
+    MediaPipelineImpl::getStats ()
+{
+  return getStats (false);
+}
+
+std::map <std::string, std::shared_ptr<Stats>>
+    MediaPipelineImpl::getStats (bool onlyChanged)
+{
+  return getStats (onlyChanged, "");
+}
+
+std::map <std::string, std::shared_ptr<Stats>>
+    MediaPipelineImpl::getStats (bool onlyChanged,
+                                 const std::string &baselineId)
+{
+  std::map <std::string, std::shared_ptr<Stats>> report;
+  std::map <std::string, Json::Value> snapshot;
+
+  collectChildrenStats (std::dynamic_pointer_cast<MediaObjectImpl>
+                        (shared_from_this() ), report, time (NULL) );
+
+  if (!onlyChanged) {
+    /* Only calls asking for changes use and move the baseline */
+    return report;
+  }
+
+  std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+  StatsBaseline &baseline = statsBaselines[baselineId];
+
+  for (auto it = report.begin (); it != report.end (); ) {
+    JsonSerializer serializer (true);
+    Json::Value value;
+    bool changed;
+
+    serializer.Serialize ("stats", it->second);
+    value = serializer.JsonValue["stats"];
+    value.removeMember ("timestamp");
+
+    auto last = baseline.stats.find (it->first);
+    changed = last == baseline.stats.end () || last->second != value;
+
+    snapshot[it->first] = value;
+
+    if (!changed) {
+      it = report.erase (it);
+    } else {
+      ++it;
+    }
+  }
+
+  baseline.stats.swap (snapshot);
+  baseline.lastUse = ++statsBaselinesUse;
+
+  if (statsBaselines.size () > MAX_STATS_BASELINES) {
+    auto oldest = statsBaselines.begin ();
+
+    for (auto it = statsBaselines.begin (); it != statsBaselines.end (); ++it) {
+      if (it->second.lastUse < oldest->second.lastUse) {
+        oldest = it;
+      }
+    }
+
+    GST_DEBUG ("Dropping stats baseline '%s' of %s", oldest->first.c_str (),
+               getId ().c_str () );
+    statsBaselines.erase (oldest);
+  }
+
+  return report;
+}
+
+std::string
+MediaPipelineImpl::subscribeStats (int interval)
+{
+  return subscribeStats (interval,
+                         std::vector<std::shared_ptr<StatsType>> () );
+}
+
+std::string
+MediaPipelineImpl::subscribeStats (int interval,
+                                   const std::vector<std::shared_ptr<StatsType>> &statsTypes)
+{
+  std::weak_ptr<MediaPipelineImpl> weak =
+    std::dynamic_pointer_cast<MediaPipelineImpl> (shared_from_this () );
+  std::set<StatsType::type> types;
+
+  for (auto type : statsTypes) {
+    types.insert (type->getValue () );
+  }
+
+  return StatsScheduler::getScheduler ()->subscribe (this,
+  [weak] (StatsScheduler::StatsMap & report) {
+    std::shared_ptr<MediaPipelineImpl> self = weak.lock ();
+
+    if (!self) {
+      return false;
+    }
+
+    /* Do not disturb the reference used by getStats (onlyChanged) */
+    collectChildrenStats (self, report, time (NULL) );
+
+    return true;
+  },
+  [weak] (const std::string & subscriptionId,
+  const StatsScheduler::StatsMap & report) {
+    std::shared_ptr<MediaPipelineImpl> self = weak.lock ();
+
+    if (!self) {
+      return;
+    }
+
+    StatsReport event (self, StatsReport::getName (), subscriptionId, report);
+
+    self->signalStatsReport (event);
+  }, interval, types);
+}
+
+void
+MediaPipelineImpl::unsubscribeStats (const std::string &subscriptionId)
+{
+  if (!StatsScheduler::getScheduler ()->unsubscribe (this, subscriptionId) ) {
+    throw KurentoException (MEDIA_OBJECT_ILLEGAL_PARAM_ERROR,
+                            "Stats subscription " + subscriptionId +
+                            " not found in " + getId () );
+  }
+}
+
+std::shared_ptr<CpuUsage>
+MediaPipelineImpl::getCpuUsage ()
+{
+  CpuAccounting::Usage usage =
+    CpuAccounting::getCpuAccounting ()->getUsage (pipeline);
+
+  return std::make_shared<CpuUsage> (getId (), usage.threads, usage.cpuTime,
+                                     usage.usage);
+}
+
+static void
+setElementLatencyProfile (GstElement *element, KmsLatencyProfile profile)
+{
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (element),
+                                    "latency-profile") != NULL) {
+    g_object_set (element, "latency-profile", profile, NULL);
+  }
+}
+
+std::shared_ptr<LatencyProfile>
+MediaPipelineImpl::getLatencyProfile ()
+{
+  std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+  switch (latencyProfile) {
+  case KMS_LATENCY_PROFILE_INTERACTIVE:
+    return std::make_shared<LatencyProfile> (LatencyProfile::INTERACTIVE);
+
+  case KMS_LATENCY_PROFILE_BROADCAST:
+    return std::make_shared<LatencyProfile> (LatencyProfile::BROADCAST);
+
+  default:
+    return std::make_shared<LatencyProfile> (LatencyProfile::DEFAULT);
+  }
+}
+
+void
+MediaPipelineImpl::setLatencyProfile (std::shared_ptr<LatencyProfile>
+                                      latencyProfile)
+{
+  GstIterator *it;
+  gboolean done = FALSE;
+  GValue item = G_VALUE_INIT;
+  KmsLatencyProfile profile;
+  std::unique_lock <std::recursive_mutex> lock (recMutex);
+
+  switch (latencyProfile->getValue () ) {
+  case LatencyProfile::INTERACTIVE:
+    profile = KMS_LATENCY_PROFILE_INTERACTIVE;
+    break;
+
+  case LatencyProfile::BROADCAST:
+    profile = KMS_LATENCY_PROFILE_BROADCAST;
+    break;
+
+  default:
+    profile = KMS_LATENCY_PROFILE_DEFAULT;
+    break;
+  }
+
+  if (this->latencyProfile == profile) {
+    return;
+  }
+
+  this->latencyProfile = profile;
+  it = gst_bin_iterate_recurse (GST_BIN (pipeline) );
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item) ) {
+    case GST_ITERATOR_OK: {
+      setElementLatencyProfile (GST_ELEMENT (g_value_get_object (&item) ),
+                                profile);
+      g_value_reset (&item);
+      break;
+    }
+
+    case GST_ITERATOR_RESYNC:
+      gst_iterator_resync (it);
+      break;
+
+    case GST_ITERATOR_ERROR:
+    case GST_ITERATOR_DONE:
+      done = TRUE;
+      break;
+    }
+  }
+
+  g_value_unset (&item);
+  gst_iterator_free (it);
+}
+
 bool
 MediaPipelineImpl::addElement (GstElement *element)
 {
@@ -228,6 +584,8 @@ MediaPipelineImpl::addElement (GstElement *element)
     g_object_set (element, "media-stats", latencyStats, NULL);
   }
 
+  setElementLatencyProfile (element, latencyProfile);
+
   ret = gst_bin_add (GST_BIN (pipeline), element);
 
   if (ret) {
@@ -19,6 +19,9 @@
 
 #include "MediaObjectImpl.hpp"
 #include "MediaPipeline.hpp"
+#include "StatsReport.hpp"
+#include "commons/kmslatencyprofile.h"
+#include <GraphDumper.hpp>
 #include <EventHandler.hpp>
 #include <gst/gst.h>
 #include <gio/gio.h>
@@ -53,10 +56,32 @@ public:
   virtual bool getLatencyStats ();
   virtual void setLatencyStats (bool latencyStats);
 
+  virtual std::shared_ptr<LatencyProfile> getLatencyProfile ();
+  virtual void setLatencyProfile (std::shared_ptr<LatencyProfile>
+                                  latencyProfile);
+
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats ();
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats (
+        bool onlyChanged);
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats (
+        bool onlyChanged, const std::string &baselineId);
+
+  virtual std::string subscribeStats (int interval);
+  virtual std::string subscribeStats (int interval,
+                                      const std::vector<std::shared_ptr<StatsType>>
+                                      &statsTypes);
+  virtual void unsubscribeStats (const std::string &subscriptionId);
+
+  virtual std::shared_ptr<CpuUsage> getCpuUsage ();
+
+  virtual std::string getFlightRecord ();
+
   /* Next methods are automatically implemented by code generator */
   virtual bool connect (const std::string &eventType,
                         std::shared_ptr<EventHandler> handler);
 
+  sigc::signal<void, StatsReport> signalStatsReport;
+
   virtual void invoke (std::shared_ptr<MediaObjectImpl> obj,
                        const std::string &methodName, const Json::Value &params,
                        Json::Value &response);
@@ -77,11 +102,24 @@ private:
   GstElement *pipeline;
 
   gulong busMessageHandler;
+  gulong streamStatusHandler;
+  gulong flightRecorderHandler;
 
   std::recursive_mutex recMutex;
   bool latencyStats = false;
+  KmsLatencyProfile latencyProfile = KMS_LATENCY_PROFILE_DEFAULT;
+  GraphDumper::Limits errorDumpLimits;
+
+  /* Last stats returned by getStats to each caller, to report only changes */
+  struct StatsBaseline {
+    std::map <std::string, Json::Value> stats;
+    uint64_t lastUse;
+  };
+  std::map <std::string, StatsBaseline> statsBaselines;
+  uint64_t statsBaselinesUse = 0;
 
   void busMessage (GstMessage *message);
+  void dumpFlightRecord (const std::string &tag);
 
   class StaticConstructor
   {
@@ -22,6 +22,12 @@
 #include <jsonrpc/JsonSerializer.hpp>
 #include <KurentoException.hpp>
 #include <MediaSet.hpp>
+#include <CpuAccounting.hpp>
+#include <CpuUsage.hpp>
+#include <ObjectCensus.hpp>
+#include <LoopStats.hpp>
+#include <commons/kmscensus.h>
+#include <commons/kmsloop.h>
 #include <boost/property_tree/json_parser.hpp>
 
 #define GST_CAT_DEFAULT kurento_server_manager_impl
@@ -76,6 +82,36 @@ std::vector<std::shared_ptr<MediaPipeline>> ServerManagerImpl::getPipelines ()
   return ret;
 }
 
+std::map <std::string, std::shared_ptr<Stats>> ServerManagerImpl::getStats ()
+{
+  return getStats (false);
+}
+
+std::map <std::string, std::shared_ptr<Stats>> ServerManagerImpl::getStats (
+      bool onlyChanged)
+{
+  return getStats (onlyChanged, "");
+}
+
+std::map <std::string, std::shared_ptr<Stats>> ServerManagerImpl::getStats (
+      bool onlyChanged, const std::string &baselineId)
+{
+  std::map <std::string, std::shared_ptr<Stats>> report;
+
+  for (auto it : MediaSet::getMediaSet ()->getPipelines() ) {
+    std::shared_ptr<MediaPipelineImpl> pipeline =
+      std::dynamic_pointer_cast <MediaPipelineImpl> (it);
+
+    if (pipeline) {
+      auto pipelineReport = pipeline->getStats (onlyChanged, baselineId);
+
+      report.insert (pipelineReport.begin(), pipelineReport.end() );
+    }
+  }
+
+  return report;
+}
+
 std::vector<std::string> ServerManagerImpl::getSessions ()
 {
   return MediaSet::getMediaSet ()->getSessions();
@@ -132,6 +168,76 @@ ServerManagerImpl::getUsedMemory()
   return get_int64 (stat, ' ', 22) / 1024;
 }
 
+std::vector<std::shared_ptr<CpuUsage>> ServerManagerImpl::getCpuUsage ()
+{
+  std::vector<std::shared_ptr<CpuUsage>> ret;
+  CpuAccounting::Usage usage;
+
+  for (auto it : MediaSet::getMediaSet ()->getPipelines() ) {
+    std::shared_ptr<MediaPipelineImpl> pipeline =
+      std::dynamic_pointer_cast <MediaPipelineImpl> (it);
+
+    if (pipeline) {
+      ret.push_back (pipeline->getCpuUsage () );
+    }
+  }
+
+  usage = CpuAccounting::getCpuAccounting ()->getProcessUsage ();
+  ret.push_back (std::make_shared<CpuUsage> ("process", usage.threads,
+                 usage.cpuTime, usage.usage) );
+
+  return ret;
+}
+
+std::vector<std::shared_ptr<ObjectCensus>>
+    ServerManagerImpl::getObjectCensus ()
+{
+  std::vector<std::shared_ptr<ObjectCensus>> ret;
+
+  for (auto it : MediaSet::getMediaSet ()->getCensus () ) {
+    ret.push_back (std::make_shared<ObjectCensus> (it.first, it.second.live,
+                   it.second.max) );
+  }
+
+  for (int type = 0; type < KMS_CENSUS_N_TYPES; type++) {
+    gint live, max;
+
+    kms_census_get ( (KmsCensusType) type, &live, &max);
+    ret.push_back (std::make_shared<ObjectCensus> (kms_census_type_get_name ( (
+                     KmsCensusType) type), live, max) );
+  }
+
+  return ret;
+}
+
+std::vector<std::shared_ptr<LoopStats>>
+                                     ServerManagerImpl::getLoopStats ()
+{
+  std::vector<std::shared_ptr<LoopStats>> ret;
+  GstStructure *stats = kms_loop_pool_get_stats ();
+  guint size = kms_loop_pool_get_size ();
+
+  for (guint i = 0; i < size; i++) {
+    GstStructure *loopStats;
+    gint64 lag = 0, maxLag = 0;
+    gchar *name = g_strdup_printf ("loop-%u", i);
+
+    if (gst_structure_get (stats, name, GST_TYPE_STRUCTURE, &loopStats,
+                           NULL) ) {
+      gst_structure_get_int64 (loopStats, "lag", &lag);
+      gst_structure_get_int64 (loopStats, "max-lag", &maxLag);
+      gst_structure_free (loopStats);
+    }
+
+    g_free (name);
+    ret.push_back (std::make_shared<LoopStats> (i, lag, maxLag) );
+  }
+
+  gst_structure_free (stats);
+
+  return ret;
+}
+
 ServerManagerImpl::StaticConstructor ServerManagerImpl::staticConstructor;
 
 ServerManagerImpl::StaticConstructor::StaticConstructor()
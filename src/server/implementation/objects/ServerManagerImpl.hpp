@@ -72,6 +72,19 @@ public:
 
   virtual int64_t getUsedMemory() override;
 
+  virtual std::vector<std::shared_ptr<CpuUsage>> getCpuUsage () override;
+
+  virtual std::vector<std::shared_ptr<ObjectCensus>> getObjectCensus ()
+  override;
+
+  virtual std::vector<std::shared_ptr<LoopStats>> getLoopStats () override;
+
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats () override;
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats (
+        bool onlyChanged) override;
+  virtual std::map <std::string, std::shared_ptr<Stats>> getStats (
+        bool onlyChanged, const std::string &baselineId) override;
+
   /* Next methods are automatically implemented by code generator */
   virtual bool connect (const std::string &eventType,
                         std::shared_ptr<EventHandler> handler) override;
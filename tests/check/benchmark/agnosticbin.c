@@ -0,0 +1,671 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Benchmark of the agnosticbin fan-out path. Every scenario pushes a fixed
+ * number of synthetic frames as fast as possible through agnosticbin (or
+ * agnosticbin3) into N outputs and measures throughput, the latency of
+ * each buffer from the agnosticbin sink pad to the fakesinks and the CPU
+ * time spent per buffer. Decoding scenarios replay frames encoded once
+ * before any scenario runs, so the encoder is not measured with them.
+ *
+ * Results are written as a key file, one group per scenario. When a
+ * baseline in the same format is given, the program fails if any metric
+ * is worse than the baseline by more than the tolerance.
+ */
+
+#include <gst/gst.h>
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+
+#include "benchmark.h"
+
+#define FRAMERATE 30
+#define WIDTH 320
+#define HEIGHT 240
+
+/* Runtime of a scenario is bounded, the frames not arrived are lost */
+#define SCENARIO_TIMEOUT_SECONDS 120
+
+/* One output is replaced by a new one every CHURN_PERIOD_MS */
+#define CHURN_PERIOD_MS 20
+
+typedef enum
+{
+  SCENARIO_FANOUT,              /* same caps in and out */
+  SCENARIO_ENCODE,              /* raw in, vp8 out */
+  SCENARIO_DECODE,              /* vp8 in, raw out */
+  SCENARIO_CHURN                /* fan-out while outputs join and leave */
+} ScenarioType;
+
+typedef struct _Scenario
+{
+  const gchar *name;
+  ScenarioType type;
+  guint n_outputs;
+} Scenario;
+
+static const Scenario scenarios[] = {
+  {"fanout-1", SCENARIO_FANOUT, 1},
+  {"fanout-8", SCENARIO_FANOUT, 8},
+  {"fanout-32", SCENARIO_FANOUT, 32},
+  {"encode-1", SCENARIO_ENCODE, 1},
+  {"encode-4", SCENARIO_ENCODE, 4},
+  {"decode-1", SCENARIO_DECODE, 1},
+  {"decode-4", SCENARIO_DECODE, 4},
+  {"churn-8", SCENARIO_CHURN, 8},
+};
+
+typedef struct _Metric
+{
+  const gchar *key;
+  gboolean higher_is_better;
+} Metric;
+
+/* Metrics checked against the baseline, the rest are informative */
+static const Metric metrics[] = {
+  {"buffers-per-second", TRUE},
+  {"latency-p50-us", FALSE},
+  {"latency-p99-us", FALSE},
+  {"cpu-us-per-buffer", FALSE},
+  {"join-latency-p50-us", FALSE},
+};
+
+typedef struct _Bench
+{
+  const Scenario *scenario;
+  GstElement *pipeline;
+  GstElement *agnosticbin;
+  GMainLoop *loop;
+  gboolean timed_out;
+  guint churn_id;
+  volatile gint source_eos;
+
+  /* Monotonic time each frame entered agnosticbin, indexed by frame */
+  gint64 *entry_times;
+  guint n_frames;
+
+  GQueue branches;
+
+  GMutex mutex;
+  GArray *latencies;
+  GArray *join_latencies;
+  guint64 received;
+} Bench;
+
+typedef struct _Branch
+{
+  Bench *bench;
+  GstElement *filter;
+  GstElement *sink;
+  GstPad *pad;
+
+  /* Only touched from the streaming thread of the sink */
+  GArray *latencies;
+  guint64 received;
+  gint64 joined;
+  gint64 first_buffer;
+} Branch;
+
+static gchar *element_name = "agnosticbin";
+static gint n_frames = 600;
+static gchar *only_scenario = NULL;
+static gchar *output_file = NULL;
+static gchar *baseline_file = NULL;
+static gdouble tolerance = 0.25;
+static gchar *plugin_path = NULL;
+
+/* Frames replayed by the decoding scenarios */
+static GPtrArray *encoded_frames = NULL;
+static GstCaps *encoded_caps = NULL;
+
+static GOptionEntry entries[] = {
+  {"element", 'e', 0, G_OPTION_ARG_STRING, &element_name,
+      "agnosticbin or agnosticbin3", "NAME"},
+  {"frames", 'n', 0, G_OPTION_ARG_INT, &n_frames,
+      "Frames pushed on each scenario", "N"},
+  {"scenario", 's', 0, G_OPTION_ARG_STRING, &only_scenario,
+      "Run only this scenario", "NAME"},
+  {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_file,
+      "Write the results to FILE instead of stdout", "FILE"},
+  {"baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline_file,
+      "Fail on regressions against the results in FILE", "FILE"},
+  {"tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &tolerance,
+      "Allowed relative regression (default 0.25)", "RATIO"},
+  {"plugin-path", 'p', 0, G_OPTION_ARG_FILENAME, &plugin_path,
+      "Directory with the kurento plugins", "DIR"},
+  {NULL}
+};
+
+static guint
+frame_index (GstBuffer * buffer)
+{
+  if (!GST_BUFFER_PTS_IS_VALID (buffer)) {
+    return G_MAXUINT;
+  }
+
+  return gst_util_uint64_scale_round (GST_BUFFER_PTS (buffer), FRAMERATE,
+      GST_SECOND);
+}
+
+static GstPadProbeReturn
+entry_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  Bench *bench = data;
+  guint index = frame_index (GST_PAD_PROBE_INFO_BUFFER (info));
+
+  if (index < bench->n_frames) {
+    bench->entry_times[index] = g_get_monotonic_time ();
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+eos_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  Bench *bench = data;
+
+  if (GST_EVENT_TYPE (GST_PAD_PROBE_INFO_EVENT (info)) == GST_EVENT_EOS) {
+    g_atomic_int_set (&bench->source_eos, TRUE);
+  }
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+sink_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer data)
+{
+  Branch *branch = data;
+  gint64 now = g_get_monotonic_time ();
+  guint index = frame_index (buffer);
+  gint64 latency;
+
+  if (branch->first_buffer == 0) {
+    branch->first_buffer = now;
+  }
+
+  branch->received++;
+
+  if (index >= branch->bench->n_frames
+      || branch->bench->entry_times[index] == 0) {
+    return;
+  }
+
+  latency = now - branch->bench->entry_times[index];
+  g_array_append_val (branch->latencies, latency);
+}
+
+static GstCaps *
+output_caps (const Scenario * scenario)
+{
+  switch (scenario->type) {
+    case SCENARIO_ENCODE:
+      return gst_caps_from_string ("video/x-vp8");
+    case SCENARIO_DECODE:
+      return gst_caps_from_string ("video/x-raw");
+    default:
+      return gst_caps_new_any ();
+  }
+}
+
+static Branch *
+branch_add (Bench * bench)
+{
+  Branch *branch = g_slice_new0 (Branch);
+  GstCaps *caps = output_caps (bench->scenario);
+  GstPad *sinkpad;
+
+  branch->bench = bench;
+  branch->latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  branch->filter = gst_element_factory_make ("capsfilter", NULL);
+  branch->sink = gst_element_factory_make ("fakesink", NULL);
+
+  g_object_set (branch->filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  g_object_set (branch->sink, "sync", FALSE, "async", FALSE,
+      "signal-handoffs", TRUE, NULL);
+  g_signal_connect (branch->sink, "handoff", G_CALLBACK (sink_handoff),
+      branch);
+
+  gst_bin_add_many (GST_BIN (bench->pipeline), branch->filter, branch->sink,
+      NULL);
+  gst_element_link (branch->filter, branch->sink);
+  gst_element_sync_state_with_parent (branch->sink);
+  gst_element_sync_state_with_parent (branch->filter);
+
+  /* Outputs linked before starting do not count as joins */
+  if (GST_STATE (bench->pipeline) == GST_STATE_PLAYING) {
+    branch->joined = g_get_monotonic_time ();
+  }
+
+  if (!gst_element_link (bench->agnosticbin, branch->filter)) {
+    g_printerr ("Cannot link %s to an output\n", element_name);
+    exit (1);
+  }
+
+  sinkpad = gst_element_get_static_pad (branch->filter, "sink");
+  branch->pad = gst_pad_get_peer (sinkpad);
+  g_object_unref (sinkpad);
+
+  g_queue_push_tail (&bench->branches, branch);
+
+  return branch;
+}
+
+static void
+branch_collect (Branch * branch)
+{
+  Bench *bench = branch->bench;
+  gint64 join_latency;
+
+  g_mutex_lock (&bench->mutex);
+  g_array_append_vals (bench->latencies, branch->latencies->data,
+      branch->latencies->len);
+  bench->received += branch->received;
+
+  if (branch->joined != 0 && branch->first_buffer != 0) {
+    join_latency = branch->first_buffer - branch->joined;
+    g_array_append_val (bench->join_latencies, join_latency);
+  }
+  g_mutex_unlock (&bench->mutex);
+}
+
+static void
+branch_remove (Branch * branch)
+{
+  Bench *bench = branch->bench;
+
+  gst_element_set_locked_state (branch->filter, TRUE);
+  gst_element_set_locked_state (branch->sink, TRUE);
+  gst_element_set_state (branch->sink, GST_STATE_NULL);
+  gst_element_set_state (branch->filter, GST_STATE_NULL);
+
+  gst_element_release_request_pad (bench->agnosticbin, branch->pad);
+  gst_object_unref (branch->pad);
+
+  gst_bin_remove_many (GST_BIN (bench->pipeline), branch->filter,
+      branch->sink, NULL);
+
+  branch_collect (branch);
+  g_array_free (branch->latencies, TRUE);
+  g_slice_free (Branch, branch);
+}
+
+static gboolean
+churn (gpointer data)
+{
+  Bench *bench = data;
+
+  /* Outputs joining after the last frame would never receive media */
+  if (g_atomic_int_get (&bench->source_eos)) {
+    bench->churn_id = 0;
+    return G_SOURCE_REMOVE;
+  }
+
+  branch_remove (g_queue_pop_head (&bench->branches));
+  branch_add (bench);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+timeout (gpointer data)
+{
+  Bench *bench = data;
+
+  bench->timed_out = TRUE;
+  g_main_loop_quit (bench->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+bus_msg (GstBus * bus, GstMessage * msg, gpointer data)
+{
+  Bench *bench = data;
+  GError *err = NULL;
+
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:
+      gst_message_parse_error (msg, &err, NULL);
+      g_printerr ("%s: error from %s: %s\n", bench->scenario->name,
+          GST_OBJECT_NAME (GST_MESSAGE_SRC (msg)), err->message);
+      g_error_free (err);
+      exit (1);
+    case GST_MESSAGE_EOS:
+      g_main_loop_quit (bench->loop);
+      break;
+    default:
+      break;
+  }
+}
+
+static GstElement *
+raw_source_new (void)
+{
+  GstElement *bin = gst_bin_new (NULL);
+  GstElement *src = gst_element_factory_make ("videotestsrc", NULL);
+  GstElement *filter = gst_element_factory_make ("capsfilter", NULL);
+  GstCaps *caps;
+  GstPad *pad;
+
+  caps = gst_caps_new_simple ("video/x-raw", "format", G_TYPE_STRING, "I420",
+      "width", G_TYPE_INT, WIDTH, "height", G_TYPE_INT, HEIGHT,
+      "framerate", GST_TYPE_FRACTION, FRAMERATE, 1, NULL);
+  g_object_set (filter, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  /* Cheapest pattern, the source should not be the bottleneck */
+  g_object_set (src, "num-buffers", n_frames, "is-live", FALSE,
+      "pattern", 2 /* black */ , NULL);
+
+  gst_bin_add_many (GST_BIN (bin), src, filter, NULL);
+  gst_element_link (src, filter);
+
+  pad = gst_element_get_static_pad (filter, "src");
+  gst_element_add_pad (bin, gst_ghost_pad_new ("src", pad));
+  g_object_unref (pad);
+
+  return bin;
+}
+
+static void
+encoded_handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad,
+    gpointer data)
+{
+  if (encoded_caps == NULL) {
+    encoded_caps = gst_pad_get_current_caps (pad);
+  }
+
+  g_ptr_array_add (encoded_frames, gst_buffer_ref (buffer));
+}
+
+static void
+encode_frames (void)
+{
+  GstElement *pipeline = gst_pipeline_new ("encode");
+  GstElement *source = raw_source_new ();
+  GstElement *enc = gst_element_factory_make ("vp8enc", NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstMessage *msg;
+  GstBus *bus;
+
+  if (enc == NULL) {
+    g_printerr ("Element vp8enc not found\n");
+    exit (1);
+  }
+
+  encoded_frames = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_buffer_unref);
+
+  g_object_set (enc, "deadline", G_GINT64_CONSTANT (1), NULL);
+  g_object_set (sink, "sync", FALSE, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (encoded_handoff), NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), source, enc, sink, NULL);
+  gst_element_link_many (source, enc, sink, NULL);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    g_printerr ("Cannot encode the frames of the decoding scenarios\n");
+    exit (1);
+  }
+
+  gst_message_unref (msg);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+}
+
+static GstElement *
+encoded_source_new (void)
+{
+  GstElement *src = gst_element_factory_make ("appsrc", NULL);
+  GstFlowReturn ret;
+  guint i;
+
+  if (encoded_frames == NULL) {
+    encode_frames ();
+  }
+
+  /* Every frame is queued upfront, entry times are taken on its src pad */
+  g_object_set (src, "caps", encoded_caps, "format", GST_FORMAT_TIME,
+      "is-live", FALSE, "max-bytes", G_GUINT64_CONSTANT (0), NULL);
+
+  for (i = 0; i < encoded_frames->len; i++) {
+    g_signal_emit_by_name (src, "push-buffer",
+        g_ptr_array_index (encoded_frames, i), &ret);
+  }
+
+  g_signal_emit_by_name (src, "end-of-stream", &ret);
+
+  return src;
+}
+
+static GstElement *
+source_new (Bench * bench)
+{
+  if (bench->scenario->type == SCENARIO_DECODE) {
+    return encoded_source_new ();
+  }
+
+  return raw_source_new ();
+}
+
+static gint64
+cpu_time (void)
+{
+  struct rusage usage;
+
+  getrusage (RUSAGE_SELF, &usage);
+
+  return (gint64) (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) *
+      G_USEC_PER_SEC + usage.ru_utime.tv_usec + usage.ru_stime.tv_usec;
+}
+
+static gboolean
+run_scenario (const Scenario * scenario, GKeyFile * results)
+{
+  Bench bench = { 0 };
+  GstElement *source;
+  GstBus *bus;
+  GstPad *pad;
+  gint64 start, elapsed, cpu_start, cpu;
+  guint i, timeout_id;
+
+  bench.scenario = scenario;
+  bench.n_frames = n_frames;
+  bench.entry_times = g_new0 (gint64, n_frames);
+  bench.latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  bench.join_latencies = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_mutex_init (&bench.mutex);
+  g_queue_init (&bench.branches);
+
+  bench.loop = g_main_loop_new (NULL, FALSE);
+  bench.pipeline = gst_pipeline_new (scenario->name);
+  bench.agnosticbin = gst_element_factory_make (element_name, NULL);
+
+  if (bench.agnosticbin == NULL) {
+    g_printerr ("Element %s not found\n", element_name);
+    exit (1);
+  }
+
+  source = source_new (&bench);
+  gst_bin_add_many (GST_BIN (bench.pipeline), source, bench.agnosticbin,
+      NULL);
+  gst_element_link (source, bench.agnosticbin);
+
+  pad = gst_element_get_static_pad (source, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, entry_probe, &bench,
+      NULL);
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM, eos_probe,
+      &bench, NULL);
+  g_object_unref (pad);
+
+  for (i = 0; i < scenario->n_outputs; i++) {
+    branch_add (&bench);
+  }
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (bench.pipeline));
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), &bench);
+
+  if (scenario->type == SCENARIO_CHURN) {
+    bench.churn_id = g_timeout_add (CHURN_PERIOD_MS, churn, &bench);
+  }
+  timeout_id = g_timeout_add_seconds (SCENARIO_TIMEOUT_SECONDS, timeout,
+      &bench);
+
+  start = g_get_monotonic_time ();
+  cpu_start = cpu_time ();
+
+  gst_element_set_state (bench.pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (bench.loop);
+
+  elapsed = g_get_monotonic_time () - start;
+  cpu = cpu_time () - cpu_start;
+
+  if (bench.churn_id != 0) {
+    g_source_remove (bench.churn_id);
+  }
+  if (!bench.timed_out) {
+    g_source_remove (timeout_id);
+  }
+
+  gst_element_set_state (bench.pipeline, GST_STATE_NULL);
+
+  while (!g_queue_is_empty (&bench.branches)) {
+    Branch *branch = g_queue_pop_head (&bench.branches);
+
+    branch_collect (branch);
+    g_array_free (branch->latencies, TRUE);
+    gst_object_unref (branch->pad);
+    g_slice_free (Branch, branch);
+  }
+
+  g_key_file_set_integer (results, scenario->name, "outputs",
+      scenario->n_outputs);
+  g_key_file_set_uint64 (results, scenario->name, "buffers", bench.received);
+  g_key_file_set_int64 (results, scenario->name, "elapsed-us", elapsed);
+  g_key_file_set_int64 (results, scenario->name, "buffers-per-second",
+      elapsed > 0 ? bench.received * G_USEC_PER_SEC / elapsed : 0);
+  g_key_file_set_int64 (results, scenario->name, "cpu-us-per-buffer",
+      bench.received > 0 ? cpu / (gint64) bench.received : 0);
+  benchmark_store_values (results, scenario->name, "latency", "us",
+      bench.latencies);
+
+  if (scenario->type == SCENARIO_CHURN) {
+    g_key_file_set_integer (results, scenario->name, "joins",
+        bench.join_latencies->len);
+    benchmark_store_values (results, scenario->name, "join-latency", "us",
+        bench.join_latencies);
+  }
+
+  if (bench.timed_out) {
+    g_printerr ("%s: timed out after %d s\n", scenario->name,
+        SCENARIO_TIMEOUT_SECONDS);
+  }
+
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (bench.pipeline);
+  g_main_loop_unref (bench.loop);
+  g_array_free (bench.latencies, TRUE);
+  g_array_free (bench.join_latencies, TRUE);
+  g_mutex_clear (&bench.mutex);
+  g_free (bench.entry_times);
+
+  return !bench.timed_out;
+}
+
+static gboolean
+is_checked_metric (const gchar * key, gboolean * higher_is_better)
+{
+  guint i;
+
+  for (i = 0; i < G_N_ELEMENTS (metrics); i++) {
+    if (g_strcmp0 (metrics[i].key, key) == 0) {
+      *higher_is_better = metrics[i].higher_is_better;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GKeyFile *results;
+  GError *err = NULL;
+  gboolean ok = TRUE;
+  guint i;
+
+  context = g_option_context_new ("- agnosticbin benchmark");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (context, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  if (plugin_path != NULL) {
+    gst_registry_scan_path (gst_registry_get (), plugin_path);
+  }
+
+  results = g_key_file_new ();
+  g_key_file_set_string (results, "benchmark", "element", element_name);
+  g_key_file_set_integer (results, "benchmark", "frames", n_frames);
+
+  for (i = 0; i < G_N_ELEMENTS (scenarios); i++) {
+    if (only_scenario != NULL && g_strcmp0 (only_scenario,
+            scenarios[i].name) != 0) {
+      continue;
+    }
+
+    ok &= run_scenario (&scenarios[i], results);
+  }
+
+  ok &= benchmark_write_results (results, output_file);
+
+  if (baseline_file != NULL) {
+    ok &= benchmark_check_baseline (results, baseline_file, tolerance,
+        is_checked_metric);
+  }
+
+  g_key_file_free (results);
+
+  if (encoded_frames != NULL) {
+    g_ptr_array_unref (encoded_frames);
+    gst_caps_unref (encoded_caps);
+  }
+
+  return ok ? 0 : 1;
+}
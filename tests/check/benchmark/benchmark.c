@@ -0,0 +1,164 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include "benchmark.h"
+
+static gint
+compare_gint64 (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return (x > y) - (x < y);
+}
+
+gint64
+benchmark_percentile (GArray * values, guint p)
+{
+  if (values->len == 0) {
+    return 0;
+  }
+
+  return g_array_index (values, gint64, (values->len - 1) * p / 100);
+}
+
+static void
+store_value (GKeyFile * results, const gchar * group, const gchar * prefix,
+    const gchar * stat, const gchar * unit, gint64 value)
+{
+  gchar *key = g_strdup_printf ("%s-%s-%s", prefix, stat, unit);
+
+  g_key_file_set_int64 (results, group, key, value);
+  g_free (key);
+}
+
+gint64
+benchmark_store_values (GKeyFile * results, const gchar * group,
+    const gchar * prefix, const gchar * unit, GArray * values)
+{
+  gint64 sum = 0;
+  guint i;
+
+  if (values->len == 0) {
+    return 0;
+  }
+
+  g_array_sort (values, compare_gint64);
+
+  for (i = 0; i < values->len; i++) {
+    sum += g_array_index (values, gint64, i);
+  }
+
+  store_value (results, group, prefix, "mean", unit, sum / values->len);
+  store_value (results, group, prefix, "p50", unit,
+      benchmark_percentile (values, 50));
+  store_value (results, group, prefix, "p99", unit,
+      benchmark_percentile (values, 99));
+  store_value (results, group, prefix, "max", unit,
+      benchmark_percentile (values, 100));
+
+  return sum;
+}
+
+gboolean
+benchmark_write_results (GKeyFile * results, const gchar * path)
+{
+  GError *err = NULL;
+  gboolean ok = TRUE;
+  gchar *data;
+
+  data = g_key_file_to_data (results, NULL, NULL);
+
+  if (path == NULL) {
+    g_print ("%s", data);
+  } else if (!g_file_set_contents (path, data, -1, &err)) {
+    g_printerr ("Cannot write %s: %s\n", path, err->message);
+    g_error_free (err);
+    ok = FALSE;
+  }
+
+  g_free (data);
+
+  return ok;
+}
+
+gboolean
+benchmark_check_baseline (GKeyFile * results, const gchar * path,
+    gdouble tolerance, BenchmarkMetricFunc is_checked)
+{
+  GKeyFile *baseline = g_key_file_new ();
+  GError *err = NULL;
+  gchar **groups;
+  gboolean ok = TRUE;
+  guint i, j;
+
+  if (!g_key_file_load_from_file (baseline, path, G_KEY_FILE_NONE, &err)) {
+    /* Baselines depend on the machine, record one with --output first */
+    g_printerr ("No baseline loaded from %s: %s\n", path, err->message);
+    g_error_free (err);
+    g_key_file_free (baseline);
+    return TRUE;
+  }
+
+  groups = g_key_file_get_groups (results, NULL);
+
+  for (i = 0; groups[i] != NULL; i++) {
+    gchar **keys;
+
+    if (!g_key_file_has_group (baseline, groups[i])) {
+      continue;
+    }
+
+    keys = g_key_file_get_keys (results, groups[i], NULL, NULL);
+
+    for (j = 0; keys[j] != NULL; j++) {
+      gboolean higher_is_better;
+      gint64 value, reference;
+      gdouble change;
+
+      if (!is_checked (keys[j], &higher_is_better) ||
+          !g_key_file_has_key (baseline, groups[i], keys[j], NULL)) {
+        continue;
+      }
+
+      value = g_key_file_get_int64 (results, groups[i], keys[j], NULL);
+      reference = g_key_file_get_int64 (baseline, groups[i], keys[j], NULL);
+
+      if (reference == 0) {
+        continue;
+      }
+
+      change = (gdouble) (value - reference) / reference;
+      if (higher_is_better) {
+        change = -change;
+      }
+
+      if (change > tolerance) {
+        g_printerr ("REGRESSION %s %s: %" G_GINT64_FORMAT " (baseline %"
+            G_GINT64_FORMAT ", %+.0f%%)\n", groups[i], keys[j], value,
+            reference, change * 100);
+        ok = FALSE;
+      }
+    }
+
+    g_strfreev (keys);
+  }
+
+  g_strfreev (groups);
+  g_key_file_free (baseline);
+
+  return ok;
+}
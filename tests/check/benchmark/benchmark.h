@@ -0,0 +1,55 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/*
+ * Helpers shared by the benchmark programs. Results are key files with one
+ * group per scenario and gint64 values.
+ */
+
+/* Tells if @key is checked against the baseline and in which direction */
+typedef gboolean (*BenchmarkMetricFunc) (const gchar * key,
+    gboolean * higher_is_better);
+
+/* @values must be sorted */
+gint64 benchmark_percentile (GArray * values, guint p);
+
+/*
+ * Sorts @values and stores their <prefix>-mean-<unit>, -p50-, -p99- and
+ * -max- in @group. Nothing is stored for an empty array. Returns the sum.
+ */
+gint64 benchmark_store_values (GKeyFile * results, const gchar * group,
+    const gchar * prefix, const gchar * unit, GArray * values);
+
+/* Writes @results to @path, or to stdout if NULL */
+gboolean benchmark_write_results (GKeyFile * results, const gchar * path);
+
+/*
+ * FALSE if any metric of @results is worse than in the baseline at @path
+ * by more than @tolerance. A missing baseline is not an error.
+ */
+gboolean benchmark_check_baseline (GKeyFile * results, const gchar * path,
+    gdouble tolerance, BenchmarkMetricFunc is_checked);
+
+G_END_DECLS
+#endif /* __BENCHMARK_H__ */
@@ -0,0 +1,703 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+/*
+ * Benchmark of the SDP offer/answer path. Every scenario runs a number of
+ * complete negotiations between two agents configured like a WebRtc call
+ * would be, and measures each phase on its own: creating the offer,
+ * serializing and parsing it, applying it on both sides and the same for
+ * the answer. Besides the time, the number of allocations done by each
+ * phase is counted, so regressions show up even on a noisy machine.
+ *
+ * Results are written as a key file, one group per scenario. When a
+ * baseline in the same format is given, the program fails if any metric
+ * is worse than the baseline by more than the tolerance.
+ */
+
+#include <gst/gst.h>
+#include <gst/sdp/gstsdpmessage.h>
+#include <glib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "kmssdpagent.h"
+#include "kmssdpmediahandler.h"
+#include "kmssdppayloadmanager.h"
+#include "kmssdpsctpmediahandler.h"
+#include "kmssdprtpavpmediahandler.h"
+#include "kmssdprtpavpfmediahandler.h"
+#include "kmssdprtpsavpfmediahandler.h"
+#include "kmssdpsdesext.h"
+#include "kmssdpulpfecext.h"
+#include "kmssdpredundantext.h"
+#include "kmssdpbundlegroup.h"
+
+#include "benchmark.h"
+
+#define OFFERER_ADDR "222.222.222.222"
+#define ANSWERER_ADDR "111.111.111.111"
+
+#define OFFER_KEY "1abcdefghijklmnopqrstuvwxyz01234567890ABCD"
+#define ANSWER_KEY "2abcdefghijklmnopqrstuvwxyz01234567890ABCD"
+
+typedef enum
+{
+  PHASE_SETUP,
+  PHASE_CREATE_OFFER,
+  PHASE_OFFER_AS_TEXT,
+  PHASE_OFFER_PARSE,
+  PHASE_SET_LOCAL_OFFER,
+  PHASE_SET_REMOTE_OFFER,
+  PHASE_CREATE_ANSWER,
+  PHASE_ANSWER_AS_TEXT,
+  PHASE_ANSWER_PARSE,
+  PHASE_SET_LOCAL_ANSWER,
+  PHASE_SET_REMOTE_ANSWER,
+  PHASE_TEARDOWN,
+  N_PHASES
+} Phase;
+
+static const gchar *phase_names[N_PHASES] = {
+  "setup",
+  "create-offer",
+  "offer-as-text",
+  "offer-parse",
+  "set-local-offer",
+  "set-remote-offer",
+  "create-answer",
+  "answer-as-text",
+  "answer-parse",
+  "set-local-answer",
+  "set-remote-answer",
+  "teardown",
+};
+
+typedef struct _Scenario
+{
+  const gchar *name;
+  gboolean many_codecs;
+  gboolean bundle;              /* audio, video and data in one group */
+  gboolean sdes;
+  gboolean fec;                 /* ulpfec and red on video */
+  gboolean renegotiate;         /* reuse the agents for every negotiation */
+} Scenario;
+
+static const Scenario scenarios[] = {
+  {"audio-video", FALSE, FALSE, FALSE, FALSE, FALSE},
+  {"bundle", TRUE, TRUE, FALSE, FALSE, FALSE},
+  {"bundle-sdes-fec", TRUE, TRUE, TRUE, TRUE, FALSE},
+  {"renegotiate", TRUE, TRUE, TRUE, TRUE, TRUE},
+};
+
+static const gchar *basic_audio_codecs[] = {
+  "opus/48000/2",
+  "PCMU/8000/1",
+};
+
+static const gchar *basic_video_codecs[] = {
+  "VP8/90000",
+  "H264/90000",
+};
+
+/* What a browser offers nowadays */
+static const gchar *audio_codecs[] = {
+  "opus/48000/2",
+  "ISAC/16000/1",
+  "ISAC/32000/1",
+  "G722/8000/1",
+  "PCMU/8000/1",
+  "PCMA/8000/1",
+  "AMR/8000/1",
+  "CN/32000/1",
+  "CN/16000/1",
+  "CN/8000/1",
+  "telephone-event/8000/1",
+};
+
+static const gchar *video_codecs[] = {
+  "VP8/90000",
+  "VP9/90000",
+  "H264/90000",
+  "H263-1998/90000",
+  "MP4V-ES/90000",
+};
+
+typedef struct _PhaseStats
+{
+  GArray *times;                /* ns */
+  guint64 allocs;
+  guint64 alloc_bytes;
+} PhaseStats;
+
+typedef struct _Bench
+{
+  const Scenario *scenario;
+  KmsSdpAgent *offerer;
+  KmsSdpAgent *answerer;
+  guint expected_medias;
+
+  PhaseStats phases[N_PHASES];
+  gint64 phase_start;
+  guint64 phase_allocs;
+  guint64 phase_alloc_bytes;
+
+  gsize offer_size;
+  gsize answer_size;
+} Bench;
+
+static gint n_iterations = 2000;
+static gint n_warmup = 100;
+static gchar *only_scenario = NULL;
+static gchar *output_file = NULL;
+static gchar *baseline_file = NULL;
+static gdouble tolerance = 0.25;
+
+static GOptionEntry entries[] = {
+  {"iterations", 'n', 0, G_OPTION_ARG_INT, &n_iterations,
+      "Negotiations measured on each scenario", "N"},
+  {"warmup", 'w', 0, G_OPTION_ARG_INT, &n_warmup,
+      "Negotiations done before measuring", "N"},
+  {"scenario", 's', 0, G_OPTION_ARG_STRING, &only_scenario,
+      "Run only this scenario", "NAME"},
+  {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output_file,
+      "Write the results to FILE instead of stdout", "FILE"},
+  {"baseline", 'b', 0, G_OPTION_ARG_FILENAME, &baseline_file,
+      "Fail on regressions against the results in FILE", "FILE"},
+  {"tolerance", 't', 0, G_OPTION_ARG_DOUBLE, &tolerance,
+      "Allowed relative regression (default 0.25)", "RATIO"},
+  {NULL}
+};
+
+/*
+ * Allocation counting. malloc and friends are interposed so every library
+ * in the process goes through them, and only allocations done by the
+ * calling thread are counted. GSlice keeps its own magazines, so the
+ * program runs with G_SLICE=always-malloc to see those too.
+ */
+#ifdef __GLIBC__
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t nmemb, size_t size);
+extern void *__libc_realloc (void *ptr, size_t size);
+extern void __libc_free (void *ptr);
+
+static __thread guint64 thread_allocs;
+static __thread guint64 thread_alloc_bytes;
+
+void *
+malloc (size_t size)
+{
+  thread_allocs++;
+  thread_alloc_bytes += size;
+
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t nmemb, size_t size)
+{
+  thread_allocs++;
+  thread_alloc_bytes += nmemb * size;
+
+  return __libc_calloc (nmemb, size);
+}
+
+void *
+realloc (void *ptr, size_t size)
+{
+  thread_allocs++;
+  thread_alloc_bytes += size;
+
+  return __libc_realloc (ptr, size);
+}
+
+void
+free (void *ptr)
+{
+  __libc_free (ptr);
+}
+
+#define ALLOCATIONS_COUNTED TRUE
+
+#else
+
+static guint64 thread_allocs;
+static guint64 thread_alloc_bytes;
+
+#define ALLOCATIONS_COUNTED FALSE
+
+#endif
+
+static gint64
+now_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+
+  return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+phase_begin (Bench * bench)
+{
+  bench->phase_allocs = thread_allocs;
+  bench->phase_alloc_bytes = thread_alloc_bytes;
+  bench->phase_start = now_ns ();
+}
+
+static void
+phase_end (Bench * bench, Phase phase, gboolean measure)
+{
+  gint64 elapsed = now_ns () - bench->phase_start;
+  guint64 allocs = thread_allocs - bench->phase_allocs;
+  guint64 alloc_bytes = thread_alloc_bytes - bench->phase_alloc_bytes;
+  PhaseStats *stats = &bench->phases[phase];
+
+  if (!measure) {
+    return;
+  }
+
+  g_array_append_val (stats->times, elapsed);
+  stats->allocs += allocs;
+  stats->alloc_bytes += alloc_bytes;
+}
+
+static GArray *
+on_offer_keys_cb (KmsSdpSdesExt * ext, gpointer data)
+{
+  GValue val = G_VALUE_INIT;
+  GArray *keys;
+
+  keys = g_array_sized_new (FALSE, FALSE, sizeof (GValue), 2);
+  g_array_set_clear_func (keys, (GDestroyNotify) g_value_unset);
+
+  kms_sdp_sdes_ext_create_key (1, OFFER_KEY,
+      KMS_SDES_EXT_AES_CM_128_HMAC_SHA1_80, &val);
+  g_array_append_val (keys, val);
+
+  memset (&val, 0, sizeof (val));
+  kms_sdp_sdes_ext_create_key (2, OFFER_KEY,
+      KMS_SDES_EXT_AES_CM_128_HMAC_SHA1_32, &val);
+  g_array_append_val (keys, val);
+
+  return keys;
+}
+
+static gboolean
+on_answer_keys_cb (KmsSdpSdesExt * ext, const GArray * keys, GValue * key,
+    gpointer data)
+{
+  SrtpCryptoSuite crypto;
+  guint tag;
+
+  if (keys->len == 0 ||
+      !kms_sdp_sdes_ext_get_parameters_from_key (&g_array_index (keys,
+              GValue, 0), KMS_SDES_TAG_FIELD, G_TYPE_UINT, &tag,
+          KMS_SDES_CRYPTO, G_TYPE_UINT, &crypto, NULL)) {
+    return FALSE;
+  }
+
+  return kms_sdp_sdes_ext_create_key (tag, ANSWER_KEY, crypto, key);
+}
+
+static gboolean
+on_offered_fec_cb (GObject * ext, guint pt, guint clock_rate, gpointer data)
+{
+  return TRUE;
+}
+
+static KmsSdpMediaHandler *
+rtp_handler_new (const Scenario * scenario, const gchar * media,
+    gboolean offerer)
+{
+  KmsSdpPayloadManager *ptmanager;
+  KmsSdpMediaHandler *handler;
+  const gchar **codecs;
+  GError *err = NULL;
+  guint i, n_codecs;
+
+  if (g_strcmp0 (media, "audio") == 0) {
+    codecs = scenario->many_codecs ? audio_codecs : basic_audio_codecs;
+    n_codecs = scenario->many_codecs ? G_N_ELEMENTS (audio_codecs) :
+        G_N_ELEMENTS (basic_audio_codecs);
+  } else {
+    codecs = scenario->many_codecs ? video_codecs : basic_video_codecs;
+    n_codecs = scenario->many_codecs ? G_N_ELEMENTS (video_codecs) :
+        G_N_ELEMENTS (basic_video_codecs);
+  }
+
+  if (scenario->sdes) {
+    handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_savpf_media_handler_new ());
+  } else {
+    handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_avpf_media_handler_new ());
+  }
+
+  ptmanager = kms_sdp_payload_manager_new ();
+  kms_sdp_rtp_avp_media_handler_use_payload_manager
+      (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler),
+      KMS_I_SDP_PAYLOAD_MANAGER (ptmanager), &err);
+  g_assert_no_error (err);
+
+  for (i = 0; i < n_codecs; i++) {
+    if (g_strcmp0 (media, "audio") == 0) {
+      kms_sdp_rtp_avp_media_handler_add_audio_codec
+          (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), codecs[i], &err);
+    } else {
+      kms_sdp_rtp_avp_media_handler_add_video_codec
+          (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), codecs[i], &err);
+    }
+    g_assert_no_error (err);
+  }
+
+  if (scenario->fec && g_strcmp0 (media, "video") == 0) {
+    kms_sdp_rtp_avp_media_handler_add_generic_video_payload
+        (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), "red/90000", &err);
+    g_assert_no_error (err);
+    kms_sdp_rtp_avp_media_handler_add_generic_video_payload
+        (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), "ulpfec/90000", &err);
+    g_assert_no_error (err);
+
+    if (!offerer) {
+      KmsSdpUlpFecExt *fec = kms_sdp_ulp_fec_ext_new ();
+      KmsSdpRedundantExt *red = kms_sdp_redundant_ext_new ();
+
+      g_signal_connect (fec, "on-offered-ulp-fec",
+          G_CALLBACK (on_offered_fec_cb), NULL);
+      g_signal_connect (red, "on-offered-redundancy",
+          G_CALLBACK (on_offered_fec_cb), NULL);
+      kms_sdp_media_handler_add_media_extension (handler,
+          KMS_I_SDP_MEDIA_EXTENSION (fec));
+      kms_sdp_media_handler_add_media_extension (handler,
+          KMS_I_SDP_MEDIA_EXTENSION (red));
+    }
+  }
+
+  if (scenario->sdes) {
+    KmsSdpSdesExt *ext = kms_sdp_sdes_ext_new ();
+
+    if (offerer) {
+      g_signal_connect (ext, "on-offer-keys", G_CALLBACK (on_offer_keys_cb),
+          NULL);
+    } else {
+      g_signal_connect (ext, "on-answer-keys",
+          G_CALLBACK (on_answer_keys_cb), NULL);
+    }
+
+    kms_sdp_media_handler_add_media_extension (handler,
+        KMS_I_SDP_MEDIA_EXTENSION (ext));
+  }
+
+  return handler;
+}
+
+static KmsSdpAgent *
+agent_new (const Scenario * scenario, gboolean offerer)
+{
+  const gchar *medias[] = { "audio", "video", "application" };
+  KmsSdpAgent *agent;
+  guint i, n_medias;
+  gint gid = -1;
+
+  agent = kms_sdp_agent_new ();
+  g_object_set (agent, "addr", offerer ? OFFERER_ADDR : ANSWERER_ADDR, NULL);
+
+  if (scenario->bundle) {
+    gid = kms_sdp_agent_create_group (agent, KMS_TYPE_SDP_BUNDLE_GROUP, NULL,
+        NULL);
+    g_assert (gid >= 0);
+  }
+
+  /* Data channels only make sense on a bundled WebRtc call */
+  n_medias = scenario->bundle ? 3 : 2;
+
+  for (i = 0; i < n_medias; i++) {
+    KmsSdpMediaHandler *handler;
+    gint hid;
+
+    if (g_strcmp0 (medias[i], "application") == 0) {
+      handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_sctp_media_handler_new ());
+    } else {
+      handler = rtp_handler_new (scenario, medias[i], offerer);
+    }
+
+    hid = kms_sdp_agent_add_proto_handler (agent, medias[i], handler, NULL);
+    g_assert (hid >= 0);
+
+    if (gid >= 0 && !kms_sdp_agent_group_add (agent, gid, hid, NULL)) {
+      g_error ("Cannot add %s to the bundle group", medias[i]);
+    }
+  }
+
+  return agent;
+}
+
+static void
+check_error (GError * err, const gchar * what)
+{
+  if (err == NULL) {
+    return;
+  }
+
+  g_error ("%s: %s", what, err->message);
+}
+
+static GstSDPMessage *
+parse (const gchar * text)
+{
+  GstSDPMessage *msg;
+
+  gst_sdp_message_new (&msg);
+  gst_sdp_message_parse_buffer ((const guint8 *) text, strlen (text), msg);
+
+  return msg;
+}
+
+static void
+negotiate (Bench * bench, gboolean measure)
+{
+  const Scenario *scenario = bench->scenario;
+  GstSDPMessage *offer, *answer, *remote;
+  GError *err = NULL;
+  gchar *text;
+
+  if (!scenario->renegotiate || bench->offerer == NULL) {
+    phase_begin (bench);
+    bench->offerer = agent_new (scenario, TRUE);
+    bench->answerer = agent_new (scenario, FALSE);
+    phase_end (bench, PHASE_SETUP, measure && !scenario->renegotiate);
+  }
+
+  phase_begin (bench);
+  offer = kms_sdp_agent_create_offer (bench->offerer, &err);
+  phase_end (bench, PHASE_CREATE_OFFER, measure);
+  check_error (err, "create offer");
+
+  phase_begin (bench);
+  text = gst_sdp_message_as_text (offer);
+  phase_end (bench, PHASE_OFFER_AS_TEXT, measure);
+  bench->offer_size = strlen (text);
+
+  phase_begin (bench);
+  remote = parse (text);
+  phase_end (bench, PHASE_OFFER_PARSE, measure);
+  g_free (text);
+
+  phase_begin (bench);
+  kms_sdp_agent_set_local_description (bench->offerer, offer, &err);
+  phase_end (bench, PHASE_SET_LOCAL_OFFER, measure);
+  check_error (err, "set local offer");
+  gst_sdp_message_free (offer);
+
+  /* The agent takes ownership of remote descriptions */
+  phase_begin (bench);
+  kms_sdp_agent_set_remote_description (bench->answerer, remote, &err);
+  phase_end (bench, PHASE_SET_REMOTE_OFFER, measure);
+  check_error (err, "set remote offer");
+
+  phase_begin (bench);
+  answer = kms_sdp_agent_create_answer (bench->answerer, &err);
+  phase_end (bench, PHASE_CREATE_ANSWER, measure);
+  check_error (err, "create answer");
+
+  if (gst_sdp_message_medias_len (answer) != bench->expected_medias) {
+    g_error ("Answer has %u medias, expected %u",
+        gst_sdp_message_medias_len (answer), bench->expected_medias);
+  }
+
+  phase_begin (bench);
+  text = gst_sdp_message_as_text (answer);
+  phase_end (bench, PHASE_ANSWER_AS_TEXT, measure);
+  bench->answer_size = strlen (text);
+
+  phase_begin (bench);
+  remote = parse (text);
+  phase_end (bench, PHASE_ANSWER_PARSE, measure);
+  g_free (text);
+
+  phase_begin (bench);
+  kms_sdp_agent_set_local_description (bench->answerer, answer, &err);
+  phase_end (bench, PHASE_SET_LOCAL_ANSWER, measure);
+  check_error (err, "set local answer");
+  gst_sdp_message_free (answer);
+
+  phase_begin (bench);
+  kms_sdp_agent_set_remote_description (bench->offerer, remote, &err);
+  phase_end (bench, PHASE_SET_REMOTE_ANSWER, measure);
+  check_error (err, "set remote answer");
+
+  if (!scenario->renegotiate) {
+    phase_begin (bench);
+    g_clear_object (&bench->offerer);
+    g_clear_object (&bench->answerer);
+    phase_end (bench, PHASE_TEARDOWN, measure);
+  }
+}
+
+static gint64
+store_phase (GKeyFile * results, const gchar * group, const gchar * name,
+    PhaseStats * stats)
+{
+  GArray *values = stats->times;
+  gint64 sum;
+  gchar *key;
+
+  if (values->len == 0) {
+    return 0;
+  }
+
+  sum = benchmark_store_values (results, group, name, "ns", values);
+
+  if (ALLOCATIONS_COUNTED) {
+    key = g_strdup_printf ("%s-allocs", name);
+    g_key_file_set_int64 (results, group, key, stats->allocs / values->len);
+    g_free (key);
+
+    key = g_strdup_printf ("%s-alloc-bytes", name);
+    g_key_file_set_int64 (results, group, key,
+        stats->alloc_bytes / values->len);
+    g_free (key);
+  }
+
+  return sum;
+}
+
+static void
+run_scenario (const Scenario * scenario, GKeyFile * results)
+{
+  Bench bench;
+  gint64 start, elapsed, offer_ns = 0, answer_ns = 0;
+  gint n;
+  guint i;
+
+  memset (&bench, 0, sizeof (bench));
+  bench.scenario = scenario;
+  bench.expected_medias = scenario->bundle ? 3 : 2;
+
+  for (i = 0; i < N_PHASES; i++) {
+    bench.phases[i].times = g_array_sized_new (FALSE, FALSE, sizeof (gint64),
+        n_iterations);
+  }
+
+  for (n = 0; n < n_warmup; n++) {
+    negotiate (&bench, FALSE);
+  }
+
+  start = now_ns ();
+  for (n = 0; n < n_iterations; n++) {
+    negotiate (&bench, TRUE);
+  }
+  elapsed = now_ns () - start;
+
+  g_clear_object (&bench.offerer);
+  g_clear_object (&bench.answerer);
+
+  g_key_file_set_int64 (results, scenario->name, "negotiations-per-second",
+      elapsed > 0 ? (gint64) n_iterations * 1000000000 / elapsed : 0);
+
+  for (i = 0; i < N_PHASES; i++) {
+    gint64 sum;
+
+    sum = store_phase (results, scenario->name, phase_names[i],
+        &bench.phases[i]);
+
+    if (i == PHASE_CREATE_OFFER) {
+      offer_ns = sum;
+    } else if (i == PHASE_CREATE_ANSWER) {
+      answer_ns = sum;
+    }
+  }
+
+  g_key_file_set_int64 (results, scenario->name, "offers-per-second",
+      offer_ns > 0 ? (gint64) n_iterations * 1000000000 / offer_ns : 0);
+  g_key_file_set_int64 (results, scenario->name, "answers-per-second",
+      answer_ns > 0 ? (gint64) n_iterations * 1000000000 / answer_ns : 0);
+  g_key_file_set_int64 (results, scenario->name, "offer-size-bytes",
+      bench.offer_size);
+  g_key_file_set_int64 (results, scenario->name, "answer-size-bytes",
+      bench.answer_size);
+
+  for (i = 0; i < N_PHASES; i++) {
+    g_array_free (bench.phases[i].times, TRUE);
+  }
+}
+
+/* Metrics checked against the baseline, the rest are informative */
+static gboolean
+is_checked_metric (const gchar * key, gboolean * higher_is_better)
+{
+  *higher_is_better = g_str_has_suffix (key, "-per-second");
+
+  return *higher_is_better || g_str_has_suffix (key, "-p50-ns") ||
+      g_str_has_suffix (key, "-p99-ns") || g_str_has_suffix (key, "-allocs");
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *context;
+  GKeyFile *results;
+  GError *err = NULL;
+  const gchar *slice;
+  gboolean ok;
+  guint i;
+
+  /* GSlice reads its configuration when glib is loaded, restart with it */
+  slice = g_getenv ("G_SLICE");
+  if (ALLOCATIONS_COUNTED && (slice == NULL ||
+          strstr (slice, "always-malloc") == NULL)) {
+    g_setenv ("G_SLICE", "always-malloc", TRUE);
+    execv ("/proc/self/exe", argv);
+    g_printerr ("Cannot restart with G_SLICE=always-malloc, slice "
+        "allocations are not counted\n");
+  }
+
+  context = g_option_context_new ("- SDP agent benchmark");
+  g_option_context_add_main_entries (context, entries, NULL);
+  g_option_context_add_group (context, gst_init_get_option_group ());
+
+  if (!g_option_context_parse (context, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_error_free (err);
+    return 1;
+  }
+  g_option_context_free (context);
+
+  results = g_key_file_new ();
+  g_key_file_set_integer (results, "benchmark", "iterations", n_iterations);
+
+  for (i = 0; i < G_N_ELEMENTS (scenarios); i++) {
+    if (only_scenario != NULL && g_strcmp0 (only_scenario,
+            scenarios[i].name) != 0) {
+      continue;
+    }
+
+    run_scenario (&scenarios[i], results);
+  }
+
+  ok = benchmark_write_results (results, output_file);
+
+  if (baseline_file != NULL) {
+    ok &= benchmark_check_baseline (results, baseline_file, tolerance,
+        is_checked_metric);
+  }
+
+  g_key_file_free (results);
+
+  return ok ? 0 : 1;
+}
@@ -1392,6 +1392,237 @@ GST_START_TEST (test_codec_config_openh264)
   test_codec_config (pipeline_str, config_str, codec_name, agnostic_name);
 }
 
+GST_END_TEST;
+
+GST_START_TEST (bitrate_tiers_property)
+{
+  GstElement *agnosticbin = gst_element_factory_make ("agnosticbin", NULL);
+  gchar *tiers;
+
+  g_object_get (agnosticbin, "bitrate-tiers", &tiers, NULL);
+  fail_unless (tiers == NULL);
+
+  /* Tiers are sorted, duplicated and invalid values are discarded */
+  g_object_set (agnosticbin, "bitrate-tiers",
+      "1000000, 300000,invalid,-5,300000", NULL);
+  g_object_get (agnosticbin, "bitrate-tiers", &tiers, NULL);
+  fail_unless (g_strcmp0 (tiers, "300000,1000000") == 0);
+  g_free (tiers);
+
+  g_object_set (agnosticbin, "bitrate-tiers", NULL, NULL);
+  g_object_get (agnosticbin, "bitrate-tiers", &tiers, NULL);
+  fail_unless (tiers == NULL);
+
+  g_object_unref (agnosticbin);
+}
+
+GST_END_TEST;
+
+static void
+fakesink_hand_off_first (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer data)
+{
+  GMainLoop *loop = (GMainLoop *) data;
+
+  g_object_set (G_OBJECT (fakesink), "signal-handoffs", FALSE, NULL);
+  g_idle_add (quit_main_loop_idle, loop);
+}
+
+/* Bitrate tier of the encoder feeding the agnosticbin pad linked to @sink */
+static gint
+get_output_tier (GstElement * sink)
+{
+  GstPad *sink_pad, *src_pad, *target, *queue_sink, *tee_src;
+  GstElement *queue, *tee;
+  GstObject *enc_bin;
+  gint tier;
+
+  sink_pad = gst_element_get_static_pad (sink, "sink");
+  src_pad = gst_pad_get_peer (sink_pad);
+  target = gst_ghost_pad_get_target (GST_GHOST_PAD (src_pad));
+  fail_unless (target != NULL);
+
+  queue = gst_pad_get_parent_element (target);
+  queue_sink = gst_element_get_static_pad (queue, "sink");
+  tee_src = gst_pad_get_peer (queue_sink);
+  tee = gst_pad_get_parent_element (tee_src);
+  enc_bin = gst_object_get_parent (GST_OBJECT (tee));
+
+  tier = GPOINTER_TO_INT (g_object_get_qdata (G_OBJECT (enc_bin),
+          g_quark_from_string ("kms-bitrate-tier"))) - 1;
+
+  g_object_unref (enc_bin);
+  g_object_unref (tee);
+  g_object_unref (tee_src);
+  g_object_unref (queue_sink);
+  g_object_unref (queue);
+  g_object_unref (target);
+  g_object_unref (src_pad);
+  g_object_unref (sink_pad);
+
+  return tier;
+}
+
+static gint
+send_remb (GstElement * sink, guint bitrate)
+{
+  GstPad *sink_pad = gst_element_get_static_pad (sink, "sink");
+  GstEvent *event;
+
+  event = gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
+      gst_structure_new ("REMB", "bitrate", G_TYPE_UINT, bitrate, "ssrc",
+          G_TYPE_UINT, 1, NULL));
+  gst_pad_push_event (sink_pad, event);
+  g_object_unref (sink_pad);
+
+  /* Tier is switched synchronously while the event goes upstream */
+  return get_output_tier (sink);
+}
+
+GST_START_TEST (bitrate_tiers_switch)
+{
+  GstElement *pipeline, *agnosticbin, *capsfilter, *fakesink;
+  GstBus *bus;
+
+  pipeline = gst_parse_launch ("videotestsrc is-live=true "
+      "! agnosticbin name=ag bitrate-tiers=500000,1000000 "
+      "bitrate-tier-switch-interval=0 "
+      "! capsfilter name=caps caps=video/x-vp8 "
+      "! fakesink async=true sync=true name=sink signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  loop = g_main_loop_new (NULL, TRUE);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  agnosticbin = gst_bin_get_by_name (GST_BIN (pipeline), "ag");
+  capsfilter = gst_bin_get_by_name (GST_BIN (pipeline), "caps");
+  fakesink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (G_OBJECT (fakesink), "handoff",
+      G_CALLBACK (fakesink_hand_off_first), loop);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+
+  /* Default target bitrate is below the first boundary */
+  fail_unless (get_output_tier (capsfilter) == 0);
+
+  /* Going up needs 10% over the lower bound of the new tier */
+  fail_unless (send_remb (capsfilter, 1200000) == 2);
+  /* Going down needs 10% under the lower bound of the current tier */
+  fail_unless (send_remb (capsfilter, 950000) == 2);
+  fail_unless (send_remb (capsfilter, 850000) == 1);
+  fail_unless (send_remb (capsfilter, 1050000) == 1);
+  fail_unless (send_remb (capsfilter, 100000) == 0);
+  fail_unless (send_remb (capsfilter, 520000) == 0);
+  fail_unless (send_remb (capsfilter, 600000) == 1);
+
+  /* Switches are delayed until the interval since the last one passes */
+  g_object_set (agnosticbin, "bitrate-tier-switch-interval", 60000, NULL);
+  fail_unless (send_remb (capsfilter, 1200000) == 1);
+  g_object_set (agnosticbin, "bitrate-tier-switch-interval", 0, NULL);
+  fail_unless (send_remb (capsfilter, 1200000) == 2);
+
+  g_object_unref (agnosticbin);
+  g_object_unref (capsfilter);
+  g_object_unref (fakesink);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+
+GST_END_TEST;
+
+static gint
+get_output_height (GstElement * sink)
+{
+  GstPad *sink_pad = gst_element_get_static_pad (sink, "sink");
+  GstCaps *caps = gst_pad_get_current_caps (sink_pad);
+  gint height = 0;
+
+  if (caps != NULL) {
+    gst_structure_get_int (gst_caps_get_structure (caps, 0), "height",
+        &height);
+    gst_caps_unref (caps);
+  }
+
+  g_object_unref (sink_pad);
+
+  return height;
+}
+
+/* Polls the output caps, renegotiation happens on the streaming thread */
+static gboolean
+wait_output_height (GstElement * sink, gint height, gint64 timeout_ms)
+{
+  gint64 end = g_get_monotonic_time () + timeout_ms * G_TIME_SPAN_MILLISECOND;
+
+  do {
+    if (get_output_height (sink) == height) {
+      return TRUE;
+    }
+    g_usleep (10 * G_TIME_SPAN_MILLISECOND);
+  } while (g_get_monotonic_time () < end);
+
+  return FALSE;
+}
+
+GST_START_TEST (bitrate_ladder)
+{
+  GstElement *pipeline, *capsfilter, *fakesink;
+  GstBus *bus;
+
+  pipeline = gst_parse_launch ("videotestsrc is-live=true "
+      "! video/x-raw,width=640,height=480,framerate=30/1 ! agnosticbin "
+      "! capsfilter name=caps caps=video/x-vp8 "
+      "! fakesink async=true sync=true name=sink signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  loop = g_main_loop_new (NULL, TRUE);
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  capsfilter = gst_bin_get_by_name (GST_BIN (pipeline), "caps");
+  fakesink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (G_OBJECT (fakesink), "handoff",
+      G_CALLBACK (fakesink_hand_off_first), loop);
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+
+  /* Step down to the lowest resolution */
+  send_remb (capsfilter, 100000);
+  fail_unless (wait_output_height (fakesink, 180, 5000));
+
+  /* Not enough over the 240p minimum to step up */
+  send_remb (capsfilter, 140000);
+  fail_if (wait_output_height (fakesink, 240, 1000));
+
+  send_remb (capsfilter, 150000);
+  fail_unless (wait_output_height (fakesink, 240, 5000));
+
+  /* Back to the input resolution, no limit above 1 Mbps */
+  send_remb (capsfilter, 2000000);
+  fail_unless (wait_output_height (fakesink, 480, 5000));
+
+  send_remb (capsfilter, 300000);
+  fail_unless (wait_output_height (fakesink, 360, 5000));
+
+  g_object_unref (capsfilter);
+  g_object_unref (fakesink);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+
 GST_END_TEST;
 /*
  * End of test cases
@@ -1429,6 +1660,10 @@ agnostic2_suite (void)
   tcase_add_test (tc_chain, test_raw_to_rtp);
   tcase_add_test (tc_chain, test_codec_to_rtp);
 
+  tcase_add_test (tc_chain, bitrate_tiers_property);
+  tcase_add_test (tc_chain, bitrate_tiers_switch);
+  tcase_add_test (tc_chain, bitrate_ladder);
+
   return s;
 }
 
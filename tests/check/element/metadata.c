@@ -24,6 +24,7 @@
 #include <time.h>
 
 #include "kmsbufferlacentymeta.h"
+#include "kmsstats.h"
 
 #define KMS_FACTORY_MAKE_IF_AVAILABLE(factory_name) ({      \
   GstElement *_element;                                     \
@@ -416,6 +417,172 @@ GST_START_TEST (check_metadata_enc)
   }
 }
 
+GST_END_TEST;
+
+typedef struct _TestMark
+{
+  KmsRefStruct ref;
+  gboolean *freed;
+} TestMark;
+
+static void
+test_mark_destroy (TestMark * mark)
+{
+  *mark->freed = TRUE;
+  g_slice_free (TestMark, mark);
+}
+
+static void
+count_marks (GQuark id, KmsRefStruct * data, gpointer user_data)
+{
+  (*(guint *) user_data)++;
+}
+
+GST_START_TEST (check_latency_marks)
+{
+  GQuark id1 = g_quark_from_static_string ("mark-1");
+  GQuark id2 = g_quark_from_static_string ("mark-2");
+  KmsBufferLatencyMeta *meta, *copy_meta;
+  GstBuffer *buffer, *copy;
+  gboolean freed = FALSE;
+  TestMark *mark;
+  guint count = 0, i;
+
+  mark = g_slice_new0 (TestMark);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (mark),
+      (GDestroyNotify) test_mark_destroy);
+  mark->freed = &freed;
+
+  buffer = gst_buffer_new ();
+  meta = kms_buffer_add_buffer_latency_meta (buffer, 0, TRUE, 0);
+
+  fail_unless (kms_buffer_latency_meta_lookup_mark (meta, id1) == NULL);
+  fail_unless (kms_buffer_latency_meta_add_mark (meta, id1,
+          KMS_REF_STRUCT_CAST (mark)));
+  fail_unless (kms_buffer_latency_meta_lookup_mark (meta, id1) ==
+      KMS_REF_STRUCT_CAST (mark));
+  fail_unless (kms_buffer_latency_meta_lookup_mark (meta, id2) == NULL);
+
+  /* Marks are copied along with the buffer */
+  copy = gst_buffer_copy (buffer);
+  copy_meta = kms_buffer_get_buffer_latency_meta (copy);
+  fail_unless (kms_buffer_latency_meta_lookup_mark (copy_meta, id1) ==
+      KMS_REF_STRUCT_CAST (mark));
+
+  /* Marks beyond the inline ones are kept too */
+  for (i = 1; i < 2 * KMS_BUFFER_LATENCY_META_MAX_MARKS; i++) {
+    gchar *name = g_strdup_printf ("mark-extra-%u", i);
+
+    fail_unless (kms_buffer_latency_meta_add_mark (meta,
+            g_quark_from_string (name), KMS_REF_STRUCT_CAST (mark)));
+    g_free (name);
+  }
+  fail_unless (kms_buffer_latency_meta_add_mark (meta, id2,
+          KMS_REF_STRUCT_CAST (mark)));
+  fail_unless (kms_buffer_latency_meta_lookup_mark (meta, id2) ==
+      KMS_REF_STRUCT_CAST (mark));
+
+  kms_buffer_latency_meta_foreach_mark (meta, count_marks, &count);
+  fail_unless (count == 2 * KMS_BUFFER_LATENCY_META_MAX_MARKS + 1);
+
+  gst_buffer_unref (copy);
+  copy = gst_buffer_copy (buffer);
+  copy_meta = kms_buffer_get_buffer_latency_meta (copy);
+  fail_unless (kms_buffer_latency_meta_lookup_mark (copy_meta, id2) ==
+      KMS_REF_STRUCT_CAST (mark));
+
+  gst_buffer_unref (buffer);
+  gst_buffer_unref (copy);
+
+  fail_if (freed);
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (mark));
+  fail_unless (freed);
+}
+
+GST_END_TEST;
+
+static void
+legacy_latency_cb (GstPad * pad, KmsMediaType type, GstClockTimeDiff t,
+    KmsList * data, gpointer user_data)
+{
+  TestMark *mark = user_data;
+
+  fail_unless (kms_list_lookup (data, "mark-1") != NULL);
+  kms_list_append (data, g_strdup ("mark-legacy"),
+      kms_ref_struct_ref (KMS_REF_STRUCT_CAST (mark)));
+}
+
+static GstFlowReturn
+drop_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST (check_latency_legacy_callback)
+{
+  GQuark id1 = g_quark_from_static_string ("mark-1");
+  GstPad *srcpad, *sinkpad;
+  KmsBufferLatencyMeta *meta;
+  gboolean freed = FALSE;
+  GstSegment segment;
+  GstBuffer *buffer;
+  TestMark *mark;
+
+  mark = g_slice_new0 (TestMark);
+  kms_ref_struct_init (KMS_REF_STRUCT_CAST (mark),
+      (GDestroyNotify) test_mark_destroy);
+  mark->freed = &freed;
+
+  srcpad = gst_pad_new ("src", GST_PAD_SRC);
+  sinkpad = gst_pad_new ("sink", GST_PAD_SINK);
+  gst_pad_set_chain_function (sinkpad, drop_chain);
+  fail_unless (gst_pad_link (srcpad, sinkpad) == GST_PAD_LINK_OK);
+  gst_pad_set_active (sinkpad, TRUE);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("test"));
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  /* Old callbacks still see the marks as a list and can add new ones */
+  kms_stats_add_buffer_latency_notification_probe (srcpad, legacy_latency_cb,
+      TRUE, mark, NULL);
+
+  buffer = gst_buffer_new ();
+  meta = kms_buffer_add_buffer_latency_meta (buffer, 0, TRUE, 0);
+  kms_buffer_latency_meta_add_mark (meta, id1, KMS_REF_STRUCT_CAST (mark));
+
+  gst_buffer_ref (buffer);
+  fail_unless (gst_pad_push (srcpad, buffer) == GST_FLOW_OK);
+  fail_unless (kms_buffer_latency_meta_lookup_mark (meta,
+          g_quark_from_string ("mark-legacy")) == KMS_REF_STRUCT_CAST (mark));
+  gst_buffer_unref (buffer);
+
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  g_object_unref (srcpad);
+  g_object_unref (sinkpad);
+
+  kms_ref_struct_unref (KMS_REF_STRUCT_CAST (mark));
+  fail_unless (freed);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (check_element_latency_mark)
+{
+  GstElement *element = gst_element_factory_make ("fakesink", "mark-element");
+  GQuark mark;
+
+  /* Interned once and kept in the element */
+  mark = kms_stats_get_element_latency_mark (element);
+  fail_unless (mark == g_quark_try_string ("mark-element"));
+  fail_unless (kms_stats_get_element_latency_mark (element) == mark);
+
+  g_object_unref (element);
+}
+
 GST_END_TEST
 /******************************/
 /* metadata test suite        */
@@ -429,6 +596,9 @@ metadata_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, check_metadata_enc);
+  tcase_add_test (tc_chain, check_latency_marks);
+  tcase_add_test (tc_chain, check_latency_legacy_callback);
+  tcase_add_test (tc_chain, check_element_latency_mark);
 
   return s;
 }
@@ -0,0 +1,193 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+
+#define N_BUFFERS 1000
+#define BUFFER_SIZE 1000
+
+static GMainLoop *loop;
+
+static void
+bus_msg (GstBus * bus, GstMessage * msg, gpointer pipe)
+{
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GST_ERROR ("Error: %" GST_PTR_FORMAT, msg);
+      fail ("Error received on bus");
+      break;
+    }
+    case GST_MESSAGE_EOS:{
+      g_main_loop_quit (loop);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void
+check_order (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer data)
+{
+  static guint64 last_offset = 0;
+  guint *inversions = data;
+
+  if (GST_BUFFER_OFFSET (buf) < last_offset) {
+    (*inversions)++;
+  }
+
+  last_offset = GST_BUFFER_OFFSET (buf);
+}
+
+static GstStructure *
+run_pipeline (GstElement * impairment, guint n_buffers, gint64 * elapsed,
+    guint * inversions)
+{
+  GstElement *pipeline = gst_pipeline_new (__FUNCTION__);
+  GstElement *fakesrc = gst_element_factory_make ("fakesrc", NULL);
+  GstElement *fakesink = gst_element_factory_make ("fakesink", NULL);
+  GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  GstStructure *stats;
+  gint64 start;
+
+  loop = g_main_loop_new (NULL, TRUE);
+
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  g_object_set (fakesrc, "num-buffers", n_buffers, "sizetype", 2,
+      "sizemax", BUFFER_SIZE, NULL);
+  g_object_set (fakesink, "sync", FALSE, "async", FALSE, NULL);
+
+  if (inversions != NULL) {
+    g_object_set (fakesink, "signal-handoffs", TRUE, NULL);
+    g_signal_connect (fakesink, "handoff", G_CALLBACK (check_order),
+        inversions);
+  }
+
+  gst_bin_add_many (GST_BIN (pipeline), fakesrc, impairment, fakesink, NULL);
+  fail_unless (gst_element_link_many (fakesrc, impairment, fakesink, NULL));
+
+  start = g_get_monotonic_time ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+
+  if (elapsed != NULL) {
+    *elapsed = g_get_monotonic_time () - start;
+  }
+
+  g_object_get (impairment, "stats", &stats, NULL);
+  GST_INFO ("Stats: %" GST_PTR_FORMAT, stats);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_main_loop_unref (loop);
+
+  return stats;
+}
+
+GST_START_TEST (loss)
+{
+  GstElement *impairment = gst_element_factory_make ("netimpairment", NULL);
+  GstStructure *stats;
+  guint64 received, lost, burst_lost, sent;
+
+  g_object_set (impairment, "loss", 0.2, "burst-loss", 0.02, "burst-length",
+      10, "max-queue", 0, "seed", 1, NULL);
+
+  stats = run_pipeline (impairment, N_BUFFERS, NULL, NULL);
+
+  gst_structure_get (stats, "received", G_TYPE_UINT64, &received, "lost",
+      G_TYPE_UINT64, &lost, "burst-lost", G_TYPE_UINT64, &burst_lost, "sent",
+      G_TYPE_UINT64, &sent, NULL);
+
+  fail_unless (received == N_BUFFERS);
+  fail_unless (lost + burst_lost + sent == N_BUFFERS);
+  fail_unless (lost > 0);
+  fail_unless (burst_lost > 0);
+  fail_unless (sent > N_BUFFERS / 2);
+
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (delay_and_bandwidth)
+{
+  GstElement *impairment = gst_element_factory_make ("netimpairment", NULL);
+  GstStructure *stats;
+  guint64 sent;
+  gint64 elapsed;
+
+  /* 10 ms per buffer on the wire, plus 100 ms of delay */
+  g_object_set (impairment, "delay", 100, "bandwidth", BUFFER_SIZE * 8 * 100,
+      NULL);
+
+  stats = run_pipeline (impairment, 20, &elapsed, NULL);
+
+  gst_structure_get (stats, "sent", G_TYPE_UINT64, &sent, NULL);
+  fail_unless (sent == 20);
+  fail_unless (elapsed >= 300 * G_TIME_SPAN_MILLISECOND,
+      "Elapsed only %" G_GINT64_FORMAT " us", elapsed);
+
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (reorder)
+{
+  GstElement *impairment = gst_element_factory_make ("netimpairment", NULL);
+  GstStructure *stats;
+  guint64 reordered, sent;
+  guint inversions = 0;
+
+  g_object_set (impairment, "delay", 20, "reorder", 0.2, "max-queue", 0,
+      "seed", 1, NULL);
+
+  stats = run_pipeline (impairment, 200, NULL, &inversions);
+
+  gst_structure_get (stats, "reordered", G_TYPE_UINT64, &reordered, "sent",
+      G_TYPE_UINT64, &sent, NULL);
+  fail_unless (sent == 200);
+  fail_unless (reordered > 0);
+  fail_unless (inversions > 0);
+
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+static Suite *
+netimpairment_suite (void)
+{
+  Suite *s = suite_create ("netimpairment");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, loss);
+  tcase_add_test (tc_chain, delay_and_bandwidth);
+  tcase_add_test (tc_chain, reorder);
+
+  return s;
+}
+
+GST_CHECK_MAIN (netimpairment);
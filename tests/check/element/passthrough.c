@@ -26,6 +26,10 @@ G_DEFINE_QUARK (VIDEO_SINK, video_sink);
 
 #define BITRATE 500000
 
+/* Must match the media flow timer wheel of KmsElement */
+#define MEDIA_FLOW_INTERNAL_TIME_MSEC 2000
+#define MEDIA_FLOW_WHEEL_TICK_MSEC (MEDIA_FLOW_INTERNAL_TIME_MSEC / 8)
+
 static gboolean
 quit_main_loop_idle (gpointer data)
 {
@@ -306,6 +310,96 @@ GST_START_TEST (check_bitrate)
 }
 
 GST_END_TEST;
+
+typedef struct _FlowData
+{
+  GMainLoop *loop;
+  GstPad *src_pad;
+  gulong block_id;
+  gint64 flowing_time;
+  gint64 not_flowing_time;
+  guint flowing_count;
+  guint not_flowing_count;
+} FlowData;
+
+static GstPadProbeReturn
+block_src (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+flow_in_media_cb (GstElement * element, gboolean flowing, gchar * pad_name,
+    KmsElementPadType type, FlowData * data)
+{
+  GST_DEBUG_OBJECT (element, "Flowing %d in %s", flowing, pad_name);
+
+  if (flowing) {
+    data->flowing_count++;
+    data->flowing_time = g_get_monotonic_time ();
+    /* Stop the media right after the first buffer */
+    data->block_id = gst_pad_add_probe (data->src_pad,
+        GST_PAD_PROBE_TYPE_BLOCK_DOWNSTREAM, block_src, NULL, NULL);
+  } else {
+    data->not_flowing_count++;
+    data->not_flowing_time = g_get_monotonic_time ();
+    g_idle_add (quit_main_loop_idle, data->loop);
+  }
+}
+
+GST_START_TEST (check_media_flow_wheel)
+{
+  GMainLoop *loop = g_main_loop_new (NULL, TRUE);
+  GstElement *pipeline = gst_pipeline_new (__FUNCTION__);
+  GstElement *videotestsrc = gst_element_factory_make ("videotestsrc", NULL);
+  GstElement *fakesink = gst_element_factory_make ("fakesink", NULL);
+  GstElement *passthrough = gst_element_factory_make ("passthrough", NULL);
+  FlowData data = { NULL, };
+  gint64 elapsed;
+
+  data.loop = loop;
+  data.src_pad = gst_element_get_static_pad (videotestsrc, "src");
+
+  g_object_set (G_OBJECT (videotestsrc), "is-live", TRUE, NULL);
+  g_object_set (G_OBJECT (fakesink), "async", FALSE, NULL);
+
+  g_object_set_qdata (G_OBJECT (passthrough), video_sink_quark (), fakesink);
+  g_signal_connect (passthrough, "pad-added",
+      G_CALLBACK (on_pad_added_cb), NULL);
+  g_signal_connect (passthrough, "flow-in-media",
+      G_CALLBACK (flow_in_media_cb), &data);
+
+  gst_bin_add_many (GST_BIN (pipeline), passthrough, fakesink, NULL);
+  fail_unless (kms_element_request_srcpad (passthrough,
+          KMS_ELEMENT_PAD_TYPE_VIDEO));
+  fail_if (!connect_sink_async (passthrough, videotestsrc, pipeline,
+          "sink_video_default"));
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+
+  fail_unless (data.flowing_count == 1);
+  fail_unless (data.not_flowing_count == 1);
+
+  /* Every flow is checked once per wheel turn, so media stopping is
+   * detected after one or two turns, give or take a tick */
+  elapsed = (data.not_flowing_time - data.flowing_time) /
+      G_TIME_SPAN_MILLISECOND;
+  GST_DEBUG ("Not flowing detected after %" G_GINT64_FORMAT " ms", elapsed);
+  fail_unless (elapsed >= MEDIA_FLOW_INTERNAL_TIME_MSEC -
+      MEDIA_FLOW_WHEEL_TICK_MSEC);
+  fail_unless (elapsed <= 2 * MEDIA_FLOW_INTERNAL_TIME_MSEC +
+      MEDIA_FLOW_WHEEL_TICK_MSEC);
+
+  gst_pad_remove_probe (data.src_pad, data.block_id);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (data.src_pad);
+  g_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+
+GST_END_TEST;
+
 /* Suite initialization */
 static Suite *
 passthrough_suite (void)
@@ -317,6 +411,7 @@ passthrough_suite (void)
 
   tcase_add_test (tc_chain, check_connecion);
   tcase_add_test (tc_chain, check_bitrate);
+  tcase_add_test (tc_chain, check_media_flow_wheel);
 
   return s;
 }
@@ -0,0 +1,162 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include "../../src/gst-plugins/commons/kmselementpadtype.h"
+
+#define KMS_VIDEO_PREFIX "video_src_"
+
+#define VIDEO_SINK "video-sink"
+G_DEFINE_QUARK (VIDEO_SINK, video_sink);
+
+/* The tracer is enabled for this binary only, it instruments every pad */
+static void set_tracers (void) __attribute__ ((constructor));
+
+static void
+set_tracers (void)
+{
+  /* Tracers are instantiated by gst_init */
+  g_setenv ("GST_TRACERS", "kmsproctime", TRUE);
+}
+
+static gboolean
+quit_main_loop_idle (gpointer data)
+{
+  GMainLoop *loop = data;
+
+  g_main_loop_quit (loop);
+  return FALSE;
+}
+
+static void
+fakesink_hand_off (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer data)
+{
+  static int count = 0;
+  GMainLoop *loop = (GMainLoop *) data;
+
+  if (count++ > 40) {
+    g_object_set (G_OBJECT (fakesink), "signal-handoffs", FALSE, NULL);
+    g_idle_add (quit_main_loop_idle, loop);
+  }
+}
+
+static gboolean
+kms_element_request_srcpad (GstElement * src, KmsElementPadType pad_type)
+{
+  gchar *padname;
+  gboolean ret;
+
+  g_signal_emit_by_name (src, "request-new-pad", pad_type, NULL, GST_PAD_SRC,
+      &padname);
+  ret = padname != NULL;
+  g_free (padname);
+
+  return ret;
+}
+
+static void
+on_pad_added_cb (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  GstElement *sink;
+  GstPad *sinkpad;
+
+  if (gst_pad_get_direction (pad) != GST_PAD_SRC ||
+      !g_str_has_prefix (GST_PAD_NAME (pad), KMS_VIDEO_PREFIX)) {
+    return;
+  }
+
+  sink = g_object_get_qdata (G_OBJECT (element), video_sink_quark ());
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_link (pad, sinkpad);
+  g_object_unref (sinkpad);
+  gst_element_sync_state_with_parent (sink);
+}
+
+GST_START_TEST (check_processing_time)
+{
+  GMainLoop *loop = g_main_loop_new (NULL, TRUE);
+  GstElement *pipeline = gst_pipeline_new (__FUNCTION__);
+  GstElement *videotestsrc = gst_element_factory_make ("videotestsrc", NULL);
+  GstElement *fakesink = gst_element_factory_make ("fakesink", NULL);
+  GstElement *passthrough = gst_element_factory_make ("passthrough", NULL);
+  const GstStructure *e_stats, *p_stats, *element_stats;
+  GstStructure *stats = NULL;
+  guint64 buffers = 0;
+
+  g_object_set (G_OBJECT (videotestsrc), "is-live", TRUE, NULL);
+  g_object_set (G_OBJECT (fakesink), "sync", TRUE, "signal-handoffs", TRUE,
+      "async", FALSE, NULL);
+  g_signal_connect (G_OBJECT (fakesink), "handoff",
+      G_CALLBACK (fakesink_hand_off), loop);
+
+  g_object_set_qdata (G_OBJECT (passthrough), video_sink_quark (), fakesink);
+  g_signal_connect (passthrough, "pad-added",
+      G_CALLBACK (on_pad_added_cb), NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), videotestsrc, passthrough, fakesink,
+      NULL);
+  fail_unless (kms_element_request_srcpad (passthrough,
+          KMS_ELEMENT_PAD_TYPE_VIDEO));
+  fail_unless (gst_element_link_pads (videotestsrc, NULL, passthrough,
+          "sink_video_default"));
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  g_main_loop_run (loop);
+
+  g_signal_emit_by_name (passthrough, "stats", NULL, &stats);
+  GST_DEBUG ("Stats: %" GST_PTR_FORMAT, stats);
+  fail_unless (stats != NULL);
+
+  e_stats = gst_value_get_structure (gst_structure_get_value (stats,
+          "media-element"));
+  fail_unless (e_stats != NULL);
+  p_stats = gst_value_get_structure (gst_structure_get_value (e_stats,
+          "processing-times"));
+  fail_unless (p_stats != NULL);
+  element_stats = gst_value_get_structure (gst_structure_get_value (p_stats,
+          "element"));
+  fail_unless (element_stats != NULL);
+  fail_unless (g_strcmp0 (gst_structure_get_string (element_stats, "type"),
+          "element") == 0);
+  fail_unless (gst_structure_get_uint64 (element_stats, "buffers", &buffers));
+  fail_unless (buffers > 0);
+
+  gst_structure_free (stats);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  g_object_unref (pipeline);
+  g_main_loop_unref (loop);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+proctime_suite (void)
+{
+  Suite *s = suite_create ("proctime");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+
+  tcase_add_test (tc_chain, check_processing_time);
+
+  return s;
+}
+
+GST_CHECK_MAIN (proctime);
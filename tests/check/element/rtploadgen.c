@@ -0,0 +1,393 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gst/gst.h>
+#include <gst/rtp/gstrtpbuffer.h>
+#include <gst/rtp/gstrtcpbuffer.h>
+
+#define SSRC 1000
+#define N_STREAMS 3
+#define MAX_STREAMS 256
+#define MTU 1200
+#define REMOTE_SSRC 5000
+#define REMB_BITRATE 250000
+
+typedef struct _TestData
+{
+  GMainLoop *loop;
+  GstElement *loadgen;
+  GstElement *appsrc;
+  GHashTable *ssrcs;
+  guint16 first_seq;
+  gboolean first_seq_set;
+  guint rembs;
+  GHashTable *sr_ssrcs;
+} TestData;
+
+static void
+bus_msg (GstBus * bus, GstMessage * msg, gpointer pipe)
+{
+  switch (GST_MESSAGE_TYPE (msg)) {
+    case GST_MESSAGE_ERROR:{
+      GST_ERROR ("Error: %" GST_PTR_FORMAT, msg);
+      fail ("Error received on bus");
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+static void
+rtp_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  TestData *data = user_data;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint32 ssrc;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READ, &rtp));
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+
+  if (ssrc == SSRC && !data->first_seq_set) {
+    data->first_seq = gst_rtp_buffer_get_seq (&rtp);
+    data->first_seq_set = TRUE;
+  }
+
+  g_hash_table_add (data->ssrcs, GUINT_TO_POINTER (ssrc));
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+static void
+rtcp_handoff (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    gpointer user_data)
+{
+  TestData *data = user_data;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  gboolean more;
+
+  fail_unless (gst_buffer_get_size (buf) <= MTU);
+  fail_unless (gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp));
+
+  /* Every compound packet starts with a report */
+  fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &packet));
+  fail_unless (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_SR ||
+      gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_RR);
+
+  for (more = gst_rtcp_buffer_get_first_packet (&rtcp, &packet); more;
+      more = gst_rtcp_packet_move_to_next (&packet)) {
+    if (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_SR &&
+        data->sr_ssrcs != NULL) {
+      guint32 ssrc;
+
+      gst_rtcp_packet_sr_get_sender_info (&packet, &ssrc, NULL, NULL, NULL,
+          NULL);
+      g_hash_table_add (data->sr_ssrcs, GUINT_TO_POINTER (ssrc));
+    }
+
+    if (gst_rtcp_packet_get_type (&packet) == GST_RTCP_TYPE_PSFB &&
+        gst_rtcp_packet_fb_get_type (&packet) == GST_RTCP_PSFB_TYPE_AFB) {
+      guint8 *fci = gst_rtcp_packet_fb_get_fci (&packet);
+
+      fail_unless (memcmp (fci, "REMB", 4) == 0);
+      fail_unless (fci[4] == 1);
+      fail_unless (GST_READ_UINT32_BE (fci + 8) == REMOTE_SSRC);
+      data->rembs++;
+    }
+  }
+
+  gst_rtcp_buffer_unmap (&rtcp);
+}
+
+static void
+add_feedback (GstRTCPBuffer * rtcp, GstRTCPType type, guint fmt,
+    GstRTCPPacket * packet)
+{
+  fail_unless (gst_rtcp_buffer_add_packet (rtcp, type, packet));
+  gst_rtcp_packet_fb_set_type (packet, fmt);
+  gst_rtcp_packet_fb_set_sender_ssrc (packet, REMOTE_SSRC);
+  gst_rtcp_packet_fb_set_media_ssrc (packet, SSRC);
+}
+
+static gboolean
+send_feedback (gpointer user_data)
+{
+  TestData *data = user_data;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GstFlowReturn ret;
+  GstBuffer *buffer;
+  guint8 *fci;
+
+  fail_unless (data->first_seq_set);
+
+  buffer = gst_rtcp_buffer_new (1400);
+  gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp);
+
+  /* Makes the remote SSRC known, so that REMB is sent for it */
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR, &packet));
+  gst_rtcp_packet_sr_set_sender_info (&packet, REMOTE_SSRC, 0, 0, 0, 0);
+
+  /* NACK of the first two packets */
+  add_feedback (&rtcp, GST_RTCP_TYPE_RTPFB, GST_RTCP_RTPFB_TYPE_NACK, &packet);
+  fail_unless (gst_rtcp_packet_fb_set_fci_length (&packet, 1));
+  fci = gst_rtcp_packet_fb_get_fci (&packet);
+  GST_WRITE_UINT16_BE (fci, data->first_seq);
+  GST_WRITE_UINT16_BE (fci + 2, 0x0001);
+
+  add_feedback (&rtcp, GST_RTCP_TYPE_PSFB, GST_RTCP_PSFB_TYPE_PLI, &packet);
+
+  add_feedback (&rtcp, GST_RTCP_TYPE_PSFB, GST_RTCP_PSFB_TYPE_AFB, &packet);
+  fail_unless (gst_rtcp_packet_fb_set_fci_length (&packet, 3));
+  fci = gst_rtcp_packet_fb_get_fci (&packet);
+  memcpy (fci, "REMB", 4);
+  fci[4] = 1;
+  /* Exponent 0, fits in the 18 bits of the mantissa */
+  fci[5] = (REMB_BITRATE >> 16) & 0x03;
+  fci[6] = (REMB_BITRATE >> 8) & 0xff;
+  fci[7] = REMB_BITRATE & 0xff;
+  GST_WRITE_UINT32_BE (fci + 8, SSRC);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  g_signal_emit_by_name (data->appsrc, "push-buffer", buffer, &ret);
+  gst_buffer_unref (buffer);
+  fail_unless (ret == GST_FLOW_OK);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+check_stats (gpointer user_data)
+{
+  TestData *data = user_data;
+  GstStructure *stats;
+  guint64 frames, keyframes, retransmissions, requests, rembs_received;
+  guint remb;
+
+  g_object_get (data->loadgen, "stats", &stats, NULL);
+  GST_INFO ("Stats: %" GST_PTR_FORMAT, stats);
+
+  gst_structure_get (stats, "frames", G_TYPE_UINT64, &frames, "keyframes",
+      G_TYPE_UINT64, &keyframes, "retransmissions", G_TYPE_UINT64,
+      &retransmissions, "keyframe-requests", G_TYPE_UINT64, &requests,
+      "rembs-received", G_TYPE_UINT64, &rembs_received, "remb-received",
+      G_TYPE_UINT, &remb, NULL);
+  gst_structure_free (stats);
+
+  fail_unless (g_hash_table_size (data->ssrcs) == N_STREAMS);
+  fail_unless (frames > N_STREAMS * 10);
+  /* The first frame of each stream plus the one requested */
+  fail_unless (keyframes == N_STREAMS + 1);
+  fail_unless (retransmissions == 2);
+  fail_unless (requests == 1);
+  fail_unless (rembs_received == 1);
+  fail_unless (remb == REMB_BITRATE);
+  fail_unless (data->rembs > 0);
+
+  g_main_loop_quit (data->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (feedback)
+{
+  GstElement *pipeline = gst_pipeline_new (__FUNCTION__);
+  GstElement *rtp_sink = gst_element_factory_make ("fakesink", NULL);
+  GstElement *rtcp_sink = gst_element_factory_make ("fakesink", NULL);
+  GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  GstCaps *caps;
+  TestData data = { 0 };
+
+  data.loop = g_main_loop_new (NULL, TRUE);
+  data.ssrcs = g_hash_table_new (NULL, NULL);
+  data.loadgen = gst_element_factory_make ("rtploadgen", NULL);
+  data.appsrc = gst_element_factory_make ("appsrc", NULL);
+
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  g_object_set (data.loadgen, "ssrc", SSRC, "n-streams", N_STREAMS,
+      "bitrate", 300000, "keyframe-interval", 0, "rtcp-interval", 100,
+      "remb-bitrate", 1000000, NULL);
+
+  caps = gst_caps_new_empty_simple ("application/x-rtcp");
+  g_object_set (data.appsrc, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  g_object_set (rtp_sink, "sync", FALSE, "async", FALSE, "signal-handoffs",
+      TRUE, NULL);
+  g_signal_connect (rtp_sink, "handoff", G_CALLBACK (rtp_handoff), &data);
+  g_object_set (rtcp_sink, "sync", FALSE, "async", FALSE, "signal-handoffs",
+      TRUE, NULL);
+  g_signal_connect (rtcp_sink, "handoff", G_CALLBACK (rtcp_handoff), &data);
+
+  gst_bin_add_many (GST_BIN (pipeline), data.loadgen, data.appsrc, rtp_sink,
+      rtcp_sink, NULL);
+  fail_unless (gst_element_link_pads (data.loadgen, "rtp_src", rtp_sink,
+          NULL));
+  fail_unless (gst_element_link_pads (data.loadgen, "rtcp_src", rtcp_sink,
+          NULL));
+  fail_unless (gst_element_link_pads (data.appsrc, NULL, data.loadgen,
+          "rtcp_sink"));
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_timeout_add (500, send_feedback, &data);
+  g_timeout_add (1500, check_stats, &data);
+
+  g_main_loop_run (data.loop);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_main_loop_unref (data.loop);
+  g_hash_table_unref (data.ssrcs);
+}
+
+GST_END_TEST;
+
+static gboolean
+send_big_remb (gpointer user_data)
+{
+  TestData *data = user_data;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket packet;
+  GstFlowReturn ret;
+  GstBuffer *buffer;
+  guint8 *fci;
+
+  buffer = gst_rtcp_buffer_new (1400);
+  gst_rtcp_buffer_map (buffer, GST_MAP_READWRITE, &rtcp);
+
+  fail_unless (gst_rtcp_buffer_add_packet (&rtcp, GST_RTCP_TYPE_SR, &packet));
+  gst_rtcp_packet_sr_set_sender_info (&packet, REMOTE_SSRC, 0, 0, 0, 0);
+
+  add_feedback (&rtcp, GST_RTCP_TYPE_PSFB, GST_RTCP_PSFB_TYPE_AFB, &packet);
+  fail_unless (gst_rtcp_packet_fb_set_fci_length (&packet, 3));
+  fci = gst_rtcp_packet_fb_get_fci (&packet);
+  memcpy (fci, "REMB", 4);
+  fci[4] = 1;
+  /* Largest exponent and mantissa, far beyond 32 bits */
+  fci[5] = 0xff;
+  fci[6] = 0xff;
+  fci[7] = 0xff;
+  GST_WRITE_UINT32_BE (fci + 8, SSRC);
+
+  gst_rtcp_buffer_unmap (&rtcp);
+
+  g_signal_emit_by_name (data->appsrc, "push-buffer", buffer, &ret);
+  gst_buffer_unref (buffer);
+  fail_unless (ret == GST_FLOW_OK);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+check_split_stats (gpointer user_data)
+{
+  TestData *data = user_data;
+  GstStructure *stats;
+  guint remb;
+
+  g_object_get (data->loadgen, "stats", &stats, NULL);
+  gst_structure_get (stats, "remb-received", G_TYPE_UINT, &remb, NULL);
+  gst_structure_free (stats);
+
+  fail_unless (remb == G_MAXUINT32);
+  fail_unless (g_hash_table_size (data->sr_ssrcs) == MAX_STREAMS);
+  fail_unless (data->rembs > 0);
+
+  g_main_loop_quit (data->loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (rtcp_split)
+{
+  GstElement *pipeline = gst_pipeline_new (__FUNCTION__);
+  GstElement *rtp_sink = gst_element_factory_make ("fakesink", NULL);
+  GstElement *rtcp_sink = gst_element_factory_make ("fakesink", NULL);
+  GstBus *bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  GstCaps *caps;
+  TestData data = { 0 };
+
+  data.loop = g_main_loop_new (NULL, TRUE);
+  data.sr_ssrcs = g_hash_table_new (NULL, NULL);
+  data.loadgen = gst_element_factory_make ("rtploadgen", NULL);
+  data.appsrc = gst_element_factory_make ("appsrc", NULL);
+
+  gst_bus_add_signal_watch (bus);
+  g_signal_connect (bus, "message", G_CALLBACK (bus_msg), pipeline);
+
+  /* SRs of every stream need several MTU sized compound packets */
+  g_object_set (data.loadgen, "ssrc", SSRC, "n-streams", MAX_STREAMS,
+      "bitrate", 10000, "mtu", MTU, "rtcp-interval", 100,
+      "remb-bitrate", 1000000, NULL);
+
+  caps = gst_caps_new_empty_simple ("application/x-rtcp");
+  g_object_set (data.appsrc, "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  g_object_set (rtp_sink, "sync", FALSE, "async", FALSE, NULL);
+  g_object_set (rtcp_sink, "sync", FALSE, "async", FALSE, "signal-handoffs",
+      TRUE, NULL);
+  g_signal_connect (rtcp_sink, "handoff", G_CALLBACK (rtcp_handoff), &data);
+
+  gst_bin_add_many (GST_BIN (pipeline), data.loadgen, data.appsrc, rtp_sink,
+      rtcp_sink, NULL);
+  fail_unless (gst_element_link_pads (data.loadgen, "rtp_src", rtp_sink,
+          NULL));
+  fail_unless (gst_element_link_pads (data.loadgen, "rtcp_src", rtcp_sink,
+          NULL));
+  fail_unless (gst_element_link_pads (data.appsrc, NULL, data.loadgen,
+          "rtcp_sink"));
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  g_timeout_add (200, send_big_remb, &data);
+  g_timeout_add (1000, check_split_stats, &data);
+
+  g_main_loop_run (data.loop);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_bus_remove_signal_watch (bus);
+  g_object_unref (bus);
+  g_object_unref (pipeline);
+  g_main_loop_unref (data.loop);
+  g_hash_table_unref (data.sr_ssrcs);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtploadgen_suite (void)
+{
+  Suite *s = suite_create ("rtploadgen");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, feedback);
+  tcase_add_test (tc_chain, rtcp_split);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtploadgen);
@@ -2813,6 +2813,122 @@ GST_START_TEST (sdp_agent_sdes_negotiation)
 
 GST_END_TEST;
 
+static GArray *
+on_offer_gcm_keys_cb (KmsSdpSdesExt * ext, gpointer data)
+{
+  GValue v1 = G_VALUE_INIT;
+  GValue v2 = G_VALUE_INIT;
+  GArray *keys;
+
+  keys = g_array_sized_new (FALSE, FALSE, sizeof (GValue), 2);
+  g_array_set_clear_func (keys, (GDestroyNotify) g_value_unset);
+
+  fail_if (!kms_sdp_sdes_ext_create_key (1, "1abcdefgh",
+          KMS_SDES_EXT_AES_CM_128_HMAC_SHA1_80, &v1));
+  g_array_append_val (keys, v1);
+
+  fail_if (!kms_sdp_sdes_ext_create_key (2, "2abcdefgh",
+          KMS_SDES_EXT_AEAD_AES_128_GCM, &v2));
+  g_array_append_val (keys, v2);
+
+  return keys;
+}
+
+static void
+on_selected_gcm_key_cb (KmsSdpSdesExt * ext, const GValue * key,
+    gpointer data)
+{
+  SrtpCryptoSuite crypto;
+  guint tag, cipher, auth, key_size;
+
+  fail_if (!kms_sdp_sdes_ext_get_parameters_from_key (key, KMS_SDES_TAG_FIELD,
+          G_TYPE_UINT, &tag, KMS_SDES_CRYPTO, G_TYPE_UINT, &crypto, NULL));
+
+  /* AEAD suite must be preferred even if it is not offered first */
+  fail_if (tag != 2);
+  fail_if (crypto != KMS_SDES_EXT_AEAD_AES_128_GCM);
+
+  fail_if (!kms_sdp_sdes_ext_get_srtp_params (crypto, &cipher, &auth,
+          &key_size));
+  fail_if (auth != 0);
+  fail_if (key_size != 28);
+
+  *((gboolean *) data) = TRUE;
+}
+
+GST_START_TEST (sdp_agent_sdes_gcm_negotiation)
+{
+  KmsSdpAgent *offerer, *answerer;
+  KmsSdpMediaHandler *handler;
+  GstSDPMessage *offer, *answer;
+  KmsSdpSdesExt *ext1, *ext2;
+  GError *err = NULL;
+  const GstSDPMedia *media;
+  gboolean selected = FALSE;
+
+  offerer = kms_sdp_agent_new ();
+  fail_if (offerer == NULL);
+
+  answerer = kms_sdp_agent_new ();
+  fail_if (answerer == NULL);
+
+  handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_savpf_media_handler_new ());
+  set_default_codecs (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), audio_codecs,
+      G_N_ELEMENTS (audio_codecs), video_codecs, G_N_ELEMENTS (video_codecs));
+
+  ext1 = kms_sdp_sdes_ext_new ();
+  fail_if (!kms_sdp_media_handler_add_media_extension (handler,
+          KMS_I_SDP_MEDIA_EXTENSION (ext1)));
+
+  g_signal_connect (ext1, "on-offer-keys", G_CALLBACK (on_offer_gcm_keys_cb),
+      NULL);
+  g_signal_connect (ext1, "on-selected-key",
+      G_CALLBACK (on_selected_gcm_key_cb), &selected);
+
+  fail_if (kms_sdp_agent_add_proto_handler (offerer, "video", handler,
+          NULL) < 0);
+
+  handler = KMS_SDP_MEDIA_HANDLER (kms_sdp_rtp_savpf_media_handler_new ());
+  set_default_codecs (KMS_SDP_RTP_AVP_MEDIA_HANDLER (handler), audio_codecs,
+      G_N_ELEMENTS (audio_codecs), video_codecs, G_N_ELEMENTS (video_codecs));
+
+  ext2 = kms_sdp_sdes_ext_new ();
+  fail_if (!kms_sdp_media_handler_add_media_extension (handler,
+          KMS_I_SDP_MEDIA_EXTENSION (ext2)));
+
+  /* Selects the first offered key */
+  g_signal_connect (ext2, "on-answer-keys", G_CALLBACK (on_answer_keys_cb),
+      NULL);
+
+  fail_if (kms_sdp_agent_add_proto_handler (answerer, "video", handler,
+          NULL) < 0);
+
+  offer = kms_sdp_agent_create_offer (offerer, &err);
+  fail_if (err != NULL);
+
+  media = gst_sdp_message_get_media (offer, 0);
+  fail_if (!g_str_has_prefix (gst_sdp_media_get_attribute_val (media,
+              "crypto"), "2 AEAD_AES_128_GCM inline:"));
+
+  fail_if (!kms_sdp_agent_set_remote_description (answerer, offer, &err));
+  answer = kms_sdp_agent_create_answer (answerer, &err);
+  fail_if (err != NULL);
+
+  media = gst_sdp_message_get_media (answer, 0);
+  fail_if (gst_sdp_media_get_port (media) == 0);
+
+  fail_if (!kms_i_sdp_media_extension_process_answer_attributes
+      (KMS_I_SDP_MEDIA_EXTENSION (ext1), media, &err));
+  fail_unless (selected);
+
+  gst_sdp_message_free (answer);
+
+  g_object_unref (offerer);
+  g_object_unref (answerer);
+}
+
+GST_END_TEST;
+
 static gchar *sdp_first_media_inactive = "v=0\r\n"
     "o=- 123456 0 IN IP4 127.0.0.1\r\n"
     "s=Kurento Media Server\r\n"
@@ -5739,6 +5855,7 @@ sdp_agent_suite (void)
   tcase_add_test (tc_chain, sdp_agent_regression_tests);
   tcase_add_test (tc_chain, sdp_agent_udp_tls_rtp_savpf_negotiation);
   tcase_add_test (tc_chain, sdp_agent_sdes_negotiation);
+  tcase_add_test (tc_chain, sdp_agent_sdes_gcm_negotiation);
   tcase_add_test (tc_chain, sdp_agent_test_connection_ext);
   tcase_add_test (tc_chain, sdp_agent_ulpfec_ext);
   tcase_add_test (tc_chain, sdp_agent_redundant_ext);
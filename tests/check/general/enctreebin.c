@@ -0,0 +1,197 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+#include "kmsenctreebin.h"
+#include "kmslatencyprofile.h"
+
+static gint
+is_encoder (const GValue * item, gconstpointer user_data)
+{
+  GstElement *element = g_value_get_object (item);
+  GstElementFactory *factory = gst_element_get_factory (element);
+  const gchar *klass;
+
+  if (factory == NULL) {
+    return 1;
+  }
+
+  klass = gst_element_factory_get_metadata (factory,
+      GST_ELEMENT_METADATA_KLASS);
+
+  return klass != NULL && strstr (klass, "Encoder") != NULL ? 0 : 1;
+}
+
+static KmsEncTreeBin *
+create_enc_tree_bin (const gchar * caps_str, KmsLatencyProfile profile,
+    GstElement ** encoder)
+{
+  KmsEncTreeBin *enc;
+  GstIterator *it;
+  GstCaps *caps;
+  GValue item = G_VALUE_INIT;
+
+  caps = gst_caps_from_string (caps_str);
+  enc = kms_enc_tree_bin_new_full (caps, 300000, 0, G_MAXINT, NULL, profile);
+  gst_caps_unref (caps);
+  fail_if (enc == NULL);
+
+  it = gst_bin_iterate_elements (GST_BIN (enc));
+  fail_unless (gst_iterator_find_custom (it, (GCompareFunc) is_encoder, &item,
+          NULL));
+  *encoder = g_value_dup_object (&item);
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  return enc;
+}
+
+static gint
+get_default_int (GstElement * element, const gchar * name)
+{
+  GParamSpec *pspec;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (element), name);
+  fail_if (pspec == NULL);
+
+  return G_PARAM_SPEC_INT (pspec)->default_value;
+}
+
+GST_START_TEST (vp8_profiles)
+{
+  KmsEncTreeBin *enc;
+  GstElement *encoder;
+  gint keyframe_max_dist;
+
+  enc = create_enc_tree_bin ("video/x-vp8", KMS_LATENCY_PROFILE_DEFAULT,
+      &encoder);
+  g_object_get (encoder, "keyframe-max-dist", &keyframe_max_dist, NULL);
+  fail_unless_equals_int (keyframe_max_dist,
+      get_default_int (encoder, "keyframe-max-dist"));
+  g_object_unref (encoder);
+  g_object_unref (enc);
+
+  enc = create_enc_tree_bin ("video/x-vp8", KMS_LATENCY_PROFILE_INTERACTIVE,
+      &encoder);
+  g_object_get (encoder, "keyframe-max-dist", &keyframe_max_dist, NULL);
+  fail_unless_equals_int (keyframe_max_dist,
+      kms_latency_profile_get_settings
+      (KMS_LATENCY_PROFILE_INTERACTIVE)->enc_keyframe_interval);
+  g_object_unref (encoder);
+  g_object_unref (enc);
+
+  enc = create_enc_tree_bin ("video/x-vp8", KMS_LATENCY_PROFILE_BROADCAST,
+      &encoder);
+  g_object_get (encoder, "keyframe-max-dist", &keyframe_max_dist, NULL);
+  fail_unless_equals_int (keyframe_max_dist,
+      kms_latency_profile_get_settings
+      (KMS_LATENCY_PROFILE_BROADCAST)->enc_keyframe_interval);
+  g_object_unref (encoder);
+  g_object_unref (enc);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (x264_profiles)
+{
+  GstElementFactory *factory;
+  KmsEncTreeBin *enc;
+  GstElement *encoder;
+  guint key_int_max, tune;
+
+  factory = gst_element_factory_find ("x264enc");
+  if (factory == NULL) {
+    GST_WARNING ("x264enc not available, skipping");
+    return;
+  }
+  gst_object_unref (factory);
+
+  enc = create_enc_tree_bin ("video/x-h264", KMS_LATENCY_PROFILE_INTERACTIVE,
+      &encoder);
+  fail_unless (g_str_has_prefix (GST_OBJECT_NAME (encoder), "x264enc"));
+  g_object_get (encoder, "key-int-max", &key_int_max, "tune", &tune, NULL);
+  fail_unless_equals_int (key_int_max, 30);
+  fail_unless_equals_int (tune, 4 /* zero-latency */ );
+  g_object_unref (encoder);
+  g_object_unref (enc);
+
+  enc = create_enc_tree_bin ("video/x-h264", KMS_LATENCY_PROFILE_BROADCAST,
+      &encoder);
+  g_object_get (encoder, "key-int-max", &key_int_max, "tune", &tune, NULL);
+  fail_unless_equals_int (key_int_max, 120);
+  fail_unless_equals_int (tune, 0);
+  g_object_unref (encoder);
+  g_object_unref (enc);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (default_constructor)
+{
+  KmsEncTreeBin *enc;
+  GstCaps *caps;
+
+  /* The previous constructor keeps working with the default profile */
+  caps = gst_caps_from_string ("video/x-vp8");
+  enc = kms_enc_tree_bin_new (caps, 300000, 0, G_MAXINT, NULL);
+  gst_caps_unref (caps);
+
+  fail_if (enc == NULL);
+  g_object_unref (enc);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (audio_mixer_bin_profile)
+{
+  GstElement *mixer;
+  KmsLatencyProfile profile;
+
+  mixer = gst_element_factory_make ("audiomixerbin", NULL);
+  fail_if (mixer == NULL);
+
+  g_object_get (mixer, "latency-profile", &profile, NULL);
+  fail_unless_equals_int (profile, KMS_LATENCY_PROFILE_DEFAULT);
+
+  g_object_set (mixer, "latency-profile", KMS_LATENCY_PROFILE_BROADCAST, NULL);
+  g_object_get (mixer, "latency-profile", &profile, NULL);
+  fail_unless_equals_int (profile, KMS_LATENCY_PROFILE_BROADCAST);
+
+  g_object_unref (mixer);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+enc_tree_bin_suite (void)
+{
+  Suite *s = suite_create ("enctreebin");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, vp8_profiles);
+  tcase_add_test (tc_chain, x264_profiles);
+  tcase_add_test (tc_chain, default_constructor);
+  tcase_add_test (tc_chain, audio_mixer_bin_profile);
+
+  return s;
+}
+
+GST_CHECK_MAIN (enc_tree_bin);
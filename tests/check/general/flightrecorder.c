@@ -0,0 +1,149 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+#include <string.h>
+
+#include "kmsflightrecorder.h"
+
+/* Must match the dump layout documented in kmsflightrecorder.h */
+#define HEADER_SIZE 32
+#define RECORD_SIZE 128
+
+GST_START_TEST (ring_keeps_latest)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *pad;
+  const guint8 *data;
+  GBytes *dump;
+  gchar *text;
+  guint32 n_records;
+  guint64 seq;
+  gsize size;
+  guint i;
+
+  gst_bin_add (GST_BIN (pipeline), sink);
+  pad = gst_element_get_static_pad (sink, "sink");
+
+  kms_flight_recorder_attach (pipeline, 3);
+
+  for (i = 0; i < 6; i++) {
+    kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_KEYFRAME_REQUEST, 0, 0,
+        NULL);
+  }
+  kms_flight_recorder_record (sink, KMS_FLIGHT_EVENT_REMB, 1234,
+      ((guint64) 500000 << 32) | 300000, NULL);
+
+  dump = kms_flight_recorder_dump (pipeline);
+  data = g_bytes_get_data (dump, &size);
+
+  fail_unless (memcmp (data, KMS_FLIGHT_RECORDER_MAGIC, 4) == 0);
+  /* 3 records are rounded up to 4 */
+  memcpy (&n_records, data + 8, sizeof (n_records));
+  fail_unless (n_records == 4);
+  fail_unless (size == HEADER_SIZE + n_records * RECORD_SIZE);
+
+  /* Oldest first */
+  memcpy (&seq, data + HEADER_SIZE, sizeof (seq));
+  fail_unless (seq == 4);
+  memcpy (&seq, data + HEADER_SIZE + 3 * RECORD_SIZE, sizeof (seq));
+  fail_unless (seq == 7);
+  g_bytes_unref (dump);
+
+  text = kms_flight_recorder_dump_text (pipeline);
+  GST_DEBUG ("Flight record:\n%s", text);
+  fail_unless (strstr (text, "keyframe-request") != NULL);
+  fail_unless (strstr (text, "ssrc 1234 bitrate 500000 min 300000") != NULL);
+  g_free (text);
+
+  g_object_unref (pad);
+  g_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (no_recorder)
+{
+  GstElement *pipeline = gst_pipeline_new (NULL);
+
+  kms_flight_recorder_record (pipeline, KMS_FLIGHT_EVENT_CAPS, 0, 0, "any");
+  fail_unless (kms_flight_recorder_dump (pipeline) == NULL);
+  fail_unless (kms_flight_recorder_dump_text (pipeline) == NULL);
+
+  g_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (element_moved)
+{
+  GstElement *first = gst_pipeline_new (NULL);
+  GstElement *second = gst_pipeline_new (NULL);
+  GstElement *sink = gst_element_factory_make ("fakesink", NULL);
+  GstPad *pad;
+  gchar *text;
+
+  kms_flight_recorder_attach (first, 4);
+  kms_flight_recorder_attach (second, 4);
+
+  gst_object_ref (sink);
+  gst_bin_add (GST_BIN (first), sink);
+  pad = gst_element_get_static_pad (sink, "sink");
+
+  kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_CAPS, 0, 0, "in-first");
+
+  /* The recorder kept on the pad must not outlive the move */
+  gst_bin_remove (GST_BIN (first), sink);
+  gst_bin_add (GST_BIN (second), sink);
+  kms_flight_recorder_record (pad, KMS_FLIGHT_EVENT_CAPS, 0, 0, "in-second");
+
+  text = kms_flight_recorder_dump_text (first);
+  fail_unless (strstr (text, "in-first") != NULL);
+  fail_unless (strstr (text, "in-second") == NULL);
+  g_free (text);
+
+  text = kms_flight_recorder_dump_text (second);
+  fail_unless (strstr (text, "in-first") == NULL);
+  fail_unless (strstr (text, "in-second") != NULL);
+  g_free (text);
+
+  g_object_unref (pad);
+  g_object_unref (sink);
+  g_object_unref (first);
+  g_object_unref (second);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+flightrecorder_suite (void)
+{
+  Suite *s = suite_create ("flightrecorder");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, ring_keeps_latest);
+  tcase_add_test (tc_chain, no_recorder);
+  tcase_add_test (tc_chain, element_moved);
+
+  return s;
+}
+
+GST_CHECK_MAIN (flightrecorder);
@@ -0,0 +1,192 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+#include "kmsloop.h"
+#include "kmscensus.h"
+
+/* Period of the lag source of KmsLoop */
+#define LAG_INTERVAL_MSEC 500
+
+GST_START_TEST (pool_same_key_same_loop)
+{
+  gpointer key = g_malloc (64);
+  KmsLoop *loop1, *loop2;
+
+  loop1 = kms_loop_pool_get_loop (key);
+  loop2 = kms_loop_pool_get_loop (key);
+  fail_unless (loop1 == loop2);
+
+  g_object_unref (loop1);
+  g_object_unref (loop2);
+  g_free (key);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (pool_round_robin)
+{
+  guint i, size = kms_loop_pool_get_size ();
+  GHashTable *loops = g_hash_table_new (NULL, NULL);
+
+  for (i = 0; i < size; i++) {
+    KmsLoop *loop = kms_loop_pool_get_loop (NULL);
+
+    g_hash_table_add (loops, loop);
+    g_object_unref (loop);
+  }
+
+  fail_unless (g_hash_table_size (loops) == size);
+  g_hash_table_unref (loops);
+}
+
+GST_END_TEST;
+
+typedef struct _LagData
+{
+  KmsLoop *loop;
+  GMutex mutex;
+  GCond cond;
+  gboolean done;
+} LagData;
+
+static gboolean
+lag_measured (gpointer user_data)
+{
+  LagData *data = user_data;
+
+  g_mutex_lock (&data->mutex);
+  data->done = TRUE;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->mutex);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+block_loop (gpointer user_data)
+{
+  LagData *data = user_data;
+
+  g_usleep (3 * LAG_INTERVAL_MSEC * G_TIME_SPAN_MILLISECOND);
+
+  /* The lag source is ready by now and has a higher priority, so it is
+   * dispatched before this idle */
+  kms_loop_idle_add_full (data->loop, G_PRIORITY_LOW, lag_measured, data,
+      NULL);
+
+  return G_SOURCE_REMOVE;
+}
+
+GST_START_TEST (loop_lag)
+{
+  LagData data;
+  gint64 max_lag, end_time;
+
+  data.loop = kms_loop_new ();
+  g_mutex_init (&data.mutex);
+  g_cond_init (&data.cond);
+  data.done = FALSE;
+
+  /* Fires after the first tick of the lag source, which was attached first */
+  kms_loop_timeout_add (data.loop, LAG_INTERVAL_MSEC + 100,
+      block_loop, &data);
+
+  end_time = g_get_monotonic_time () + 10 * G_TIME_SPAN_SECOND;
+  g_mutex_lock (&data.mutex);
+  while (!data.done) {
+    if (!g_cond_wait_until (&data.cond, &data.mutex, end_time)) {
+      break;
+    }
+  }
+  g_mutex_unlock (&data.mutex);
+  fail_unless (data.done);
+
+  g_object_get (data.loop, "max-lag", &max_lag, NULL);
+  GST_DEBUG ("Max lag: %" G_GINT64_FORMAT, max_lag);
+  fail_unless (max_lag > 0);
+
+  g_object_unref (data.loop);
+  g_cond_clear (&data.cond);
+  g_mutex_clear (&data.mutex);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (pool_stats)
+{
+  GstStructure *stats, *loop_stats;
+
+  stats = kms_loop_pool_get_stats ();
+  fail_unless (gst_structure_n_fields (stats) == kms_loop_pool_get_size ());
+  fail_unless (gst_structure_get (stats, "loop-0", GST_TYPE_STRUCTURE,
+          &loop_stats, NULL));
+  fail_unless (gst_structure_has_field (loop_stats, "lag"));
+  fail_unless (gst_structure_has_field (loop_stats, "max-lag"));
+
+  gst_structure_free (loop_stats);
+  gst_structure_free (stats);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (census)
+{
+  KmsLoop *loop1, *loop2;
+  gint live, max, initial_live, initial_max;
+
+  kms_census_get (KMS_CENSUS_LOOP, &initial_live, &initial_max);
+
+  loop1 = kms_loop_new ();
+  loop2 = kms_loop_new ();
+
+  kms_census_get (KMS_CENSUS_LOOP, &live, &max);
+  fail_unless (live == initial_live + 2);
+  fail_unless (max >= live);
+
+  g_object_unref (loop1);
+  g_object_unref (loop2);
+
+  kms_census_get (KMS_CENSUS_LOOP, &live, &max);
+  fail_unless (live == initial_live);
+  fail_unless (max >= initial_live + 2);
+  fail_unless (g_strcmp0 (kms_census_type_get_name (KMS_CENSUS_LOOP),
+          "KmsLoop") == 0);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+loop_suite (void)
+{
+  Suite *s = suite_create ("loop");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, pool_same_key_same_loop);
+  tcase_add_test (tc_chain, pool_round_robin);
+  tcase_add_test (tc_chain, loop_lag);
+  tcase_add_test (tc_chain, pool_stats);
+  tcase_add_test (tc_chain, census);
+
+  return s;
+}
+
+GST_CHECK_MAIN (loop);
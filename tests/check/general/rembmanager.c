@@ -16,10 +16,17 @@
  */
 
 #include "kmsutils.h"
+#include "kmsremb.h"
 
 #include <gst/check/gstcheck.h>
+#include <gst/rtp/gstrtcpbuffer.h>
 #include <glib.h>
 
+#define REMB_SSRC 1234
+#define PROBE_STEP_TIME_USEC (3 * 500 * G_TIME_SPAN_MILLISECOND + \
+    100 * G_TIME_SPAN_MILLISECOND)
+#define PROBE_DELAY 200         /* ms */
+
 static void
 bitrate_cb (RembEventManager * manager, guint bitrate, gpointer user_data)
 {
@@ -130,6 +137,145 @@ GST_START_TEST (check_take_into_account_after_clear_time)
 
 GST_END_TEST;
 
+typedef struct _RembRemoteData
+{
+  GstElement *session;
+  GObject *rtpsess;
+  GstPad *src, *sink;
+  RembEventManager *manager;
+  KmsRembRemote *rm;
+  guint bitrate;
+} RembRemoteData;
+
+static void
+remb_remote_data_init (RembRemoteData * data)
+{
+  GstStructure *params;
+
+  data->session = gst_element_factory_make ("rtpsession", NULL);
+  fail_if (data->session == NULL);
+  g_object_get (data->session, "internal-session", &data->rtpsess, NULL);
+
+  /* REMB events travel upstream from sink to src */
+  data->src = gst_pad_new (NULL, GST_PAD_SRC);
+  data->sink = gst_pad_new (NULL, GST_PAD_SINK);
+  gst_pad_set_active (data->src, TRUE);
+  gst_pad_set_active (data->sink, TRUE);
+  fail_unless (gst_pad_link (data->src, data->sink) == GST_PAD_LINK_OK);
+
+  data->bitrate = 0;
+  data->manager = kms_utils_remb_event_manager_create (data->src);
+  kms_utils_remb_event_manager_set_callback (data->manager, bitrate_cb,
+      &data->bitrate, NULL);
+
+  data->rm = kms_remb_remote_create (data->rtpsess, REMB_SSRC, 0, 0,
+      data->sink);
+
+  params = gst_structure_new ("params", "probe-factor", G_TYPE_FLOAT, 2.0,
+      "probe-steps", G_TYPE_INT, 2, "probe-delay", G_TYPE_INT, PROBE_DELAY,
+      NULL);
+  kms_remb_remote_set_params (data->rm, params);
+  gst_structure_free (params);
+}
+
+static void
+remb_remote_data_clear (RembRemoteData * data)
+{
+  kms_remb_remote_destroy (data->rm);
+  kms_utils_remb_event_manager_destroy (data->manager);
+  g_object_unref (data->src);
+  g_object_unref (data->sink);
+  g_object_unref (data->rtpsess);
+  g_object_unref (data->session);
+}
+
+/* Emits a REMB as if it had been received, returns the bitrate sent */
+/* upstream to the encoder */
+static guint
+receive_remb (RembRemoteData * data, guint bitrate)
+{
+  GstBuffer *fci;
+  GstMapInfo map;
+  guint exp = 0, mantissa = bitrate;
+
+  while (mantissa >= (1 << 18)) {
+    mantissa >>= 1;
+    exp++;
+  }
+
+  fci = gst_buffer_new_allocate (NULL, 12, NULL);
+  gst_buffer_map (fci, &map, GST_MAP_WRITE);
+  memcpy (map.data, "REMB", 4);
+  map.data[4] = 1;
+  map.data[5] = (exp << 2) | ((mantissa >> 16) & 0x03);
+  map.data[6] = mantissa >> 8;
+  map.data[7] = mantissa;
+  GST_WRITE_UINT32_BE (map.data + 8, REMB_SSRC);
+  gst_buffer_unmap (fci, &map);
+
+  g_signal_emit_by_name (data->rtpsess, "on-feedback-rtcp",
+      GST_RTCP_TYPE_PSFB, GST_RTCP_PSFB_TYPE_AFB, 5678, 0, fci);
+  gst_buffer_unref (fci);
+
+  return data->bitrate;
+}
+
+GST_START_TEST (check_remb_remote_probe_steps)
+{
+  RembRemoteData data;
+
+  remb_remote_data_init (&data);
+
+  /* First REMB starts probing at twice the estimation */
+  fail_unless_equals_int (receive_remb (&data, 500000), 1000000);
+
+  /* The step is kept until it has been measured */
+  fail_unless_equals_int (receive_remb (&data, 900000), 1000000);
+
+  /* The receiver follows: next step */
+  g_usleep (PROBE_STEP_TIME_USEC);
+  fail_unless_equals_int (receive_remb (&data, 900000), 2000000);
+
+  /* The receiver does not follow: back to the estimation */
+  g_usleep (PROBE_STEP_TIME_USEC);
+  fail_unless_equals_int (receive_remb (&data, 1000000), 1000000);
+
+  /* Probing starts again once the delay has passed */
+  fail_unless_equals_int (receive_remb (&data, 1000000), 1000000);
+  g_usleep ((PROBE_DELAY + 100) * G_TIME_SPAN_MILLISECOND);
+  fail_unless_equals_int (receive_remb (&data, 1000000), 2000000);
+
+  remb_remote_data_clear (&data);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (check_remb_remote_probe_rollback)
+{
+  RembRemoteData data;
+
+  remb_remote_data_init (&data);
+
+  fail_unless_equals_int (receive_remb (&data, 1000000), 2000000);
+
+  /* Congestion while probing: roll back to the estimation */
+  fail_unless_equals_int (receive_remb (&data, 500000), 500000);
+
+  /* Not probing until the delay has passed */
+  fail_unless_equals_int (receive_remb (&data, 500000), 500000);
+  g_usleep ((PROBE_DELAY + 100) * G_TIME_SPAN_MILLISECOND);
+  fail_unless_equals_int (receive_remb (&data, 500000), 1000000);
+
+  /* A configured max bandwidth limits the probe */
+  g_usleep (PROBE_STEP_TIME_USEC);
+  kms_remb_remote_set_max_bw (data.rm, 1200);
+  fail_unless_equals_int (receive_remb (&data, 1000000), 1200000);
+
+  remb_remote_data_clear (&data);
+}
+
+GST_END_TEST;
+
 /* Suite initialization */
 static Suite *
 rembmanager_suite (void)
@@ -140,6 +286,8 @@ rembmanager_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, check_min_br_update);
   tcase_add_test (tc_chain, check_take_into_account_after_clear_time);
+  tcase_add_test (tc_chain, check_remb_remote_probe_steps);
+  tcase_add_test (tc_chain, check_remb_remote_probe_rollback);
 
   return s;
 }
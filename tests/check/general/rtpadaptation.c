@@ -0,0 +1,238 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <glib.h>
+
+#include "kmsrtpadaptation.h"
+
+/* Memory budget used by the tests, see rtp_adaptation_suite */
+#define MEMORY_LIMIT (1024 * 1024)
+
+/* NTP short format (16.16 seconds) */
+#define RTT_100_MS 6554
+#define RTT_1_S 65536
+#define RTT_50_MS 3277
+#define RTT_200_MS 13107
+
+/* 1/256 units */
+#define LOSS_10 26
+#define LOSS_11 29
+#define LOSS_50 128
+
+GST_START_TEST (rtx_history_size)
+{
+  guint64 reserved = 0;
+  guint size;
+
+  /* (100 ms + 200 ms margin) at 1 Mbps with 1000 bytes packets */
+  size = kms_rtx_history_get_size (&reserved, RTT_100_MS, 1000000, 1000);
+  fail_unless_equals_int (size, 37);
+  fail_unless (reserved == 37 * 1000);
+
+  /* Low bitrates still keep the minimum history */
+  size = kms_rtx_history_get_size (&reserved, RTT_100_MS, 64000, 1000);
+  fail_unless_equals_int (size, KMS_RTX_HISTORY_MIN_SIZE);
+
+  /* High bitrates are limited to the maximum history */
+  size = kms_rtx_history_get_size (&reserved, RTT_1_S, 100000000, 100);
+  fail_unless_equals_int (size, KMS_RTX_HISTORY_MAX_SIZE);
+  fail_unless (reserved == KMS_RTX_HISTORY_MAX_SIZE * 100);
+
+  kms_rtx_history_release (&reserved);
+  fail_unless (reserved == 0);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtx_history_budget)
+{
+  guint64 a = 0, b = 0, c = 0;
+  guint size;
+
+  fail_unless (kms_rtx_history_get_memory_limit () == MEMORY_LIMIT);
+
+  size = kms_rtx_history_get_size (&a, RTT_1_S, 100000000, 100);
+  fail_unless_equals_int (size, KMS_RTX_HISTORY_MAX_SIZE);
+
+  /* Only what is left of the budget is given to the second history */
+  size = kms_rtx_history_get_size (&b, RTT_1_S, 100000000, 100);
+  fail_unless_equals_int (size, (MEMORY_LIMIT - a) / 100);
+  fail_unless (a + b <= MEMORY_LIMIT);
+
+  /* Budget exhausted, nothing is charged but the minimum is kept */
+  size = kms_rtx_history_get_size (&c, RTT_1_S, 100000000, 100);
+  fail_unless_equals_int (size, KMS_RTX_HISTORY_MIN_SIZE);
+  fail_unless (c < 100);
+
+  /* Released memory can be taken by others */
+  kms_rtx_history_release (&a);
+  size = kms_rtx_history_get_size (&b, RTT_1_S, 100000000, 100);
+  fail_unless_equals_int (size, KMS_RTX_HISTORY_MAX_SIZE);
+
+  /* Shrinking returns memory to the budget */
+  size = kms_rtx_history_get_size (&b, RTT_100_MS, 1000000, 100);
+  fail_unless_equals_int (size, 375);
+  fail_unless (b == 375 * 100);
+
+  kms_rtx_history_release (&b);
+  kms_rtx_history_release (&c);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtx_history_initial_size)
+{
+  guint64 a = 0, b = 0, c = 0;
+  guint size;
+
+  size = kms_rtx_history_get_initial_size (&a, 512);
+  fail_unless_equals_int (size, 512);
+  fail_unless (a > 0);
+
+  size = kms_rtx_history_get_initial_size (&b, 512);
+  fail_unless (size < 512);
+  fail_unless (size > KMS_RTX_HISTORY_MIN_SIZE);
+  fail_unless (a + b <= MEMORY_LIMIT);
+
+  size = kms_rtx_history_get_initial_size (&c, 512);
+  fail_unless_equals_int (size, KMS_RTX_HISTORY_MIN_SIZE);
+
+  kms_rtx_history_release (&a);
+  kms_rtx_history_release (&b);
+  kms_rtx_history_release (&c);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (fec_thresholds)
+{
+  guint percentage;
+
+  /* Losses are recovered by retransmissions while RTT is low */
+  percentage = kms_fec_get_percentage (0, TRUE, RTT_50_MS, LOSS_10, 1000000,
+      0);
+  fail_unless_equals_int (percentage, 0);
+
+  /* Enabled when RTT grows */
+  percentage = kms_fec_get_percentage (0, TRUE, RTT_200_MS, LOSS_10, 1000000,
+      0);
+  fail_unless_equals_int (percentage, 20);
+
+  /* Without NACK, RTT does not matter */
+  percentage = kms_fec_get_percentage (0, FALSE, RTT_50_MS, LOSS_10, 1000000,
+      0);
+  fail_unless_equals_int (percentage, 20);
+
+  /* Small changes are ignored */
+  percentage = kms_fec_get_percentage (20, FALSE, RTT_50_MS, LOSS_11,
+      1200000, 0);
+  fail_unless_equals_int (percentage, 20);
+
+  /* Protection is limited */
+  percentage = kms_fec_get_percentage (20, FALSE, RTT_50_MS, LOSS_50,
+      1200000, 0);
+  fail_unless_equals_int (percentage, 50);
+
+  /* Disabled when losses stop */
+  percentage = kms_fec_get_percentage (20, FALSE, RTT_200_MS, 0, 1200000, 0);
+  fail_unless_equals_int (percentage, 0);
+
+  /* And when RTT drops back below the NACK threshold */
+  percentage = kms_fec_get_percentage (20, TRUE, RTT_50_MS, LOSS_10, 1200000,
+      0);
+  fail_unless_equals_int (percentage, 0);
+
+  /* Overhead does not exceed the available bandwidth: media is 1 Mbps */
+  percentage = kms_fec_get_percentage (20, FALSE, RTT_200_MS, LOSS_50,
+      1200000, 1100000);
+  fail_unless_equals_int (percentage, 10);
+
+  percentage = kms_fec_get_percentage (20, FALSE, RTT_200_MS, LOSS_10,
+      1200000, 900000);
+  fail_unless_equals_int (percentage, 0);
+
+  /* Nothing measured yet */
+  percentage = kms_fec_get_percentage (20, FALSE, 0, LOSS_10, 1200000, 0);
+  fail_unless_equals_int (percentage, 20);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (jitter_buffer_latency)
+{
+  guint latency = 100, i;
+
+  /* Stable network: shrinks slowly towards jitter * 4 + 20 ms */
+  latency = kms_jitter_buffer_get_latency (latency, 0, 1000, 5, 0, FALSE);
+  fail_unless_equals_int (latency, 90);
+
+  for (i = 0; i < 10; i++) {
+    latency = kms_jitter_buffer_get_latency (latency, 0, 1000, 5, 0, FALSE);
+  }
+  fail_unless_equals_int (latency, 40);
+
+  /* Jitter grows: latency follows in bounded steps */
+  latency = kms_jitter_buffer_get_latency (latency, 0, 1000, 50, 0, FALSE);
+  fail_unless_equals_int (latency, 90);
+  latency = kms_jitter_buffer_get_latency (latency, 0, 1000, 50, 0, FALSE);
+  fail_unless_equals_int (latency, 140);
+  latency = kms_jitter_buffer_get_latency (latency, 0, 1000, 50, 0, FALSE);
+  fail_unless_equals_int (latency, 190);
+  latency = kms_jitter_buffer_get_latency (latency, 0, 1000, 50, 0, FALSE);
+  fail_unless_equals_int (latency, 220);
+
+  /* Late packets force growth even when jitter is low */
+  latency = kms_jitter_buffer_get_latency (40, 0, 1000, 5, 0, TRUE);
+  fail_unless_equals_int (latency, 90);
+
+  /* Profile limits */
+  latency = kms_jitter_buffer_get_latency (140, 0, 150, 50, 0, FALSE);
+  fail_unless_equals_int (latency, 150);
+  latency = kms_jitter_buffer_get_latency (100, 95, 1000, 5, 0, FALSE);
+  fail_unless_equals_int (latency, 95);
+
+  /* Room for retransmissions: rtt 100 ms + 20 ms margin */
+  latency = kms_jitter_buffer_get_latency (125, 0, 1000, 5, 100, FALSE);
+  fail_unless_equals_int (latency, 120);
+  latency = kms_jitter_buffer_get_latency (120, 0, 1000, 5, 100, FALSE);
+  fail_unless_equals_int (latency, 120);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+rtp_adaptation_suite (void)
+{
+  Suite *s = suite_create ("rtpadaptation");
+  TCase *tc_chain = tcase_create ("element");
+
+  /* Limit read on first use, in MiB */
+  g_setenv (KMS_RTX_MEMORY_LIMIT_ENV, "1", TRUE);
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, rtx_history_size);
+  tcase_add_test (tc_chain, rtx_history_budget);
+  tcase_add_test (tc_chain, rtx_history_initial_size);
+  tcase_add_test (tc_chain, fec_thresholds);
+  tcase_add_test (tc_chain, jitter_buffer_latency);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtp_adaptation);
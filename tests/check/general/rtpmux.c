@@ -0,0 +1,339 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#include <gst/check/gstcheck.h>
+#include <gio/gio.h>
+#include <glib.h>
+
+#include "kmsrtpmux.h"
+
+/* Two ports chosen by the system */
+#define TEST_PORTS "0-1"
+#define TEST_SSRC 0x12345678
+
+typedef struct _RecvData
+{
+  GMutex mutex;
+  GCond cond;
+  guint rtp;
+  guint rtcp;
+} RecvData;
+
+static void
+recv_cb (GstBuffer * buffer, gboolean is_rtcp, RecvData * data)
+{
+  g_mutex_lock (&data->mutex);
+
+  if (is_rtcp) {
+    data->rtcp++;
+  } else {
+    data->rtp++;
+  }
+
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->mutex);
+
+  gst_buffer_unref (buffer);
+}
+
+static gboolean
+wait_packets (RecvData * data, guint rtp, guint rtcp)
+{
+  gint64 end_time = g_get_monotonic_time () + 2 * G_TIME_SPAN_SECOND;
+  gboolean ret = TRUE;
+
+  g_mutex_lock (&data->mutex);
+
+  while (ret && (data->rtp < rtp || data->rtcp < rtcp)) {
+    ret = g_cond_wait_until (&data->cond, &data->mutex, end_time);
+  }
+
+  g_mutex_unlock (&data->mutex);
+
+  return ret;
+}
+
+static GSocket *
+create_client_socket (void)
+{
+  GInetAddress *inet = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *addr = g_inet_socket_address_new (inet, 0);
+  GSocket *socket;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+  fail_unless (g_socket_bind (socket, addr, FALSE, NULL));
+
+  g_object_unref (addr);
+  g_object_unref (inet);
+
+  return socket;
+}
+
+static void
+send_packet (GSocket * socket, guint port, gboolean rtcp, guint32 ssrc)
+{
+  GInetAddress *inet = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  GSocketAddress *addr = g_inet_socket_address_new (inet, port);
+  guint8 packet[12] = { 0x80, 96, };
+
+  if (rtcp) {
+    /* Receiver report without report blocks */
+    packet[1] = 201;
+    packet[3] = 1;
+    GST_WRITE_UINT32_BE (packet + 4, ssrc);
+  } else {
+    GST_WRITE_UINT32_BE (packet + 8, ssrc);
+  }
+
+  fail_unless (g_socket_send_to (socket, addr, (gchar *) packet,
+          rtcp ? 8 : 12, NULL, NULL) > 0);
+
+  g_object_unref (addr);
+  g_object_unref (inet);
+}
+
+GST_START_TEST (route_by_ssrc)
+{
+  RecvData data = { 0 };
+  GSocket *client, *other;
+  KmsRtpMux *mux;
+  GstStructure *stats;
+  GstBuffer *buffer;
+  gchar reply[16];
+  guint id, port;
+  guint64 dropped;
+
+  g_setenv ("KMS_RTP_MUX_PORTS", TEST_PORTS, TRUE);
+
+  g_mutex_init (&data.mutex);
+  g_cond_init (&data.cond);
+
+  mux = kms_rtp_mux_get ();
+  fail_unless (kms_rtp_mux_get_n_ports (mux) == 2);
+
+  fail_unless (kms_rtp_mux_get_port (mux, 0) != 0);
+  fail_unless (kms_rtp_mux_get_port (mux, 1) != 0);
+  fail_unless (kms_rtp_mux_get_port (mux, 0) != kms_rtp_mux_get_port (mux,
+          1));
+
+  id = kms_rtp_mux_add_route (mux, "127.0.0.1", 0, TEST_SSRC,
+      (KmsRtpMuxRecvFunc) recv_cb, &data, NULL);
+  fail_unless (id != 0);
+
+  /* Already routed SSRC */
+  fail_unless (kms_rtp_mux_add_route (mux, "127.0.0.1", 0, TEST_SSRC,
+          (KmsRtpMuxRecvFunc) recv_cb, &data, NULL) == 0);
+
+  port = kms_rtp_mux_get_route_port (mux, id);
+  fail_unless (port != 0);
+
+  client = create_client_socket ();
+
+  /* No route without a remote host */
+  fail_unless (kms_rtp_mux_add_route (mux, NULL, 0, TEST_SSRC + 3,
+          (KmsRtpMuxRecvFunc) recv_cb, &data, NULL) == 0);
+
+  /* Unknown SSRC is dropped */
+  send_packet (client, port, FALSE, TEST_SSRC + 1);
+  /* RTP by SSRC teaches the route the remote port */
+  send_packet (client, port, FALSE, TEST_SSRC);
+  fail_unless (wait_packets (&data, 1, 0));
+
+  /* RTCP from the learnt address is routed whatever its SSRC */
+  send_packet (client, port, TRUE, TEST_SSRC + 2);
+  fail_unless (wait_packets (&data, 1, 1));
+
+  /* Once learnt, the stream can not be taken from another port */
+  other = create_client_socket ();
+  send_packet (other, port, FALSE, TEST_SSRC);
+  send_packet (client, port, TRUE, TEST_SSRC);
+  fail_unless (wait_packets (&data, 1, 2));
+  g_object_unref (other);
+
+  buffer = gst_buffer_new_wrapped (g_strdup ("reply"), 5);
+  fail_unless (kms_rtp_mux_send (mux, id, buffer));
+  gst_buffer_unref (buffer);
+
+  g_socket_set_timeout (client, 2);
+  fail_unless (g_socket_receive (client, reply, sizeof (reply), NULL,
+          NULL) == 5);
+  fail_unless (memcmp (reply, "reply", 5) == 0);
+
+  stats = kms_rtp_mux_get_stats (mux);
+  fail_unless (gst_structure_get_uint64 (stats, "packets-dropped", &dropped));
+  fail_unless (dropped == 2);
+  gst_structure_free (stats);
+
+  kms_rtp_mux_remove_route (mux, id);
+  kms_rtp_mux_unref (mux);
+
+  g_object_unref (client);
+  g_mutex_clear (&data.mutex);
+  g_cond_clear (&data.cond);
+}
+
+GST_END_TEST;
+
+#define N_SHARDS 4
+#define N_STREAMS 16
+#define N_PACKETS 4
+
+typedef struct _ShardData
+{
+  RecvData recv;
+  /* SSRC -> thread of the shard that received it */
+  GHashTable *threads;
+  gboolean moved;
+} ShardData;
+
+static void
+shard_recv_cb (GstBuffer * buffer, gboolean is_rtcp, ShardData * data)
+{
+  GThread *thread;
+  guint32 ssrc;
+
+  fail_if (is_rtcp);
+  fail_unless (gst_buffer_extract (buffer, 8, &ssrc, 4) == 4);
+  ssrc = GUINT32_FROM_BE (ssrc);
+
+  g_mutex_lock (&data->recv.mutex);
+
+  thread = g_hash_table_lookup (data->threads, GUINT_TO_POINTER (ssrc));
+
+  if (thread == NULL) {
+    g_hash_table_insert (data->threads, GUINT_TO_POINTER (ssrc),
+        g_thread_self ());
+  } else if (thread != g_thread_self ()) {
+    data->moved = TRUE;
+  }
+
+  g_mutex_unlock (&data->recv.mutex);
+
+  recv_cb (buffer, is_rtcp, &data->recv);
+}
+
+static void
+count_thread (gpointer key, GThread * thread, GHashTable * threads)
+{
+  g_hash_table_add (threads, thread);
+}
+
+GST_START_TEST (sharded_port)
+{
+  ShardData data = { {0}, };
+  GSocket *client;
+  KmsRtpMux *mux;
+  GstStructure *stats;
+  guint ids[N_STREAMS];
+  guint i, j, port, shards, steered;
+  guint64 received;
+
+  g_setenv ("KMS_RTP_MUX_PORTS", "0-0", TRUE);
+  g_setenv ("KMS_RTP_MUX_SHARDS", G_STRINGIFY (N_SHARDS), TRUE);
+
+  g_mutex_init (&data.recv.mutex);
+  g_cond_init (&data.recv.cond);
+  data.threads = g_hash_table_new (NULL, NULL);
+
+  mux = kms_rtp_mux_get ();
+  fail_unless (kms_rtp_mux_get_n_ports (mux) == 1);
+  port = kms_rtp_mux_get_port (mux, 0);
+
+  for (i = 0; i < N_STREAMS; i++) {
+    ids[i] = kms_rtp_mux_add_route (mux, "127.0.0.1", 0, TEST_SSRC + i,
+        (KmsRtpMuxRecvFunc) shard_recv_cb, &data, NULL);
+    fail_unless (ids[i] != 0);
+  }
+
+  client = create_client_socket ();
+
+  /* Every stream is delivered whatever shard receives it */
+  for (j = 0; j < N_PACKETS; j++) {
+    for (i = 0; i < N_STREAMS; i++) {
+      send_packet (client, port, FALSE, TEST_SSRC + i);
+    }
+  }
+
+  fail_unless (wait_packets (&data.recv, N_STREAMS * N_PACKETS, 0));
+
+  /* A stream always goes to the same shard */
+  fail_if (data.moved);
+  fail_unless (g_hash_table_size (data.threads) == N_STREAMS);
+
+  stats = kms_rtp_mux_get_stats (mux);
+  GST_DEBUG ("Stats: %" GST_PTR_FORMAT, stats);
+  fail_unless (gst_structure_get_uint (stats, "shards", &shards));
+  fail_unless (shards == N_SHARDS);
+  fail_unless (gst_structure_get_uint64 (stats, "packets-received",
+          &received));
+  fail_unless (received == N_STREAMS * N_PACKETS);
+
+  fail_unless (gst_structure_get_uint (stats, "steered-ports", &steered));
+
+  if (steered == 1) {
+    GHashTable *threads = g_hash_table_new (NULL, NULL);
+
+    /* Steered by SSRC % shards: consecutive SSRCs spread evenly even if */
+    /* they all come from the same remote address                        */
+    for (i = 0; i < N_SHARDS; i++) {
+      gchar *name = g_strdup_printf ("shard-%u-%u", port, i);
+
+      fail_unless (gst_structure_get_uint64 (stats, name, &received));
+      fail_unless_equals_int (received, N_STREAMS * N_PACKETS / N_SHARDS);
+      g_free (name);
+    }
+
+    g_hash_table_foreach (data.threads, (GHFunc) count_thread, threads);
+    fail_unless_equals_int (g_hash_table_size (threads), N_SHARDS);
+    g_hash_table_unref (threads);
+  } else {
+    GST_WARNING ("SSRC steering not attached, shards not checked");
+  }
+
+  gst_structure_free (stats);
+
+  for (i = 0; i < N_STREAMS; i++) {
+    kms_rtp_mux_remove_route (mux, ids[i]);
+  }
+
+  kms_rtp_mux_unref (mux);
+
+  g_object_unref (client);
+  g_hash_table_unref (data.threads);
+  g_mutex_clear (&data.recv.mutex);
+  g_cond_clear (&data.recv.cond);
+}
+
+GST_END_TEST;
+
+/* Suite initialization */
+static Suite *
+rtpmux_suite (void)
+{
+  Suite *s = suite_create ("rtpmux");
+  TCase *tc_chain = tcase_create ("element");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, route_by_ssrc);
+  tcase_add_test (tc_chain, sharded_port);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtpmux);
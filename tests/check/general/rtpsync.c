@@ -20,6 +20,22 @@
 #include <gst/rtp/gstrtcpbuffer.h>
 
 #include <kmsrtpsynchronizer.h>
+#include <kmsrtpsynctrace.h>
+#include <glib/gstdio.h>
+
+#define STATS_RECORD_SIZE 72
+
+static gchar *stats_dir;
+
+static void set_stats_path (void) __attribute__ ((constructor));
+
+static void
+set_stats_path (void)
+{
+  /* Read once, when the first context is created */
+  stats_dir = g_dir_make_tmp ("kms-rtpsync-XXXXXX", NULL);
+  g_setenv ("KMS_RTP_SYNC_STATS_PATH", stats_dir, TRUE);
+}
 
 /* based on rtpjitterbuffer.c */
 static GstBuffer *
@@ -344,6 +360,54 @@ GST_START_TEST (test_interpolate_avoid_negative_pts)
 
 GST_END_TEST;
 
+GST_START_TEST (test_sync_context_stats)
+{
+  KmsRtpSyncContext *ctx;
+  const gchar *name = NULL;
+  gchar *path, *contents;
+  guint32 record_size;
+  guint64 pts;
+  gsize len;
+  GDir *dir;
+  guint i;
+
+  ctx = kms_rtp_sync_context_new ("trace");
+
+  for (i = 0; i < 3; i++) {
+    fail_unless (kms_rtp_sync_context_write_stats (ctx, 1234, 90000, i,
+            i + 1, i + 2, i + 3, 0, 0));
+  }
+
+  /* The file is closed once the records are written */
+  g_object_unref (ctx);
+  kms_rtp_sync_trace_flush ();
+
+  dir = g_dir_open (stats_dir, 0, NULL);
+  fail_if (dir == NULL);
+  name = g_dir_read_name (dir);
+  fail_unless (g_str_has_suffix (name, "_trace.rtpsync"));
+
+  path = g_build_filename (stats_dir, name, NULL);
+  g_dir_close (dir);
+
+  fail_unless (g_file_get_contents (path, &contents, &len, NULL));
+  fail_unless (len == 8 + 3 * STATS_RECORD_SIZE);
+  fail_unless (memcmp (contents, KMS_RTP_SYNC_TRACE_MAGIC, 4) == 0);
+  memcpy (&record_size, contents + 4, sizeof (record_size));
+  fail_unless (record_size == STATS_RECORD_SIZE);
+
+  /* pts of the last record, after entry time, thread, ssrc and clock rate */
+  memcpy (&pts, contents + 8 + 2 * STATS_RECORD_SIZE + 32, sizeof (pts));
+  fail_unless (pts == 3);
+
+  g_free (contents);
+  g_unlink (path);
+  g_free (path);
+  g_rmdir (stats_dir);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpsync_suite (void)
 {
@@ -352,6 +416,7 @@ rtpsync_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_sync_context);
+  tcase_add_test (tc_chain, test_sync_context_stats);
 
   tcase_add_test (tc_chain, test_sync_add_clock_rate_for_pt);
   tcase_add_test (tc_chain, test_sync_one_stream);
@@ -0,0 +1,118 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE GraphDumper
+#include <boost/test/unit_test.hpp>
+#include <GraphDumper.hpp>
+#include <thread>
+
+using namespace kurento;
+
+struct GF {
+  GF();
+};
+
+BOOST_GLOBAL_FIXTURE (GF)
+
+GF::GF()
+{
+  gst_init (NULL, NULL);
+}
+
+BOOST_AUTO_TEST_CASE (error_dedup_test)
+{
+  std::shared_ptr<GraphDumper> dumper = GraphDumper::getGraphDumper ();
+  GstBin *bin = GST_BIN (gst_bin_new ("dedup") );
+  GstBin *other = GST_BIN (gst_bin_new ("dedup-other") );
+  GraphDumper::Limits limits;
+
+  limits.burst = 3;
+  limits.interval = std::chrono::seconds (60);
+
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_CORE_ERROR,
+                                    GST_CORE_ERROR_FAILED, "test", limits) );
+  BOOST_CHECK (!dumper->dumpOnError (bin, GST_CORE_ERROR,
+                                     GST_CORE_ERROR_FAILED, "test", limits) );
+
+  /* Same code in another domain is another error */
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_STREAM_ERROR,
+                                    GST_CORE_ERROR_FAILED, "test", limits) );
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_CORE_ERROR,
+                                    GST_CORE_ERROR_NEGOTIATION, "test", limits) );
+
+  /* Every pipeline has its own dedup and bucket */
+  BOOST_CHECK (dumper->dumpOnError (other, GST_CORE_ERROR,
+                                    GST_CORE_ERROR_FAILED, "test", limits) );
+
+  /* Forgotten pipelines start again */
+  dumper->forget (bin);
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_CORE_ERROR,
+                                    GST_CORE_ERROR_FAILED, "test", limits) );
+
+  dumper->forget (bin);
+  dumper->forget (other);
+  gst_object_unref (bin);
+  gst_object_unref (other);
+}
+
+BOOST_AUTO_TEST_CASE (token_bucket_test)
+{
+  std::shared_ptr<GraphDumper> dumper = GraphDumper::getGraphDumper ();
+  GstBin *bin = GST_BIN (gst_bin_new ("bucket") );
+  GraphDumper::Limits limits;
+  int code;
+
+  limits.burst = 2;
+  limits.interval = std::chrono::seconds (1);
+
+  /* Distinct errors so dedup does not interfere */
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_CORE_ERROR, 1, "test", limits) );
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_CORE_ERROR, 2, "test", limits) );
+  BOOST_CHECK (!dumper->dumpOnError (bin, GST_CORE_ERROR, 3, "test", limits) );
+
+  /* One token is regained per interval */
+  std::this_thread::sleep_for (std::chrono::milliseconds (1100) );
+  BOOST_CHECK (dumper->dumpOnError (bin, GST_CORE_ERROR, 4, "test", limits) );
+  BOOST_CHECK (!dumper->dumpOnError (bin, GST_CORE_ERROR, 5, "test", limits) );
+
+  /* Never more than burst tokens, however long the bucket idles */
+  std::this_thread::sleep_for (std::chrono::milliseconds (3100) );
+
+  for (code = 6; dumper->dumpOnError (bin, GST_CORE_ERROR, code, "test",
+                                      limits); code++) {
+  }
+
+  BOOST_CHECK_EQUAL (code - 6, limits.burst);
+
+  dumper->forget (bin);
+  gst_object_unref (bin);
+}
+
+BOOST_AUTO_TEST_CASE (generate_test)
+{
+  std::shared_ptr<GraphDumper> dumper = GraphDumper::getGraphDumper ();
+  GstBin *bin = GST_BIN (gst_bin_new ("generate") );
+  std::string dot;
+
+  dot = dumper->generate (bin, std::shared_ptr <GstreamerDotDetails>
+                          (new GstreamerDotDetails (GstreamerDotDetails::SHOW_VERBOSE) ) );
+
+  BOOST_CHECK (dot.find ("digraph") != std::string::npos);
+
+  gst_object_unref (bin);
+}
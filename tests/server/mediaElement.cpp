@@ -24,8 +24,13 @@
 #include <MediaType.hpp>
 #include <KurentoException.hpp>
 #include <GstreamerDotDetails.hpp>
+#include <CpuUsage.hpp>
+#include <StatsReport.hpp>
+#include <DotGraph.hpp>
 #include <MediaSet.hpp>
 #include <ModuleManager.hpp>
+#include <atomic>
+#include <thread>
 
 using namespace kurento;
 
@@ -291,6 +296,14 @@ BOOST_AUTO_TEST_CASE (dot_test)
 
   BOOST_CHECK (!dot.empty() );
 
+  Json::Value topology;
+  Json::Reader reader;
+
+  BOOST_REQUIRE (reader.parse (generateJsonGraph (GST_BIN (
+                                 pipe->getPipeline () ) ), topology) );
+  BOOST_CHECK (topology["children"].size() == 2);
+  BOOST_CHECK (topology["children"][0].isMember ("pads") );
+
   releaseMediaObject (sink->getId() );
   releaseMediaObject (src->getId() );
   releaseMediaObject (mediaPipelineId);
@@ -299,3 +312,148 @@ BOOST_AUTO_TEST_CASE (dot_test)
   src.reset();
   pipe.reset();
 }
+
+BOOST_AUTO_TEST_CASE (cpu_usage_test)
+{
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+
+  std::shared_ptr <MediaElementImpl> sink = createDummyElement ("dummysink",
+      mediaPipelineId);
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId);
+  std::shared_ptr <MediaPipelineImpl> pipe = std::dynamic_pointer_cast
+      <MediaPipelineImpl> (MediaSet::getMediaSet()->getMediaObject (
+                             mediaPipelineId) );
+
+  g_object_set (src->getGstreamerElement(), "audio", TRUE, "video", TRUE, NULL);
+  g_object_set (sink->getGstreamerElement(), "audio", TRUE, "video", TRUE, NULL);
+
+  src->connect (sink);
+
+  /* The pipeline is playing, its streaming threads enter once media flows */
+  std::shared_ptr<CpuUsage> usage = pipe->getCpuUsage ();
+
+  for (int i = 0; i < 50 && usage->getThreads () == 0; i++) {
+    std::this_thread::sleep_for (std::chrono::milliseconds (100) );
+    usage = pipe->getCpuUsage ();
+  }
+
+  BOOST_CHECK (usage->getId () == mediaPipelineId);
+  BOOST_REQUIRE (usage->getThreads () > 0);
+
+  /* Time is read with clock tick resolution, give it a few to move */
+  int64_t cpuTime = usage->getCpuTime ();
+
+  for (int i = 0; i < 100 && usage->getCpuTime () <= cpuTime; i++) {
+    std::this_thread::sleep_for (std::chrono::milliseconds (100) );
+    usage = pipe->getCpuUsage ();
+  }
+
+  BOOST_CHECK (usage->getCpuTime () > cpuTime);
+
+  releaseMediaObject (sink->getId() );
+  releaseMediaObject (src->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  sink.reset();
+  src.reset();
+  pipe.reset();
+}
+
+BOOST_AUTO_TEST_CASE (pipeline_stats_test)
+{
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+
+  std::shared_ptr <MediaElementImpl> sink = createDummyElement ("dummysink",
+      mediaPipelineId);
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId);
+  std::shared_ptr <MediaPipelineImpl> pipe = std::dynamic_pointer_cast
+      <MediaPipelineImpl> (MediaSet::getMediaSet()->getMediaObject (
+                             mediaPipelineId) );
+
+  /* Without media flowing, stats only change when the reference moves */
+  pipe->setLatencyStats (true);
+
+  auto all = pipe->getStats ();
+
+  BOOST_REQUIRE (!all.empty () );
+
+  for (auto it : all) {
+    BOOST_CHECK (it.first.find (src->getId () ) == 0
+                 || it.first.find (sink->getId () ) == 0);
+  }
+
+  /* Calls without onlyChanged do not set a reference */
+  BOOST_CHECK (pipe->getStats (true).size () == all.size () );
+
+  BOOST_CHECK (pipe->getStats (true, "client-a").size () == all.size () );
+
+  /* Other callers do not move the reference of client-a */
+  BOOST_CHECK (pipe->getStats (true, "client-b").size () == all.size () );
+  BOOST_CHECK (pipe->getStats (true, "client-b").size () < all.size () );
+  BOOST_CHECK (pipe->getStats (true, "client-a").size () < all.size () );
+
+  /* An unknown reference reports everything */
+  BOOST_CHECK (pipe->getStats (true, "client-c").size () == all.size () );
+
+  releaseMediaObject (sink->getId() );
+  releaseMediaObject (src->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  sink.reset();
+  src.reset();
+  pipe.reset();
+}
+
+BOOST_AUTO_TEST_CASE (stats_subscription_test)
+{
+  std::string mediaPipelineId =
+    moduleManager.getFactory ("MediaPipeline")->createObject (
+      config, "",
+      Json::Value() )->getId();
+
+  std::shared_ptr <MediaElementImpl> src = createDummyElement ("dummysrc",
+      mediaPipelineId);
+  std::shared_ptr <MediaPipelineImpl> pipe = std::dynamic_pointer_cast
+      <MediaPipelineImpl> (MediaSet::getMediaSet()->getMediaObject (
+                             mediaPipelineId) );
+  std::atomic<int> reports (0);
+  std::string subscriptionId;
+
+  pipe->signalStatsReport.connect ([&] (StatsReport event) {
+    BOOST_CHECK (event.getSubscriptionId () == subscriptionId);
+    reports++;
+  });
+
+  subscriptionId = pipe->subscribeStats (100);
+
+  for (int i = 0; i < 50 && reports < 2; i++) {
+    std::this_thread::sleep_for (std::chrono::milliseconds (100) );
+  }
+
+  BOOST_CHECK (reports >= 2);
+
+  /* Only the object that created the subscription can cancel it */
+  BOOST_CHECK_THROW (src->unsubscribeStats (subscriptionId),
+                     KurentoException);
+  BOOST_CHECK_THROW (pipe->unsubscribeStats ("unknown"), KurentoException);
+
+  /* Scheduling itself is covered by test_stats_scheduler */
+  pipe->unsubscribeStats (subscriptionId);
+
+  BOOST_CHECK_THROW (pipe->unsubscribeStats (subscriptionId),
+                     KurentoException);
+
+  releaseMediaObject (src->getId() );
+  releaseMediaObject (mediaPipelineId);
+
+  src.reset();
+  pipe.reset();
+}
@@ -0,0 +1,160 @@
+/*
+ * (C) Copyright 2016 Kurento (http://kurento.org/)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE StatsScheduler
+#include <boost/test/unit_test.hpp>
+#include <gst/gst.h>
+#include <StatsScheduler.hpp>
+
+using namespace kurento;
+
+struct GF {
+  GF();
+};
+
+BOOST_GLOBAL_FIXTURE (GF)
+
+GF::GF()
+{
+  gst_init (NULL, NULL);
+}
+
+/* Time only moves when the test says so */
+struct FakeClock {
+  std::chrono::steady_clock::time_point now;
+
+  StatsScheduler::Clock get ()
+  {
+    return [this] () {
+      return now;
+    };
+  }
+
+  void advance (int ms)
+  {
+    now += std::chrono::milliseconds (ms);
+  }
+};
+
+BOOST_AUTO_TEST_CASE (interval_test)
+{
+  FakeClock clock;
+  StatsScheduler scheduler (clock.get () );
+  std::set<StatsType::type> types;
+  int source, samples = 0, reports = 0;
+
+  scheduler.subscribe (&source, [&] (StatsScheduler::StatsMap &) {
+    samples++;
+    return true;
+  }, [&] (const std::string &, const StatsScheduler::StatsMap &) {
+    reports++;
+  }, 200, types);
+
+  clock.advance (199);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 0);
+
+  clock.advance (1);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 1);
+
+  /* Late ticks do not try to catch up */
+  clock.advance (1000);
+  scheduler.dispatch ();
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 2);
+
+  clock.advance (200);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 3);
+  BOOST_CHECK_EQUAL (samples, reports);
+
+  scheduler.unsubscribeAll (&source);
+}
+
+BOOST_AUTO_TEST_CASE (shared_sample_test)
+{
+  FakeClock clock;
+  StatsScheduler scheduler (clock.get () );
+  std::set<StatsType::type> types;
+  int source, samples = 0, reports = 0;
+  auto sampler = [&] (StatsScheduler::StatsMap &) {
+    samples++;
+    return true;
+  };
+  auto notifier = [&] (const std::string &, const StatsScheduler::StatsMap &) {
+    reports++;
+  };
+
+  scheduler.subscribe (&source, sampler, notifier, 100, types);
+  scheduler.subscribe (&source, sampler, notifier, 100, types);
+
+  /* One sample per source and tick for all its subscriptions */
+  clock.advance (100);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (samples, 1);
+  BOOST_CHECK_EQUAL (reports, 2);
+
+  scheduler.unsubscribeAll (&source);
+
+  clock.advance (100);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 2);
+}
+
+BOOST_AUTO_TEST_CASE (unsubscribe_test)
+{
+  FakeClock clock;
+  StatsScheduler scheduler (clock.get () );
+  std::set<StatsType::type> types;
+  int source, other, reports = 0;
+  bool alive = true;
+  std::string id;
+
+  id = scheduler.subscribe (&source, [] (StatsScheduler::StatsMap &) {
+    return true;
+  }, [&] (const std::string & subscriptionId,
+  const StatsScheduler::StatsMap &) {
+    reports++;
+    /* Notifiers run unlocked, they can use the scheduler */
+    BOOST_CHECK (scheduler.unsubscribe (&source, subscriptionId) );
+  }, 100, types);
+
+  /* Only the source can cancel its subscriptions */
+  BOOST_CHECK (!scheduler.unsubscribe (&other, id) );
+
+  clock.advance (100);
+  scheduler.dispatch ();
+  clock.advance (100);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 1);
+  BOOST_CHECK (!scheduler.unsubscribe (&source, id) );
+
+  /* Subscriptions of sources that are gone are dropped */
+  id = scheduler.subscribe (&source, [&] (StatsScheduler::StatsMap &) {
+    return alive;
+  }, [&] (const std::string &, const StatsScheduler::StatsMap &) {
+    reports++;
+  }, 100, types);
+
+  alive = false;
+  clock.advance (100);
+  scheduler.dispatch ();
+  BOOST_CHECK_EQUAL (reports, 1);
+  BOOST_CHECK (!scheduler.unsubscribe (&source, id) );
+}